@@ -0,0 +1,1002 @@
+/*
+ * Copyright (c) 2013 Mellanox Technologies®. All rights reserved.
+ *
+ * This software is available to you under a choice of one of two licenses.
+ * You may choose to be licensed under the terms of the GNU General Public
+ * License (GPL) Version 2, available from the file COPYING in the main
+ * directory of this source tree, or the Mellanox Technologies® BSD license
+ * below:
+ *
+ *      - Redistribution and use in source and binary forms, with or without
+ *        modification, are permitted provided that the following conditions
+ *        are met:
+ *
+ *      - Redistributions of source code must retain the above copyright
+ *        notice, this list of conditions and the following disclaimer.
+ *
+ *      - Redistributions in binary form must reproduce the above
+ *        copyright notice, this list of conditions and the following
+ *        disclaimer in the documentation and/or other materials
+ *        provided with the distribution.
+ *
+ *      - Neither the name of the Mellanox Technologies® nor the names of its
+ *        contributors may be used to endorse or promote products derived from
+ *        this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+#include <unistd.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <inttypes.h>
+#include <string.h>
+#include <getopt.h>
+#include <time.h>
+#include <errno.h>
+#include <sched.h>
+#include <signal.h>
+#include <malloc.h>
+#include <pthread.h>
+#include <sys/types.h>
+#include <sys/wait.h>
+
+#include "libxio.h"
+
+/*
+ * connection scale benchmark. for every step of N the client opens N
+ * sessions of one connection each, spread over M contexts, against a
+ * server running M worker contexts and reports per step:
+ *  - connection setup rate and setup latency percentiles. all connects of
+ *    a step are issued at once, as a restarting client fleet would
+ *  - resident and pinned memory per connection, client and server
+ *  - request rate in steady state with every connection busy
+ *  - the time to tear all N down
+ * the contexts live for the whole run and the sessions are torn down
+ * between steps, so the memory deltas hold the connections alone.
+ * the server is spawned locally unless -x points at one started with -S.
+ * without an HCA soft RoCE serves, e.g.
+ *	rdma link add rxe0 type rxe netdev eth0
+ * and the address of eth0 as host
+ */
+
+#define XIO_DEF_ADDRESS		"127.0.0.1"
+#define XIO_DEF_PORT		2061
+#define XIO_DEF_STEPS		"16:1024"
+#define XIO_DEF_CTXS		1
+#define XIO_DEF_DEPTH		1
+#define XIO_DEF_DATA_SIZE	64
+#define XIO_DEF_DURATION	2
+#define XIO_TEST_VERSION	"1.0.0"
+
+#define MAX_DATA_SIZE		4096
+#define MAX_STEPS		32
+#define MAX_CTXS		64
+#define NSECS_IN_USEC		1000ULL
+#define NSECS_IN_MSEC		1000000ULL
+#define NSECS_IN_SEC		1000000000ULL
+
+struct xio_test_config {
+	char			server_addr[64];
+	int			steps[MAX_STEPS];
+	int			steps_nr;
+	int			ctxs;
+	int			depth;
+	int			data_len;
+	int			duration;
+	int			server;		/* serve only */
+	int			external;	/* do not spawn a server */
+	int			ready_fd;	/* spawned server is bound */
+	uint16_t		server_port;
+	uint16_t		pad;
+};
+
+enum conn_state {
+	CONN_PENDING,
+	CONN_UP,
+	CONN_FAILED
+};
+
+struct worker_data;
+
+struct conn_data {
+	struct xio_session	*session;
+	struct xio_connection	*conn;
+	struct worker_data	*wdata;
+	struct xio_msg		*msgs;		/* depth requests */
+	uint64_t		start;
+	enum conn_state		state;
+	int			pad;
+};
+
+struct worker_data {
+	struct xio_context	*ctx;
+	struct conn_data	*conns;
+	uint64_t		*setup_ns;	/* slice of the step's array */
+	uint64_t		responses;
+	pthread_t		thread_id;
+	int			idx;
+	int			conns_nr;
+	int			pending;	/* connects not resolved */
+	int			alive;		/* sessions not torn down */
+	int			setup_nr;
+	int			failed;
+	int			sending;
+	int			tearing;
+};
+
+struct mem_sample {
+	long			rss_kb;
+	long			pin_kb;
+};
+
+/*---------------------------------------------------------------------------*/
+/* globals								     */
+/*---------------------------------------------------------------------------*/
+static struct xio_test_config  test_config = {
+	.server_addr	= XIO_DEF_ADDRESS,
+	.ctxs		= XIO_DEF_CTXS,
+	.depth		= XIO_DEF_DEPTH,
+	.data_len	= XIO_DEF_DATA_SIZE,
+	.duration	= XIO_DEF_DURATION,
+	.ready_fd	= -1,
+	.server_port	= XIO_DEF_PORT,
+};
+
+static struct worker_data	wdata[MAX_CTXS];
+static pthread_barrier_t	barrier;
+static struct xio_server	*server;
+static volatile int		step_conns;	/* 0 ends the run */
+static char			url[128];
+static char			data_buf[MAX_DATA_SIZE];
+
+/* responses are recycled on the worker that sent them */
+static __thread struct xio_msg	*rsp_free_list;
+
+/*---------------------------------------------------------------------------*/
+/* now_ns								     */
+/*---------------------------------------------------------------------------*/
+static uint64_t now_ns(void)
+{
+	struct timespec ts;
+
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return ts.tv_sec * NSECS_IN_SEC + ts.tv_nsec;
+}
+
+/*---------------------------------------------------------------------------*/
+/* mem_sample_read							     */
+/*---------------------------------------------------------------------------*/
+static void mem_sample_read(pid_t pid, struct mem_sample *sample)
+{
+	char	path[64];
+	char	line[256];
+	FILE	*fp;
+
+	sample->rss_kb = 0;
+	sample->pin_kb = 0;
+	if (pid <= 0)
+		return;
+
+	snprintf(path, sizeof(path), "/proc/%d/status", (int)pid);
+	fp = fopen(path, "r");
+	if (fp == NULL)
+		return;
+	/* VmPin counts the pages pinned by memory registration */
+	while (fgets(line, sizeof(line), fp)) {
+		if (strncmp(line, "VmRSS:", 6) == 0)
+			sample->rss_kb = strtol(line + 6, NULL, 10);
+		else if (strncmp(line, "VmPin:", 6) == 0)
+			sample->pin_kb = strtol(line + 6, NULL, 10);
+	}
+	fclose(fp);
+}
+
+/*---------------------------------------------------------------------------*/
+/* cmp_u64								     */
+/*---------------------------------------------------------------------------*/
+static int cmp_u64(const void *a, const void *b)
+{
+	uint64_t x = *(const uint64_t *)a;
+	uint64_t y = *(const uint64_t *)b;
+
+	return (x > y) - (x < y);
+}
+
+/*---------------------------------------------------------------------------*/
+/* percentile_us							     */
+/*---------------------------------------------------------------------------*/
+static double percentile_us(const uint64_t *sorted, int nr, double p)
+{
+	if (nr == 0)
+		return 0;
+
+	return (double)sorted[(int)((nr - 1) * p)] / NSECS_IN_USEC;
+}
+
+/*---------------------------------------------------------------------------*/
+/* request_init								     */
+/*---------------------------------------------------------------------------*/
+static void request_init(struct xio_msg *msg)
+{
+	memset(msg, 0, sizeof(*msg));
+	if (test_config.data_len) {
+		msg->out.data_iovlen		= 1;
+		msg->out.data_iov[0].iov_base	= data_buf;
+		msg->out.data_iov[0].iov_len	= test_config.data_len;
+	}
+}
+
+/*---------------------------------------------------------------------------*/
+/* conn_resolved							     */
+/*---------------------------------------------------------------------------*/
+static void conn_resolved(struct conn_data *cdata, enum conn_state state)
+{
+	struct worker_data *wd = cdata->wdata;
+
+	if (cdata->state != CONN_PENDING)
+		return;
+
+	cdata->state = state;
+	if (state == CONN_UP)
+		wd->setup_ns[wd->setup_nr++] = now_ns() - cdata->start;
+	else
+		wd->failed++;
+
+	if (--wd->pending == 0)
+		xio_context_stop_loop(wd->ctx, 1);
+}
+
+/*---------------------------------------------------------------------------*/
+/* on_session_event							     */
+/*---------------------------------------------------------------------------*/
+static int on_session_event(struct xio_session *session,
+		struct xio_session_event_data *event_data,
+		void *cb_user_context)
+{
+	struct conn_data	*cdata = cb_user_context;
+	struct worker_data	*wd = cdata->wdata;
+
+	switch (event_data->event) {
+	case XIO_SESSION_REJECT_EVENT:
+	case XIO_SESSION_CONNECTION_REFUSED_EVENT:
+	case XIO_SESSION_CONNECTION_ERROR_EVENT:
+		if (cdata->state == CONN_PENDING)
+			fprintf(stderr, "connect failed. reason: %s\n",
+				xio_strerror(event_data->reason));
+		conn_resolved(cdata, CONN_FAILED);
+		break;
+	case XIO_SESSION_CONNECTION_TEARDOWN_EVENT:
+		conn_resolved(cdata, CONN_FAILED);
+		xio_connection_destroy(event_data->conn);
+		cdata->conn = NULL;
+		break;
+	case XIO_SESSION_TEARDOWN_EVENT:
+		xio_session_destroy(session);
+		cdata->session = NULL;
+		if (--wd->alive == 0 && wd->tearing)
+			xio_context_stop_loop(wd->ctx, 1);
+		break;
+	default:
+		break;
+	};
+
+	return 0;
+}
+
+/*---------------------------------------------------------------------------*/
+/* on_session_established						     */
+/*---------------------------------------------------------------------------*/
+static int on_session_established(struct xio_session *session,
+			struct xio_new_session_rsp *rsp,
+			void *cb_user_context)
+{
+	conn_resolved(cb_user_context, CONN_UP);
+
+	return 0;
+}
+
+/*---------------------------------------------------------------------------*/
+/* on_response								     */
+/*---------------------------------------------------------------------------*/
+static int on_response(struct xio_session *session,
+			struct xio_msg *msg,
+			int more_in_batch,
+			void *cb_user_context)
+{
+	struct conn_data	*cdata = cb_user_context;
+	struct worker_data	*wd = cdata->wdata;
+
+	xio_release_response(msg);
+	if (!wd->sending)
+		return 0;
+
+	wd->responses++;
+	request_init(msg);
+	if (xio_send_request(cdata->conn, msg) == -1 &&
+	    xio_errno() != EAGAIN)
+		fprintf(stderr, "**** [%p] Error - xio_send_request " \
+			"failed. %s\n", session, xio_strerror(xio_errno()));
+
+	return 0;
+}
+
+/*---------------------------------------------------------------------------*/
+/* on_request_error							     */
+/*---------------------------------------------------------------------------*/
+static int on_request_error(struct xio_session *session,
+			enum xio_status error, struct xio_msg  *msg,
+			void *cb_user_context)
+{
+	/* flushed by the teardown, the request stays with its connection */
+	return 0;
+}
+
+static struct xio_session_ops client_ops = {
+	.on_session_event		=  on_session_event,
+	.on_session_established		=  on_session_established,
+	.on_msg				=  on_response,
+	.on_msg_error			=  on_request_error
+};
+
+/*---------------------------------------------------------------------------*/
+/* worker_setup								     */
+/*---------------------------------------------------------------------------*/
+static void worker_setup(struct worker_data *wd)
+{
+	struct xio_session_attr	attr = { &client_ops, NULL, 0 };
+	struct conn_data	*cdata;
+	int			i;
+
+	wd->pending	= 0;
+	wd->alive	= 0;
+	wd->setup_nr	= 0;
+	wd->failed	= 0;
+	wd->tearing	= 0;
+
+	for (i = 0; i < wd->conns_nr; i++) {
+		cdata = &wd->conns[i];
+		cdata->start = now_ns();
+		cdata->session = xio_session_create(XIO_SESSION_CLIENT,
+						    &attr, url, 0, 0, cdata);
+		if (cdata->session == NULL) {
+			cdata->state = CONN_FAILED;
+			wd->failed++;
+			continue;
+		}
+		wd->alive++;
+		wd->pending++;
+		cdata->conn = xio_connect(cdata->session, wd->ctx, 0, NULL,
+					  cdata);
+		if (cdata->conn == NULL) {
+			fprintf(stderr, "connect failed. reason: %s\n",
+				xio_strerror(xio_errno()));
+			xio_session_destroy(cdata->session);
+			cdata->session = NULL;
+			cdata->state = CONN_FAILED;
+			wd->failed++;
+			wd->pending--;
+			wd->alive--;
+		}
+	}
+
+	if (wd->pending)
+		xio_context_run_loop(wd->ctx, XIO_INFINITE);
+}
+
+/*---------------------------------------------------------------------------*/
+/* worker_run								     */
+/*---------------------------------------------------------------------------*/
+static void worker_run(struct worker_data *wd)
+{
+	struct conn_data	*cdata;
+	int			i, j;
+
+	wd->responses	= 0;
+	wd->sending	= 1;
+	for (i = 0; i < wd->conns_nr; i++) {
+		cdata = &wd->conns[i];
+		if (cdata->state != CONN_UP)
+			continue;
+		for (j = 0; j < test_config.depth; j++) {
+			if (xio_send_request(cdata->conn,
+					     &cdata->msgs[j]) == -1)
+				break;
+		}
+	}
+
+	/* the main thread stops the loop when the duration is up */
+	xio_context_run_loop(wd->ctx, XIO_INFINITE);
+	wd->sending = 0;
+}
+
+/*---------------------------------------------------------------------------*/
+/* worker_teardown							     */
+/*---------------------------------------------------------------------------*/
+static void worker_teardown(struct worker_data *wd)
+{
+	int i;
+
+	wd->tearing = 1;
+	for (i = 0; i < wd->conns_nr; i++) {
+		if (wd->conns[i].state == CONN_UP && wd->conns[i].conn)
+			xio_disconnect(wd->conns[i].conn);
+	}
+	if (wd->alive)
+		xio_context_run_loop(wd->ctx, XIO_INFINITE);
+}
+
+/*---------------------------------------------------------------------------*/
+/* worker_thread							     */
+/*---------------------------------------------------------------------------*/
+static void *worker_thread(void *data)
+{
+	struct worker_data	*wd = data;
+	cpu_set_t		cpuset;
+
+	CPU_ZERO(&cpuset);
+	CPU_SET(wd->idx % sysconf(_SC_NPROCESSORS_ONLN), &cpuset);
+	pthread_setaffinity_np(wd->thread_id, sizeof(cpu_set_t), &cpuset);
+
+	wd->ctx = xio_context_create(NULL, 0);
+	if (wd->ctx == NULL) {
+		fprintf(stderr, "context creation failed. reason %s\n",
+			xio_strerror(xio_errno()));
+		exit(1);
+	}
+
+	while (1) {
+		pthread_barrier_wait(&barrier);		/* step posted */
+		if (step_conns == 0)
+			break;
+		worker_setup(wd);
+		pthread_barrier_wait(&barrier);		/* all set up */
+		pthread_barrier_wait(&barrier);		/* memory taken */
+		worker_run(wd);
+		pthread_barrier_wait(&barrier);		/* rate taken */
+		worker_teardown(wd);
+		pthread_barrier_wait(&barrier);		/* all torn down */
+	}
+
+	xio_context_destroy(wd->ctx);
+
+	return NULL;
+}
+
+/*---------------------------------------------------------------------------*/
+/* server side								     */
+/*---------------------------------------------------------------------------*/
+static int on_new_session(struct xio_session *session,
+			struct xio_new_session_req *req,
+			void *cb_user_context)
+{
+	xio_accept(session, NULL, 0, NULL, 0);
+
+	return 0;
+}
+
+static int on_server_session_event(struct xio_session *session,
+		struct xio_session_event_data *event_data,
+		void *cb_user_context)
+{
+	switch (event_data->event) {
+	case XIO_SESSION_CONNECTION_TEARDOWN_EVENT:
+		xio_connection_destroy(event_data->conn);
+		break;
+	case XIO_SESSION_TEARDOWN_EVENT:
+		xio_session_destroy(session);
+		break;
+	default:
+		break;
+	};
+
+	return 0;
+}
+
+static void rsp_put(struct xio_msg *rsp)
+{
+	rsp->user_context = rsp_free_list;
+	rsp_free_list = rsp;
+}
+
+static int on_request(struct xio_session *session,
+			struct xio_msg *req,
+			int more_in_batch,
+			void *cb_user_context)
+{
+	struct xio_msg *rsp = rsp_free_list;
+
+	if (rsp)
+		rsp_free_list = rsp->user_context;
+	else
+		rsp = malloc(sizeof(*rsp));
+	if (rsp == NULL)
+		return 0;
+
+	/* an empty response, the benchmark is about the connections */
+	memset(rsp, 0, sizeof(*rsp));
+	rsp->request = req;
+
+	if (xio_send_response(rsp) == -1) {
+		fprintf(stderr, "**** [%p] Error - xio_send_response " \
+			"failed. %s\n", session, xio_strerror(xio_errno()));
+		rsp_put(rsp);
+	}
+
+	return 0;
+}
+
+static int on_response_comp(struct xio_session *session,
+			struct xio_msg *rsp,
+			void *cb_user_context)
+{
+	rsp_put(rsp);
+
+	return 0;
+}
+
+static int on_response_error(struct xio_session *session,
+			enum xio_status error, struct xio_msg  *rsp,
+			void *cb_user_context)
+{
+	rsp_put(rsp);
+
+	return 0;
+}
+
+static struct xio_session_ops server_ops = {
+	.on_session_event		=  on_server_session_event,
+	.on_new_session			=  on_new_session,
+	.on_msg_send_complete		=  on_response_comp,
+	.on_msg				=  on_request,
+	.on_msg_error			=  on_response_error
+};
+
+/*---------------------------------------------------------------------------*/
+/* server_worker_thread							     */
+/*---------------------------------------------------------------------------*/
+static void *server_worker_thread(void *data)
+{
+	struct worker_data	*wd = data;
+	cpu_set_t		cpuset;
+
+	CPU_ZERO(&cpuset);
+	CPU_SET(wd->idx % sysconf(_SC_NPROCESSORS_ONLN), &cpuset);
+	pthread_setaffinity_np(wd->thread_id, sizeof(cpu_set_t), &cpuset);
+
+	wd->ctx = xio_context_create(NULL, 0);
+	if (wd->ctx == NULL || xio_bind_worker(server, wd->ctx)) {
+		fprintf(stderr, "server worker failed. reason %s\n",
+			xio_strerror(xio_errno()));
+		exit(1);
+	}
+	pthread_barrier_wait(&barrier);
+
+	xio_context_run_loop(wd->ctx, XIO_INFINITE);
+
+	return NULL;
+}
+
+/*---------------------------------------------------------------------------*/
+/* run_server								     */
+/*---------------------------------------------------------------------------*/
+static int run_server(void)
+{
+	struct xio_context	*ctx;
+	char			c = 0;
+	int			i;
+
+	ctx = xio_context_create(NULL, 0);
+	if (ctx == NULL)
+		return -1;
+
+	/* connection requests arrive here and run on the workers */
+	server = xio_bind(ctx, &server_ops, url, NULL, 0, NULL);
+	if (server == NULL) {
+		fprintf(stderr, "bind to %s failed. reason %s\n", url,
+			xio_strerror(xio_errno()));
+		xio_context_destroy(ctx);
+		return -1;
+	}
+
+	pthread_barrier_init(&barrier, NULL, test_config.ctxs + 1);
+	for (i = 0; i < test_config.ctxs; i++) {
+		wdata[i].idx = i + 1;
+		pthread_create(&wdata[i].thread_id, NULL,
+			       server_worker_thread, &wdata[i]);
+	}
+	pthread_barrier_wait(&barrier);
+
+	if (test_config.ready_fd >= 0) {
+		if (write(test_config.ready_fd, &c, 1) != 1)
+			return -1;
+		close(test_config.ready_fd);
+	} else {
+		printf("listening on %s with %d workers\n", url,
+		       test_config.ctxs);
+	}
+
+	/* runs until the client kills it */
+	xio_context_run_loop(ctx, XIO_INFINITE);
+
+	return 0;
+}
+
+/*---------------------------------------------------------------------------*/
+/* spawn_server								     */
+/*---------------------------------------------------------------------------*/
+static pid_t spawn_server(const char *argv0)
+{
+	char	port[16], ctxs[16], fd[16];
+	int	fds[2];
+	pid_t	pid;
+	char	c;
+
+	if (pipe(fds) != 0)
+		return -1;
+
+	pid = fork();
+	if (pid == 0) {
+		close(fds[0]);
+		snprintf(port, sizeof(port), "%u", test_config.server_port);
+		snprintf(ctxs, sizeof(ctxs), "%d", test_config.ctxs);
+		snprintf(fd, sizeof(fd), "%d", fds[1]);
+		execl("/proc/self/exe", argv0, "-S", "-p", port, "-m", ctxs,
+		      "-R", fd, test_config.server_addr, (char *)NULL);
+		_exit(127);
+	}
+	close(fds[1]);
+
+	/* wait until the server is bound */
+	if (pid < 0 || read(fds[0], &c, 1) != 1) {
+		fprintf(stderr, "failed to start the server\n");
+		if (pid > 0)
+			waitpid(pid, NULL, 0);
+		pid = -1;
+	}
+	close(fds[0]);
+
+	return pid;
+}
+
+/*---------------------------------------------------------------------------*/
+/* run_step								     */
+/*---------------------------------------------------------------------------*/
+static void run_step(int conns, pid_t server_pid, uint64_t *setup_ns)
+{
+	struct mem_sample	cli0, cli1, srv0, srv1;
+	struct timespec		ts;
+	struct worker_data	*wd;
+	uint64_t		t0, t1, t2, t3, t4, t5;
+	uint64_t		responses = 0;
+	int			up = 0, failed = 0;
+	int			i, j, off = 0;
+	double			div;
+
+	/* the requests are in place before the baseline is taken */
+	for (i = 0; i < test_config.ctxs; i++) {
+		wd = &wdata[i];
+		wd->conns_nr = conns / test_config.ctxs +
+			       (i < conns % test_config.ctxs);
+		wd->conns = calloc(wd->conns_nr, sizeof(*wd->conns));
+		wd->setup_ns = setup_ns + off;
+		off += wd->conns_nr;
+		for (j = 0; j < wd->conns_nr; j++) {
+			wd->conns[j].wdata = wd;
+			wd->conns[j].state = CONN_PENDING;
+			wd->conns[j].msgs = calloc(test_config.depth,
+						   sizeof(struct xio_msg));
+		}
+		for (j = 0; j < wd->conns_nr * test_config.depth; j++)
+			request_init(&wd->conns[j / test_config.depth].msgs[
+					j % test_config.depth]);
+	}
+	malloc_trim(0);
+	mem_sample_read(getpid(), &cli0);
+	mem_sample_read(server_pid, &srv0);
+
+	step_conns = conns;
+	t0 = now_ns();
+	pthread_barrier_wait(&barrier);		/* step posted */
+	pthread_barrier_wait(&barrier);		/* all set up */
+	t1 = now_ns();
+	mem_sample_read(getpid(), &cli1);
+	mem_sample_read(server_pid, &srv1);
+	pthread_barrier_wait(&barrier);		/* memory taken */
+
+	t2 = now_ns();
+	ts.tv_sec = test_config.duration;
+	ts.tv_nsec = 0;
+	nanosleep(&ts, NULL);
+	for (i = 0; i < test_config.ctxs; i++)
+		xio_context_stop_loop(wdata[i].ctx, 0);
+	t3 = now_ns();
+	pthread_barrier_wait(&barrier);		/* rate taken */
+	t4 = now_ns();
+	pthread_barrier_wait(&barrier);		/* all torn down */
+	t5 = now_ns();
+
+	/* gather the latencies of the connections that came up */
+	off = 0;
+	for (i = 0; i < test_config.ctxs; i++) {
+		wd = &wdata[i];
+		memmove(setup_ns + off, wd->setup_ns,
+			wd->setup_nr * sizeof(uint64_t));
+		off += wd->setup_nr;
+		up += wd->setup_nr;
+		failed += wd->failed;
+		responses += wd->responses;
+		for (j = 0; j < wd->conns_nr; j++)
+			free(wd->conns[j].msgs);
+		free(wd->conns);
+		wd->conns = NULL;
+	}
+	qsort(setup_ns, up, sizeof(uint64_t), cmp_u64);
+
+	div = up ? up : 1;
+	printf("%7d %4d %6d %9.0f %8.1f %8.1f %8.1f " \
+	       "%8.2f %8.2f %8.2f %8.2f %11.0f %9.1f\n",
+	       conns, test_config.ctxs, failed,
+	       (double)up * NSECS_IN_SEC / (t1 - t0),
+	       percentile_us(setup_ns, up, 0.5),
+	       percentile_us(setup_ns, up, 0.99),
+	       percentile_us(setup_ns, up, 1),
+	       (cli1.rss_kb - cli0.rss_kb) / div,
+	       (cli1.pin_kb - cli0.pin_kb) / div,
+	       (srv1.rss_kb - srv0.rss_kb) / div,
+	       (srv1.pin_kb - srv0.pin_kb) / div,
+	       (double)responses * NSECS_IN_SEC / (t3 - t2),
+	       (double)(t5 - t4) / NSECS_IN_MSEC);
+	fflush(stdout);
+}
+
+/*---------------------------------------------------------------------------*/
+/* usage                                                                     */
+/*---------------------------------------------------------------------------*/
+static void usage(const char *argv0, int status)
+{
+	printf("Usage:\n");
+	printf("  %s [OPTIONS] [host]\tOpen connections to <host>\n", argv0);
+	printf("\n");
+	printf("Options:\n");
+
+	printf("\t-p, --port=<port> ");
+	printf("\t\tConnect to port <port> (default %d)\n",
+	       XIO_DEF_PORT);
+
+	printf("\t-n, --conns=<list> ");
+	printf("\t\tConnections per step, a list n1,n2,.. or a range " \
+	       "min:max\n\t\t\t\t\tdoubling per step (default %s)\n",
+	       XIO_DEF_STEPS);
+
+	printf("\t-m, --contexts=<number> ");
+	printf("\tContexts on each side (default %d, max %d)\n",
+	       XIO_DEF_CTXS, MAX_CTXS);
+
+	printf("\t-q, --queue-depth=<number> ");
+	printf("\tRequests in flight per connection (default %d)\n",
+	       XIO_DEF_DEPTH);
+
+	printf("\t-w, --data-len=<length> ");
+	printf("\tRequest data length in bytes (default %d, max %d)\n",
+	       XIO_DEF_DATA_SIZE, MAX_DATA_SIZE);
+
+	printf("\t-t, --time=<seconds> ");
+	printf("\t\tSteady state duration per step (default %d)\n",
+	       XIO_DEF_DURATION);
+
+	printf("\t-x, --external ");
+	printf("\t\tUse a server already running on <host>\n");
+
+	printf("\t-S, --server ");
+	printf("\t\t\tServe on <host> only\n");
+
+	printf("\t-v, --version ");
+	printf("\t\t\tPrint the version and exit\n");
+
+	printf("\t-h, --help ");
+	printf("\t\t\tDisplay this help and exit\n");
+
+	exit(status);
+}
+
+/*---------------------------------------------------------------------------*/
+/* parse_steps								     */
+/*---------------------------------------------------------------------------*/
+static int parse_steps(struct xio_test_config *test_config, const char *str)
+{
+	char	*end;
+	long	n, max;
+
+	test_config->steps_nr = 0;
+	n = strtol(str, &end, 0);
+	if (*end == ':') {
+		max = strtol(end + 1, &end, 0);
+		if (n < 1 || max < n || *end)
+			return -1;
+		for (; n <= max && test_config->steps_nr < MAX_STEPS; n *= 2)
+			test_config->steps[test_config->steps_nr++] = n;
+		return 0;
+	}
+	while (1) {
+		if (n < 1 || (*end && *end != ',') ||
+		    test_config->steps_nr == MAX_STEPS)
+			return -1;
+		test_config->steps[test_config->steps_nr++] = n;
+		if (*end == 0)
+			return 0;
+		n = strtol(end + 1, &end, 0);
+	}
+}
+
+/*---------------------------------------------------------------------------*/
+/* parse_cmdline							     */
+/*---------------------------------------------------------------------------*/
+static int parse_cmdline(struct xio_test_config *test_config,
+			 int argc, char **argv)
+{
+	const char *steps = XIO_DEF_STEPS;
+
+	while (1) {
+		int c;
+
+		static struct option const long_options[] = {
+			{ .name = "port",	 .has_arg = 1, .val = 'p'},
+			{ .name = "conns",	 .has_arg = 1, .val = 'n'},
+			{ .name = "contexts",	 .has_arg = 1, .val = 'm'},
+			{ .name = "queue-depth", .has_arg = 1, .val = 'q'},
+			{ .name = "data-len",	 .has_arg = 1, .val = 'w'},
+			{ .name = "time",	 .has_arg = 1, .val = 't'},
+			{ .name = "external",	 .has_arg = 0, .val = 'x'},
+			{ .name = "server",	 .has_arg = 0, .val = 'S'},
+			{ .name = "version",	 .has_arg = 0, .val = 'v'},
+			{ .name = "help",	 .has_arg = 0, .val = 'h'},
+			{0, 0, 0, 0},
+		};
+
+		/* -R is internal, the spawned server reports on that fd */
+		static char *short_options = "p:n:m:q:w:t:xSR:vh";
+
+		c = getopt_long(argc, argv, short_options,
+				long_options, NULL);
+		if (c == -1)
+			break;
+
+		switch (c) {
+		case 'p':
+			test_config->server_port =
+				(uint16_t)strtol(optarg, NULL, 0);
+			break;
+		case 'n':
+			steps = optarg;
+			break;
+		case 'm':
+			test_config->ctxs = (int)strtol(optarg, NULL, 0);
+			break;
+		case 'q':
+			test_config->depth = (int)strtol(optarg, NULL, 0);
+			break;
+		case 'w':
+			test_config->data_len = (int)strtol(optarg, NULL, 0);
+			break;
+		case 't':
+			test_config->duration = (int)strtol(optarg, NULL, 0);
+			break;
+		case 'x':
+			test_config->external = 1;
+			break;
+		case 'S':
+			test_config->server = 1;
+			break;
+		case 'R':
+			test_config->ready_fd = (int)strtol(optarg, NULL, 0);
+			break;
+		case 'v':
+			printf("version: %s\n", XIO_TEST_VERSION);
+			exit(0);
+			break;
+		case 'h':
+			usage(argv[0], 0);
+			break;
+		default:
+			fprintf(stderr, " invalid command or flag.\n");
+			fprintf(stderr, " please check command line and " \
+				"run again.\n\n");
+			usage(argv[0], -1);
+			break;
+		}
+	}
+	if (optind == argc - 1) {
+		snprintf(test_config->server_addr,
+			 sizeof(test_config->server_addr), "%s", argv[optind]);
+	} else if (optind < argc) {
+		fprintf(stderr,
+			" Invalid Command line.Please check command rerun\n");
+		exit(-1);
+	}
+
+	if (parse_steps(test_config, steps) ||
+	    test_config->ctxs < 1 || test_config->ctxs > MAX_CTXS ||
+	    test_config->depth < 1 || test_config->duration < 1 ||
+	    test_config->data_len < 0 ||
+	    test_config->data_len > MAX_DATA_SIZE)
+		usage(argv[0], -1);
+
+	return 0;
+}
+
+/*---------------------------------------------------------------------------*/
+/* main									     */
+/*---------------------------------------------------------------------------*/
+int main(int argc, char *argv[])
+{
+	uint64_t	*setup_ns;
+	pid_t		server_pid = 0;
+	int		max_conns = 0;
+	int		i;
+
+	if (parse_cmdline(&test_config, argc, argv) != 0)
+		return -1;
+
+	snprintf(url, sizeof(url), "rdma://%s:%u", test_config.server_addr,
+		 test_config.server_port);
+
+	if (test_config.server)
+		return run_server();
+
+	if (!test_config.external) {
+		server_pid = spawn_server(argv[0]);
+		if (server_pid < 0)
+			return -1;
+	}
+
+	for (i = 0; i < test_config.steps_nr; i++)
+		if (test_config.steps[i] > max_conns)
+			max_conns = test_config.steps[i];
+	setup_ns = calloc(max_conns, sizeof(uint64_t));
+	if (setup_ns == NULL)
+		goto cleanup;
+
+	pthread_barrier_init(&barrier, NULL, test_config.ctxs + 1);
+	for (i = 0; i < test_config.ctxs; i++) {
+		wdata[i].idx = i;
+		pthread_create(&wdata[i].thread_id, NULL, worker_thread,
+			       &wdata[i]);
+	}
+
+	printf("%s, %d contexts, queue depth %d, %d bytes, %d s per step\n",
+	       url, test_config.ctxs, test_config.depth,
+	       test_config.data_len, test_config.duration);
+	printf("%7s %4s %6s %9s %8s %8s %8s " \
+	       "%8s %8s %8s %8s %11s %9s\n",
+	       "conns", "ctxs", "failed", "setup/s", "p50[us]", "p99[us]",
+	       "max[us]", "rss[KB]", "pin[KB]", "srss[KB]", "spin[KB]",
+	       "msg/s", "down[ms]");
+
+	for (i = 0; i < test_config.steps_nr; i++)
+		run_step(test_config.steps[i], server_pid, setup_ns);
+
+	step_conns = 0;
+	pthread_barrier_wait(&barrier);
+	for (i = 0; i < test_config.ctxs; i++)
+		pthread_join(wdata[i].thread_id, NULL);
+	pthread_barrier_destroy(&barrier);
+	free(setup_ns);
+
+cleanup:
+	if (server_pid > 0) {
+		kill(server_pid, SIGTERM);
+		waitpid(server_pid, NULL, 0);
+	}
+
+	return 0;
+}
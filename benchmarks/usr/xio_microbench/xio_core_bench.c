@@ -0,0 +1,635 @@
+/*
+ * Copyright (c) 2013 Mellanox Technologies®. All rights reserved.
+ *
+ * This software is available to you under a choice of one of two licenses.
+ * You may choose to be licensed under the terms of the GNU General Public
+ * License (GPL) Version 2, available from the file COPYING in the main
+ * directory of this source tree, or the Mellanox Technologies® BSD license
+ * below:
+ *
+ *      - Redistribution and use in source and binary forms, with or without
+ *        modification, are permitted provided that the following conditions
+ *        are met:
+ *
+ *      - Redistributions of source code must retain the above copyright
+ *        notice, this list of conditions and the following disclaimer.
+ *
+ *      - Redistributions in binary form must reproduce the above
+ *        copyright notice, this list of conditions and the following
+ *        disclaimer in the documentation and/or other materials
+ *        provided with the distribution.
+ *
+ *      - Neither the name of the Mellanox Technologies® nor the names of its
+ *        contributors may be used to endorse or promote products derived from
+ *        this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+#include "xio_os.h"
+#include "libxio.h"
+#include "xio_common.h"
+#include "xio_mem.h"
+#include "xio_hash.h"
+#include "xio_task.h"
+#include "xio_msg_list.h"
+#include "xio_timers_list.h"
+#include "xio_rdma_mempool.h"
+#include "sys/hashtable.h"
+
+/*
+ * microbenchmarks of the library's hot path data structures. nothing
+ * here touches a device, so the numbers can be taken on any box and
+ * compared between builds. every case prints the cost of one operation
+ * for a range of sizes or thread counts so the scaling shows as well
+ */
+
+#define MIN_TIME_NS		200000000ULL	/* per measurement */
+#define BATCH			64
+#define ARRAY_SIZE(a)		(sizeof(a)/sizeof((a)[0]))
+
+/* time body in batches until MIN_TIME_NS passed */
+#define MEASURE(iters, elapsed, body) do {				\
+	uint64_t _start = now_ns();					\
+	int _b;								\
+	(iters) = 0;							\
+	do {								\
+		for (_b = 0; _b < BATCH; _b++) {			\
+			body;						\
+		}							\
+		(iters) += BATCH;					\
+		(elapsed) = now_ns() - _start;				\
+	} while ((elapsed) < MIN_TIME_NS);				\
+} while (0)
+
+struct bench {
+	const char	*name;
+	void		(*run)(void);
+};
+
+static volatile uint64_t	sink;
+
+/*---------------------------------------------------------------------------*/
+/* now_ns								     */
+/*---------------------------------------------------------------------------*/
+static uint64_t now_ns(void)
+{
+	struct timespec ts;
+
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return ts.tv_sec * 1000000000ULL + ts.tv_nsec;
+}
+
+/*---------------------------------------------------------------------------*/
+/* report								     */
+/*---------------------------------------------------------------------------*/
+static void report(const char *bench, const char *op, const char *param,
+		   uint64_t iters, uint64_t elapsed)
+{
+	printf("%-8s %-12s %-20s %10.1f ns/op\n",
+	       bench, op, param, (double)elapsed / iters);
+}
+
+/*
+ * the rdma mempool registers its regions. there is no device here, so
+ * registration is a no-op that hands back a non NULL handle
+ */
+struct xio_mr *xio_reg_mr(void *addr, size_t length)
+{
+	return (struct xio_mr *)addr;
+}
+
+int xio_dereg_mr(struct xio_mr **p_tmr)
+{
+	*p_tmr = NULL;
+	return 0;
+}
+
+/*---------------------------------------------------------------------------*/
+/* tasks pool								     */
+/*---------------------------------------------------------------------------*/
+#define TASKS_POOL_MAX		1024
+
+static void task_release(struct kref *kref)
+{
+	struct xio_task *task = container_of(kref, struct xio_task, kref);
+	struct xio_tasks_pool *q = task->pool;
+
+	q->nr++;
+	list_move(&task->tasks_list_entry, &q->stack);
+}
+
+static void bench_tasks(void)
+{
+	static const int	depths[] = { 1, 16, 256, TASKS_POOL_MAX };
+	struct xio_tasks_pool	*q;
+	struct xio_task		*tasks[TASKS_POOL_MAX];
+	uint64_t		iters, elapsed;
+	unsigned int		d;
+	int			i, depth;
+	char			param[32];
+
+	q = xio_tasks_pool_init(TASKS_POOL_MAX, 0, 0, NULL);
+	if (q == NULL) {
+		fprintf(stderr, "tasks pool allocation failed\n");
+		exit(1);
+	}
+	for (i = 0; i < TASKS_POOL_MAX; i++)
+		q->array[i]->release = task_release;
+
+	/* take depth tasks out before returning them, the way requests in
+	 * flight hold them, so deeper pools walk colder tasks
+	 */
+	for (d = 0; d < ARRAY_SIZE(depths); d++) {
+		depth = depths[d];
+		MEASURE(iters, elapsed, {
+			for (i = 0; i < depth; i++)
+				tasks[i] = xio_tasks_pool_get(q);
+			for (i = 0; i < depth; i++)
+				xio_tasks_pool_put(tasks[i]);
+		});
+		sprintf(param, "depth %d", depth);
+		report("tasks", "get+put", param, iters * depth, elapsed);
+	}
+
+	xio_tasks_pool_free(q);
+}
+
+/*---------------------------------------------------------------------------*/
+/* rdma mempool								     */
+/*---------------------------------------------------------------------------*/
+struct mempool_thread {
+	struct xio_rdma_mempool	*mpool;
+	pthread_barrier_t	*barrier;
+	size_t			length;
+	uint64_t		iters;
+	uint64_t		elapsed;
+	int			cpu;
+	int			pad;
+	pthread_t		thread_id;
+};
+
+static void *mempool_thread_cb(void *data)
+{
+	struct mempool_thread	*mt = data;
+	struct xio_rdma_mp_mem	mem[4];
+	cpu_set_t		cpuset;
+	int			i;
+
+	CPU_ZERO(&cpuset);
+	CPU_SET(mt->cpu, &cpuset);
+	pthread_setaffinity_np(pthread_self(), sizeof(cpuset), &cpuset);
+
+	pthread_barrier_wait(mt->barrier);
+
+	MEASURE(mt->iters, mt->elapsed, {
+		for (i = 0; i < 4; i++)
+			xio_rdma_mempool_alloc(mt->mpool, mt->length,
+					       &mem[i]);
+		for (i = 0; i < 4; i++)
+			xio_rdma_mempool_free(&mem[i]);
+	});
+	mt->iters *= 4;
+
+	return NULL;
+}
+
+static void bench_mempool(void)
+{
+	static const size_t	lengths[] = { 4096, XIO_256K_BLOCK_SZ };
+	struct xio_rdma_mempool	*mpool;
+	struct xio_rdma_mp_mem	mem;
+	struct mempool_thread	*mt;
+	pthread_barrier_t	barrier;
+	double			mops;
+	uint64_t		iters, elapsed;
+	unsigned int		l;
+	int			cpus = sysconf(_SC_NPROCESSORS_ONLN);
+	int			threads, i;
+	char			param[32];
+
+	mpool = xio_rdma_mempool_create();
+	mt = calloc(cpus, sizeof(*mt));
+	if (mpool == NULL || mt == NULL) {
+		fprintf(stderr, "mempool allocation failed\n");
+		exit(1);
+	}
+
+	for (l = 0; l < ARRAY_SIZE(lengths); l++) {
+		/* populate the slot before the clock starts */
+		xio_rdma_mempool_alloc(mpool, lengths[l], &mem);
+		xio_rdma_mempool_free(&mem);
+
+		threads = 1;
+		while (1) {
+			pthread_barrier_init(&barrier, NULL, threads);
+			for (i = 0; i < threads; i++) {
+				mt[i].mpool	= mpool;
+				mt[i].barrier	= &barrier;
+				mt[i].length	= lengths[l];
+				mt[i].cpu	= i % cpus;
+				pthread_create(&mt[i].thread_id, NULL,
+					       mempool_thread_cb, &mt[i]);
+			}
+			iters = 0;
+			elapsed = 0;
+			mops = 0;
+			for (i = 0; i < threads; i++) {
+				pthread_join(mt[i].thread_id, NULL);
+				iters += mt[i].iters;
+				elapsed += mt[i].elapsed;
+				mops += (double)mt[i].iters * 1000 /
+					mt[i].elapsed;
+			}
+			pthread_barrier_destroy(&barrier);
+
+			/* per thread cost and the aggregate throughput */
+			sprintf(param, "%zdB %d thr", lengths[l], threads);
+			printf("%-8s %-12s %-20s %10.1f ns/op %10.2f Mops/s\n",
+			       "mempool", "alloc+free", param,
+			       (double)elapsed / iters, mops);
+
+			if (threads == cpus)
+				break;
+			threads = min(threads * 2, cpus);
+		}
+	}
+
+	xio_rdma_mempool_destroy(mpool);
+	free(mt);
+}
+
+/*---------------------------------------------------------------------------*/
+/* timers list								     */
+/*---------------------------------------------------------------------------*/
+static void timer_fn(void *data)
+{
+	sink++;
+}
+
+static void bench_timers(void)
+{
+	static const int		pending[] = { 0, 16, 256, 4096 };
+	struct xio_timers_list		timers_list;
+	xio_timer_handle_t		*handles;
+	xio_timer_handle_t		handle;
+	uint64_t			iters, elapsed, start, wall;
+	unsigned int			p;
+	int				i, n;
+	char				param[32];
+
+	handles = calloc(4096, sizeof(*handles));
+	if (handles == NULL) {
+		fprintf(stderr, "timers allocation failed\n");
+		exit(1);
+	}
+	xio_timers_list_init(&timers_list);
+
+	/* the list is kept sorted, so arming a timer walks the pending
+	 * ones. deadlines are random within a second of now
+	 */
+	srand(1);
+	for (p = 0; p < ARRAY_SIZE(pending); p++) {
+		n = pending[p];
+		for (i = 0; i < n; i++)
+			xio_timers_list_add_duration(
+					&timers_list, timer_fn, NULL,
+					(uint64_t)rand() % XIO_NS_IN_SEC,
+					&handles[i]);
+		MEASURE(iters, elapsed, {
+			xio_timers_list_add_duration(
+					&timers_list, timer_fn, NULL,
+					(uint64_t)rand() % XIO_NS_IN_SEC,
+					&handle);
+			xio_timers_list_del(&timers_list, handle);
+		});
+		sprintf(param, "%d pending", n);
+		report("timers", "add+del", param, iters, elapsed);
+		xio_timers_list_close(&timers_list);
+	}
+
+	/* expire n due timers at once. arming them is not timed but costs
+	 * far more than expiring, so the wall clock bounds the rounds
+	 */
+	for (p = 1; p < ARRAY_SIZE(pending); p++) {
+		n = pending[p];
+		iters = 0;
+		elapsed = 0;
+		wall = now_ns();
+		do {
+			for (i = 0; i < n; i++)
+				xio_timers_list_add_duration(
+					&timers_list, timer_fn, NULL, 0,
+					&handles[i]);
+			start = now_ns();
+			xio_timers_list_expire(&timers_list);
+			elapsed += now_ns() - start;
+			iters += n;
+		} while (now_ns() - wall < MIN_TIME_NS);
+		sprintf(param, "%d due", n);
+		report("timers", "expire", param, iters, elapsed);
+	}
+
+	xio_timers_list_close(&timers_list);
+	free(handles);
+}
+
+/*---------------------------------------------------------------------------*/
+/* msg list								     */
+/*---------------------------------------------------------------------------*/
+static void bench_msg_list(void)
+{
+	static const int	depths[] = { 1, 64, 4096 };
+	struct xio_msg_list	list;
+	struct xio_msg		*msgs, *msg;
+	uint64_t		iters, elapsed;
+	unsigned int		d;
+	int			i, depth;
+	char			param[32];
+
+	msgs = calloc(4096, sizeof(*msgs));
+	if (msgs == NULL) {
+		fprintf(stderr, "msgs allocation failed\n");
+		exit(1);
+	}
+
+	for (d = 0; d < ARRAY_SIZE(depths); d++) {
+		depth = depths[d];
+		xio_msg_list_init(&list);
+		for (i = 0; i < depth; i++)
+			xio_msg_list_insert_tail(&list, &msgs[i], pdata);
+
+		/* fifo, the way the connection queues are drained */
+		MEASURE(iters, elapsed, {
+			msg = xio_msg_list_first(&list);
+			xio_msg_list_remove(&list, msg, pdata);
+			xio_msg_list_insert_tail(&list, msg, pdata);
+		});
+		sprintf(param, "depth %d", depth);
+		report("msg_list", "remove+add", param, iters, elapsed);
+
+		MEASURE(iters, elapsed, {
+			xio_msg_list_foreach(msg, &list, pdata)
+				sink += msg->sn;
+		});
+		report("msg_list", "walk", param, iters * depth, elapsed);
+	}
+
+	free(msgs);
+}
+
+/*---------------------------------------------------------------------------*/
+/* hashtable								     */
+/*---------------------------------------------------------------------------*/
+struct htbl_entry {
+	HT_ENTRY(htbl_entry, xio_key_int32) htbl_entry;
+	uint64_t		value;
+};
+
+HT_HEAD(bench_htbl, htbl_entry, HASHTABLE_PRIME_MEDIUM);
+
+static void bench_hashtable(void)
+{
+	static const int	sizes[] = { 64, 977, 8192, 65536 };
+	struct bench_htbl	*htbl;
+	struct htbl_entry	*entries, *entry;
+	struct xio_key_int32	key = { 0 };
+	uint64_t		iters, elapsed;
+	unsigned int		s, seed = 1;
+	int			i, n;
+	char			param[32];
+
+	htbl = calloc(1, sizeof(*htbl));
+	entries = calloc(65536, sizeof(*entries));
+	if (htbl == NULL || entries == NULL) {
+		fprintf(stderr, "hashtable allocation failed\n");
+		exit(1);
+	}
+
+	/* the bucket count is fixed, so the chains grow with the load */
+	for (s = 0; s < ARRAY_SIZE(sizes); s++) {
+		n = sizes[s];
+		HT_INIT(htbl, xio_int32_hash, xio_int32_cmp, xio_int32_cp);
+		for (i = 0; i < n; i++) {
+			key.id = i;
+			entry = &entries[i];
+			HT_INSERT(htbl, &key, entry, htbl_entry);
+		}
+		MEASURE(iters, elapsed, {
+			key.id = rand_r(&seed) % n;
+			HT_LOOKUP(htbl, &key, entry, htbl_entry);
+			sink += entry->value;
+		});
+		sprintf(param, "%d entries", n);
+		report("hash", "lookup", param, iters, elapsed);
+
+		MEASURE(iters, elapsed, {
+			key.id = n + rand_r(&seed) % n;
+			HT_LOOKUP(htbl, &key, entry, htbl_entry);
+			sink += (entry == NULL);
+		});
+		report("hash", "lookup miss", param, iters, elapsed);
+	}
+
+	free(entries);
+	free(htbl);
+}
+
+/*---------------------------------------------------------------------------*/
+/* mbuf tlv								     */
+/*---------------------------------------------------------------------------*/
+#define MBUF_BUF_SZ		8192
+#define MBUF_TLV_TYPE		0x1234
+
+static void mbuf_encode(struct xio_mbuf *mbuf, uint8_t *payload,
+			size_t len)
+{
+	xio_mbuf_reset(mbuf);
+	xio_mbuf_tlv_start(mbuf);
+	/* the fixed fields of a session header, then the user header */
+	xio_mbuf_write_u32(mbuf, 0x11223344);
+	xio_mbuf_write_u32(mbuf, 0);
+	xio_mbuf_write_u64(mbuf, 0x1122334455667788ULL);
+	xio_mbuf_write_u64(mbuf, len);
+	xio_mbuf_write_u16(mbuf, 1);
+	xio_mbuf_write_u16(mbuf, 0);
+	if (len)
+		xio_mbuf_write_array(mbuf, payload, len);
+	xio_mbuf_write_tlv(mbuf, MBUF_TLV_TYPE,
+			   xio_mbuf_tlv_payload_len(mbuf));
+}
+
+static int mbuf_decode(struct xio_mbuf *mbuf, uint8_t *payload)
+{
+	uint64_t	sn = 0, len = 0;
+	uint32_t	dest = 0, flags;
+	uint16_t	iovlen, pad;
+
+	if (xio_mbuf_read_first_tlv(mbuf))
+		return -1;
+	xio_mbuf_read_u32(mbuf, &dest);
+	xio_mbuf_read_u32(mbuf, &flags);
+	xio_mbuf_read_u64(mbuf, &sn);
+	xio_mbuf_read_u64(mbuf, &len);
+	xio_mbuf_read_u16(mbuf, &iovlen);
+	xio_mbuf_read_u16(mbuf, &pad);
+	if (len)
+		xio_mbuf_read_array(mbuf, payload, len);
+
+	return (dest == 0x11223344 && sn == 0x1122334455667788ULL) ? 0 : -1;
+}
+
+static void bench_mbuf(void)
+{
+	static const size_t	lens[] = { 0, 64, 512, 4096 };
+	struct xio_mbuf		mbuf;
+	uint8_t			*buf, *in, *out;
+	uint64_t		iters, elapsed;
+	unsigned int		l;
+	char			param[32];
+
+	buf = calloc(1, MBUF_BUF_SZ);
+	in = calloc(1, MBUF_BUF_SZ);
+	out = calloc(1, MBUF_BUF_SZ);
+	if (!buf || !in || !out) {
+		fprintf(stderr, "mbuf allocation failed\n");
+		exit(1);
+	}
+	memset(in, 0xa5, MBUF_BUF_SZ);
+	xio_mbuf_init(&mbuf, buf, MBUF_BUF_SZ, 0);
+
+	for (l = 0; l < ARRAY_SIZE(lens); l++) {
+		mbuf_encode(&mbuf, in, lens[l]);
+		if (mbuf_decode(&mbuf, out) ||
+		    memcmp(in, out, lens[l])) {
+			fprintf(stderr, "mbuf: decode mismatch %zd\n",
+				lens[l]);
+			exit(1);
+		}
+		sprintf(param, "%zdB header", lens[l]);
+		MEASURE(iters, elapsed, mbuf_encode(&mbuf, in, lens[l]));
+		report("mbuf", "encode", param, iters, elapsed);
+		MEASURE(iters, elapsed, sink += mbuf_decode(&mbuf, out));
+		report("mbuf", "decode", param, iters, elapsed);
+	}
+
+	free(out);
+	free(in);
+	free(buf);
+}
+
+/*---------------------------------------------------------------------------*/
+/* memcpyv								     */
+/*---------------------------------------------------------------------------*/
+struct iov_shape {
+	int		src_nr;
+	int		dst_nr;
+	size_t		src_len;
+	size_t		dst_len;
+};
+
+static struct iov_shape shapes[] = {
+	{ .src_nr = 1,	 .src_len = 64,	  .dst_nr = 1,	.dst_len = 64 },
+	{ .src_nr = 4,	 .src_len = 256,  .dst_nr = 1,	.dst_len = 1024 },
+	{ .src_nr = 16,	 .src_len = 64,	  .dst_nr = 1,	.dst_len = 1024 },
+	{ .src_nr = 1,	 .src_len = 8192, .dst_nr = 2,	.dst_len = 4096 },
+	{ .src_nr = 3,	 .src_len = 3000, .dst_nr = 3,	.dst_len = 4096 },
+	{ .src_nr = 64,	 .src_len = 1024, .dst_nr = 16,	.dst_len = 4096 },
+	{ .src_nr = 256, .src_len = 4096, .dst_nr = 1,
+	  .dst_len = 1024*1024 },
+};
+
+static void bench_memcpyv(void)
+{
+	struct xio_iovec	*src, *dst;
+	struct iov_shape	*shape;
+	uint8_t			*sbuf, *dbuf;
+	uint64_t		iters, elapsed;
+	size_t			slen, dlen;
+	unsigned int		s;
+	int			i;
+	char			param[32];
+
+	for (s = 0; s < ARRAY_SIZE(shapes); s++) {
+		shape = &shapes[s];
+		slen = shape->src_nr * shape->src_len;
+		dlen = shape->dst_nr * shape->dst_len;
+		src = calloc(shape->src_nr, sizeof(*src));
+		dst = calloc(shape->dst_nr, sizeof(*dst));
+		sbuf = malloc(slen);
+		dbuf = malloc(dlen);
+		if (!src || !dst || !sbuf || !dbuf) {
+			fprintf(stderr, "memcpyv allocation failed\n");
+			exit(1);
+		}
+		memset(sbuf, 0x5a, slen);
+		for (i = 0; i < shape->src_nr; i++) {
+			src[i].iov_base = sbuf + i * shape->src_len;
+			src[i].iov_len = shape->src_len;
+		}
+
+		/* memcpyv trims the destination lengths, rearm them */
+		MEASURE(iters, elapsed, {
+			for (i = 0; i < shape->dst_nr; i++) {
+				dst[i].iov_base = dbuf + i * shape->dst_len;
+				dst[i].iov_len = shape->dst_len;
+			}
+			sink += memcpyv(dst, shape->dst_nr,
+					src, shape->src_nr);
+		});
+		sprintf(param, "%dx%zd->%dx%zd",
+			shape->src_nr, shape->src_len,
+			shape->dst_nr, shape->dst_len);
+		printf("%-8s %-12s %-20s %10.1f ns/op %10.2f GB/s\n",
+		       "memcpyv", "copy", param,
+		       (double)elapsed / iters,
+		       (double)slen * iters / elapsed);
+
+		free(dbuf);
+		free(sbuf);
+		free(dst);
+		free(src);
+	}
+}
+
+static struct bench benches[] = {
+	{ "tasks",	bench_tasks },
+	{ "mempool",	bench_mempool },
+	{ "timers",	bench_timers },
+	{ "msg_list",	bench_msg_list },
+	{ "hash",	bench_hashtable },
+	{ "mbuf",	bench_mbuf },
+	{ "memcpyv",	bench_memcpyv },
+};
+
+/*---------------------------------------------------------------------------*/
+/* main									     */
+/*---------------------------------------------------------------------------*/
+int main(int argc, char *argv[])
+{
+	unsigned int	i;
+	int		j, found;
+
+	xio_memcpy_init();
+
+	/* run the benchmarks named on the command line, or all of them */
+	for (i = 0; i < ARRAY_SIZE(benches); i++) {
+		found = (argc == 1);
+		for (j = 1; j < argc; j++)
+			if (strcmp(argv[j], benches[i].name) == 0)
+				found = 1;
+		if (found)
+			benches[i].run();
+	}
+
+	return 0;
+}
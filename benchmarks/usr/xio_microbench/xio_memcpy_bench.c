@@ -0,0 +1,191 @@
+/*
+ * Copyright (c) 2013 Mellanox Technologies®. All rights reserved.
+ *
+ * This software is available to you under a choice of one of two licenses.
+ * You may choose to be licensed under the terms of the GNU General Public
+ * License (GPL) Version 2, available from the file COPYING in the main
+ * directory of this source tree, or the Mellanox Technologies® BSD license
+ * below:
+ *
+ *      - Redistribution and use in source and binary forms, with or without
+ *        modification, are permitted provided that the following conditions
+ *        are met:
+ *
+ *      - Redistributions of source code must retain the above copyright
+ *        notice, this list of conditions and the following disclaimer.
+ *
+ *      - Redistributions in binary form must reproduce the above
+ *        copyright notice, this list of conditions and the following
+ *        disclaimer in the documentation and/or other materials
+ *        provided with the distribution.
+ *
+ *      - Neither the name of the Mellanox Technologies® nor the names of its
+ *        contributors may be used to endorse or promote products derived from
+ *        this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+#include "xio_os.h"
+#include "libxio.h"
+#include "xio_common.h"
+#include "xio_mem.h"
+
+/*
+ * gather copy microbenchmark: copies a vector of segments into one
+ * contiguous buffer, the way the rdma send path fills its registered
+ * buffer, with cached and with streaming stores for every kernel the
+ * cpu supports
+ */
+
+#define MIN_TIME_NS		200000000ULL	/* per measurement */
+
+struct iov_shape {
+	int		nr;
+	int		pad;
+	size_t		seg_len;
+};
+
+static struct iov_shape shapes[] = {
+	{ .nr = 1,	.seg_len = 64 },
+	{ .nr = 1,	.seg_len = 1024 },
+	{ .nr = 4,	.seg_len = 256 },
+	{ .nr = 16,	.seg_len = 64 },
+	{ .nr = 1,	.seg_len = 8192 },
+	{ .nr = 8,	.seg_len = 1024 },
+	{ .nr = 64,	.seg_len = 128 },
+	{ .nr = 1,	.seg_len = 65536 },
+	{ .nr = 16,	.seg_len = 4096 },
+	{ .nr = 256,	.seg_len = 4096 },
+	{ .nr = 1,	.seg_len = 4*1024*1024 },
+	{ .nr = 4,	.seg_len = 4*1024*1024 },
+};
+
+static const char *impl_names[] = {
+	[XIO_MEMCPY_SCALAR]	= "scalar",
+	[XIO_MEMCPY_AVX2]	= "avx2",
+	[XIO_MEMCPY_AVX512]	= "avx512",
+};
+
+/*---------------------------------------------------------------------------*/
+/* now_ns								     */
+/*---------------------------------------------------------------------------*/
+static uint64_t now_ns(void)
+{
+	struct timespec ts;
+
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return ts.tv_sec * 1000000000ULL + ts.tv_nsec;
+}
+
+/*---------------------------------------------------------------------------*/
+/* verify								     */
+/*---------------------------------------------------------------------------*/
+static int verify(struct xio_iovec_ex *iov, int nr, uint8_t *dst)
+{
+	int i;
+
+	for (i = 0; i < nr; i++) {
+		if (memcmp(dst, iov[i].iov_base, iov[i].iov_len))
+			return -1;
+		dst += iov[i].iov_len;
+	}
+	return 0;
+}
+
+/*---------------------------------------------------------------------------*/
+/* run_shape								     */
+/*---------------------------------------------------------------------------*/
+static void run_shape(struct iov_shape *shape, const char *mode)
+{
+	struct xio_iovec_ex	*iov;
+	uint8_t			*src, *dst;
+	size_t			total = shape->nr * shape->seg_len;
+	uint64_t		start, elapsed, iters = 0;
+	size_t			i;
+
+	iov = calloc(shape->nr, sizeof(*iov));
+	src = malloc(total + 64);
+	dst = malloc(total + 64);
+	if (!iov || !src || !dst) {
+		fprintf(stderr, "allocation failed\n");
+		exit(1);
+	}
+	for (i = 0; i < total + 64; i++)
+		src[i] = (uint8_t)(i * 7);
+	/* misalign source and destination as user buffers often are */
+	for (i = 0; i < shape->nr; i++) {
+		iov[i].iov_base	= src + 3 + i * shape->seg_len;
+		iov[i].iov_len	= shape->seg_len;
+	}
+
+	memset(dst, 0, total + 64);
+	if (xio_memcpy_gather(dst + 8, iov, shape->nr) != total ||
+	    verify(iov, shape->nr, dst + 8)) {
+		fprintf(stderr, "%s: copy mismatch %dx%zd\n",
+			xio_memcpy_impl_name(), shape->nr, shape->seg_len);
+		exit(1);
+	}
+
+	start = now_ns();
+	do {
+		for (i = 0; i < 16; i++)
+			xio_memcpy_gather(dst + 8, iov, shape->nr);
+		iters += 16;
+		elapsed = now_ns() - start;
+	} while (elapsed < MIN_TIME_NS);
+
+	printf("%-8s %-5s %5d x %-8zd %12.1f ns/op %8.2f GB/s\n",
+	       xio_memcpy_impl_name(), mode, shape->nr, shape->seg_len,
+	       (double)elapsed / iters,
+	       (double)total * iters / elapsed);
+
+	free(dst);
+	free(src);
+	free(iov);
+}
+
+/*---------------------------------------------------------------------------*/
+/* main									     */
+/*---------------------------------------------------------------------------*/
+int main(int argc, char *argv[])
+{
+	unsigned int	i, impl;
+	size_t		nr_shapes = sizeof(shapes)/sizeof(shapes[0]);
+
+	xio_memcpy_init();
+	printf("default kernel: %s\n", xio_memcpy_impl_name());
+
+	/* cached stores are the same libc copy for every kernel */
+	xio_memcpy_set_impl(XIO_MEMCPY_SCALAR);
+	xio_memcpy_set_nt_threshold(~0UL);
+	for (i = 0; i < nr_shapes; i++)
+		run_shape(&shapes[i], "tmp");
+
+	/* streaming stores for every segment */
+	xio_memcpy_set_nt_threshold(0);
+	for (impl = XIO_MEMCPY_AVX2; impl < XIO_MEMCPY_AUTO; impl++) {
+		if (xio_memcpy_set_impl(impl)) {
+			printf("%-8s not supported\n", impl_names[impl]);
+			continue;
+		}
+		for (i = 0; i < nr_shapes; i++)
+			run_shape(&shapes[i], "nt");
+	}
+
+	/* what the library does by default */
+	xio_memcpy_init();
+	for (i = 0; i < nr_shapes; i++)
+		run_shape(&shapes[i], "auto");
+
+	return 0;
+}
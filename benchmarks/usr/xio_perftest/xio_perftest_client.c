@@ -46,6 +46,7 @@
 #include <errno.h>
 #include <sched.h>
 #include <pthread.h>
+#include <sys/timerfd.h>
 
 #include "libxio.h"
 #include "xio_msg.h"
@@ -53,11 +54,14 @@
 #include "xio_perftest_parameters.h"
 #include "xio_perftest_communication.h"
 #include "xio_perftest_resources.h"
+#include "xio_perftest_histogram.h"
 #include "xio_perftest.h"
 
 #define USECS_IN_SEC		1000000
 #define NSECS_IN_USEC		1000
 #define ONE_MB			(1 << 20)
+#define NSECS_IN_SEC		1000000000ULL
+#define MIN_TICK_NSECS		10000
 
 struct thread_stat_data {
 	volatile uint64_t	scnt;
@@ -67,18 +71,31 @@ struct thread_stat_data {
 	volatile uint64_t	min_rtt;
 };
 
+struct conn_data {
+	struct thread_data	*tdata;
+	struct xio_connection	*conn;
+	uint64_t		next_send;	/* open loop schedule */
+	int			tx_nr;
+	int			rx_nr;
+	int			disconnected;
+	int			pad;
+};
+
 struct thread_data {
 	struct thread_stat_data stat;
+	struct perf_hist	hist;
 	struct session_data    *sdata;
 	struct msg_pool		*pool;
 	struct xio_buf		*xbuf;
 	struct xio_session	*session;
-	struct xio_connection	*conn;
+	struct conn_data	*cdata;
 	struct xio_context	*ctx;
 	struct perf_parameters	*user_param;
 	uint64_t		data_len;
-	int			tx_nr;
-	int			rx_nr;
+	uint64_t		interval;	/* cycles, 0 for closed loop */
+	uint64_t		tick_ns;
+	int			conns_num;
+	int			timer_fd;
 	int			cid;
 	int			affinity;
 	int			disconnect;
@@ -92,6 +109,10 @@ struct session_data {
 	double			avg_lat_us;
 	double			min_lat_us;
 	double			max_lat_us;
+	double			p50_lat_us;
+	double			p90_lat_us;
+	double			p99_lat_us;
+	double			p999_lat_us;
 	double			avg_bw;
 	int			abort;
 	int			pad;
@@ -112,6 +133,8 @@ static uint64_t	hdr_len;
 static uint64_t	data_len;
 static FILE	*fd = NULL;
 static double	g_mhz;
+static int	records_nr;
+static struct perf_hist	g_hist;
 
 /*---------------------------------------------------------------------------*/
 /* statistics_thread_cb							     */
@@ -146,6 +169,8 @@ static void *statistics_thread_cb(void *data)
 		rtt_start += sess_data->tdata[i].stat.tot_rtt;
 		sess_data->tdata[i].stat.min_rtt  = -1;
 		sess_data->tdata[i].stat.max_rtt  = 0;
+		memset(&sess_data->tdata[i].hist, 0,
+		       sizeof(sess_data->tdata[i].hist));
 	}
 
 	/* test period */
@@ -161,12 +186,14 @@ static void *statistics_thread_cb(void *data)
 
 	delta = (get_cycles() - start_time)/g_mhz;
 
+	memset(&g_hist, 0, sizeof(g_hist));
 	for (i = 0; i < threads_iter; i++) {
+		perf_hist_merge(&g_hist, &sess_data->tdata[i].hist);
 		scnt_end += sess_data->tdata[i].stat.scnt;
 		rtt_end += sess_data->tdata[i].stat.tot_rtt;
 		if (min_rtt > sess_data->tdata[i].stat.min_rtt)
 			min_rtt = sess_data->tdata[i].stat.min_rtt;
-		if (max_rtt < sess_data->tdata[i].stat.min_rtt)
+		if (max_rtt < sess_data->tdata[i].stat.max_rtt)
 			max_rtt = sess_data->tdata[i].stat.max_rtt;
 	}
 
@@ -176,6 +203,11 @@ static void *statistics_thread_cb(void *data)
 	sess_data->min_lat_us = min_rtt/g_mhz;
 	sess_data->max_lat_us = max_rtt/g_mhz;
 
+	sess_data->p50_lat_us  = perf_hist_percentile(&g_hist, 500)/g_mhz;
+	sess_data->p90_lat_us  = perf_hist_percentile(&g_hist, 900)/g_mhz;
+	sess_data->p99_lat_us  = perf_hist_percentile(&g_hist, 990)/g_mhz;
+	sess_data->p999_lat_us = perf_hist_percentile(&g_hist, 999)/g_mhz;
+
 	sess_data->tps    = ((scnt_end - scnt_start)*USECS_IN_SEC)/delta;
 	sess_data->avg_bw = (1.0*sess_data->tps*tx_len/ONE_MB);
 
@@ -185,15 +217,152 @@ static void *statistics_thread_cb(void *data)
 	return NULL;
 }
 
+/*---------------------------------------------------------------------------*/
+/* send_request								     */
+/*---------------------------------------------------------------------------*/
+static int send_request(struct conn_data *cdata, struct xio_msg *msg,
+			uint64_t stamp)
+{
+	struct thread_data	*tdata = cdata->tdata;
+
+	/* reset message */
+	msg->in.header.iov_len = 0;
+	msg->in.data_iovlen = 0;
+	msg->out.header.iov_len = 0;
+	if (tdata->data_len) {
+		msg->out.data_iovlen		= 1;
+		msg->out.data_iov[0].iov_base	= tdata->xbuf->addr;
+		msg->out.data_iov[0].iov_len	= tdata->xbuf->length;
+		msg->out.data_iov[0].mr		= tdata->xbuf->mr;
+	} else {
+		msg->out.data_iovlen = 0;
+	}
+	msg->user_context = (void *)stamp;
+
+	if (xio_send_request(cdata->conn, msg) == -1) {
+		if (xio_errno() != EAGAIN)
+			printf("**** [%p] Error - xio_send_request " \
+			       "failed. %s\n",
+			       tdata->session,
+			       xio_strerror(xio_errno()));
+		msg_pool_put(tdata->pool, msg);
+		return -1;
+	}
+	if (tdata->do_stat)
+		tdata->stat.scnt++;
+	cdata->tx_nr++;
+
+	return 0;
+}
+
+/*---------------------------------------------------------------------------*/
+/* send_due_requests							     */
+/*---------------------------------------------------------------------------*/
+static void send_due_requests(struct conn_data *cdata, uint64_t now)
+{
+	struct thread_data	*tdata = cdata->tdata;
+	struct xio_msg		*msg;
+
+	/* stamp each request with its scheduled time rather than the time
+	 * it actually left, so a stalled server is charged for the requests
+	 * it held back (no coordinated omission). requests that find no
+	 * free message stay owed and go out as soon as a response returns
+	 */
+	while (cdata->next_send <= now) {
+		msg = msg_pool_get(tdata->pool);
+		if (msg == NULL)
+			break;
+		if (send_request(cdata, msg, cdata->next_send))
+			break;
+		cdata->next_send += tdata->interval;
+	}
+}
+
+/*---------------------------------------------------------------------------*/
+/* disconnect_idle							     */
+/*---------------------------------------------------------------------------*/
+static void disconnect_idle(struct thread_data *tdata)
+{
+	struct conn_data	*cdata;
+	int			i;
+
+	for (i = 0; i < tdata->conns_num; i++) {
+		cdata = &tdata->cdata[i];
+		if (cdata->disconnected || cdata->rx_nr != cdata->tx_nr)
+			continue;
+		cdata->disconnected = 1;
+		xio_disconnect(cdata->conn);
+	}
+}
+
+/*---------------------------------------------------------------------------*/
+/* on_send_timer							     */
+/*---------------------------------------------------------------------------*/
+static void on_send_timer(int timer_fd, int events, void *data)
+{
+	struct thread_data	*tdata = data;
+	uint64_t		exp, now;
+	int			i;
+
+	if (read(timer_fd, &exp, sizeof(exp)) != sizeof(exp))
+		return;
+
+	/* connections with nothing in flight get no response to close on */
+	if (tdata->disconnect) {
+		disconnect_idle(tdata);
+		return;
+	}
+
+	now = get_cycles();
+	for (i = 0; i < tdata->conns_num; i++)
+		send_due_requests(&tdata->cdata[i], now);
+}
+
+/*---------------------------------------------------------------------------*/
+/* start_send_timer							     */
+/*---------------------------------------------------------------------------*/
+static int start_send_timer(struct thread_data *tdata)
+{
+	struct itimerspec	its;
+	uint64_t		now = get_cycles();
+	int			i;
+
+	/* spread the connections over one interval to avoid bursts */
+	for (i = 0; i < tdata->conns_num; i++)
+		tdata->cdata[i].next_send = now +
+			(tdata->interval * i) / tdata->conns_num;
+
+	tdata->timer_fd = timerfd_create(CLOCK_MONOTONIC, TFD_NONBLOCK);
+	if (tdata->timer_fd < 0) {
+		printf("**** Error - timerfd_create failed. %m\n");
+		return -1;
+	}
+	its.it_interval.tv_sec	= tdata->tick_ns / NSECS_IN_SEC;
+	its.it_interval.tv_nsec	= tdata->tick_ns % NSECS_IN_SEC;
+	its.it_value		= its.it_interval;
+
+	if (timerfd_settime(tdata->timer_fd, 0, &its, NULL) ||
+	    xio_context_add_ev_handler(tdata->ctx, tdata->timer_fd,
+				       XIO_POLLIN, on_send_timer, tdata)) {
+		printf("**** Error - failed to arm send timer\n");
+		close(tdata->timer_fd);
+		tdata->timer_fd = -1;
+		return -1;
+	}
+
+	return 0;
+}
+
 /*---------------------------------------------------------------------------*/
 /* worker_thread							     */
 /*---------------------------------------------------------------------------*/
 static void *worker_thread(void *data)
 {
 	struct thread_data	*tdata = data;
+	struct conn_data	*cdata;
 	cpu_set_t		cpuset;
 	struct xio_msg		*msg;
-	int			i;
+	int			i, j;
 
 	/* set affinity to thread */
 
@@ -203,64 +372,62 @@ static void *worker_thread(void *data)
 	pthread_setaffinity_np(tdata->thread_id, sizeof(cpu_set_t), &cpuset);
 
 	/* prepare data for the cuurent thread */
-	tdata->pool = msg_pool_alloc(tdata->user_param->queue_depth);
+	tdata->pool = msg_pool_alloc(tdata->user_param->queue_depth *
+				     tdata->conns_num);
+	tdata->cdata = calloc(tdata->conns_num, sizeof(*tdata->cdata));
+	tdata->timer_fd = -1;
 
 	/* create thread context for the client */
 	tdata->ctx = xio_context_create(NULL, tdata->user_param->poll_timeout);
 
-
-	/* connect the session  */
-	tdata->conn = xio_connect(tdata->session, tdata->ctx,
-				  tdata->cid, NULL, tdata);
+	/* connect the session - spread the connections over the portals */
+	for (j = 0; j < tdata->conns_num; j++) {
+		cdata = &tdata->cdata[j];
+		cdata->tdata = tdata;
+		cdata->conn = xio_connect(tdata->session, tdata->ctx,
+					  tdata->cid * tdata->conns_num + j,
+					  NULL, cdata);
+	}
 
 	if (tdata->data_len)
 		tdata->xbuf = xio_alloc(tdata->data_len);
 
-	for (i = 0;  i < tdata->user_param->queue_depth; i++) {
-		/* create transaction */
-		msg = msg_pool_get(tdata->pool);
-		if (msg == NULL)
-			break;
-
-		/* get pointers to internal buffers */
-		msg->in.header.iov_len = 0;
-		msg->in.data_iovlen = 0;
-		msg->out.header.iov_len = 0;
-		if (tdata->data_len) {
-			msg->out.data_iovlen		= 1;
-			msg->out.data_iov[0].iov_base	= tdata->xbuf->addr;
-			msg->out.data_iov[0].iov_len	= tdata->xbuf->length;
-			msg->out.data_iov[0].mr		= tdata->xbuf->mr;
-		} else {
-			msg->out.data_iovlen = 0;
-		}
-		msg->user_context = (void *)get_cycles();
-		/* send first message */
-		if (xio_send_request(tdata->conn, msg) == -1) {
-			if (xio_errno() != EAGAIN)
-				printf("**** [%p] Error - xio_send_request " \
-				       "failed. %s\n",
-					tdata->session,
-					xio_strerror(xio_errno()));
-			msg_pool_put(tdata->pool, msg);
-			return 0;
+	if (tdata->interval) {
+		if (start_send_timer(tdata))
+			goto cleanup;
+	} else {
+		for (j = 0; j < tdata->conns_num; j++) {
+			for (i = 0; i < tdata->user_param->queue_depth; i++) {
+				/* create transaction */
+				msg = msg_pool_get(tdata->pool);
+				if (msg == NULL)
+					break;
+
+				/* send first message */
+				if (send_request(&tdata->cdata[j], msg,
+						 get_cycles()))
+					break;
+			}
 		}
-		if (tdata->do_stat)
-			tdata->stat.scnt++;
-		tdata->tx_nr++;
 	}
 
 	/* the default xio supplied main loop */
 	xio_context_run_loop(tdata->ctx, XIO_INFINITE);
 
 	/* normal exit phase */
+	if (tdata->timer_fd >= 0) {
+		xio_context_del_ev_handler(tdata->ctx, tdata->timer_fd);
+		close(tdata->timer_fd);
+	}
 
+cleanup:
 	if (tdata->pool)
 		msg_pool_free(tdata->pool);
 
 	if (tdata->xbuf)
 		xio_free(&tdata->xbuf);
 
+	free(tdata->cdata);
 
 	/* free the context */
 	xio_context_destroy(tdata->ctx);
@@ -314,8 +481,10 @@ static int on_response(struct xio_session *session,
 			int more_in_batch,
 			void *cb_user_context)
 {
-	struct thread_data  *tdata = cb_user_context;
-	cycles_t rtt = (get_cycles()-(cycles_t)msg->user_context);
+	struct conn_data    *cdata = cb_user_context;
+	struct thread_data  *tdata = cdata->tdata;
+	cycles_t now = get_cycles();
+	cycles_t rtt = (now-(cycles_t)msg->user_context);
 
 	if (tdata->do_stat) {
 		if (rtt > tdata->stat.max_rtt)
@@ -324,39 +493,31 @@ static int on_response(struct xio_session *session,
 			tdata->stat.min_rtt = rtt;
 		tdata->stat.tot_rtt += rtt;
 		tdata->stat.ccnt++;
+		perf_hist_record(&tdata->hist, rtt);
 	}
 
-	tdata->rx_nr++;
+	cdata->rx_nr++;
 
 	/* message is no longer needed */
 	xio_release_response(msg);
 
 	if (tdata->disconnect) {
-		if (tdata->rx_nr == tdata->tx_nr)
-			xio_disconnect(tdata->conn);
-		else
-			msg_pool_put(tdata->pool, msg);
+		msg_pool_put(tdata->pool, msg);
+		if (cdata->rx_nr == cdata->tx_nr && !cdata->disconnected) {
+			cdata->disconnected = 1;
+			xio_disconnect(cdata->conn);
+		}
 		return 0;
 	}
 
-	/* reset message */
-	msg->in.header.iov_len = 0;
-	msg->in.data_iovlen = 0;
-
-	msg->user_context = (void *)get_cycles();
-	if (xio_send_request(tdata->conn, msg) == -1) {
-		if (xio_errno() != EAGAIN)
-			printf("**** [%p] Error - xio_send_request " \
-					"failed %s\n",
-					session,
-					xio_strerror(xio_errno()));
+	/* open loop - the slot is free for any request that is due */
+	if (tdata->interval) {
 		msg_pool_put(tdata->pool, msg);
+		send_due_requests(cdata, now);
 		return 0;
 	}
-	if (tdata->do_stat)
-		tdata->stat.scnt++;
 
-	tdata->tx_nr++;
+	send_request(cdata, msg, now);
 
 	return 0;
 }
@@ -368,9 +529,9 @@ static int on_msg_error(struct xio_session *session,
 		enum xio_status error, struct xio_msg  *msg,
 		void *cb_user_context)
 {
-	struct thread_data  *tdata = cb_user_context;
+	struct conn_data  *cdata = cb_user_context;
 
-	msg_pool_put(tdata->pool, msg);
+	msg_pool_put(cdata->tdata->pool, msg);
 
 	return 0;
 }
@@ -386,6 +547,59 @@ static struct xio_session_ops ses_ops = {
 	.on_msg_error			=  on_msg_error
 };
 
+/*---------------------------------------------------------------------------*/
+/* output_open								     */
+/*---------------------------------------------------------------------------*/
+static void output_open(struct perf_parameters *user_param)
+{
+	records_nr = 0;
+	if (user_param->output_format == JSON)
+		fprintf(fd, "[\n");
+	else
+		fprintf(fd, "size, threads, conns, rate, tps, bw[MBps], " \
+			"lat[usec], min[usec], p50[usec], p90[usec], " \
+			"p99[usec], p99.9[usec], max[usec]\n");
+	fflush(fd);
+}
+
+/*---------------------------------------------------------------------------*/
+/* output_record							     */
+/*---------------------------------------------------------------------------*/
+static void output_record(struct perf_parameters *user_param,
+			  struct test_results *res)
+{
+	if (user_param->output_format == JSON)
+		fprintf(fd, "%s  {\"size\": %u, \"threads\": %u, " \
+			"\"conns\": %u, \"rate\": %u, \"tps\": %lu, " \
+			"\"bw_mbps\": %.2lf, \"lat_us\": {\"avg\": %.2lf, " \
+			"\"min\": %.2lf, \"p50\": %.2lf, \"p90\": %.2lf, " \
+			"\"p99\": %.2lf, \"p999\": %.2lf, \"max\": %.2lf}}",
+			records_nr ? ",\n" : "",
+			res->bytes, res->threads, res->conns, res->rate,
+			res->tps, res->avg_bw, res->avg_lat, res->min_lat,
+			res->p50_lat, res->p90_lat, res->p99_lat,
+			res->p999_lat, res->max_lat);
+	else
+		fprintf(fd, "%u, %u, %u, %u, %lu, %.2lf, %.2lf, %.2lf, " \
+			"%.2lf, %.2lf, %.2lf, %.2lf, %.2lf\n",
+			res->bytes, res->threads, res->conns, res->rate,
+			res->tps, res->avg_bw, res->avg_lat, res->min_lat,
+			res->p50_lat, res->p90_lat, res->p99_lat,
+			res->p999_lat, res->max_lat);
+	records_nr++;
+	fflush(fd);
+}
+
+/*---------------------------------------------------------------------------*/
+/* output_close								     */
+/*---------------------------------------------------------------------------*/
+static void output_close(struct perf_parameters *user_param)
+{
+	if (user_param->output_format == JSON)
+		fprintf(fd, "%s]\n", records_nr ? "\n" : "");
+	fclose(fd);
+}
+
 /*---------------------------------------------------------------------------*/
 /* run_client_test							     */
 /*---------------------------------------------------------------------------*/
@@ -400,7 +614,7 @@ int run_client_test(struct perf_parameters *user_param)
 	pthread_t		statistics_thread_id;
 	struct perf_command	command;
 	int			size_log2;
-	int			max_size_log2 = 24;
+	uint64_t		conns_total;
 
 
 	/* client session attributes */
@@ -413,7 +627,7 @@ int run_client_test(struct perf_parameters *user_param)
 	g_mhz		= get_cpu_mhz(0);
 	max_cpus	= sysconf(_SC_NPROCESSORS_ONLN);
 	threads_iter	= 1;
-	size_log2	= 0;
+	size_log2	= user_param->min_size_log2;
 
 	tdata = calloc(user_param->threads_num, sizeof(*tdata));
 	if (tdata == NULL) {
@@ -438,8 +652,7 @@ int run_client_test(struct perf_parameters *user_param)
 			destroy_comm_struct(comm);
 			return -1;
 		}
-		fprintf(fd, "size, threads, tps, bw[Mbps], lat[usec]\n");
-		fflush(fd);
+		output_open(user_param);
 	}
 
 
@@ -453,6 +666,7 @@ int run_client_test(struct perf_parameters *user_param)
 		memset(&sess_data, 0, sizeof(sess_data));
 		memset(tdata, 0, user_param->threads_num*sizeof(*tdata));
 		sess_data.tdata = tdata;
+		conns_total	= threads_iter * user_param->conns_num;
 
 		command.test_param.machine_type	= user_param->machine_type;
 		command.test_param.test_type	= user_param->test_type;
@@ -485,6 +699,21 @@ int run_client_test(struct perf_parameters *user_param)
 			sess_data.tdata[i].sdata		= &sess_data;
 			sess_data.tdata[i].user_param		= user_param;
 			sess_data.tdata[i].data_len		= data_len;
+			sess_data.tdata[i].conns_num		=
+				user_param->conns_num;
+
+			/* the target rate is shared by all connections */
+			if (user_param->rate) {
+				sess_data.tdata[i].interval	=
+					g_mhz * USECS_IN_SEC * conns_total /
+					user_param->rate;
+				sess_data.tdata[i].tick_ns	=
+					NSECS_IN_SEC * conns_total /
+					user_param->rate;
+				if (sess_data.tdata[i].tick_ns < MIN_TICK_NSECS)
+					sess_data.tdata[i].tick_ns =
+						MIN_TICK_NSECS;
+			}
 
 			/* all threads are working on the same session */
 			sess_data.tdata[i].session	= sess_data.session;
@@ -509,11 +738,17 @@ int run_client_test(struct perf_parameters *user_param)
 		/* send result to server */
 		command.results.bytes		= data_len;
 		command.results.threads		= threads_iter;
+		command.results.conns		= conns_total;
+		command.results.rate		= user_param->rate;
 		command.results.tps		= sess_data.tps;
 		command.results.avg_bw		= sess_data.avg_bw;
 		command.results.avg_lat		= sess_data.avg_lat_us;
 		command.results.min_lat		= sess_data.min_lat_us;
 		command.results.max_lat		= sess_data.max_lat_us;
+		command.results.p50_lat		= sess_data.p50_lat_us;
+		command.results.p90_lat		= sess_data.p90_lat_us;
+		command.results.p99_lat		= sess_data.p99_lat_us;
+		command.results.p999_lat	= sess_data.p999_lat_us;
 		command.command			= GetTestResults;
 
 		/* sync point */
@@ -522,35 +757,34 @@ int run_client_test(struct perf_parameters *user_param)
 		printf(REPORT_FMT,
 		       data_len,
 		       threads_iter,
+		       (int)conns_total,
 		       sess_data.tps,
 		       sess_data.avg_bw,
 		       sess_data.avg_lat_us,
 		       sess_data.min_lat_us,
+		       sess_data.p50_lat_us,
+		       sess_data.p90_lat_us,
+		       sess_data.p99_lat_us,
+		       sess_data.p999_lat_us,
 		       sess_data.max_lat_us);
 		if (fd)
-			fprintf(fd, "%lu, %d, %lu, %.2lf, %.2lf\n",
-				data_len,
-				threads_iter,
-				sess_data.tps,
-				sess_data.avg_bw,
-				sess_data.avg_lat_us);
-		fflush(fd);
+			output_record(user_param, &command.results);
 
 		/* sync point */
 		ctx_read_data(comm, NULL, 0, NULL);
 
-		if (++size_log2 < max_size_log2)
+		if (++size_log2 <= user_param->max_size_log2)
 			continue;
 
 		threads_iter++;
-		size_log2 = 0;
+		size_log2 = user_param->min_size_log2;
 	}
 
 	printf("%s", RESULT_LINE);
 
 cleanup:
 	if (fd)
-		fclose(fd);
+		output_close(user_param);
 
 	ctx_hand_shake(comm);
 
@@ -0,0 +1,95 @@
+/*
+ * Copyright (c) 2013 Mellanox Technologies®. All rights reserved.
+ *
+ * This software is available to you under a choice of one of two licenses.
+ * You may choose to be licensed under the terms of the GNU General Public
+ * License (GPL) Version 2, available from the file COPYING in the main
+ * directory of this source tree, or the Mellanox Technologies® BSD license
+ * below:
+ *
+ *      - Redistribution and use in source and binary forms, with or without
+ *        modification, are permitted provided that the following conditions
+ *        are met:
+ *
+ *      - Redistributions of source code must retain the above copyright
+ *        notice, this list of conditions and the following disclaimer.
+ *
+ *      - Redistributions in binary form must reproduce the above
+ *        copyright notice, this list of conditions and the following
+ *        disclaimer in the documentation and/or other materials
+ *        provided with the distribution.
+ *
+ *      - Neither the name of the Mellanox Technologies® nor the names of its
+ *        contributors may be used to endorse or promote products derived from
+ *        this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+#include <stdint.h>
+
+#include "xio_perftest_histogram.h"
+
+/*---------------------------------------------------------------------------*/
+/* perf_hist_bucket_max							     */
+/*---------------------------------------------------------------------------*/
+static uint64_t perf_hist_bucket_max(uint32_t idx)
+{
+	uint32_t group = idx >> PERF_HIST_SUB_BITS;
+	uint32_t shift;
+
+	if (group == 0)
+		return idx;
+
+	/* group g covers [2^(g+SUB_BITS-1), 2^(g+SUB_BITS)) in SUB steps */
+	shift = group - 1;
+
+	return (((uint64_t)(idx & (PERF_HIST_SUB - 1)) + PERF_HIST_SUB + 1)
+		<< shift) - 1;
+}
+
+/*---------------------------------------------------------------------------*/
+/* perf_hist_merge							     */
+/*---------------------------------------------------------------------------*/
+void perf_hist_merge(struct perf_hist *dst, const struct perf_hist *src)
+{
+	uint32_t i;
+
+	for (i = 0; i < PERF_HIST_BUCKETS; i++)
+		dst->bucket[i] += src->bucket[i];
+	dst->count += src->count;
+}
+
+/*---------------------------------------------------------------------------*/
+/* perf_hist_percentile							     */
+/*---------------------------------------------------------------------------*/
+uint64_t perf_hist_percentile(const struct perf_hist *hist,
+			      uint32_t permille)
+{
+	uint64_t	rank, seen = 0;
+	uint32_t	i;
+
+	if (hist->count == 0)
+		return 0;
+
+	rank = (hist->count * permille + 999) / 1000;
+	if (rank == 0)
+		rank = 1;
+
+	for (i = 0; i < PERF_HIST_BUCKETS; i++) {
+		seen += hist->bucket[i];
+		if (seen >= rank)
+			return perf_hist_bucket_max(i);
+	}
+
+	return perf_hist_bucket_max(PERF_HIST_BUCKETS - 1);
+}
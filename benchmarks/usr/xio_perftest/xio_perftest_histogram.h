@@ -0,0 +1,93 @@
+/*
+ * Copyright (c) 2013 Mellanox Technologies®. All rights reserved.
+ *
+ * This software is available to you under a choice of one of two licenses.
+ * You may choose to be licensed under the terms of the GNU General Public
+ * License (GPL) Version 2, available from the file COPYING in the main
+ * directory of this source tree, or the Mellanox Technologies® BSD license
+ * below:
+ *
+ *      - Redistribution and use in source and binary forms, with or without
+ *        modification, are permitted provided that the following conditions
+ *        are met:
+ *
+ *      - Redistributions of source code must retain the above copyright
+ *        notice, this list of conditions and the following disclaimer.
+ *
+ *      - Redistributions in binary form must reproduce the above
+ *        copyright notice, this list of conditions and the following
+ *        disclaimer in the documentation and/or other materials
+ *        provided with the distribution.
+ *
+ *      - Neither the name of the Mellanox Technologies® nor the names of its
+ *        contributors may be used to endorse or promote products derived from
+ *        this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+#ifndef XIO_PERFTEST_HISTOGRAM_H
+#define XIO_PERFTEST_HISTOGRAM_H
+
+#include <stdint.h>
+
+/*---------------------------------------------------------------------------*/
+/* log-linear latency histogram in cycles. values below 16 have a bucket    */
+/* each, every power of two above is split in 16 so the percentiles are     */
+/* within 6.25% of the true value whatever the shape of the tail	     */
+/*---------------------------------------------------------------------------*/
+#define PERF_HIST_SUB_BITS		4
+#define PERF_HIST_SUB			(1 << PERF_HIST_SUB_BITS)
+#define PERF_HIST_MSB_MAX		44
+#define PERF_HIST_GROUPS	(PERF_HIST_MSB_MAX - PERF_HIST_SUB_BITS + 1)
+#define PERF_HIST_BUCKETS		(PERF_HIST_GROUPS << PERF_HIST_SUB_BITS)
+
+struct perf_hist {
+	uint64_t		count;
+	uint64_t		bucket[PERF_HIST_BUCKETS];
+};
+
+/*---------------------------------------------------------------------------*/
+/* perf_hist_record							     */
+/*---------------------------------------------------------------------------*/
+static inline void perf_hist_record(struct perf_hist *hist, uint64_t cycles)
+{
+	uint32_t msb, idx;
+
+	if (cycles < PERF_HIST_SUB) {
+		idx = cycles;
+	} else {
+		msb = 63 - __builtin_clzll(cycles);
+		if (msb >= PERF_HIST_MSB_MAX)
+			idx = PERF_HIST_BUCKETS - 1;
+		else
+			idx = ((msb - PERF_HIST_SUB_BITS + 1) <<
+			       PERF_HIST_SUB_BITS) +
+			      ((cycles >> (msb - PERF_HIST_SUB_BITS)) &
+			       (PERF_HIST_SUB - 1));
+	}
+	hist->bucket[idx]++;
+	hist->count++;
+}
+
+/*---------------------------------------------------------------------------*/
+/* perf_hist_merge							     */
+/*---------------------------------------------------------------------------*/
+void perf_hist_merge(struct perf_hist *dst, const struct perf_hist *src);
+
+/*---------------------------------------------------------------------------*/
+/* perf_hist_percentile - upper bound in cycles of the permille bucket	     */
+/*---------------------------------------------------------------------------*/
+uint64_t perf_hist_percentile(const struct perf_hist *hist,
+			      uint32_t permille);
+
+#endif /* XIO_PERFTEST_HISTOGRAM_H */
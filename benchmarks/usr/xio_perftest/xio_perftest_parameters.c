@@ -50,6 +50,7 @@
 
 
 #define test_type_str(type) (((type) == BW) ? "BW" : "LAT")
+#define output_format_str(fmt) (((fmt) == JSON) ? "json" : "csv")
 
 /*---------------------------------------------------------------------------*/
 /* isnumeric								     */
@@ -91,6 +92,62 @@ static int tokenize_host_port(char *token, char *host, uint16_t *port)
 	return 0;
 }
 
+/*---------------------------------------------------------------------------*/
+/* size_to_log2 - round a message size down to a power of two		     */
+/*---------------------------------------------------------------------------*/
+static int size_to_log2(char *str, uint32_t *log2)
+{
+	char		*end;
+	uint64_t	size = strtoull(str, &end, 0);
+
+	switch (*end) {
+	case 'k': case 'K':
+		size <<= 10;
+		end++;
+		break;
+	case 'm': case 'M':
+		size <<= 20;
+		end++;
+		break;
+	default:
+		break;
+	}
+	if (*end || size == 0 || size > (1ULL << XIO_MAX_SIZE_LOG2))
+		return -1;
+
+	*log2 = 63 - __builtin_clzll(size);
+
+	return 0;
+}
+
+/* parses "min[:max]" string */
+/*---------------------------------------------------------------------------*/
+/* sizes_arg_to_range							     */
+/*---------------------------------------------------------------------------*/
+static int sizes_arg_to_range(char *sizes_arg,
+			      struct perf_parameters *user_param)
+{
+	char	*p = strstr(sizes_arg, ":");
+
+	if (p)
+		*p++ = 0;
+
+	if (size_to_log2(sizes_arg, &user_param->min_size_log2))
+		return -1;
+
+	if (p == NULL) {
+		user_param->max_size_log2 = user_param->min_size_log2;
+		return 0;
+	}
+	if (size_to_log2(p, &user_param->max_size_log2))
+		return -1;
+
+	if (user_param->max_size_log2 < user_param->min_size_log2)
+		return -1;
+
+	return 0;
+}
+
 /* parses "host:port;host:port;..." string */
 /*---------------------------------------------------------------------------*/
 /* portals_arg_to_urls							     */
@@ -173,6 +230,25 @@ void usage(const char *argv0, int status)
 	printf("\t\t\tSet the number of messages to send " \
 	       "(default %d)\n", XIO_DEF_QUEUE_DEPTH);
 
+	printf("\t-s, --sizes=<min>[:<max>] ");
+	printf("\t\t\tSweep message sizes in powers of two " \
+	       "(default %u:%u)\n",
+	       1U << XIO_DEF_MIN_SIZE_LOG2, 1U << XIO_DEF_MAX_SIZE_LOG2);
+
+	printf("\t-C, --connections=<number> ");
+	printf("\t\t\tSet the number of connections per thread " \
+	       "(default %d)\n", XIO_DEF_CONNS_NUM);
+
+	printf("\t-r, --rate=<req/sec> ");
+	printf("\t\t\t\tOpen loop at a total request rate, " \
+	       "0 for closed loop (default %d)\n", XIO_DEF_RATE);
+
+	printf("\t-o, --output_file=<file> ");
+	printf("\t\t\tWrite the results to <file>\n");
+
+	printf("\t-f, --format=<csv|json> ");
+	printf("\t\t\tSet the output file format (default csv)\n");
+
 	printf("\t-v, --version ");
 	printf("\t\t\t\t\tPrint the version and exit\n");
 
@@ -187,8 +263,14 @@ void usage(const char *argv0, int status)
 /*---------------------------------------------------------------------------*/
 static int force_dependencies(struct perf_parameters *user_param)
 {
-	if (user_param->test_type == LAT) {
+	if (user_param->rate) {
+		/* open loop - queue depth only caps the requests in flight */
+		if (user_param->queue_depth == XIO_DEF_QUEUE_DEPTH)
+			user_param->queue_depth = OPEN_LOOP_QUEUE_DEPTH;
+	} else if (user_param->test_type == LAT) {
 		user_param->queue_depth = LAT_QUEUE_DEPTH;
+	}
+	if (user_param->test_type == LAT) {
 		if (user_param->poll_timeout == XIO_DEF_POLL_TIMEOUT) {
 			if (user_param->machine_type == SERVER)
 				user_param->poll_timeout =
@@ -235,6 +317,11 @@ static void init_perf_params(struct perf_parameters *user_param)
 	user_param->queue_depth		= XIO_DEF_QUEUE_DEPTH;
 	user_param->poll_timeout	= XIO_DEF_POLL_TIMEOUT;
 	user_param->threads_num		= XIO_DEF_THREADS_NUM;
+	user_param->conns_num		= XIO_DEF_CONNS_NUM;
+	user_param->rate		= XIO_DEF_RATE;
+	user_param->min_size_log2	= XIO_DEF_MIN_SIZE_LOG2;
+	user_param->max_size_log2	= XIO_DEF_MAX_SIZE_LOG2;
+	user_param->output_format	= CSV;
 	user_param->test_type		= XIO_TEST_TYPE;
 	user_param->verb		= XIO_VERB;
 	user_param->machine_type	= SERVER;
@@ -283,12 +370,16 @@ int parse_cmdline(struct perf_parameters *user_param,
 			{ .name = "poll_time",   .has_arg = 1, .val = 't'},
 			{ .name = "queue_depth", .has_arg = 1, .val = 'q'},
 			{ .name = "output file", .has_arg = 1, .val = 'o'},
+			{ .name = "format",	 .has_arg = 1, .val = 'f'},
+			{ .name = "sizes",	 .has_arg = 1, .val = 's'},
+			{ .name = "connections", .has_arg = 1, .val = 'C'},
+			{ .name = "rate",	 .has_arg = 1, .val = 'r'},
 			{ .name = "version",	 .has_arg = 0, .val = 'v'},
 			{ .name = "help",	 .has_arg = 0, .val = 'h'},
 			{0, 0, 0, 0},
 		};
 
-		static char *short_options = "c:p:n:w:t:q:o:vh";
+		static char *short_options = "c:p:n:w:t:q:o:f:s:C:r:vh";
 
 		c = getopt_long(argc, argv, short_options,
 				long_options, NULL);
@@ -339,6 +430,34 @@ int parse_cmdline(struct perf_parameters *user_param,
 			if (optarg)
 				user_param->output_file = strdup(optarg);
 		break;
+		case 'f':
+			if (strcmp(optarg, "json") == 0) {
+				user_param->output_format = JSON;
+			} else if (strcmp(optarg, "csv") == 0) {
+				user_param->output_format = CSV;
+			} else {
+				fprintf(stderr, "unknown format %s\n", optarg);
+				return -1;
+			}
+			break;
+		case 's':
+			if (sizes_arg_to_range(optarg, user_param)) {
+				fprintf(stderr, "failed to parse sizes\n");
+				return -1;
+			}
+			break;
+		case 'C':
+			user_param->conns_num =
+				(uint32_t)strtol(optarg, NULL, 0);
+			if (user_param->conns_num < 1) {
+				fprintf(stderr, "at least one connection\n");
+				return -1;
+			}
+			break;
+		case 'r':
+			user_param->rate =
+				(uint32_t)strtol(optarg, NULL, 0);
+			break;
 		case 'v':
 			printf("version: %s\n", XIO_PERF_VERSION);
 			exit(0);
@@ -391,11 +510,24 @@ void print_test_info(const struct perf_parameters *user_param)
 	       user_param->queue_depth);
 	printf(" Threads		: %d\n",
 	       user_param->threads_num);
+	if (user_param->machine_type == CLIENT) {
+		printf(" Connections		: %d per thread\n",
+		       user_param->conns_num);
+		printf(" Message sizes		: %u - %u\n",
+		       1U << user_param->min_size_log2,
+		       1U << user_param->max_size_log2);
+		if (user_param->rate)
+			printf(" Open loop rate		: %u req/sec\n",
+			       user_param->rate);
+		else
+			printf(" Closed loop		: yes\n");
+	}
 	printf(" Poll timeout		: %d\n",
 	       user_param->poll_timeout);
 	if (user_param->output_file)
-		printf(" Output file		: %s\n",
-		       user_param->output_file);
+		printf(" Output file		: %s (%s)\n",
+		       user_param->output_file,
+		       output_format_str(user_param->output_format));
 	printf(" CPU Affinity		: %x\n",
 	       user_param->cpu);
 	printf(" =============================================\n");
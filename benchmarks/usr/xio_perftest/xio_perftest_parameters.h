@@ -47,6 +47,9 @@ typedef enum { SERVER , CLIENT , UNCHOSEN} MachineType;
 /* verb operation */
 typedef enum { READ, WRITE} Verb;
 
+/* format of the output file */
+typedef enum { CSV, JSON} OutputFormat;
+
 
 
 #define LAT_QUEUE_DEPTH			1
@@ -78,14 +81,20 @@ typedef enum { READ, WRITE} Verb;
 #endif
 
 #define XIO_DEF_THREADS_NUM		0
+#define XIO_DEF_CONNS_NUM		1
+#define XIO_DEF_RATE			0
+#define XIO_DEF_MIN_SIZE_LOG2		0
+#define XIO_DEF_MAX_SIZE_LOG2		23
+#define XIO_MAX_SIZE_LOG2		30
+#define OPEN_LOOP_QUEUE_DEPTH		256
 #define XIO_PERF_VERSION		"1.0.0"
 
-#define RESULT_LINE "----------------------------------------------------------------------------------------------------------------------\n"
+#define RESULT_LINE "--------------------------------------------------------------------------------------------------------------------------------\n"
 
 /* The format of the results */
-#define RESULT_FMT		" #bytes     #threads   #TPS       BW average[MBps]   Latency average[usecs]   Latency low[usecs]   Latency peak[usecs]\n"
+#define RESULT_FMT		" #bytes     #threads  #conns  #TPS        BW average[MBps]  avg[usecs]  low       p50       p90       p99       p99.9     peak\n"
 /* Result print format */
-#define REPORT_FMT		" %-7lu     %d         %-7.2lu	  %-7.2lf            %-7.2lf		      %-7.2lf		    %-7.2lf\n"
+#define REPORT_FMT		" %-10lu %-9d %-7d %-11lu %-17.2lf %-11.2lf %-9.2lf %-9.2lf %-9.2lf %-9.2lf %-9.2lf %.2lf\n"
 
 
 struct perf_parameters {
@@ -95,9 +104,15 @@ struct perf_parameters {
 	uint32_t		poll_timeout;
 	uint32_t		threads_num;
 	uint32_t		portals_arr_len;
+	uint32_t		conns_num;	/* connections per thread */
+	uint32_t		rate;		/* req/sec, 0 for closed loop */
+	uint32_t		min_size_log2;
+	uint32_t		max_size_log2;
 	TestType		test_type;
 	MachineType		machine_type;
 	Verb			verb;
+	OutputFormat		output_format;
+	int			pad;
 	char			*output_file;
 	char			*portals;
 	char			**portals_arr;
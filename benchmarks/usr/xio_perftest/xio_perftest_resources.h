@@ -53,11 +53,17 @@ struct test_parameters {
 struct test_results {
 	uint32_t		bytes;
 	uint32_t		threads;
+	uint32_t		conns;
+	uint32_t		rate;
 	uint64_t		tps;
 	double			avg_bw;
 	double			avg_lat;
 	double			min_lat;
 	double			max_lat;
+	double			p50_lat;
+	double			p90_lat;
+	double			p99_lat;
+	double			p999_lat;
 
 };
 
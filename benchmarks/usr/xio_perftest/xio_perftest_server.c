@@ -334,10 +334,15 @@ static void on_test_results(struct test_results *results)
 	printf(REPORT_FMT,
 	       (uint64_t)results->bytes,
 	       results->threads,
+	       results->conns,
 	       results->tps,
 	       results->avg_bw,
 	       results->avg_lat,
 	       results->min_lat,
+	       results->p50_lat,
+	       results->p90_lat,
+	       results->p99_lat,
+	       results->p999_lat,
 	       results->max_lat);
 }
 
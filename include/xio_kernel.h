@@ -50,6 +50,10 @@
 /* preprocessor directives                                                   */
 /*---------------------------------------------------------------------------*/
 #define XIO_MAX_IOV			16	/* limit message fragments */
+#define XIO_MAX_EXT_IOV			256	/* user space only, the kernel
+						 * rejects data_iovlen above
+						 * XIO_MAX_IOV
+						 */
 #define XIO_VERSION			0x0100
 
 
@@ -98,7 +102,20 @@ enum xio_optname {
 	XIO_OPTNAME_ENABLE_DMA_LATENCY,   /**< enables the dma latency        */
 
 	XIO_OPTNAME_RDMA_BUF_THRESHOLD,   /**< set/get rdma buffer threshold  */
-	XIO_OPTNAME_MEM_ALLOCATOR         /**< set customed allocators hooks  */
+	XIO_OPTNAME_MEM_ALLOCATOR,        /**< set customed allocators hooks  */
+
+	XIO_OPTNAME_TCLASS_ATTR,	  /**< set/get traffic class	      */
+					  /**< scheduling - xio_tclass_attr   */
+	XIO_OPTNAME_TX_QUEUE_ATTR,	  /**< set/get send queue watermarks  */
+					  /**< - xio_tx_queue_attr	      */
+	XIO_OPTNAME_HEDGE_ATTR,		  /**< set/get request hedging	      */
+					  /**< policy - xio_hedge_attr	      */
+	XIO_OPTNAME_RESUME_ATTR,	  /**< set/get session resumption     */
+					  /**< policy - xio_resume_attr	      */
+	XIO_OPTNAME_ENABLE_SHM_STATS,	  /**< user space only		      */
+	XIO_OPTNAME_TRACE_ATTR,		  /**< set/get task lifecycle tracing */
+	XIO_OPTNAME_LOG_ATTR,		  /**< set/get log delivery and rate  */
+	XIO_OPTNAME_METRICS_ATTR	  /**< set/get the OpenMetrics	      */
 };
 
 /*  A number random enough not to collide with different errno ranges.       */
@@ -138,13 +155,25 @@ enum xio_status {
 	XIO_E_MSG_FLUSHED		= (XIO_BASE_STATUS + 28)
 };
 
+/* requests of a resilient session are delivered at least once - a request
+ * answered just before the transport failed is delivered again on replay
+ */
 enum xio_session_flags {
 	XIO_SESSION_FLAG_DONTQUEUE	= 0x001, /*  do not queue messages */
+	XIO_SESSION_FLAG_RESILIENT	= 0x002, /*  resume the session    */
+						 /*  after transport loss */
+};
+
+enum xio_accept_policy {
+	XIO_ACCEPT_ROUND_ROBIN,
+	XIO_ACCEPT_LEAST_LOADED,
+	XIO_ACCEPT_PEER_HASH,
 };
 
 enum xio_msg_flags {
 	/* request flags */
-	XIO_MSG_FLAG_REQUEST_READ_RECEIPT = 0x1
+	XIO_MSG_FLAG_REQUEST_READ_RECEIPT = 0x1,
+	XIO_MSG_FLAG_HEDGE		  = 0x2
 };
 
 enum xio_session_event {
@@ -176,6 +205,141 @@ enum xio_receipt_result {
 	XIO_READ_RECEIPT_REJECT,
 };
 
+enum xio_msg_tclass {
+	XIO_MSG_TCLASS_NORMAL,
+	XIO_MSG_TCLASS_INTERACTIVE,
+	XIO_MSG_TCLASS_BULK,
+	XIO_MSG_TCLASS_MAX,
+};
+
+struct xio_tclass_attr {
+	enum xio_msg_tclass	tclass;		/**< class to configure	      */
+	uint32_t		quantum;	/**< bytes served per round   */
+	uint32_t		reserve;	/**< requests in flight kept  */
+						/**< for this class alone     */
+	uint32_t		reserved;	/**< reseved for padding      */
+};
+
+struct xio_tx_queue_attr {
+	uint32_t		high_msgs;	/**< queued messages mark     */
+	uint32_t		low_msgs;	/**< and where it clears      */
+	uint64_t		high_bytes;	/**< queued bytes mark        */
+	uint64_t		low_bytes;	/**< and where it clears      */
+	int			fail_fast;	/**< fail requests with       */
+						/**< EAGAIN above the mark    */
+	uint32_t		reserved;	/**< reseved for padding      */
+};
+
+struct xio_hedge_attr {
+	uint32_t		percentile;	/**< in tenths of percent,    */
+						/**< e.g. 990 is p99. 0 - off */
+	uint32_t		min_delay;	/**< delay bounds in msec     */
+	uint32_t		max_delay;	/**< also used until enough   */
+						/**< samples were seen        */
+	uint32_t		reserved;	/**< reseved for padding      */
+};
+
+struct xio_resume_attr {
+	uint32_t		window;		/**< msec, 0 - off	      */
+	uint32_t		min_delay;	/**< retry delay bounds in    */
+	uint32_t		max_delay;	/**< msec		      */
+	uint32_t		reserved;	/**< reseved for padding      */
+};
+
+struct xio_rebalance_attr {
+	int			interval;	/**< msec between checks      */
+	int			imbalance;	/**< percent above the least  */
+						/**< loaded context to act on */
+};
+
+enum xio_trace_event {
+	XIO_TRACE_SEND_REQ,		/**< request queued by the user	 */
+	XIO_TRACE_XMIT_REQ,		/**< request posted to the wire	 */
+	XIO_TRACE_TX_COMP_REQ,		/**< request send completed	 */
+	XIO_TRACE_RECV_REQ,		/**< request arrived		 */
+	XIO_TRACE_ON_REQ,		/**< request handed to the user	 */
+	XIO_TRACE_SEND_RSP,		/**< response queued by the user */
+	XIO_TRACE_XMIT_RSP,		/**< response posted to the wire */
+	XIO_TRACE_TX_COMP_RSP,		/**< response send completed	 */
+	XIO_TRACE_RECV_RSP,		/**< response arrived		 */
+	XIO_TRACE_ON_RSP,		/**< response handed to the user */
+	XIO_TRACE_LAST
+};
+
+struct xio_trace_rec {
+	uint64_t		cycles;		/**< timestamp		      */
+	uint64_t		sn;		/**< session serial number    */
+	uint32_t		ltid;		/**< local task id	      */
+	uint32_t		rtid;		/**< remote task id	      */
+	uint32_t		event;		/**< enum xio_trace_event     */
+	uint32_t		reserved;
+};
+
+struct xio_trace_attr {
+	uint32_t		enable;
+	uint32_t		ring_size;	/**< records, power of 2      */
+};
+
+/* not supported in the kernel, printk is already deferred */
+struct xio_log_attr {
+	uint32_t		async;
+	uint32_t		ring_size;
+	uint32_t		rate_burst;
+	uint32_t		rate_interval_ms;
+};
+
+/* not supported in the kernel, the exporter is a user space facility */
+struct xio_metrics_attr {
+	char			addr[112];
+	uint32_t		interval_ms;
+	uint32_t		reserved;
+};
+
+enum xio_latency_type {
+	XIO_LATENCY_RTT,		/**< request sent to response    */
+					/**< received			 */
+	XIO_LATENCY_APP,		/**< request delivered to its	 */
+					/**< response sent		 */
+	XIO_LATENCY_QUEUE,		/**< request sent to posted on	 */
+					/**< the transport		 */
+	XIO_LATENCY_POST,		/**< message submitted to posted */
+					/**< on the wire		 */
+	XIO_LATENCY_SEND,		/**< message posted to its send	 */
+					/**< completion reaped		 */
+	XIO_LATENCY_RECV,		/**< receive completion reaped	 */
+					/**< to message delivered	 */
+	XIO_LATENCY_LAST
+};
+
+struct xio_latency_stats {
+	uint64_t		count;		/**< samples recorded	      */
+	uint64_t		mean;		/**< in nsec		      */
+	uint64_t		p50;
+	uint64_t		p90;
+	uint64_t		p99;
+	uint64_t		p999;
+	uint64_t		max;
+};
+
+enum xio_transport_gauge {
+	XIO_TRANSPORT_TX_READY,		/**< tasks ready, not yet posted */
+	XIO_TRANSPORT_REQS_IN_FLIGHT,
+	XIO_TRANSPORT_RSPS_IN_FLIGHT,
+	XIO_TRANSPORT_SQE_AVAIL,
+	XIO_TRANSPORT_RQE_AVAIL,
+	XIO_TRANSPORT_CQE_AVAIL,
+	XIO_TRANSPORT_PEER_CREDITS,
+	XIO_TRANSPORT_GAUGE_LAST
+};
+
+struct xio_transport_stats {
+	uint64_t		window_stalls;
+	uint64_t		credit_stalls;
+	uint32_t		gauge[XIO_TRANSPORT_GAUGE_LAST];
+	uint32_t		reserved;
+	uint64_t		avg_milli[XIO_TRANSPORT_GAUGE_LAST];
+};
+
 /*---------------------------------------------------------------------------*/
 /* opaque data structures                                                    */
 /*---------------------------------------------------------------------------*/
@@ -184,6 +348,7 @@ struct xio_server;		/* server handle		*/
 struct xio_session;		/* session handle		*/
 struct xio_connection;		/* connection handle		*/
 struct xio_mr;			/* registered memory handle	*/
+struct xio_rebalancer;		/* rebalancing group		*/
 
 /*---------------------------------------------------------------------------*/
 /* typedefs								     */
@@ -258,6 +423,9 @@ struct xio_vmsg {
 	struct xio_iovec	header;		/* header's iovec */
 	size_t			data_iovlen;	/* number of items in vector  */
 	struct xio_iovec_ex	data_iov[XIO_MAX_IOV];
+	struct xio_iovec_ex	*pdata_iov;	/* user space only, not used by
+						 * the kernel transports
+						 */
 };
 
 /**
@@ -269,6 +437,27 @@ struct xio_msg_pdata {
         struct xio_msg          **prev;         /**< internal library usage   */
 };
 
+/**
+ * @struct xio_msg_tmo
+ * @brief message deadline data used internaly by the library
+ */
+struct xio_msg_tmo {
+        struct xio_msg          *next;          /**< internal library usage   */
+        struct xio_msg          **prev;         /**< internal library usage   */
+        uint32_t                expire;         /**< internal library usage   */
+        uint32_t                state;          /**< internal library usage   */
+};
+
+/* the kernel transports stamp only the submit and deliver stages */
+enum xio_msg_stage {
+	XIO_STAGE_SUBMIT,
+	XIO_STAGE_POST,
+	XIO_STAGE_SEND_COMP,
+	XIO_STAGE_RECV_COMP,
+	XIO_STAGE_DELIVER,
+	XIO_STAGE_LAST
+};
+
 /**
  * @struct xio_msg
  * @brief  accelio's message definition
@@ -295,12 +484,18 @@ struct xio_msg {
         int                     flags;          /**< message flags mask       */
         enum xio_receipt_result receipt_res;    /**< the receipt result if    */
                                                 /**< required                 */
-        int                     reserved;       /**< reseved for padding      */
+        int                     tclass;         /**< enum xio_msg_tclass      */
+        uint32_t                timeout;        /**< request deadline in msec */
+                                                /**< 0 - no deadline          */
+        uint32_t                reserved;       /**< structure alignment      */
         uint64_t                timestamp;      /**< submission timestamp     */
         void                    *user_context;  /**< private user data        */
                                                 /**< not sent to the peer     */
 	struct xio_msg_pdata	pdata;		/**< accelio private data     */
+        struct xio_msg_tmo      tmo;            /**< accelio deadline data    */
+        void                    *hedge;         /**< accelio hedging data     */
         struct xio_msg          *next;          /**< send list of messages    */
+        uint64_t                stamp[XIO_STAGE_LAST]; /**< stage timestamps  */
 };
 
 /**
@@ -414,6 +609,16 @@ struct xio_session_ops {
 	/* notify the user to assign a data buffer for incoming read */
 	int (*assign_data_in_buf)(struct xio_msg *msg,
 				  void *cb_user_context);
+
+	/* send queue crossed its high watermark */
+	int (*on_tx_queue_high)(struct xio_session *session,
+				struct xio_connection *conn,
+				void *conn_user_context);
+
+	/* send queue drained below its low watermark */
+	int (*on_tx_queue_low)(struct xio_session *session,
+			       struct xio_connection *conn,
+			       void *conn_user_context);
 };
 
 /**
@@ -628,6 +833,42 @@ struct xio_context *xio_context_create(unsigned int flags,
  */
 void xio_context_destroy(struct xio_context *ctx);
 
+/**
+ * xio_context_get_latency - summarize the latencies of a context.
+ *
+ * @ctx: The xio context handle.
+ * @type: the latency to summarize.
+ * @stats: the summary, in nsec.
+ *
+ * RETURNS: success (0), or a (negative) error value.
+ */
+int xio_context_get_latency(struct xio_context *ctx,
+			    enum xio_latency_type type,
+			    struct xio_latency_stats *stats);
+
+/**
+ * xio_context_reset_latency - clear the latency histograms of a context
+ *			       and of its connections.
+ *
+ * @ctx: The xio context handle.
+ *
+ * RETURNS: success (0), or a (negative) error value.
+ */
+int xio_context_reset_latency(struct xio_context *ctx);
+
+/**
+ * xio_context_get_trace - copy the newest trace records of a context,
+ *			   oldest first.
+ *
+ * @ctx: The xio context handle.
+ * @recs: array of nrecs records.
+ * @nrecs: array size.
+ *
+ * RETURNS: number of records copied, or a (negative) error value.
+ */
+int xio_context_get_trace(struct xio_context *ctx,
+			  struct xio_trace_rec *recs, int nrecs);
+
 /*---------------------------------------------------------------------------*/
 /* XIO session API                                                           */
 /*---------------------------------------------------------------------------*/
@@ -697,6 +938,106 @@ int xio_disconnect(struct xio_connection *conn);
  */
 int xio_connection_destroy(struct xio_connection *conn);
 
+/**
+ * set the connection on which hedged requests of conn are duplicated
+ *
+ * @param[in] conn	The xio connection handle
+ * @param[in] alt	connection on the same context. NULL stops hedging
+ *
+ * @returns success (0), or a (negative) error value
+ */
+int xio_set_hedge_connection(struct xio_connection *conn,
+			     struct xio_connection *alt);
+
+/**
+ * stripe the messages sent on conn over conn and additional paths
+ *
+ * @param[in] conn	The xio connection handle
+ * @param[in] paths	connections on the same context
+ * @param[in] npaths	number of paths. 0 stops striping
+ *
+ * @returns success (0), or a (negative) error value
+ */
+int xio_set_connection_paths(struct xio_connection *conn,
+			     struct xio_connection **paths, int npaths);
+
+/**
+ * move conn to another context. the target context reconnects, queued
+ * requests move over and conn closes once its in flight requests drain
+ *
+ * @param[in] conn	The xio connection handle
+ * @param[in] ctx	target context
+ *
+ * @returns success (0), or a (negative) error value
+ */
+int xio_connection_migrate(struct xio_connection *conn,
+			   struct xio_context *ctx);
+
+/**
+ * xio_connection_get_latency - summarize the latencies of a connection.
+ *
+ * @conn: The xio connection handle.
+ * @type: the latency to summarize.
+ * @stats: the summary, in nsec.
+ *
+ * RETURNS: success (0), or a (negative) error value.
+ */
+int xio_connection_get_latency(struct xio_connection *conn,
+			       enum xio_latency_type type,
+			       struct xio_latency_stats *stats);
+
+/**
+ * xio_connection_get_transport_stats - read the transport queue gauges of
+ *					a connection.
+ *
+ * @conn: The xio connection handle.
+ * @stats: the gauges and stall counts.
+ *
+ * RETURNS: success (0), or a (negative) error value. the kernel
+ * transports do not keep them.
+ */
+int xio_connection_get_transport_stats(struct xio_connection *conn,
+				       struct xio_transport_stats *stats);
+
+/**
+ * xio_rebalancer_create - create a group of contexts whose client
+ *			   connections are rebalanced automatically
+ *
+ * @attr: rebalancing policy.
+ *
+ * RETURNS: rebalancer handle, or NULL on error.
+ */
+struct xio_rebalancer *xio_rebalancer_create(struct xio_rebalance_attr *attr);
+
+/**
+ * xio_rebalancer_destroy - destroy an empty rebalancing group.
+ *
+ * @rb: The rebalancer handle.
+ *
+ * RETURNS: success (0), or a (negative) error value.
+ */
+int xio_rebalancer_destroy(struct xio_rebalancer *rb);
+
+/**
+ * xio_rebalancer_add_ctx - add a context to a group, from its thread.
+ *
+ * @rb: The rebalancer handle.
+ * @ctx: The xio context handle.
+ *
+ * RETURNS: success (0), or a (negative) error value.
+ */
+int xio_rebalancer_add_ctx(struct xio_rebalancer *rb, struct xio_context *ctx);
+
+/**
+ * xio_rebalancer_del_ctx - remove a context from a group, from its thread.
+ *
+ * @rb: The rebalancer handle.
+ * @ctx: The xio context handle.
+ *
+ * RETURNS: success (0), or a (negative) error value.
+ */
+int xio_rebalancer_del_ctx(struct xio_rebalancer *rb, struct xio_context *ctx);
+
 /**
  * xio_send_request - send request.
  *
@@ -776,6 +1117,38 @@ struct xio_server *xio_bind(struct xio_context *ctx,
  */
 int xio_unbind(struct xio_server *server);
 
+/**
+ * xio_bind_worker - add a context to the server's worker pool.
+ *
+ * @server: The xio server handle.
+ * @ctx: the worker's xio context handle, called from its thread.
+ *
+ * RETURNS: success (0), or a (negative) error value.
+ */
+int xio_bind_worker(struct xio_server *server, struct xio_context *ctx);
+
+/**
+ * xio_unbind_worker - remove a context from the server's worker pool.
+ *
+ * @server: The xio server handle.
+ * @ctx: the worker's xio context handle.
+ *
+ * RETURNS: success (0), or a (negative) error value.
+ */
+int xio_unbind_worker(struct xio_server *server, struct xio_context *ctx);
+
+/**
+ * xio_set_accept_policy - select how accepted connections are spread
+ *			   over the server's workers.
+ *
+ * @server: The xio server handle.
+ * @policy: The accept policy as defined in xio_accept_policy.
+ *
+ * RETURNS: success (0), or a (negative) error value.
+ */
+int xio_set_accept_policy(struct xio_server *server,
+			  enum xio_accept_policy policy);
+
 /**
  * xio_get_connection - return connection handle on server.
  *
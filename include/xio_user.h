@@ -61,6 +61,12 @@ extern "C" {
  */
 #define XIO_MAX_IOV			16
 
+/**
+ * @def XIO_MAX_EXT_IOV
+ * @brief maximum size of external data IO vector in message
+ */
+#define XIO_MAX_EXT_IOV			256
+
 /**
  * @def XIO_VERSION
  * @brief accelio current api version number
@@ -136,7 +142,29 @@ enum xio_optname {
 	XIO_OPTNAME_ENABLE_DMA_LATENCY,   /**< enables the dma latency        */
 
 	XIO_OPTNAME_RDMA_BUF_THRESHOLD,   /**< set/get rdma buffer threshold  */
-	XIO_OPTNAME_MEM_ALLOCATOR         /**< set customed allocators hooks  */
+	XIO_OPTNAME_MEM_ALLOCATOR,        /**< set customed allocators hooks  */
+
+	XIO_OPTNAME_RDMA_STREAM_CHUNK_SZ, /**< set/get streaming chunk size   */
+	XIO_OPTNAME_RDMA_STREAM_WINDOW,   /**< set/get streaming chunks in    */
+					  /**< flight per message	      */
+
+	XIO_OPTNAME_TCLASS_ATTR,	  /**< set/get traffic class	      */
+					  /**< scheduling - xio_tclass_attr   */
+	XIO_OPTNAME_TX_QUEUE_ATTR,	  /**< set/get send queue watermarks  */
+					  /**< - xio_tx_queue_attr	      */
+	XIO_OPTNAME_HEDGE_ATTR,		  /**< set/get request hedging	      */
+					  /**< policy - xio_hedge_attr	      */
+	XIO_OPTNAME_RESUME_ATTR,	  /**< set/get session resumption     */
+					  /**< policy - xio_resume_attr	      */
+	XIO_OPTNAME_ENABLE_SHM_STATS,	  /**< export the counters of the     */
+					  /**< contexts created later in      */
+					  /**< shared memory - int	      */
+	XIO_OPTNAME_TRACE_ATTR,		  /**< set/get task lifecycle tracing */
+					  /**< - xio_trace_attr		      */
+	XIO_OPTNAME_LOG_ATTR,		  /**< set/get log delivery and rate  */
+					  /**< limiting - xio_log_attr	      */
+	XIO_OPTNAME_METRICS_ATTR	  /**< set/get the OpenMetrics	      */
+					  /**< exporter - xio_metrics_attr    */
 };
 
 /**
@@ -195,10 +223,25 @@ enum xio_ev_loop_events {
 
 /**
  * @enum xio_session_flags
- * @brief session level specific flags
+ * @brief session level specific flags. requests of a resilient session
+ *	  are delivered at least once: a request whose response was sent
+ *	  before the transport failed is delivered again when the client
+ *	  replays it, so the application should handle duplicates by sn
  */
 enum xio_session_flags {
 	XIO_SESSION_FLAG_DONTQUEUE	= 0x001, /**<  do not queue messages */
+	XIO_SESSION_FLAG_RESILIENT	= 0x002, /**<  resume the session    */
+						 /**<  after transport loss */
+};
+
+/**
+ * @enum xio_accept_policy
+ * @brief how a server picks the worker context of an accepted connection
+ */
+enum xio_accept_policy {
+	XIO_ACCEPT_ROUND_ROBIN,		/**< workers take turns		      */
+	XIO_ACCEPT_LEAST_LOADED,	/**< worker with fewest connections   */
+	XIO_ACCEPT_PEER_HASH,		/**< same client host, same worker    */
 };
 
 /**
@@ -223,6 +266,8 @@ enum xio_session_event {
  */
 enum xio_msg_flags {
 	XIO_MSG_FLAG_REQUEST_READ_RECEIPT = 0x1,  /**< request read receipt   */
+	XIO_MSG_FLAG_HEDGE		  = 0x2,  /**< request is idempotent  */
+						  /**< and may be hedged      */
 };
 
 /**
@@ -234,6 +279,328 @@ enum xio_receipt_result {
 	XIO_READ_RECEIPT_REJECT,
 };
 
+/**
+ * @enum xio_msg_tclass
+ * @brief message traffic classes - each class is queued separately and the
+ *	  connection serves the classes by deficit round robin
+ */
+enum xio_msg_tclass {
+	XIO_MSG_TCLASS_NORMAL,		/**< default class		      */
+	XIO_MSG_TCLASS_INTERACTIVE,	/**< latency sensitive messages	      */
+	XIO_MSG_TCLASS_BULK,		/**< throughput oriented transfers    */
+	XIO_MSG_TCLASS_MAX,
+};
+
+/**
+ * @struct xio_tclass_attr
+ * @brief traffic class scheduling parameters. set or get them by
+ *	  XIO_OPTNAME_TCLASS_ATTR. they are process wide defaults, each
+ *	  connection copies them when it is created
+ */
+struct xio_tclass_attr {
+	enum xio_msg_tclass	tclass;		/**< class to configure	      */
+	uint32_t		quantum;	/**< bytes served per round   */
+	uint32_t		reserve;	/**< requests in flight kept  */
+						/**< for this class alone     */
+	uint32_t		reserved;	/**< reseved for padding      */
+};
+
+/**
+ * @struct xio_tx_queue_attr
+ * @brief per connection send queue watermarks. set or get them by
+ *	  XIO_OPTNAME_TX_QUEUE_ATTR. a zero high watermark disables the
+ *	  check on that dimension. they are process wide defaults, each
+ *	  connection copies them when it is created
+ */
+struct xio_tx_queue_attr {
+	uint32_t		high_msgs;	/**< queued messages mark     */
+	uint32_t		low_msgs;	/**< and where it clears      */
+	uint64_t		high_bytes;	/**< queued bytes mark        */
+	uint64_t		low_bytes;	/**< and where it clears      */
+	int			fail_fast;	/**< fail requests with       */
+						/**< EAGAIN above the mark    */
+	uint32_t		reserved;	/**< reseved for padding      */
+};
+
+/**
+ * @struct xio_hedge_attr
+ * @brief request hedging policy. set or get it by XIO_OPTNAME_HEDGE_ATTR.
+ *	  a request flagged XIO_MSG_FLAG_HEDGE that is not answered within
+ *	  the given percentile of its connection's response times is sent
+ *	  again on the connection's hedge partner. the first response wins
+ *	  and the other copy is canceled. it is a process wide default, each
+ *	  connection copies it when it is created
+ */
+struct xio_hedge_attr {
+	uint32_t		percentile;	/**< in tenths of percent,    */
+						/**< e.g. 990 is p99. 0 - off */
+	uint32_t		min_delay;	/**< delay bounds in msec     */
+	uint32_t		max_delay;	/**< also used until enough   */
+						/**< samples were seen        */
+	uint32_t		reserved;	/**< reseved for padding      */
+};
+
+/**
+ * @struct xio_resume_attr
+ * @brief session resumption policy. set or get it by XIO_OPTNAME_RESUME_ATTR.
+ *	  a connection of a session created with XIO_SESSION_FLAG_RESILIENT
+ *	  whose transport fails reconnects within the window, retrying with
+ *	  a delay that doubles from min_delay to max_delay. requests in
+ *	  flight are replayed and a resilient server answers a replayed
+ *	  request it still serves only once. a request whose answer was
+ *	  already sent and lost is served again. after the window the
+ *	  messages are flushed as without the flag. it is a process wide
+ *	  default, each connection copies it when it is created
+ */
+struct xio_resume_attr {
+	uint32_t		window;		/**< msec, 0 - off	      */
+	uint32_t		min_delay;	/**< retry delay bounds in    */
+	uint32_t		max_delay;	/**< msec		      */
+	uint32_t		reserved;	/**< reseved for padding      */
+};
+
+/**
+ * @struct xio_rebalance_attr
+ * @brief automatic rebalancing policy. every interval each context of the
+ *	  group compares the messages it handled with the least busy one
+ *	  and, above the imbalance, migrates its busiest client connection
+ *	  there
+ */
+struct xio_rebalance_attr {
+	int			interval;	/**< msec between checks      */
+	int			imbalance;	/**< percent above the least  */
+						/**< loaded context to act on */
+};
+
+/**
+ * @enum xio_latency_type
+ * @brief latencies kept in histograms per connection and per context
+ */
+enum xio_latency_type {
+	XIO_LATENCY_RTT,		/**< request sent to response    */
+					/**< received			 */
+	XIO_LATENCY_APP,		/**< request delivered to its	 */
+					/**< response sent		 */
+	XIO_LATENCY_QUEUE,		/**< request sent to posted on	 */
+					/**< the transport		 */
+	XIO_LATENCY_POST,		/**< message submitted to posted */
+					/**< on the wire		 */
+	XIO_LATENCY_SEND,		/**< message posted to its send	 */
+					/**< completion reaped		 */
+	XIO_LATENCY_RECV,		/**< receive completion reaped	 */
+					/**< to message delivered	 */
+	XIO_LATENCY_LAST
+};
+
+/**
+ * @struct xio_latency_stats
+ * @brief summary of a latency histogram, in nanoseconds. a percentile is
+ *	  the upper bound of its histogram bucket, at most 12.5% above the
+ *	  exact value
+ */
+struct xio_latency_stats {
+	uint64_t		count;		/**< samples recorded	      */
+	uint64_t		mean;
+	uint64_t		p50;
+	uint64_t		p90;
+	uint64_t		p99;
+	uint64_t		p999;
+	uint64_t		max;
+};
+
+/**
+ * @enum xio_transport_gauge
+ * @brief transport queue gauges of a connection
+ */
+enum xio_transport_gauge {
+	XIO_TRANSPORT_TX_READY,		/**< tasks ready, not yet posted */
+	XIO_TRANSPORT_REQS_IN_FLIGHT,	/**< requests posted, not yet	 */
+					/**< completed			 */
+	XIO_TRANSPORT_RSPS_IN_FLIGHT,	/**< responses posted, not yet	 */
+					/**< completed			 */
+	XIO_TRANSPORT_SQE_AVAIL,	/**< free send queue elements	 */
+	XIO_TRANSPORT_RQE_AVAIL,	/**< free receive queue elements */
+	XIO_TRANSPORT_CQE_AVAIL,	/**< free completion queue	 */
+					/**< elements, of the shared cq	 */
+	XIO_TRANSPORT_PEER_CREDITS,	/**< sends the peer can receive	 */
+	XIO_TRANSPORT_GAUGE_LAST
+};
+
+/**
+ * @struct xio_transport_stats
+ * @brief transport queues of a connection. gauge holds the values now,
+ *	  avg_milli their means weighted by the time each value was held
+ *	  since the connection's first transmission, in thousandths. a
+ *	  transmission attempt finding no send window counts as a window
+ *	  stall, and also as a credit stall when the peer had no credits
+ *	  left. a credit bound connection shows credit stalls with sqes to
+ *	  spare, a NIC bound one few sqes and cqes available, a CPU bound
+ *	  one tasks piling up ready with window to post them
+ */
+struct xio_transport_stats {
+	uint64_t		window_stalls;
+	uint64_t		credit_stalls;
+	uint32_t		gauge[XIO_TRANSPORT_GAUGE_LAST];
+	uint32_t		reserved;
+	uint64_t		avg_milli[XIO_TRANSPORT_GAUGE_LAST];
+};
+
+/*---------------------------------------------------------------------------*/
+/* shared memory statistics						     */
+/*---------------------------------------------------------------------------*/
+/** shm_open name of a process's statistics region, formatted with its pid */
+#define XIO_STATS_SHM_NAME		"/xio-stats-%d"
+#define XIO_STATS_SHM_MAGIC		0x73746174736f6978ULL	/* xiostats */
+#define XIO_STATS_SHM_VERSION		1
+
+/**
+ * @struct xio_stats_shm_hdr
+ * @brief head of the statistics region of a process that set
+ *	  XIO_OPTNAME_ENABLE_SHM_STATS. nblocks blocks of block_size bytes
+ *	  start at blocks_off, one per exported context. a reader checks
+ *	  magic and version and finds every field through the offsets and
+ *	  sizes given here. the region of a process that died without
+ *	  exiting stays behind, check that pid is alive
+ */
+struct xio_stats_shm_hdr {
+	uint64_t		magic;		/**< written last	      */
+	uint32_t		version;
+	uint32_t		blocks_off;	/**< first block	      */
+	uint32_t		block_size;
+	uint32_t		nblocks;
+	uint32_t		ncounters;	/**< counters per block	      */
+	uint32_t		counters_off;	/**< in a block, uint64_t     */
+	uint32_t		name_len;	/**< bytes per counter name,  */
+						/**< nul padded		      */
+	uint32_t		names_off;	/**< in a block		      */
+	int32_t			pid;
+	uint32_t		reserved;	/**< reseved for padding      */
+	uint64_t		hertz;		/**< cycles per second of the */
+						/**< delay counters	      */
+};
+
+/**
+ * @struct xio_stats_shm_block
+ * @brief head of a context's block. the context thread copies its
+ *	  counters into the block about every 100 msec, and also takes,
+ *	  releases and renames it, with seq odd while it writes. counters
+ *	  are never reset. a reader retries until it gets a stable copy:
+ *
+ *		do {
+ *			seq = block->seq;	(volatile load)
+ *			read barrier;
+ *			copy the block;
+ *			read barrier;
+ *		} while ((seq & 1) || block->seq != seq);
+ */
+struct xio_stats_shm_block {
+	uint32_t		seq;
+	uint32_t		in_use;		/**< describes a live context */
+	int32_t			tid;		/**< thread of the context    */
+	int32_t			cpu;
+	uint64_t		start;		/**< cycles when taken	      */
+};
+
+/*---------------------------------------------------------------------------*/
+/* task lifecycle tracing						     */
+/*---------------------------------------------------------------------------*/
+/**
+ * @enum xio_trace_event
+ * @brief stages of a message recorded by the tracepoints
+ */
+enum xio_trace_event {
+	XIO_TRACE_SEND_REQ,		/**< request queued by the user	 */
+	XIO_TRACE_XMIT_REQ,		/**< request posted to the wire	 */
+	XIO_TRACE_TX_COMP_REQ,		/**< request send completed	 */
+	XIO_TRACE_RECV_REQ,		/**< request arrived		 */
+	XIO_TRACE_ON_REQ,		/**< request handed to the user	 */
+	XIO_TRACE_SEND_RSP,		/**< response queued by the user */
+	XIO_TRACE_XMIT_RSP,		/**< response posted to the wire */
+	XIO_TRACE_TX_COMP_RSP,		/**< response send completed	 */
+	XIO_TRACE_RECV_RSP,		/**< response arrived		 */
+	XIO_TRACE_ON_RSP,		/**< response handed to the user */
+	XIO_TRACE_LAST
+};
+
+/**
+ * @struct xio_trace_rec
+ * @brief a trace record. sn is the session serial number shared by a
+ *	  request and its response on both sides, 0 where the transport
+ *	  does not know it yet; the next record of the same ltid has it.
+ *	  on the responder rtid is the requester's ltid
+ */
+struct xio_trace_rec {
+	uint64_t		cycles;		/**< timestamp		      */
+	uint64_t		sn;
+	uint32_t		ltid;		/**< local task id	      */
+	uint32_t		rtid;		/**< remote task id	      */
+	uint32_t		event;		/**< enum xio_trace_event     */
+	uint32_t		reserved;
+};
+
+/**
+ * @struct xio_trace_attr
+ * @brief tracing policy. set or get it by XIO_OPTNAME_TRACE_ATTR.
+ *	  contexts created while ring_size is non zero keep that many
+ *	  records; enable switches recording on and off at any time
+ */
+struct xio_trace_attr {
+	uint32_t		enable;
+	uint32_t		ring_size;	/**< records, power of 2      */
+};
+
+#define XIO_TRACE_MAGIC			0x65636172746f6978ULL	/* xiotrace */
+#define XIO_TRACE_VERSION		1
+
+/**
+ * @struct xio_trace_file_hdr
+ * @brief head of a file written by xio_context_dump_trace, followed by
+ *	  nrecs records of rec_size bytes, oldest first
+ */
+struct xio_trace_file_hdr {
+	uint64_t		magic;
+	uint32_t		version;
+	uint32_t		rec_size;
+	uint64_t		hertz;		/**< cycles per second	      */
+	int32_t			pid;
+	int32_t			cpu;		/**< of the context	      */
+	uint64_t		nrecs;
+};
+
+/**
+ * @struct xio_log_attr
+ * @brief log delivery policy. set or get it by XIO_OPTNAME_LOG_ATTR.
+ *	  with async set the calling thread only formats the message into
+ *	  a ring of its own and a background thread writes it out. a call
+ *	  site logging more than rate_burst messages in rate_interval_ms
+ *	  is muted for the rest of the interval; zero rate_burst disables
+ *	  the limit. the default log function is the only one affected
+ */
+struct xio_log_attr {
+	uint32_t		async;
+	uint32_t		ring_size;	/**< per thread, power of 2   */
+	uint32_t		rate_burst;
+	uint32_t		rate_interval_ms;
+};
+
+/**
+ * @struct xio_metrics_attr
+ * @brief OpenMetrics exporter. set or get it by XIO_OPTNAME_METRICS_ATTR
+ *	  before creating the contexts to export, or name the address in
+ *	  the XIO_METRICS_ADDR environment variable. addr is
+ *	  "unix:<path>" or "tcp:[<host>:]<port>", the host defaults to
+ *	  the loopback; an empty addr stops the exporter. every
+ *	  interval_ms each context copies its counters, latency histograms
+ *	  and connection queue depths aside on its own thread, a scrape
+ *	  reads only the copies. HTTP GET is answered, a client that sends
+ *	  nothing gets the bare text
+ */
+struct xio_metrics_attr {
+	char			addr[112];
+	uint32_t		interval_ms;	/**< 0 for 1000		      */
+	uint32_t		reserved;
+};
+
 /** message request refered type  */
 #define XIO_REQUEST			2
 /** message response refered type */
@@ -262,6 +629,7 @@ struct xio_server;			     /* server handle                */
 struct xio_session;			     /* session handle		     */
 struct xio_connection;			     /* connection handle	     */
 struct xio_mr;				     /* registered memory handle     */
+struct xio_rebalancer;			     /* rebalancing group	     */
 
 /*---------------------------------------------------------------------------*/
 /* typedefs								     */
@@ -378,15 +746,52 @@ struct xio_msg_pdata {
 	struct xio_msg		**prev;		/**< internal library usage   */
 };
 
+/**
+ * @struct xio_msg_tmo
+ * @brief message deadline data used internaly by the library
+ */
+struct xio_msg_tmo {
+	struct xio_msg		*next;          /**< internal library usage   */
+	struct xio_msg		**prev;		/**< internal library usage   */
+	uint32_t		expire;		/**< internal library usage   */
+	uint32_t		state;		/**< internal library usage   */
+};
+
 
 /**
  * @struct xio_vmsg
  * @brief message sub element type
+ *
+ * up to XIO_MAX_IOV fragments are described in the embedded data_iov
+ * array. longer scatter gather lists (up to XIO_MAX_EXT_IOV fragments)
+ * are passed in an application owned array pointed by pdata_iov. the
+ * library consults pdata_iov only when data_iovlen exceeds XIO_MAX_IOV,
+ * and the array must remain valid until the message is completed.
  */
 struct xio_vmsg {
 	struct xio_iovec	header;		/**< header's io vector	    */
 	size_t			data_iovlen;	/**< data iovecs count	    */
 	struct xio_iovec_ex	data_iov[XIO_MAX_IOV];  /**< data io vector */
+	struct xio_iovec_ex	*pdata_iov;	/**< external data io vector */
+						/**< used when data_iovlen    */
+						/**< exceeds XIO_MAX_IOV      */
+};
+
+/**
+ * @enum xio_msg_stage
+ * @brief points of a message's life stamped in xio_msg::stamp, in cycles.
+ *	  a requester finds the stages of the request and of its response
+ *	  in the request once the response is delivered. a responder finds
+ *	  the receive stages in the request and the send stages in the
+ *	  response once its send completes. a stage not observed is 0
+ */
+enum xio_msg_stage {
+	XIO_STAGE_SUBMIT,		/**< handed to the library	 */
+	XIO_STAGE_POST,			/**< posted on the wire		 */
+	XIO_STAGE_SEND_COMP,		/**< send completion reaped	 */
+	XIO_STAGE_RECV_COMP,		/**< receive completion reaped	 */
+	XIO_STAGE_DELIVER,		/**< handed to the application	 */
+	XIO_STAGE_LAST
 };
 
 /**
@@ -415,12 +820,18 @@ struct xio_msg {
 	int			flags;		/**< message flags mask       */
 	enum xio_receipt_result	receipt_res;    /**< the receipt result if    */
 						/**< required                 */
-	int			reserved;	/**< reseved for padding      */
+	int			tclass;		/**< enum xio_msg_tclass      */
+	uint32_t		timeout;	/**< request deadline in msec */
+						/**< 0 - no deadline          */
+	uint32_t		reserved;	/**< structure alignment      */
 	uint64_t		timestamp;	/**< submission timestamp     */
 	void			*user_context;	/**< private user data        */
 						/**< not sent to the peer     */
 	struct xio_msg_pdata	pdata;		/**< accelio private data     */
+	struct xio_msg_tmo	tmo;		/**< accelio deadline data    */
+	void			*hedge;		/**< accelio hedging data     */
 	struct xio_msg		*next;          /**< send list of messages    */
+	uint64_t		stamp[XIO_STAGE_LAST]; /**< stage timestamps  */
 };
 
 /**
@@ -635,6 +1046,61 @@ struct xio_session_ops {
 	 */
 	int (*assign_data_in_buf)(struct xio_msg *msg,
 			void *conn_user_context);
+
+	/**
+	 * incoming data chunk notification - responder only
+	 *
+	 * when set, large incoming messages are streamed: the library
+	 * reads the data in chunks of XIO_OPTNAME_RDMA_STREAM_CHUNK_SZ bytes,
+	 * keeping at most XIO_OPTNAME_RDMA_STREAM_WINDOW chunks in flight,
+	 * and delivers each chunk in order. the chunk buffer is reused once
+	 * the callback returns. on_msg is called after the last chunk with
+	 * no data attached.
+	 *
+	 *  @param[in] session			the session
+	 *  @param[in] msg			the incoming message. msg->in
+	 *					describes the remote fragments
+	 *  @param[in] offset			chunk offset within the data
+	 *  @param[in] chunk			the chunk's data
+	 *  @param[in] conn_user_context	user private data provided in
+	 *					connection open on which
+	 *					the message send
+	 *  @returns 0
+	 */
+	int (*on_msg_data_chunk)(struct xio_session *session,
+			struct xio_msg *msg,
+			size_t offset,
+			struct xio_iovec *chunk,
+			void *conn_user_context);
+
+	/**
+	 * send queue crossed its high watermark notification
+	 *
+	 * messages the transport cannot take yet wait in the connection's
+	 * send queue. see XIO_OPTNAME_TX_QUEUE_ATTR
+	 *
+	 *  @param[in] session			the session
+	 *  @param[in] conn			the congested connection
+	 *  @param[in] conn_user_context	user private data provided in
+	 *					connection open
+	 *  @returns 0
+	 */
+	int (*on_tx_queue_high)(struct xio_session *session,
+			struct xio_connection *conn,
+			void *conn_user_context);
+
+	/**
+	 * send queue drained below its low watermark notification
+	 *
+	 *  @param[in] session			the session
+	 *  @param[in] conn			the connection
+	 *  @param[in] conn_user_context	user private data provided in
+	 *					connection open
+	 *  @returns 0
+	 */
+	int (*on_tx_queue_low)(struct xio_session *session,
+			struct xio_connection *conn,
+			void *conn_user_context);
 };
 
 /**
@@ -891,6 +1357,54 @@ int xio_context_set_params(struct xio_context *ctx,
  */
 struct xio_context_params *xio_context_get_params(struct xio_context *ctx);
 
+/**
+ * summarize the latencies recorded by all connections of a context. call
+ * it from the context thread for a consistent snapshot
+ *
+ * @param[in] ctx	The xio context handle
+ * @param[in] type	the latency to summarize
+ * @param[out] stats	the summary
+ *
+ * @returns success (0), or a (negative) error value
+ */
+int xio_context_get_latency(struct xio_context *ctx,
+			    enum xio_latency_type type,
+			    struct xio_latency_stats *stats);
+
+/**
+ * clear the latency histograms of a context and of its connections. call
+ * it from the context thread
+ *
+ * @param[in] ctx	The xio context handle
+ *
+ * @returns success (0), or a (negative) error value
+ */
+int xio_context_reset_latency(struct xio_context *ctx);
+
+/**
+ * copy the newest trace records of a context, oldest first. safe to call
+ * from any thread while the context runs
+ *
+ * @param[in] ctx	The xio context handle
+ * @param[out] recs	array of nrecs records
+ * @param[in] nrecs	array size
+ *
+ * @returns number of records copied, or a (negative) error value
+ */
+int xio_context_get_trace(struct xio_context *ctx,
+			  struct xio_trace_rec *recs, int nrecs);
+
+/**
+ * write the trace records of a context to a file, preceded by a struct
+ * xio_trace_file_hdr. safe to call from any thread while the context runs
+ *
+ * @param[in] ctx	The xio context handle
+ * @param[in] fd	file descriptor open for writing
+ *
+ * @returns success (0), or a (negative) error value
+ */
+int xio_context_dump_trace(struct xio_context *ctx, int fd);
+
 /*---------------------------------------------------------------------------*/
 /* XIO session API                                                           */
 /*---------------------------------------------------------------------------*/
@@ -976,6 +1490,118 @@ int xio_connection_destroy(struct xio_connection *conn);
 int xio_set_connection_params(struct xio_connection *conn,
 			      struct xio_connection_params *params);
 
+/**
+ * set the connection on which hedged requests of conn are duplicated
+ *
+ * @param[in] conn	The xio connection handle
+ * @param[in] alt	connection on the same context, typically to another
+ *			portal or replica. NULL stops hedging on conn
+ *
+ * @returns success (0), or a (negative) error value
+ */
+int xio_set_hedge_connection(struct xio_connection *conn,
+			     struct xio_connection *alt);
+
+/**
+ * stripe the messages sent on conn over conn and additional paths. each
+ * batch goes to the live path with the least queued work weighted by its
+ * completion latency, and the messages of a path that fails move to the
+ * others. responses and errors of all paths are reported on conn
+ *
+ * @param[in] conn	The xio connection handle
+ * @param[in] paths	connections on the same context, typically to other
+ *			portals or devices
+ * @param[in] npaths	number of paths. 0 stops striping
+ *
+ * @returns success (0), or a (negative) error value
+ */
+int xio_set_connection_paths(struct xio_connection *conn,
+			     struct xio_connection **paths, int npaths);
+
+/**
+ * move conn to another context of the same process. the target context
+ * opens a new connection of conn's session and the requests queued on
+ * conn and not sent yet move to it. XIO_SESSION_NEW_CONNECTION_EVENT
+ * reports the new connection on the target context's thread, with conn's
+ * user context. conn closes once its in flight requests are answered and
+ * refuses new messages with EAGAIN meanwhile. only client connections
+ * without hedge partner or striping paths can migrate. call it from
+ * conn's context thread
+ *
+ * @param[in] conn	The xio connection handle
+ * @param[in] ctx	target context, served by a running event loop
+ *
+ * @returns success (0), or a (negative) error value
+ */
+int xio_connection_migrate(struct xio_connection *conn,
+			   struct xio_context *ctx);
+
+/**
+ * create a group of contexts whose client connections are rebalanced
+ * automatically
+ *
+ * @param[in] attr	rebalancing policy
+ *
+ * @returns rebalancer handle, or NULL on error
+ */
+struct xio_rebalancer *xio_rebalancer_create(struct xio_rebalance_attr *attr);
+
+/**
+ * destroy a rebalancing group. all contexts must be removed first
+ *
+ * @param[in] rb	The rebalancer handle
+ *
+ * @returns success (0), or a (negative) error value
+ */
+int xio_rebalancer_destroy(struct xio_rebalancer *rb);
+
+/**
+ * add a context to a rebalancing group. call it from ctx's thread
+ *
+ * @param[in] rb	The rebalancer handle
+ * @param[in] ctx	The xio context handle
+ *
+ * @returns success (0), or a (negative) error value
+ */
+int xio_rebalancer_add_ctx(struct xio_rebalancer *rb, struct xio_context *ctx);
+
+/**
+ * remove a context from a rebalancing group. call it from ctx's thread
+ * before the context is destroyed
+ *
+ * @param[in] rb	The rebalancer handle
+ * @param[in] ctx	The xio context handle
+ *
+ * @returns success (0), or a (negative) error value
+ */
+int xio_rebalancer_del_ctx(struct xio_rebalancer *rb, struct xio_context *ctx);
+
+/**
+ * summarize the latencies recorded by a connection. call it from the
+ * connection's context thread for a consistent snapshot
+ *
+ * @param[in] conn	The xio connection handle
+ * @param[in] type	the latency to summarize
+ * @param[out] stats	the summary
+ *
+ * @returns success (0), or a (negative) error value
+ */
+int xio_connection_get_latency(struct xio_connection *conn,
+			       enum xio_latency_type type,
+			       struct xio_latency_stats *stats);
+
+/**
+ * read the transport queue gauges of a connection. call it from the
+ * connection's context thread
+ *
+ * @param[in] conn	The xio connection handle
+ * @param[out] stats	the gauges and stall counts
+ *
+ * @returns success (0), or a (negative) error value
+ */
+int xio_connection_get_transport_stats(struct xio_connection *conn,
+				       struct xio_transport_stats *stats);
+
 /**
  * get connection context
  *
@@ -988,6 +1614,11 @@ struct xio_context *xio_get_connection_context(struct xio_connection *conn);
 /**
  * send request to responder
  *
+ * a request with a non zero timeout is canceled by the library if no
+ * response arrived within timeout msec. its resources are released and
+ * on_msg_error is called with XIO_E_TIMEOUT. deadlines are tracked with
+ * a granularity of a few msec
+ *
  * @param[in] conn	The xio connection handle
  * @param[in] req	request message to send
  *
@@ -1106,6 +1737,42 @@ struct xio_server *xio_bind(struct xio_context *ctx,
  */
 int xio_unbind(struct xio_server *server);
 
+/**
+ * add the calling thread's context to the pool of workers that run the
+ * connections accepted by server. connection requests still arrive on the
+ * server's context but are handed over to a worker before the connection
+ * is set up, so one uri scales over many threads without redirection.
+ * must be called from the thread running ctx
+ *
+ * @param[in] server	The xio server handle
+ * @param[in] ctx	The worker's xio context handle
+ *
+ * @returns success (0), or a (negative) error value
+ */
+int xio_bind_worker(struct xio_server *server, struct xio_context *ctx);
+
+/**
+ * remove a context from the server's worker pool. connections already
+ * running on it are not affected. call it before destroying ctx
+ *
+ * @param[in] server	The xio server handle
+ * @param[in] ctx	The worker's xio context handle
+ *
+ * @returns success (0), or a (negative) error value
+ */
+int xio_unbind_worker(struct xio_server *server, struct xio_context *ctx);
+
+/**
+ * select how the server spreads accepted connections over its workers
+ *
+ * @param[in] server	The xio server handle
+ * @param[in] policy	The accept policy as defined in enum xio_accept_policy
+ *
+ * @returns success (0), or a (negative) error value
+ */
+int xio_set_accept_policy(struct xio_server *server,
+			  enum xio_accept_policy policy);
+
 /**
  * return connection handle on server
  *
@@ -0,0 +1,168 @@
+#!/usr/bin/env python
+
+# Copyright (c) 2013 Mellanox Technologies (r). All rights reserved.
+#
+# This software is available to you under a choice of one of two licenses.
+# You may choose to be licensed under the terms of the GNU General Public
+# License (GPL) Version 2, available from the file COPYING in the main
+# directory of this source tree, or the Mellanox Technologies (r) BSD license
+# below:
+#
+#      - Redistribution and use in source and binary forms, with or without
+#        modification, are permitted provided that the following conditions
+#        are met:
+#
+#      - Redistributions of source code must retain the above copyright
+#        notice, this list of conditions and the following disclaimer.
+#
+#      - Redistributions in binary form must reproduce the above
+#        copyright notice, this list of conditions and the following
+#        disclaimer in the documentation and/or other materials
+#        provided with the distribution.
+#
+#      - Neither the name of the Mellanox Technologies (r) nor the names of its
+#        contributors may be used to endorse or promote products derived from
+#        this software without specific prior written permission.
+#
+# THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+# AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+# IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+# ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE
+# LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+# CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+# SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+# INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+# CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+# ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+# POSSIBILITY OF SUCH DAMAGE.
+
+"""
+Sample the shared memory statistics region of an accelio process.
+
+The process must set XIO_OPTNAME_ENABLE_SHM_STATS before creating its
+contexts. Reading the region makes no system call into the process and
+does no work on its threads.
+
+usage: shm_statistics.py <pid> [interval seconds]
+"""
+
+from __future__ import print_function
+
+import os
+import sys
+import mmap
+import time
+import struct
+
+XIO_STATS_SHM_NAME = "/dev/shm/xio-stats-%d"
+XIO_STATS_SHM_MAGIC = 0x73746174736f6978
+XIO_STATS_SHM_VERSION = 1
+
+# struct xio_stats_shm_hdr
+HDR = struct.Struct("=QIIIIIIIIiIQ")
+# struct xio_stats_shm_block
+BLOCK = struct.Struct("=IIiiQ")
+
+class Region(object):
+    """Read only mapping of a process's statistics region."""
+
+    def __init__(self, pid):
+        fd = os.open(XIO_STATS_SHM_NAME % pid, os.O_RDONLY)
+        try:
+            self.map = mmap.mmap(fd, 0, mmap.MAP_SHARED, mmap.PROT_READ)
+        finally:
+            os.close(fd)
+
+        (magic, version, self.blocks_off, self.block_size, self.nblocks,
+         self.ncounters, self.counters_off, self.name_len, self.names_off,
+         self.pid, _, self.hertz) = HDR.unpack_from(self.map, 0)
+        if magic != XIO_STATS_SHM_MAGIC:
+            raise ValueError("not an accelio statistics region")
+        if version != XIO_STATS_SHM_VERSION:
+            raise ValueError("unsupported version %d" % version)
+        self.counters = struct.Struct("=%dQ" % self.ncounters)
+
+    def block(self, i):
+        """Consistent copy of a block, None if it is free."""
+        off = self.blocks_off + i * self.block_size
+        while True:
+            seq = BLOCK.unpack_from(self.map, off)[0]
+            if seq & 1:
+                continue
+            raw = self.map[off:off + self.block_size]
+            if BLOCK.unpack_from(self.map, off)[0] == seq:
+                break
+
+        _, in_use, tid, cpu, start = BLOCK.unpack_from(raw, 0)
+        if not in_use:
+            return None
+
+        counters = self.counters.unpack_from(raw, self.counters_off)
+        stats = {}
+        for j in range(self.ncounters):
+            name = raw[self.names_off + j * self.name_len:
+                       self.names_off + (j + 1) * self.name_len]
+            name = name.split(b"\0")[0].decode()
+            if name:
+                stats[name] = counters[j]
+
+        return (tid, cpu, start, stats)
+
+    def blocks(self):
+        for i in range(self.nblocks):
+            b = self.block(i)
+            if b:
+                yield b
+
+def report(prev, cur, seconds, hertz):
+    """Rates per second, delays per message in usec."""
+    fields = []
+    for name in sorted(cur):
+        delta = cur[name] - prev.get(name, 0)
+        if name == "DELAY":
+            msgs = cur.get("RX_MSG", 0) - prev.get("RX_MSG", 0)
+            value = 1e6 * delta / hertz / max(msgs, 1)
+        elif name == "APPDELAY":
+            msgs = cur.get("TX_MSG", 0) - prev.get("TX_MSG", 0)
+            value = 1e6 * delta / hertz / max(msgs, 1)
+        else:
+            value = delta / seconds
+        fields.append("%s=%.3f" % (name, value))
+    return " ".join(fields)
+
+def main():
+    if len(sys.argv) < 2:
+        print(__doc__)
+        sys.exit(1)
+
+    pid = int(sys.argv[1])
+    interval = float(sys.argv[2]) if len(sys.argv) > 2 else 1.0
+    region = Region(pid)
+    prev = {}
+    last = time.time()
+
+    while True:
+        time.sleep(interval)
+        try:
+            os.kill(pid, 0)
+        except OSError:
+            print("process %d is gone" % pid)
+            sys.exit(0)
+
+        now = time.time()
+        cur = {}
+        for tid, cpu, start, stats in region.blocks():
+            # a block reused by another context starts over
+            key = (tid, start)
+            cur[key] = stats
+            if key not in prev:
+                continue
+            print("%7d %7d cpu %3d %s" %
+                  (pid, tid, cpu,
+                   report(prev[key], stats, now - last,
+                          region.hertz)))
+        prev = cur
+        last = now
+
+if __name__ == '__main__':
+    main()
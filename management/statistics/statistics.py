@@ -84,6 +84,8 @@ XIO_STAT_TX_BYTES = 2
 XIO_STAT_RX_BYTES = 3
 XIO_STAT_DELAY = 4
 XIO_STAT_APPDELAY = 5
+XIO_STAT_CREDIT_STALLS = 6
+XIO_STAT_NOP_TX = 7
 
 def align(l, alignto=4):
     return (l + alignto - 1) & ~(alignto - 1)
@@ -0,0 +1,163 @@
+#!/usr/bin/env python
+
+# Copyright (c) 2013 Mellanox Technologies (r). All rights reserved.
+#
+# This software is available to you under a choice of one of two licenses.
+# You may choose to be licensed under the terms of the GNU General Public
+# License (GPL) Version 2, available from the file COPYING in the main
+# directory of this source tree, or the Mellanox Technologies (r) BSD license
+# below:
+#
+#      - Redistribution and use in source and binary forms, with or without
+#        modification, are permitted provided that the following conditions
+#        are met:
+#
+#      - Redistributions of source code must retain the above copyright
+#        notice, this list of conditions and the following disclaimer.
+#
+#      - Redistributions in binary form must reproduce the above
+#        copyright notice, this list of conditions and the following
+#        disclaimer in the documentation and/or other materials
+#        provided with the distribution.
+#
+#      - Neither the name of the Mellanox Technologies (r) nor the names of its
+#        contributors may be used to endorse or promote products derived from
+#        this software without specific prior written permission.
+#
+# THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+# AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+# IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+# ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE
+# LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+# CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+# SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+# INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+# CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+# ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+# POSSIBILITY OF SUCH DAMAGE.
+
+"""
+Decode task lifecycle traces written by xio_context_dump_trace.
+
+Each file holds the newest records of one context. Records of a message
+are tied by the session serial number; transport records that do not
+know it yet take it from the next record of the same task. Stages of a
+file are timed against each other only, as each host has its own clock,
+unless --same-clock says the files come from one host.
+
+usage: xio_trace.py [--same-clock] [--list] <dump> [<dump> ...]
+"""
+
+from __future__ import print_function
+
+import os
+import sys
+import struct
+
+XIO_TRACE_MAGIC = 0x65636172746f6978
+XIO_TRACE_VERSION = 1
+
+# struct xio_trace_file_hdr
+HDR = struct.Struct("=IIQiiQ")
+MAGIC = struct.Struct("=Q")
+# struct xio_trace_rec
+REC = struct.Struct("=QQIIII")
+
+EVENTS = ["SEND_REQ", "XMIT_REQ", "TX_COMP_REQ", "RECV_REQ", "ON_REQ",
+          "SEND_RSP", "XMIT_RSP", "TX_COMP_RSP", "RECV_RSP", "ON_RSP"]
+
+class Dump(object):
+    """Records of one context, sn filled in where the transport lacked it."""
+
+    def __init__(self, path):
+        with open(path, "rb") as f:
+            data = f.read()
+        if MAGIC.unpack_from(data, 0)[0] != XIO_TRACE_MAGIC:
+            raise ValueError("%s: not an accelio trace" % path)
+        (version, rec_size, self.hertz, self.pid, self.cpu,
+         nrecs) = HDR.unpack_from(data, MAGIC.size)
+        if version != XIO_TRACE_VERSION:
+            raise ValueError("%s: unsupported version %d" % (path, version))
+
+        self.name = os.path.basename(path)
+        off = MAGIC.size + HDR.size
+        self.recs = []
+        for i in range(nrecs):
+            cycles, sn, ltid, rtid, event, _ = \
+                REC.unpack_from(data, off + i * rec_size)
+            self.recs.append([cycles, sn, ltid, rtid, event])
+
+        # RECV_REQ is followed by ON_REQ of the same task
+        pending = {}
+        for rec in self.recs:
+            if rec[1] == 0 and rec[4] != 0:
+                pending.setdefault(rec[2], []).append(rec)
+            elif rec[2] in pending:
+                for p in pending.pop(rec[2]):
+                    p[1] = rec[1]
+
+    def usec(self, cycles):
+        return 1e6 * cycles / self.hertz if self.hertz else float(cycles)
+
+def timelines(dumps, same_clock):
+    """sn -> list of (usec, side, event), ordered."""
+    lines = {}
+    base = min(r[0] for d in dumps for r in d.recs) if same_clock else 0
+    for d in dumps:
+        start = base if same_clock else (d.recs[0][0] if d.recs else 0)
+        for cycles, sn, ltid, rtid, event in d.recs:
+            if not sn and event != 0:
+                continue
+            lines.setdefault(sn, []).append(
+                (d.usec(cycles - start), d.name, event))
+    for sn in lines:
+        lines[sn].sort()
+    return lines
+
+def percentile(values, p):
+    values = sorted(values)
+    return values[min(len(values) - 1, int(len(values) * p / 100.0))]
+
+def main():
+    args = sys.argv[1:]
+    same_clock = "--same-clock" in args
+    listing = "--list" in args
+    paths = [a for a in args if not a.startswith("--")]
+    if not paths:
+        print(__doc__)
+        sys.exit(1)
+
+    dumps = [Dump(p) for p in paths]
+    lines = timelines(dumps, same_clock)
+
+    # time between consecutive stages of a message on the same side,
+    # or across sides when the clock is shared
+    steps = {}
+    for sn in sorted(lines):
+        line = lines[sn]
+        if listing:
+            print("sn %d" % sn)
+            t0 = {}
+            for t, side, event in line:
+                key = "" if same_clock else side
+                t0.setdefault(key, t)
+                print("  %12.3f %-12s %s" %
+                      (t - t0[key], side, EVENTS[event]))
+        if same_clock:
+            sides = [line]
+        else:
+            sides = [[r for r in line if r[1] == d.name] for d in dumps]
+        for side in sides:
+            for (t1, _, e1), (t2, _, e2) in zip(side, side[1:]):
+                key = "%s -> %s" % (EVENTS[e1], EVENTS[e2])
+                steps.setdefault(key, []).append(t2 - t1)
+
+    print("%-28s %8s %10s %10s %10s" % ("stage (usec)", "count", "p50",
+                                        "p99", "max"))
+    for key in sorted(steps, key=lambda k: -percentile(steps[k], 99)):
+        v = steps[key]
+        print("%-28s %8d %10.3f %10.3f %10.3f" %
+              (key, len(v), percentile(v, 50), percentile(v, 99), max(v)))
+
+if __name__ == '__main__':
+    main()
@@ -53,6 +53,10 @@
 #define uint64_from_ptr(p)	(uint64_t)(uintptr_t)(p)
 #define ptr_from_int64(p)	(void *)(unsigned long)(p)
 
+/* message data vector - external array is used above XIO_MAX_IOV entries */
+#define xio_vmsg_data_iov(vmsg)	(((vmsg)->data_iovlen > XIO_MAX_IOV) ? \
+				 (vmsg)->pdata_iov : (vmsg)->data_iov)
+
 /*---------------------------------------------------------------------------*/
 /* debuging facilities							     */
 /*---------------------------------------------------------------------------*/
@@ -167,6 +171,7 @@ struct __attribute__((__packed__)) xio_session_cancel_hdr {
 };
 
 struct xio_msg;
+struct xio_vmsg;
 struct xio_iovec;
 struct xio_iovec_ex;
 
@@ -221,6 +226,15 @@ size_t		memcpyv(struct xio_iovec *dst, int dsize,
 size_t		memclonev(struct xio_iovec *dst, int dsize,
 			  struct xio_iovec *src, int ssize);
 
+size_t		memcpyv_ex(struct xio_iovec_ex *dst, int dsize,
+			   struct xio_iovec_ex *src, int ssize);
+
+size_t		memclonev_ex(struct xio_iovec_ex *dst, int dsize,
+			     struct xio_iovec_ex *src, int ssize);
+
+void		xio_vmsg_set_data_iovlen(struct xio_vmsg *vmsg,
+					 size_t iovlen);
+
 size_t		xio_iov_length(const struct xio_iovec *iov,
 			       unsigned long nr_segs);
 
@@ -76,6 +76,7 @@ static void xio_on_conn_closed(struct xio_conn *conn,
 static inline void xio_conn_init_observers_htbl(struct xio_conn *conn)
 {
 	INIT_LIST_HEAD(&conn->observers_htbl);
+	conn->observers_hint = NULL;
 }
 
 /*---------------------------------------------------------------------------*/
@@ -91,6 +92,7 @@ static void xio_conn_free_observers_htbl(struct xio_conn *conn)
 		list_del(&node->observers_htbl_node);
 		kfree(node);
 	}
+	conn->observers_hint = NULL;
 }
 
 /*---------------------------------------------------------------------------*/
@@ -129,6 +131,8 @@ static int xio_conn_unhash_observer(struct xio_conn *conn,
 				 &conn->observers_htbl,
 				 observers_htbl_node) {
 		if (node->observer == observer) {
+			if (conn->observers_hint == node)
+				conn->observers_hint = NULL;
 			list_del(&node->observers_htbl_node);
 			kfree(node);
 			return 0;
@@ -144,13 +148,18 @@ static int xio_conn_unhash_observer(struct xio_conn *conn,
 struct xio_observer *xio_conn_observer_lookup(struct xio_conn *conn,
 					      uint32_t id)
 {
-	struct xio_observers_htbl_node	*node;
+	struct xio_observers_htbl_node	*node = conn->observers_hint;
+
+	if (node && node->id == id)
+		return node->observer;
 
 	list_for_each_entry(node,
 			    &conn->observers_htbl,
 			    observers_htbl_node) {
-		if (node->id == id)
+		if (node->id == id) {
+			conn->observers_hint = node;
 			return node->observer;
+		}
 	}
 
 	return NULL;
@@ -186,7 +195,9 @@ static void xio_pre_put_task(struct xio_task *task)
 	task->imsg.flags		= 0;
 	task->tlv_type			= 0xdead;
 	task->omsg_flags		= 0;
+	task->imm_rsp			= 0;
 	task->state			= XIO_TASK_STATE_INIT;
+	list_del_init(&task->io_tasks_htbl_entry);
 }
 
 /*---------------------------------------------------------------------------*/
@@ -979,7 +990,7 @@ struct xio_conn *xio_conn_create(struct xio_conn *parent_conn,
 			  xio_on_context_event);
 
 	xio_context_reg_observer(transport_hndl->ctx, &conn->ctx_observer);
-
+	atomic_inc(&transport_hndl->ctx->nr_conns);
 
 	/* add the conection to temporary list */
 	conn->transport_hndl		= transport_hndl;
@@ -1040,6 +1051,29 @@ static void xio_on_message_error(struct xio_conn *conn,
 					   &conn_event_data);
 }
 
+/*---------------------------------------------------------------------------*/
+/* xio_on_accept_ctx			                                     */
+/*---------------------------------------------------------------------------*/
+static void xio_on_accept_ctx(struct xio_conn *conn,
+			      union xio_transport_event_data *event_data)
+{
+	union xio_conn_event_data	conn_event_data;
+
+	/* the server picks the context that runs the new connection, or
+	 * takes back a pick the transport could not use */
+	conn_event_data.accept_ctx.peer_addr = event_data->accept_ctx.peer_addr;
+	conn_event_data.accept_ctx.release = event_data->accept_ctx.release;
+	conn_event_data.accept_ctx.ctx = event_data->accept_ctx.release ?
+					 event_data->accept_ctx.ctx : NULL;
+
+	xio_conn_notify_server(
+			conn,
+			XIO_CONN_EVENT_ACCEPT_CTX,
+			&conn_event_data);
+
+	event_data->accept_ctx.ctx = conn_event_data.accept_ctx.ctx;
+}
+
 /*---------------------------------------------------------------------------*/
 /* xio_on_new_connection		                                     */
 /*---------------------------------------------------------------------------*/
@@ -1099,9 +1133,12 @@ static void xio_on_conn_closed(struct xio_conn *conn,
 
 	xio_conns_store_remove(conn->cid);
 
-	if (conn->transport_hndl)
+	if (conn->transport_hndl) {
 		xio_context_unreg_observer(conn->transport_hndl->ctx,
 					   &conn->ctx_observer);
+		if (!conn->transport_hndl->is_client && !conn->is_listener)
+			atomic_dec(&conn->transport_hndl->ctx->nr_conns);
+	}
 
 	kfree(conn);
 }
@@ -1234,6 +1271,8 @@ static int xio_on_assign_in_buf(struct xio_conn *conn,
 	union xio_conn_event_data	conn_event_data;
 
 	conn_event_data.assign_in_buf.task = event_data->msg.task;
+	conn_event_data.assign_in_buf.is_streamed =
+		event_data->assign_in_buf.is_streamed;
 	task->conn = conn;
 
 	xio_observable_notify_any_observer(
@@ -1243,10 +1282,34 @@ static int xio_on_assign_in_buf(struct xio_conn *conn,
 
 	event_data->assign_in_buf.is_assigned =
 		conn_event_data.assign_in_buf.is_assigned;
+	event_data->assign_in_buf.is_streamed =
+		conn_event_data.assign_in_buf.is_streamed;
 
 	return retval;
 }
 
+/*---------------------------------------------------------------------------*/
+/* xio_on_message_chunk							     */
+/*---------------------------------------------------------------------------*/
+static int xio_on_message_chunk(struct xio_conn *conn,
+				union xio_transport_event_data
+				*event_data)
+{
+	union xio_conn_event_data conn_event_data = {
+		.chunk.task		= event_data->chunk.task,
+		.chunk.data		= event_data->chunk.data,
+		.chunk.offset		= event_data->chunk.offset,
+		.chunk.length		= event_data->chunk.length,
+	};
+
+	xio_observable_notify_any_observer(
+			&conn->observable,
+			XIO_CONN_EVENT_MESSAGE_CHUNK,
+			&conn_event_data);
+
+	return 0;
+}
+
 /*---------------------------------------------------------------------------*/
 /* xio_on_cancel_request						     */
 /*---------------------------------------------------------------------------*/
@@ -1323,6 +1386,9 @@ static int xio_on_transport_event(void *observer, void *sender, int event,
 			 "conn:%p, transport:%p\n", observer, sender);
 		xio_on_assign_in_buf(conn, ev_data);
 		break;
+	case XIO_TRANSPORT_MESSAGE_CHUNK:
+		xio_on_message_chunk(conn, ev_data);
+		break;
 	case XIO_TRANSPORT_MESSAGE_ERROR:
 		DEBUG_LOG("conn: [notification] - message error. " \
 			 "conn:%p, transport:%p\n", observer, sender);
@@ -1343,6 +1409,9 @@ static int xio_on_transport_event(void *observer, void *sender, int event,
 			 "conn:%p, transport:%p\n", observer, sender);
 		xio_on_new_connection(conn, ev_data);
 		break;
+	case XIO_TRANSPORT_ACCEPT_CTX:
+		xio_on_accept_ctx(conn, ev_data);
+		break;
 	case XIO_TRANSPORT_ESTABLISHED:
 		DEBUG_LOG("conn: [notification] - transport established. " \
 			 "conn:%p, transport:%p\n", observer, sender);
@@ -1393,6 +1462,11 @@ struct xio_conn *xio_conn_open(
 
 	/* look for opened connection */
 	conn = xio_conns_store_find(ctx, portal_uri);
+	if (conn != NULL && conn->state == XIO_CONN_STATE_DISCONNECTED) {
+		/* its transport is gone - reconnect on a fresh one */
+		xio_conns_store_remove(conn->cid);
+		conn = NULL;
+	}
 	if (conn != NULL) {
 		if (observer) {
 			xio_observable_reg_observer(&conn->observable,
@@ -1594,6 +1668,20 @@ int xio_conn_reject(struct xio_conn *conn)
 	}
 	return 0;
 }
+
+/*---------------------------------------------------------------------------*/
+/* xio_conn_attach_ctx			                                     */
+/*---------------------------------------------------------------------------*/
+int xio_conn_attach_ctx(struct xio_conn *conn, struct xio_context *ctx)
+{
+	if (conn->transport->attach_ctx == NULL) {
+		ERROR_LOG("transport does not implement \"attach_ctx\"\n");
+		xio_set_error(ENOSYS);
+		return -1;
+	}
+	return conn->transport->attach_ctx(conn->transport_hndl, ctx);
+}
+
 /*---------------------------------------------------------------------------*/
 /* xio_conn_delayed_close		                                     */
 /*---------------------------------------------------------------------------*/
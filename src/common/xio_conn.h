@@ -41,7 +41,6 @@
 #include "xio_hash.h"
 #include "xio_context.h"
 #include "xio_transport.h"
-#include "sys/hashtable.h"
 
 /*---------------------------------------------------------------------------*/
 /* defines	                                                             */
@@ -58,6 +57,7 @@ struct xio_conn;
 /*---------------------------------------------------------------------------*/
 enum xio_conn_event {
 	XIO_CONN_EVENT_NEW_CONNECTION,
+	XIO_CONN_EVENT_ACCEPT_CTX,
 	XIO_CONN_EVENT_ESTABLISHED,
 	XIO_CONN_EVENT_DISCONNECTED,
 	XIO_CONN_EVENT_CLOSED,
@@ -65,6 +65,7 @@ enum xio_conn_event {
 	XIO_CONN_EVENT_NEW_MESSAGE,
 	XIO_CONN_EVENT_SEND_COMPLETION,
 	XIO_CONN_EVENT_ASSIGN_IN_BUF,
+	XIO_CONN_EVENT_MESSAGE_CHUNK,
 	XIO_CONN_EVENT_CANCEL_REQUEST,
 	XIO_CONN_EVENT_CANCEL_RESPONSE,
 	XIO_CONN_EVENT_ERROR,
@@ -95,8 +96,14 @@ union xio_conn_event_data {
 	struct {
 		struct xio_task		*task;
 		int			is_assigned;
-		int			pad;
+		int			is_streamed;
 	} assign_in_buf;
+	struct {
+		struct xio_task		*task;
+		void			*data;
+		size_t			offset;
+		size_t			length;
+	} chunk;
 	struct {
 		struct xio_task		*task;
 		enum xio_status		reason;
@@ -105,6 +112,12 @@ union xio_conn_event_data {
 	struct {
 		struct xio_conn		*child_conn;
 	} new_connection;
+	struct {
+		struct sockaddr_storage	*peer_addr;
+		struct xio_context	*ctx;
+		int			release;
+		int			pad;
+	} accept_ctx;
 	struct {
 		enum xio_status		reason;
 	} error;
@@ -144,8 +157,8 @@ struct xio_conn {
 	xio_ctx_timer_handle_t		close_time_hndl;
 
 	struct list_head		observers_htbl;
-
-	HT_ENTRY(xio_conn, xio_key_int32) conns_htbl;
+	/* last hit - most conns serve a single session */
+	struct xio_observers_htbl_node	*observers_hint;
 };
 
 /*---------------------------------------------------------------------------*/
@@ -184,6 +197,11 @@ int xio_conn_accept(struct xio_conn *conn);
 /*---------------------------------------------------------------------------*/
 int xio_conn_reject(struct xio_conn *conn);
 
+/*---------------------------------------------------------------------------*/
+/* xio_conn_attach_ctx							     */
+/*---------------------------------------------------------------------------*/
+int xio_conn_attach_ctx(struct xio_conn *conn, struct xio_context *ctx);
+
 /*---------------------------------------------------------------------------*/
 /* xio_conn_poll							     */
 /*---------------------------------------------------------------------------*/
@@ -41,16 +41,133 @@
 #include "xio_task.h"
 #include "xio_msg_list.h"
 #include "xio_observer.h"
+#include "xio_context.h"
 #include "xio_conn.h"
 #include "xio_connection.h"
 #include "xio_session.h"
-#include "xio_context.h"
 
 #define MSG_POOL_SZ	1024
 
 #define		IS_APPLICATION_MSG(msg) \
 		  (IS_MESSAGE((msg)->type) || IS_ONE_WAY((msg)->type))
 
+/* per message charge so that empty messages also use up the turn */
+#define XIO_TC_MSG_OVERHEAD	64
+
+/* defaults for new connections, a connection keeps its own copy */
+static spinlock_t tclass_lock;
+static struct xio_tclass_attr tclass_attrs[XIO_MSG_TCLASS_MAX] = {
+	{ XIO_MSG_TCLASS_NORMAL,	65536,	0,	0 },
+	{ XIO_MSG_TCLASS_INTERACTIVE,	65536,	2,	0 },
+	{ XIO_MSG_TCLASS_BULK,		65536,	0,	0 },
+};
+
+/* send queue watermarks, all disabled by default. a connection keeps its
+ * own copy
+ */
+static spinlock_t txq_lock;
+static struct xio_tx_queue_attr txq_attr;
+
+static void xio_connection_tmo_tick(void *data);
+static void xio_connection_release(struct kref *kref);
+
+/*---------------------------------------------------------------------------*/
+/* xio_connection_tcq							     */
+/*---------------------------------------------------------------------------*/
+static inline struct xio_tc_queue *xio_connection_tcq(
+		struct xio_connection *connection,
+		struct xio_msg *msg)
+{
+	/* internal messages and unknown classes are served as normal */
+	if (!IS_APPLICATION_MSG(msg) ||
+	    (unsigned int)msg->tclass >= XIO_MSG_TCLASS_MAX)
+		return &connection->tcq[XIO_MSG_TCLASS_NORMAL];
+
+	return &connection->tcq[msg->tclass];
+}
+
+/*---------------------------------------------------------------------------*/
+/* xio_connection_txq_add						     */
+/*---------------------------------------------------------------------------*/
+static inline void xio_connection_txq_add(struct xio_connection *connection,
+					  struct xio_msg *msg)
+{
+	struct xio_vmsg *vmsg = &msg->out;
+
+	if (!IS_APPLICATION_MSG(msg))
+		return;
+
+	connection->txq_msgs++;
+	connection->txq_bytes += vmsg->header.iov_len +
+		xio_iovex_length(xio_vmsg_data_iov(vmsg), vmsg->data_iovlen);
+}
+
+/*---------------------------------------------------------------------------*/
+/* xio_connection_txq_del						     */
+/*---------------------------------------------------------------------------*/
+static inline void xio_connection_txq_del(struct xio_connection *connection,
+					  struct xio_msg *msg)
+{
+	struct xio_vmsg *vmsg = &msg->out;
+	uint64_t	bytes;
+
+	if (!IS_APPLICATION_MSG(msg))
+		return;
+
+	bytes = vmsg->header.iov_len +
+		xio_iovex_length(xio_vmsg_data_iov(vmsg), vmsg->data_iovlen);
+
+	if (connection->txq_msgs)
+		connection->txq_msgs--;
+	connection->txq_bytes -= min(bytes, connection->txq_bytes);
+}
+
+/*---------------------------------------------------------------------------*/
+/* xio_connection_txq_full						     */
+/*---------------------------------------------------------------------------*/
+static inline int xio_connection_txq_full(struct xio_connection *connection)
+{
+	return connection->txq_attr.fail_fast && connection->txq_high;
+}
+
+/*---------------------------------------------------------------------------*/
+/* xio_connection_txq_update						     */
+/*---------------------------------------------------------------------------*/
+static void xio_connection_txq_update(struct xio_connection *connection)
+{
+	struct xio_tx_queue_attr *attr = &connection->txq_attr;
+	int high;
+
+	/* hysteresis - high once either mark is reached, low again only
+	 * when both drained to their low marks
+	 */
+	if (!connection->txq_high) {
+		high = (attr->high_msgs &&
+			connection->txq_msgs >= attr->high_msgs) ||
+		       (attr->high_bytes &&
+			connection->txq_bytes >= attr->high_bytes);
+		if (!high)
+			return;
+		connection->txq_high = 1;
+		if (connection->ses_ops.on_tx_queue_high)
+			connection->ses_ops.on_tx_queue_high(
+					connection->session, connection,
+					connection->cb_user_context);
+		return;
+	}
+
+	if ((attr->high_msgs && connection->txq_msgs > attr->low_msgs) ||
+	    (attr->high_bytes &&
+	     connection->txq_bytes > attr->low_bytes))
+		return;
+
+	connection->txq_high = 0;
+	if (connection->ses_ops.on_tx_queue_low)
+		connection->ses_ops.on_tx_queue_low(
+				connection->session, connection,
+				connection->cb_user_context);
+}
+
 
 /*---------------------------------------------------------------------------*/
 /* xio_get_connection_context						     */
@@ -70,6 +187,141 @@ static int xio_is_connection_online(struct xio_connection *connection)
 		   connection->state == XIO_CONNECTION_STATE_ONLINE;
 }
 
+/*---------------------------------------------------------------------------*/
+/* xio_connection_mpath_pick						     */
+/*---------------------------------------------------------------------------*/
+static struct xio_connection *xio_connection_mpath_pick(
+					struct xio_connection *front,
+					struct xio_connection *skip)
+{
+	struct xio_connection	*path;
+	struct xio_connection	*best = NULL;
+	uint64_t		cost, best_cost = 0;
+	uint32_t		in_flight;
+	int			n = front->mpath.nr + 1;
+	int			i, j, tc;
+
+	/* queued and outstanding messages weighted by how fast the path
+	 * completes them. the rotating start breaks ties between idle paths
+	 */
+	for (i = 0; i < n; i++) {
+		j = (front->mpath.cursor + i) % n;
+		path = j ? front->mpath.paths[j - 1] : front;
+		if (path == skip || !xio_is_connection_online(path) ||
+		    xio_connection_txq_full(path))
+			continue;
+		in_flight = 0;
+		for (tc = 0; tc < XIO_MSG_TCLASS_MAX; tc++)
+			in_flight += path->tcq[tc].reqs_in_flight;
+		cost = (uint64_t)(path->txq_msgs + in_flight + 1) *
+		       (path->mpath.lat + 1);
+		if (best == NULL || cost < best_cost) {
+			best		= path;
+			best_cost	= cost;
+		}
+	}
+	front->mpath.cursor++;
+
+	return best;
+}
+
+/*---------------------------------------------------------------------------*/
+/* xio_connection_mpath_failover - move a message off a failed path	     */
+/*---------------------------------------------------------------------------*/
+static int xio_connection_mpath_failover(struct xio_connection *connection,
+					 struct xio_msg *msg)
+{
+	struct xio_connection	*front = xio_connection_owner(connection);
+	struct xio_connection	*path;
+
+	/* a hedged request has its copy to fall back on */
+	if (front->mpath.nr == 0 || XIO_HEDGE_MSG(msg))
+		return 0;
+
+	path = xio_connection_mpath_pick(front, connection);
+	if (path == NULL)
+		return 0;
+
+	msg->next = NULL;
+	if (msg->type == XIO_MSG_TYPE_REQ)
+		return xio_send_request(path, msg) == 0;
+	if (msg->type == XIO_ONE_WAY_REQ)
+		return xio_send_msg(path, msg) == 0;
+
+	return 0;
+}
+
+/*---------------------------------------------------------------------------*/
+/* xio_connection_mpath_locate - the path a request was placed on	     */
+/*---------------------------------------------------------------------------*/
+static struct xio_connection *xio_connection_mpath_locate(
+					struct xio_connection *front,
+					struct xio_msg *msg)
+{
+	struct xio_connection	*path;
+	struct xio_msg		*pmsg;
+	int			i;
+
+	for (i = 0; i < front->mpath.nr; i++) {
+		path = front->mpath.paths[i];
+		xio_msg_list_foreach(pmsg, &path->in_flight_reqs_msgq, pdata) {
+			if (pmsg == msg)
+				return path;
+		}
+		xio_msg_list_foreach(pmsg,
+				     &xio_connection_tcq(path, msg)->reqs_msgq,
+				     pdata) {
+			if (pmsg == msg)
+				return path;
+		}
+	}
+
+	return front;
+}
+
+/*---------------------------------------------------------------------------*/
+/* xio_connection_mpath_sample						     */
+/*---------------------------------------------------------------------------*/
+void xio_connection_mpath_sample(struct xio_connection *connection,
+				 uint64_t cycles)
+{
+	struct xio_mpath *mpath = &connection->mpath;
+
+	if (mpath->owner == NULL && mpath->nr == 0)
+		return;
+
+	/* ewma with 1/8 weight for the new sample */
+	if (mpath->lat == 0)
+		mpath->lat = cycles;
+	else
+		mpath->lat = mpath->lat - (mpath->lat >> 3) + (cycles >> 3);
+}
+
+/*---------------------------------------------------------------------------*/
+/* xio_connection_mpath_release						     */
+/*---------------------------------------------------------------------------*/
+static void xio_connection_mpath_release(struct xio_connection *connection)
+{
+	struct xio_connection	*front = connection->mpath.owner;
+	int			i;
+
+	for (i = 0; i < connection->mpath.nr; i++)
+		connection->mpath.paths[i]->mpath.owner = NULL;
+	kfree(connection->mpath.paths);
+	connection->mpath.paths	= NULL;
+	connection->mpath.nr	= 0;
+
+	if (front == NULL)
+		return;
+	for (i = 0; i < front->mpath.nr; i++) {
+		if (front->mpath.paths[i] == connection) {
+			front->mpath.paths[i] =
+				front->mpath.paths[--front->mpath.nr];
+			break;
+		}
+	}
+}
+
 /*---------------------------------------------------------------------------*/
 /* xio_init_ow_msg_pool							     */
 /*---------------------------------------------------------------------------*/
@@ -114,6 +366,7 @@ struct xio_connection *xio_connection_init(struct xio_session *session,
 					       void *cb_user_context)
 {
 		struct xio_connection *connection;
+		int i;
 
 		if ((ctx == NULL) || (session == NULL)) {
 			xio_set_error(EINVAL);
@@ -138,11 +391,25 @@ struct xio_connection *xio_connection_init(struct xio_session *session,
 		INIT_LIST_HEAD(&connection->post_io_tasks_list);
 		INIT_LIST_HEAD(&connection->pre_send_list);
 
-		xio_msg_list_init(&connection->reqs_msgq);
-		xio_msg_list_init(&connection->rsps_msgq);
+		spin_lock(&tclass_lock);
+		for (i = 0; i < XIO_MSG_TCLASS_MAX; i++) {
+			xio_msg_list_init(&connection->tcq[i].reqs_msgq);
+			xio_msg_list_init(&connection->tcq[i].rsps_msgq);
+			connection->tcq[i].quantum = tclass_attrs[i].quantum;
+			connection->tcq[i].reserve = tclass_attrs[i].reserve;
+		}
+		spin_unlock(&tclass_lock);
+
+		spin_lock(&txq_lock);
+		connection->txq_attr = txq_attr;
+		spin_unlock(&txq_lock);
 
 		xio_msg_list_init(&connection->in_flight_reqs_msgq);
 		xio_msg_list_init(&connection->in_flight_rsps_msgq);
+		for (i = 0; i < XIO_TMO_WHEEL_SIZE; i++)
+			xio_msg_list_init(&connection->tmo_wheel.slot[i]);
+		xio_hedge_init(&connection->hedge);
+		xio_resume_init(&connection->resume);
 
 		xio_init_ow_msg_pool(connection);
 
@@ -224,6 +491,7 @@ int xio_connection_send(struct xio_connection *connection,
 			}
 			list_move_tail(&task->tasks_list_entry,
 				       &connection->pre_send_list);
+			list_del_init(&task->io_tasks_htbl_entry);
 
 			hdr.serial_num	= msg->request->sn;
 		}
@@ -266,6 +534,8 @@ int xio_connection_send(struct xio_connection *connection,
 		}
 		goto cleanup;
 	}
+	if (XIO_HEDGE_MSG(msg))
+		xio_hedge_on_send(msg, task);
 
 	return 0;
 
@@ -273,7 +543,7 @@ cleanup:
 	if (is_req)
 		xio_tasks_pool_put(task);
 	else
-		list_move(&task->tasks_list_entry, &connection->io_tasks_list);
+		xio_connection_queue_io_task(connection, task);
 
 
 	return -1;
@@ -284,35 +554,67 @@ cleanup:
 /*---------------------------------------------------------------------------*/
 int xio_connection_flush_msgs(struct xio_connection *connection)
 {
-	struct xio_msg		*pmsg, *tmp_pmsg, *omsg = NULL;
+	struct xio_msg		*pmsg, *tmp_pmsg;
+	struct xio_msg		*reqs_first[XIO_MSG_TCLASS_MAX];
+	struct xio_msg		*rsps_first[XIO_MSG_TCLASS_MAX];
+	struct xio_msg_list	expired;
+	struct xio_tc_queue	*tcq;
+	int			i;
+
+	/* in flight messages go back ahead of their class's queue */
+	for (i = 0; i < XIO_MSG_TCLASS_MAX; i++) {
+		tcq = &connection->tcq[i];
+		reqs_first[i] = xio_msg_list_first(&tcq->reqs_msgq);
+		rsps_first[i] = xio_msg_list_first(&tcq->rsps_msgq);
+		tcq->reqs_in_flight = 0;
+	}
+	/* no answer comes for cancels sent on the old transport */
+	connection->cancels_owed.nr = 0;
+	xio_msg_list_init(&expired);
 
-	if (!xio_msg_list_empty(&connection->reqs_msgq))
-		omsg = xio_msg_list_first(&connection->reqs_msgq);
 	xio_msg_list_foreach_safe(pmsg, &connection->in_flight_reqs_msgq,
 				  tmp_pmsg, pdata) {
 		xio_msg_list_remove(&connection->in_flight_reqs_msgq,
 				    pmsg, pdata);
-		if (omsg)
-			xio_msg_list_insert_before(omsg, pmsg, pdata);
+		tcq = xio_connection_tcq(connection, pmsg);
+		i = tcq - connection->tcq;
+		/* a request past its deadline is not sent again */
+		if (pmsg->tmo.state == XIO_MSG_TMO_EXPIRED) {
+			pmsg->tmo.state = XIO_MSG_TMO_NONE;
+			xio_msg_list_insert_tail(&expired, pmsg, pdata);
+			continue;
+		}
+		if (pmsg->tmo.state == XIO_MSG_TMO_IN_FLIGHT)
+			pmsg->tmo.state = XIO_MSG_TMO_QUEUED;
+		if (XIO_HEDGE_MSG(pmsg))
+			xio_hedge_on_requeue(pmsg);
+		if (reqs_first[i])
+			xio_msg_list_insert_before(reqs_first[i], pmsg, pdata);
 		else
-			xio_msg_list_insert_tail(&connection->reqs_msgq,
+			xio_msg_list_insert_tail(&tcq->reqs_msgq,
 						 pmsg, pdata);
+		xio_connection_txq_add(connection, pmsg);
 	}
 
-	if (!xio_msg_list_empty(&connection->rsps_msgq))
-		omsg = xio_msg_list_first(&connection->rsps_msgq);
-	else
-		omsg = NULL;
-
 	xio_msg_list_foreach_safe(pmsg, &connection->in_flight_rsps_msgq,
 				  tmp_pmsg, pdata) {
 		xio_msg_list_remove(&connection->in_flight_rsps_msgq,
 				    pmsg, pdata);
-		if (omsg)
-			xio_msg_list_insert_before(omsg, pmsg, pdata);
+		tcq = xio_connection_tcq(connection, pmsg);
+		i = tcq - connection->tcq;
+		if (rsps_first[i])
+			xio_msg_list_insert_before(rsps_first[i], pmsg, pdata);
 		else
-			xio_msg_list_insert_tail(&connection->rsps_msgq,
+			xio_msg_list_insert_tail(&tcq->rsps_msgq,
 						 pmsg, pdata);
+		xio_connection_txq_add(connection, pmsg);
+	}
+
+	/* the callbacks may queue new messages, so fail them last */
+	while (!xio_msg_list_empty(&expired)) {
+		pmsg = xio_msg_list_first(&expired);
+		xio_msg_list_remove(&expired, pmsg, pdata);
+		xio_session_notify_msg_error(connection, pmsg, XIO_E_TIMEOUT);
 	}
 
 	return 0;
@@ -324,26 +626,37 @@ int xio_connection_flush_msgs(struct xio_connection *connection)
 int xio_connection_notify_msgs_flush(struct xio_connection *connection)
 {
 	struct xio_msg		*pmsg, *tmp_pmsg;
+	struct xio_tc_queue	*tcq;
+	int			i;
+
+	for (i = 0; i < XIO_MSG_TCLASS_MAX; i++) {
+		tcq = &connection->tcq[i];
+		xio_msg_list_foreach_safe(pmsg, &tcq->reqs_msgq,
+					  tmp_pmsg, pdata) {
+			xio_msg_list_remove(&tcq->reqs_msgq, pmsg, pdata);
+			xio_connection_txq_del(connection, pmsg);
+			xio_connection_tmo_disarm(connection, pmsg);
+			if (xio_connection_mpath_failover(connection, pmsg))
+				continue;
+			xio_session_notify_msg_error(connection, pmsg,
+						     XIO_E_MSG_FLUSHED);
+		}
 
-	xio_msg_list_foreach_safe(pmsg, &connection->reqs_msgq,
-				  tmp_pmsg, pdata) {
-		xio_msg_list_remove(&connection->reqs_msgq, pmsg, pdata);
-		xio_session_notify_msg_error(connection, pmsg,
-					     XIO_E_MSG_FLUSHED);
-	}
-
-	xio_msg_list_foreach_safe(pmsg, &connection->rsps_msgq,
-				  tmp_pmsg, pdata) {
-		xio_msg_list_remove(&connection->rsps_msgq, pmsg, pdata);
-		if (pmsg->type == XIO_ONE_WAY_RSP) {
-			xio_msg_list_insert_head(
-					&connection->one_way_msg_pool,
-					pmsg, pdata);
-			continue;
+		xio_msg_list_foreach_safe(pmsg, &tcq->rsps_msgq,
+					  tmp_pmsg, pdata) {
+			xio_msg_list_remove(&tcq->rsps_msgq, pmsg, pdata);
+			xio_connection_txq_del(connection, pmsg);
+			if (pmsg->type == XIO_ONE_WAY_RSP) {
+				xio_msg_list_insert_head(
+						&connection->one_way_msg_pool,
+						pmsg, pdata);
+				continue;
+			}
+			xio_session_notify_msg_error(connection, pmsg,
+						     XIO_E_MSG_FLUSHED);
 		}
-		xio_session_notify_msg_error(connection, pmsg,
-					     XIO_E_MSG_FLUSHED);
 	}
+	xio_connection_txq_update(connection);
 
 	return 0;
 }
@@ -405,77 +718,463 @@ int xio_connection_flush_tasks(struct xio_connection *connection)
 }
 
 /*---------------------------------------------------------------------------*/
-/* xio_connection_xmit							     */
+/* xio_connection_msg_cost						     */
 /*---------------------------------------------------------------------------*/
-static int xio_connection_xmit(struct xio_connection *connection)
+static inline int64_t xio_connection_msg_cost(struct xio_msg *msg,
+					      int64_t quantum)
 {
-	struct xio_msg *msg;
-	int    retval = 0;
-	int    retry_cnt = 0;
-	int    error;
-	struct xio_msg_list *msg_lists[] = {
-		&connection->reqs_msgq,
-		&connection->rsps_msgq
-	};
-	struct xio_msg_list *in_flight_msg_lists[] = {
-		&connection->in_flight_reqs_msgq,
-		&connection->in_flight_rsps_msgq
-	};
-	struct xio_msg_list *msgq, *in_flight_msgq;
+	struct xio_vmsg *vmsg = &msg->out;
+	int64_t		cost;
+
+	cost = XIO_TC_MSG_OVERHEAD + vmsg->header.iov_len +
+	       xio_iovex_length(xio_vmsg_data_iov(vmsg), vmsg->data_iovlen);
+
+	/* a message larger than the quantum takes a whole turn */
+	return min(cost, quantum);
+}
+
+/*---------------------------------------------------------------------------*/
+/* xio_connection_may_send						     */
+/*---------------------------------------------------------------------------*/
+static int xio_connection_may_send(struct xio_connection *connection,
+				   int tc, struct xio_msg *msg)
+{
+	struct xio_tc_queue	*tcq;
+	uint32_t		in_flight = 0;
+	uint32_t		reserved = 0;
+	int			window;
+	int			i;
+
+	/* fin trails everything the other classes queued before it */
+	if (msg->type == XIO_FIN_REQ || msg->type == XIO_FIN_RSP) {
+		for (i = 0; i < XIO_MSG_TCLASS_MAX; i++) {
+			tcq = &connection->tcq[i];
+			if (i != tc &&
+			    !xio_msg_list_empty(IS_REQUEST(msg->type) ?
+						&tcq->reqs_msgq :
+						&tcq->rsps_msgq))
+				return 0;
+		}
+		return 1;
+	}
+	if (!IS_APPLICATION_MSG(msg) || !IS_REQUEST(msg->type))
+		return 1;
+
+	window = connection->conn->transport_hndl->tx_window;
+	if (window <= 0)
+		return 1;
+
+	/* keep the unused part of the other classes' reservations free */
+	for (i = 0; i < XIO_MSG_TCLASS_MAX; i++) {
+		tcq = &connection->tcq[i];
+		in_flight += tcq->reqs_in_flight;
+		if (i != tc && tcq->reqs_in_flight < tcq->reserve)
+			reserved += tcq->reserve - tcq->reqs_in_flight;
+	}
+
+	return (in_flight + reserved) < (uint32_t)window;
+}
+
+/*---------------------------------------------------------------------------*/
+/* xio_connection_xmit_tc						     */
+/*---------------------------------------------------------------------------*/
+static int xio_connection_xmit_tc(struct xio_connection *connection, int tc)
+{
+	struct xio_tc_queue	*tcq = &connection->tcq[tc];
+	int64_t			quantum = tcq->quantum;
+	struct xio_msg_list	*msgq;
+	struct xio_msg		*msg;
+	int64_t			cost;
+	int			sent = 0;
+	int			retry_cnt = 0;
+	int			error;
+
+	if (xio_msg_list_empty(&tcq->reqs_msgq) &&
+	    xio_msg_list_empty(&tcq->rsps_msgq)) {
+		tcq->deficit = 0;
+		return 0;
+	}
+	tcq->deficit += quantum;
 
 	while (retry_cnt < 2) {
-		msgq		= msg_lists[connection->send_req_toggle];
-		in_flight_msgq	=
-			in_flight_msg_lists[connection->send_req_toggle];
-		connection->send_req_toggle =
-			1 - connection->send_req_toggle;
+		msgq = tcq->send_req_toggle ? &tcq->rsps_msgq :
+					      &tcq->reqs_msgq;
+		tcq->send_req_toggle = 1 - tcq->send_req_toggle;
 		msg = xio_msg_list_first(msgq);
-		if (msg != NULL) {
-			retval = xio_connection_send(connection, msg);
-			if (retval) {
-				error = xio_errno();
-				if (error == EAGAIN) {
-					/* if user requested not to
-					 * queue messages */
-					if (xio_session_not_queueing(
-							connection->session)) {
-						xio_msg_list_remove(msgq, msg,
-								    pdata);
-						break;
-					}
-					retval = 0;
-					retry_cnt++;
-					continue;
-				} else if (error == ENOMSG) {
-					/* message error was notified */
-					TRACE_LOG(
-					    "xio_connection_send failed.\n");
-					retval = 0;
-					/* while error drain the messages */
-					retry_cnt = 0;
-					continue;
-				} else  {
+		if (msg == NULL ||
+		    !xio_connection_may_send(connection, tc, msg)) {
+			retry_cnt++;
+			continue;
+		}
+		cost = xio_connection_msg_cost(msg, quantum);
+		if (cost > tcq->deficit) {
+			retry_cnt++;
+			continue;
+		}
+		if (xio_connection_send(connection, msg)) {
+			error = xio_errno();
+			if (error == EAGAIN) {
+				/* if user requested not to queue messages */
+				if (xio_session_not_queueing(
+						connection->session)) {
 					xio_msg_list_remove(msgq, msg, pdata);
-					break;
+					xio_connection_txq_del(connection,
+							       msg);
+					if (IS_REQUEST(msg->type))
+						xio_connection_tmo_disarm(
+							connection, msg);
+					return -1;
 				}
-			} else {
+				retry_cnt++;
+				continue;
+			} else if (error == ENOMSG) {
+				/* message error was notified */
+				TRACE_LOG("xio_connection_send failed.\n");
+				/* while error drain the messages */
 				retry_cnt = 0;
-				xio_msg_list_remove(msgq, msg, pdata);
-				if (IS_APPLICATION_MSG(msg))
-					xio_msg_list_insert_tail(
-							in_flight_msgq, msg,
-							pdata);
+				continue;
 			}
+			xio_msg_list_remove(msgq, msg, pdata);
+			xio_connection_txq_del(connection, msg);
+			return -1;
+		}
+		retry_cnt = 0;
+		sent++;
+		tcq->deficit -= cost;
+		xio_msg_list_remove(msgq, msg, pdata);
+		xio_connection_txq_del(connection, msg);
+		if (!IS_APPLICATION_MSG(msg))
+			continue;
+		if (IS_REQUEST(msg->type)) {
+			xio_connection_latency(connection, XIO_LATENCY_QUEUE,
+					       get_cycles() - msg->timestamp);
+			tcq->reqs_in_flight++;
+			if (msg->tmo.state == XIO_MSG_TMO_QUEUED)
+				msg->tmo.state = XIO_MSG_TMO_IN_FLIGHT;
+			xio_msg_list_insert_tail(
+					&connection->in_flight_reqs_msgq,
+					msg, pdata);
 		} else {
-			retry_cnt++;
+			xio_msg_list_insert_tail(
+					&connection->in_flight_rsps_msgq,
+					msg, pdata);
 		}
 	}
 
-	if (retval != 0)
-		ERROR_LOG("failed to send message - %s\n",
-			  xio_strerror(xio_errno()));
+	/* an idle class keeps no credit and a blocked one does not bank
+	 * more than one turn for when the window opens
+	 */
+	if (xio_msg_list_empty(&tcq->reqs_msgq) &&
+	    xio_msg_list_empty(&tcq->rsps_msgq))
+		tcq->deficit = 0;
+	else if (tcq->deficit > quantum)
+		tcq->deficit = quantum;
+
+	return sent;
+}
+
+/*---------------------------------------------------------------------------*/
+/* xio_connection_xmit							     */
+/*---------------------------------------------------------------------------*/
+static int xio_connection_xmit(struct xio_connection *connection)
+{
+	int	sent;
+	int	retval;
+	int	tc;
+	int	i;
+
+	/* deficit round robin - each class gets its quantum per round and
+	 * rounds repeat while any class still makes progress
+	 */
+	do {
+		sent = 0;
+		for (i = 0; i < XIO_MSG_TCLASS_MAX; i++) {
+			tc = connection->tc_cursor;
+			connection->tc_cursor = (tc + 1) % XIO_MSG_TCLASS_MAX;
+			retval = xio_connection_xmit_tc(connection, tc);
+			if (retval < 0) {
+				ERROR_LOG("failed to send message - %s\n",
+					  xio_strerror(xio_errno()));
+				xio_connection_txq_update(connection);
+				return -1;
+			}
+			sent += retval;
+		}
+	} while (sent);
+
+	xio_connection_txq_update(connection);
+
+	return 0;
+}
+
+/*---------------------------------------------------------------------------*/
+/* xio_connection_construct						     */
+/*---------------------------------------------------------------------------*/
+void xio_connection_construct(void)
+{
+	spin_lock_init(&tclass_lock);
+	spin_lock_init(&txq_lock);
+	xio_hedge_construct();
+	xio_resume_construct();
+}
+
+/*---------------------------------------------------------------------------*/
+/* xio_connection_set_tclass_attr					     */
+/*---------------------------------------------------------------------------*/
+int xio_connection_set_tclass_attr(const struct xio_tclass_attr *attr)
+{
+	if ((unsigned int)attr->tclass >= XIO_MSG_TCLASS_MAX ||
+	    attr->quantum == 0) {
+		xio_set_error(EINVAL);
+		return -1;
+	}
+	spin_lock(&tclass_lock);
+	tclass_attrs[attr->tclass].quantum = attr->quantum;
+	tclass_attrs[attr->tclass].reserve = attr->reserve;
+	spin_unlock(&tclass_lock);
+
+	return 0;
+}
+
+/*---------------------------------------------------------------------------*/
+/* xio_connection_get_tclass_attr					     */
+/*---------------------------------------------------------------------------*/
+int xio_connection_get_tclass_attr(struct xio_tclass_attr *attr)
+{
+	if ((unsigned int)attr->tclass >= XIO_MSG_TCLASS_MAX) {
+		xio_set_error(EINVAL);
+		return -1;
+	}
+	spin_lock(&tclass_lock);
+	*attr = tclass_attrs[attr->tclass];
+	spin_unlock(&tclass_lock);
+
+	return 0;
+}
+
+/*---------------------------------------------------------------------------*/
+/* xio_connection_set_tx_queue_attr					     */
+/*---------------------------------------------------------------------------*/
+int xio_connection_set_tx_queue_attr(const struct xio_tx_queue_attr *attr)
+{
+	if ((attr->high_msgs && attr->low_msgs >= attr->high_msgs) ||
+	    (attr->high_bytes && attr->low_bytes >= attr->high_bytes)) {
+		xio_set_error(EINVAL);
+		return -1;
+	}
+	spin_lock(&txq_lock);
+	txq_attr = *attr;
+	spin_unlock(&txq_lock);
+
+	return 0;
+}
+
+/*---------------------------------------------------------------------------*/
+/* xio_connection_get_tx_queue_attr					     */
+/*---------------------------------------------------------------------------*/
+int xio_connection_get_tx_queue_attr(struct xio_tx_queue_attr *attr)
+{
+	spin_lock(&txq_lock);
+	*attr = txq_attr;
+	spin_unlock(&txq_lock);
+
+	return 0;
+}
+
+/*---------------------------------------------------------------------------*/
+/* xio_connection_get_transport_stats					     */
+/*---------------------------------------------------------------------------*/
+int xio_connection_get_transport_stats(struct xio_connection *connection,
+				       struct xio_transport_stats *stats)
+{
+	struct xio_conn *conn;
+
+	if (!connection || !stats) {
+		xio_set_error(EINVAL);
+		return -1;
+	}
+	conn = connection->conn;
+	if (!conn || !conn->transport_hndl) {
+		xio_set_error(ENOTCONN);
+		return -1;
+	}
+	if (!conn->transport->get_stats) {
+		xio_set_error(XIO_E_NOT_SUPPORTED);
+		return -1;
+	}
+
+	return conn->transport->get_stats(conn->transport_hndl, stats);
+}
+
+/*---------------------------------------------------------------------------*/
+/* xio_connection_tmo_arm						     */
+/*---------------------------------------------------------------------------*/
+static void xio_connection_tmo_arm(struct xio_connection *connection,
+				   struct xio_msg *msg, uint32_t msec)
+{
+	struct xio_tmo_wheel	*wheel = &connection->tmo_wheel;
+
+	/* round up so a deadline never fires early by more than a tick */
+	msg->tmo.expire	= wheel->now + msec / XIO_TMO_TICK_MSEC + 1;
+	msg->tmo.state	= XIO_MSG_TMO_QUEUED;
+	xio_msg_list_insert_tail(
+			&wheel->slot[msg->tmo.expire & XIO_TMO_WHEEL_MASK],
+			msg, tmo);
+
+	if (wheel->nr++ == 0 && wheel->timer == NULL)
+		xio_ctx_timer_add(connection->ctx, XIO_TMO_TICK_MSEC,
+				  connection, xio_connection_tmo_tick,
+				  &wheel->timer);
+}
+
+/*---------------------------------------------------------------------------*/
+/* xio_connection_tmo_left - msec left of the deadline set at submit	     */
+/*---------------------------------------------------------------------------*/
+static uint32_t xio_connection_tmo_left(struct xio_connection *connection,
+					struct xio_msg *msg)
+{
+	uint64_t		hertz = connection->ctx->stats.hertz;
+	uint64_t		msec;
+
+	if (hertz == 0)
+		return msg->timeout;
+
+	msec = (get_cycles() - msg->timestamp) * 1000 / hertz;
+
+	return (msec < msg->timeout) ? msg->timeout - msec : 0;
+}
+
+/*---------------------------------------------------------------------------*/
+/* xio_connection_tmo_disarm						     */
+/*---------------------------------------------------------------------------*/
+void xio_connection_tmo_disarm(struct xio_connection *connection,
+			       struct xio_msg *msg)
+{
+	struct xio_tmo_wheel	*wheel = &connection->tmo_wheel;
+
+	switch (msg->tmo.state) {
+	case XIO_MSG_TMO_QUEUED:
+	case XIO_MSG_TMO_IN_FLIGHT:
+		xio_msg_list_remove(
+			&wheel->slot[msg->tmo.expire & XIO_TMO_WHEEL_MASK],
+			msg, tmo);
+		wheel->nr--;
+		break;
+	default:
+		break;
+	}
+	msg->tmo.state = XIO_MSG_TMO_NONE;
+}
+
+/*---------------------------------------------------------------------------*/
+/* xio_connection_cancel_owed - the library cancels sn on its own	     */
+/*---------------------------------------------------------------------------*/
+void xio_connection_cancel_owed(struct xio_connection *connection,
+				uint64_t sn)
+{
+	struct xio_cancels_owed	*owed = &connection->cancels_owed;
 
-	return retval;
+	/* forget the oldest - its answer is long overdue */
+	if (owed->nr == XIO_CANCELS_OWED) {
+		memmove(&owed->sn[0], &owed->sn[1],
+			(XIO_CANCELS_OWED - 1) * sizeof(owed->sn[0]));
+		owed->nr--;
+	}
+	owed->sn[owed->nr++] = sn;
+}
+
+/*---------------------------------------------------------------------------*/
+/* xio_connection_cancel_answered - returns 1 when the answer for sn was    */
+/* owed to a cancel of the library					     */
+/*---------------------------------------------------------------------------*/
+int xio_connection_cancel_answered(struct xio_connection *connection,
+				   uint64_t sn)
+{
+	struct xio_cancels_owed	*owed = &connection->cancels_owed;
+	uint32_t		i;
+
+	for (i = 0; i < owed->nr; i++) {
+		if (owed->sn[i] != sn)
+			continue;
+		owed->nr--;
+		memmove(&owed->sn[i], &owed->sn[i + 1],
+			(owed->nr - i) * sizeof(owed->sn[0]));
+		return 1;
+	}
+
+	return 0;
+}
+
+/*---------------------------------------------------------------------------*/
+/* xio_connection_tmo_expire						     */
+/*---------------------------------------------------------------------------*/
+static void xio_connection_tmo_expire(struct xio_connection *connection,
+				      struct xio_msg *msg)
+{
+	struct xio_tmo_wheel	*wheel = &connection->tmo_wheel;
+
+	xio_msg_list_remove(&wheel->slot[msg->tmo.expire & XIO_TMO_WHEEL_MASK],
+			    msg, tmo);
+	wheel->nr--;
+
+	if (msg->tmo.state == XIO_MSG_TMO_QUEUED) {
+		/* never sent - nothing to cancel on the wire */
+		msg->tmo.state = XIO_MSG_TMO_NONE;
+		xio_msg_list_remove(
+				&xio_connection_tcq(connection, msg)->reqs_msgq,
+				msg, pdata);
+		xio_connection_txq_del(connection, msg);
+		xio_session_notify_msg_error(connection, msg, XIO_E_TIMEOUT);
+		xio_connection_txq_update(connection);
+		return;
+	}
+
+	/* no cancel can go out now. a flush for resumption fails the
+	 * request with a timeout, a close flushes it
+	 */
+	if (connection->state != XIO_CONNECTION_STATE_ONLINE) {
+		msg->tmo.state = XIO_MSG_TMO_EXPIRED;
+		return;
+	}
+
+	DEBUG_LOG("[%llu] - request timed out. canceling\n", msg->sn);
+	msg->tmo.state = XIO_MSG_TMO_EXPIRED;
+	xio_connection_cancel_owed(connection, msg->sn);
+	xio_cancel_request(connection, msg);
+}
+
+/*---------------------------------------------------------------------------*/
+/* xio_connection_tmo_tick						     */
+/*---------------------------------------------------------------------------*/
+static void xio_connection_tmo_tick(void *data)
+{
+	struct xio_connection	*connection = data;
+	struct xio_tmo_wheel	*wheel = &connection->tmo_wheel;
+	struct xio_msg_list	*slot;
+	struct xio_msg		*msg;
+
+	wheel->now++;
+	slot = &wheel->slot[wheel->now & XIO_TMO_WHEEL_MASK];
+
+	/* the callbacks may complete, resend or destroy, so hold the
+	 * connection and rescan the slot after each expiry
+	 */
+	kref_get(&connection->kref);
+	do {
+		xio_msg_list_foreach(msg, slot, tmo) {
+			if ((int32_t)(msg->tmo.expire - wheel->now) <= 0)
+				break;
+		}
+		if (msg)
+			xio_connection_tmo_expire(connection, msg);
+	} while (msg);
+
+	if (wheel->nr && wheel->timer == NULL)
+		xio_ctx_timer_add(connection->ctx, XIO_TMO_TICK_MSEC,
+				  connection, xio_connection_tmo_tick,
+				  &wheel->timer);
+
+	kref_put(&connection->kref, xio_connection_release);
 }
 
 /*---------------------------------------------------------------------------*/
@@ -484,13 +1183,19 @@ static int xio_connection_xmit(struct xio_connection *connection)
 int xio_connection_remove_in_flight(struct xio_connection *connection,
 				    struct xio_msg *msg)
 {
+	struct xio_tc_queue *tcq;
+
 	if (!IS_APPLICATION_MSG(msg))
 		return 0;
 
-	if (IS_REQUEST(msg->type))
+	if (IS_REQUEST(msg->type)) {
+		tcq = xio_connection_tcq(connection, msg);
 		xio_msg_list_remove(
 				&connection->in_flight_reqs_msgq, msg, pdata);
-	else
+		if (tcq->reqs_in_flight)
+			tcq->reqs_in_flight--;
+		xio_connection_tmo_disarm(connection, msg);
+	} else
 		xio_msg_list_remove(
 				&connection->in_flight_rsps_msgq, msg, pdata);
 
@@ -506,12 +1211,241 @@ int xio_connection_remove_msg_from_queue(struct xio_connection *connection,
 	if (!IS_APPLICATION_MSG(msg))
 		return 0;
 
-	if (IS_REQUEST(msg->type))
+	if (IS_REQUEST(msg->type)) {
 		xio_msg_list_remove(
-				&connection->reqs_msgq, msg, pdata);
-	else
+				&xio_connection_tcq(connection, msg)->reqs_msgq,
+				msg, pdata);
+		xio_connection_tmo_disarm(connection, msg);
+	} else {
 		xio_msg_list_remove(
-				&connection->rsps_msgq, msg, pdata);
+				&xio_connection_tcq(connection, msg)->rsps_msgq,
+				msg, pdata);
+	}
+	xio_connection_txq_del(connection, msg);
+
+	return 0;
+}
+
+/*---------------------------------------------------------------------------*/
+/* xio_msg_stamp_submit							     */
+/*---------------------------------------------------------------------------*/
+static inline void xio_msg_stamp_submit(struct xio_msg *msg)
+{
+	msg->timestamp = get_cycles();
+	memset(msg->stamp, 0, sizeof(msg->stamp));
+	msg->stamp[XIO_STAGE_SUBMIT] = msg->timestamp;
+}
+
+/*---------------------------------------------------------------------------*/
+/* xio_connection_stamp_sent						     */
+/*---------------------------------------------------------------------------*/
+void xio_connection_stamp_sent(struct xio_connection *connection,
+			       struct xio_msg *msg,
+			       struct xio_task *task)
+{
+	uint64_t *stamp = msg->stamp;
+
+	/* the send completion of a request may still be unreaped when its
+	 * response arrives, selective signaling reaps it later
+	 */
+	stamp[XIO_STAGE_POST]	   = task->stamp[XIO_STAGE_POST];
+	stamp[XIO_STAGE_SEND_COMP] = task->stamp[XIO_STAGE_SEND_COMP];
+
+	if (!stamp[XIO_STAGE_POST] || !stamp[XIO_STAGE_SUBMIT])
+		return;
+	xio_connection_latency(connection, XIO_LATENCY_POST,
+			       stamp[XIO_STAGE_POST] -
+			       stamp[XIO_STAGE_SUBMIT]);
+	if (stamp[XIO_STAGE_SEND_COMP])
+		xio_connection_latency(connection, XIO_LATENCY_SEND,
+				       stamp[XIO_STAGE_SEND_COMP] -
+				       stamp[XIO_STAGE_POST]);
+}
+
+/*---------------------------------------------------------------------------*/
+/* xio_connection_stamp_recv						     */
+/*---------------------------------------------------------------------------*/
+void xio_connection_stamp_recv(struct xio_connection *connection,
+			       struct xio_msg *msg,
+			       struct xio_task *task)
+{
+	uint64_t *stamp = msg->stamp;
+
+	stamp[XIO_STAGE_RECV_COMP] = task->stamp[XIO_STAGE_RECV_COMP];
+	stamp[XIO_STAGE_DELIVER]   = get_cycles();
+
+	if (stamp[XIO_STAGE_RECV_COMP])
+		xio_connection_latency(connection, XIO_LATENCY_RECV,
+				       stamp[XIO_STAGE_DELIVER] -
+				       stamp[XIO_STAGE_RECV_COMP]);
+}
+
+/*---------------------------------------------------------------------------*/
+/* xio_connection_queue_request						     */
+/*---------------------------------------------------------------------------*/
+static void xio_connection_queue_request(struct xio_connection *connection,
+					 struct xio_msg *msg)
+{
+	struct xio_statistics	*stats = &connection->ctx->stats;
+	struct xio_vmsg		*vmsg = &msg->out;
+
+	xio_msg_stamp_submit(msg);
+	xio_stat_inc(stats, XIO_STAT_TX_MSG);
+	xio_stat_add(stats, XIO_STAT_TX_BYTES,
+		     vmsg->header.iov_len +
+		     xio_iovex_length(xio_vmsg_data_iov(vmsg),
+				      vmsg->data_iovlen));
+
+	msg->sn = xio_session_get_sn(connection->session);
+	msg->type = XIO_MSG_TYPE_REQ;
+	xio_trace(connection->ctx, XIO_TRACE_SEND_REQ, msg->sn, 0, 0);
+
+	xio_msg_list_insert_tail(
+		&xio_connection_tcq(connection, msg)->reqs_msgq,
+		msg, pdata);
+	xio_connection_txq_add(connection, msg);
+
+	msg->tmo.state = XIO_MSG_TMO_NONE;
+	if (msg->timeout)
+		xio_connection_tmo_arm(connection, msg, msg->timeout);
+}
+
+/*---------------------------------------------------------------------------*/
+/* xio_connection_queue_msg						     */
+/*---------------------------------------------------------------------------*/
+static void xio_connection_queue_msg(struct xio_connection *connection,
+				     struct xio_msg *msg)
+{
+	struct xio_statistics	*stats = &connection->ctx->stats;
+	struct xio_vmsg		*vmsg = &msg->out;
+
+	xio_msg_stamp_submit(msg);
+	xio_stat_inc(stats, XIO_STAT_TX_MSG);
+	xio_stat_add(stats, XIO_STAT_TX_BYTES,
+		     vmsg->header.iov_len +
+		     xio_iovex_length(xio_vmsg_data_iov(vmsg),
+				      vmsg->data_iovlen));
+
+	msg->sn = xio_session_get_sn(connection->session);
+	msg->type = XIO_ONE_WAY_REQ;
+	msg->tmo.state = XIO_MSG_TMO_NONE;
+
+	xio_msg_list_insert_tail(
+		&xio_connection_tcq(connection, msg)->reqs_msgq,
+		msg, pdata);
+	xio_connection_txq_add(connection, msg);
+}
+
+/*---------------------------------------------------------------------------*/
+/* xio_connection_detach_msgs - take back requests not sent yet		     */
+/*---------------------------------------------------------------------------*/
+void xio_connection_detach_msgs(struct xio_connection *connection,
+				struct xio_msg_list *msgq)
+{
+	struct xio_msg	*pmsg, *tmp_pmsg;
+	int		tc;
+
+	for (tc = 0; tc < XIO_MSG_TCLASS_MAX; tc++) {
+		xio_msg_list_foreach_safe(pmsg, &connection->tcq[tc].reqs_msgq,
+					  tmp_pmsg, pdata) {
+			if (!IS_APPLICATION_MSG(pmsg))
+				continue;
+			xio_connection_remove_msg_from_queue(connection, pmsg);
+			xio_msg_list_insert_tail(msgq, pmsg, pdata);
+		}
+	}
+	xio_connection_txq_update(connection);
+}
+
+/*---------------------------------------------------------------------------*/
+/* xio_connection_requeue_msgs - queue detached requests again		     */
+/*---------------------------------------------------------------------------*/
+int xio_connection_requeue_msgs(struct xio_connection *connection,
+				struct xio_msg_list *msgq)
+{
+	struct xio_msg	*pmsg;
+
+	/* the application handed these over already - no watermark check.
+	 * they keep the sn, stamps and deadline of their first submit and
+	 * were counted in the statistics then
+	 */
+	while (!xio_msg_list_empty(msgq)) {
+		pmsg = xio_msg_list_first(msgq);
+		xio_msg_list_remove(msgq, pmsg, pdata);
+		pmsg->next = NULL;
+		xio_msg_list_insert_tail(
+			&xio_connection_tcq(connection, pmsg)->reqs_msgq,
+			pmsg, pdata);
+		xio_connection_txq_add(connection, pmsg);
+		if (pmsg->type == XIO_ONE_WAY_REQ)
+			continue;
+
+		if (pmsg->timeout)
+			xio_connection_tmo_arm(
+				connection, pmsg,
+				xio_connection_tmo_left(connection, pmsg));
+		xio_hedge_arm(connection, pmsg);
+	}
+
+	if (xio_is_connection_online(connection))
+		return xio_connection_xmit(connection);
+
+	xio_connection_txq_update(connection);
+
+	return 0;
+}
+
+/*---------------------------------------------------------------------------*/
+/* xio_connection_resume_rsp - answer a replayed request on connection	     */
+/* with the response queued for it on the failed connection old	     */
+/*---------------------------------------------------------------------------*/
+int xio_connection_resume_rsp(struct xio_connection *old,
+			      struct xio_connection *connection,
+			      struct xio_task *task)
+{
+	struct xio_msg		*pmsg, *tmp_pmsg;
+	struct xio_tc_queue	*tcq;
+	int			tc;
+
+	for (tc = 0; tc < XIO_MSG_TCLASS_MAX; tc++) {
+		xio_msg_list_foreach_safe(pmsg, &old->tcq[tc].rsps_msgq,
+					  tmp_pmsg, pdata) {
+			/* read receipts come from old's own message pool */
+			if (pmsg->request->sn != task->imsg.sn ||
+			    !(pmsg->flags & XIO_MSG_RSP_FLAG_LAST))
+				continue;
+			xio_connection_remove_msg_from_queue(old, pmsg);
+			pmsg->request = &task->imsg;
+			task->state = XIO_TASK_STATE_READ;
+			tcq = xio_connection_tcq(connection, pmsg);
+			xio_msg_list_insert_tail(&tcq->rsps_msgq, pmsg, pdata);
+			xio_connection_txq_add(connection, pmsg);
+			return 1;
+		}
+	}
+
+	return 0;
+}
+
+/*---------------------------------------------------------------------------*/
+/* xio_connection_send_copy - queue a library owned copy of a request	     */
+/*---------------------------------------------------------------------------*/
+int xio_connection_send_copy(struct xio_connection *connection,
+			     struct xio_msg *msg)
+{
+	if (!xio_session_is_valid_out_msg(connection->session, msg)) {
+		xio_set_error(EINVAL);
+		ERROR_LOG("invalid out message\n");
+		return -1;
+	}
+
+	xio_connection_queue_request(connection, msg);
+
+	/* once queued the copy is reported through the hedging hooks */
+	if (xio_is_connection_online(connection))
+		xio_connection_xmit(connection);
+	else
+		xio_connection_txq_update(connection);
 
 	return 0;
 }
@@ -523,15 +1457,21 @@ int xio_send_request(struct xio_connection *connection,
 		     struct xio_msg *msg)
 {
 	int			valid;
-	struct xio_statistics	*stats;
-	struct xio_vmsg		*vmsg;
 	struct xio_msg		*pmsg;
+	struct xio_connection	*path;
 
 	if (connection  == NULL || msg == NULL) {
 		xio_set_error(EINVAL);
 		return -1;
 	}
 
+	/* a multipath front places each batch on its best path */
+	if (connection->mpath.nr) {
+		path = xio_connection_mpath_pick(connection, NULL);
+		if (path)
+			connection = path;
+	}
+
 	if (unlikely(connection->state == XIO_CONNECTION_STATE_CLOSING ||
 		     connection->state == XIO_CONNECTION_STATE_CLOSED ||
 		     connection->state == XIO_CONNECTION_STATE_DISCONNECTED)) {
@@ -545,8 +1485,19 @@ int xio_send_request(struct xio_connection *connection,
 		return -1;
 	}
 
+	/* the connection moves to another context */
+	if (unlikely(connection->migration)) {
+		xio_set_error(EAGAIN);
+		return -1;
+	}
+
+	/* producers throttle until on_tx_queue_low */
+	if (unlikely(xio_connection_txq_full(connection))) {
+		xio_set_error(EAGAIN);
+		return -1;
+	}
+
 	pmsg = msg;
-	stats = &connection->ctx->stats;
 	while (pmsg) {
 		valid = xio_session_is_valid_in_req(connection->session, pmsg);
 		if (!valid) {
@@ -561,18 +1512,8 @@ int xio_send_request(struct xio_connection *connection,
 			return -1;
 		}
 
-		vmsg = &pmsg->out;
-		pmsg->timestamp = get_cycles();
-		xio_stat_inc(stats, XIO_STAT_TX_MSG);
-		xio_stat_add(stats, XIO_STAT_TX_BYTES,
-			     vmsg->header.iov_len +
-			     xio_iovex_length(vmsg->data_iov,
-					      vmsg->data_iovlen));
-
-		pmsg->sn = xio_session_get_sn(connection->session);
-		pmsg->type = XIO_MSG_TYPE_REQ;
-
-		xio_msg_list_insert_tail(&connection->reqs_msgq, pmsg, pdata);
+		xio_connection_queue_request(connection, pmsg);
+		xio_hedge_arm(connection, pmsg);
 
 		pmsg = pmsg->next;
 	}
@@ -581,6 +1522,8 @@ int xio_send_request(struct xio_connection *connection,
 	if (xio_is_connection_online(connection))
 		return xio_connection_xmit(connection);
 
+	xio_connection_txq_update(connection);
+
 	return 0;
 }
 
@@ -594,11 +1537,20 @@ int xio_send_response(struct xio_msg *msg)
 	struct xio_statistics	*stats;
 	struct xio_vmsg		*vmsg;
 	struct xio_msg		*pmsg = msg;
+	uint64_t		delay;
 	int			valid;
 
 	while (pmsg) {
 		task	   = container_of(msg->request, struct xio_task, imsg);
 		connection = task->connection;
+		if (unlikely(connection->state ==
+			     XIO_CONNECTION_STATE_RESUMING)) {
+			/* answer the replay on the connection that replaced
+			 * the failed one
+			 */
+			task	   = xio_resume_rebind(task, pmsg);
+			connection = task->connection;
+		}
 		stats	   = &connection->ctx->stats;
 		vmsg	   = &msg->out;
 
@@ -617,8 +1569,11 @@ int xio_send_response(struct xio_msg *msg)
 		}
 
 		/* Server latency */
-		xio_stat_add(stats, XIO_STAT_APPDELAY,
-			     get_cycles() - task->imsg.timestamp);
+		delay = get_cycles() - task->imsg.timestamp;
+		xio_stat_add(stats, XIO_STAT_APPDELAY, delay);
+		xio_connection_latency(connection, XIO_LATENCY_APP, delay);
+		xio_trace(connection->ctx, XIO_TRACE_SEND_RSP,
+			  task->imsg.sn, task->ltid, task->rtid);
 
 
 		valid = xio_session_is_valid_out_msg(connection->session, pmsg);
@@ -629,10 +1584,11 @@ int xio_send_response(struct xio_msg *msg)
 		}
 
 
+		xio_msg_stamp_submit(pmsg);
 		xio_stat_inc(stats, XIO_STAT_TX_MSG);
 		xio_stat_add(stats, XIO_STAT_TX_BYTES,
 			     vmsg->header.iov_len +
-			     xio_iovex_length(vmsg->data_iov,
+			     xio_iovex_length(xio_vmsg_data_iov(vmsg),
 					      vmsg->data_iovlen));
 
 		pmsg->flags = XIO_MSG_RSP_FLAG_LAST;
@@ -644,7 +1600,10 @@ int xio_send_response(struct xio_msg *msg)
 
 		pmsg->type = XIO_MSG_TYPE_RSP;
 
-		xio_msg_list_insert_tail(&connection->rsps_msgq, pmsg, pdata);
+		xio_msg_list_insert_tail(
+			&xio_connection_tcq(connection, pmsg)->rsps_msgq,
+			pmsg, pdata);
+		xio_connection_txq_add(connection, pmsg);
 
 		pmsg = pmsg->next;
 	}
@@ -652,6 +1611,9 @@ int xio_send_response(struct xio_msg *msg)
 	if (connection && xio_is_connection_online(connection))
 		return xio_connection_xmit(connection);
 
+	if (connection)
+		xio_connection_txq_update(connection);
+
 	return 0;
 }
 
@@ -689,7 +1651,10 @@ int xio_connection_send_read_receipt(struct xio_connection *connection,
 	rsp->out.header.iov_len = 0;
 	rsp->out.data_iovlen = 0;
 
-	xio_msg_list_insert_tail(&connection->rsps_msgq, rsp, pdata);
+	xio_msg_list_insert_tail(
+			&xio_connection_tcq(connection, rsp)->rsps_msgq,
+			rsp, pdata);
+	xio_connection_txq_add(connection, rsp);
 
 	/* do not xmit until connection is assigned */
 	if (xio_is_connection_online(connection))
@@ -711,18 +1676,33 @@ int xio_connection_release_read_receipt(struct xio_connection *connection,
 int xio_send_msg(struct xio_connection *connection,
 		 struct xio_msg *msg)
 {
-	struct xio_statistics	*stats = &connection->ctx->stats;
-	struct xio_vmsg		*vmsg;
 	struct xio_msg		*pmsg = msg;
+	struct xio_connection	*path;
 	int			valid;
 
 
+	if (connection->mpath.nr) {
+		path = xio_connection_mpath_pick(connection, NULL);
+		if (path)
+			connection = path;
+	}
+
 	if (xio_session_not_queueing(connection->session) &&
 	    (connection->state != XIO_CONNECTION_STATE_ONLINE)) {
 		xio_set_error(EAGAIN);
 		return -1;
 	}
 
+	if (unlikely(connection->migration)) {
+		xio_set_error(EAGAIN);
+		return -1;
+	}
+
+	if (unlikely(xio_connection_txq_full(connection))) {
+		xio_set_error(EAGAIN);
+		return -1;
+	}
+
 	while (pmsg) {
 		valid = xio_session_is_valid_out_msg(connection->session, pmsg);
 		if (!valid) {
@@ -731,18 +1711,7 @@ int xio_send_msg(struct xio_connection *connection,
 			return -1;
 		}
 
-		vmsg	= &pmsg->out;
-		pmsg->timestamp = get_cycles();
-		xio_stat_inc(stats, XIO_STAT_TX_MSG);
-		xio_stat_add(stats, XIO_STAT_TX_BYTES,
-			     vmsg->header.iov_len +
-			     xio_iovex_length(vmsg->data_iov,
-			     vmsg->data_iovlen));
-
-		pmsg->sn = xio_session_get_sn(connection->session);
-		pmsg->type = XIO_ONE_WAY_REQ;
-
-		xio_msg_list_insert_tail(&connection->reqs_msgq, pmsg, pdata);
+		xio_connection_queue_msg(connection, pmsg);
 
 		pmsg = pmsg->next;
 	}
@@ -751,6 +1720,8 @@ int xio_send_msg(struct xio_connection *connection,
 	if (xio_is_connection_online(connection))
 		return xio_connection_xmit(connection);
 
+	xio_connection_txq_update(connection);
+
 	return 0;
 }
 
@@ -778,9 +1749,20 @@ static void xio_connection_release(struct kref *kref)
 	struct xio_connection *connection = container_of(kref,
 							 struct xio_connection,
 							 kref);
+	if (connection->session->last_connection == connection)
+		connection->session->last_connection = NULL;
+
+	if (connection->tmo_wheel.timer)
+		xio_ctx_timer_del(connection->ctx, connection->tmo_wheel.timer);
+	xio_hedge_release(connection);
+	xio_connection_mpath_release(connection);
+	xio_migrate_release(connection);
+	xio_resume_release(connection);
+
 	xio_free_ow_msg_pool(connection);
 	list_del(&connection->ctx_list_entry);
 
+	kfree(connection->io_tasks_htbl);
 	kfree(connection);
 }
 
@@ -794,6 +1776,41 @@ int xio_connection_close(struct xio_connection *connection)
 	return 0;
 }
 
+/*---------------------------------------------------------------------------*/
+/* xio_connection_index_io_tasks					     */
+/*---------------------------------------------------------------------------*/
+static void xio_connection_index_io_tasks(struct xio_connection *connection)
+{
+	struct xio_task		*ptask;
+	uint32_t		size = XIO_IO_TASKS_HTBL_MIN;
+	uint32_t		i;
+	int			max = XIO_IO_TASKS_HTBL_MAX;
+
+	/* no more tasks can be in flight than the conn's pool holds */
+	if (connection->conn && connection->conn->primary_tasks_pool)
+		max = connection->conn->primary_tasks_pool->max;
+	while (size < max && size < XIO_IO_TASKS_HTBL_MAX)
+		size <<= 1;
+
+	connection->io_tasks_htbl = kcalloc(size,
+					    sizeof(*connection->io_tasks_htbl),
+					    GFP_KERNEL);
+	if (connection->io_tasks_htbl == NULL) {
+		/* lookups fall back to walking io_tasks_list */
+		ERROR_LOG("failed to allocate the in flight index\n");
+		return;
+	}
+	connection->io_tasks_htbl_mask = size - 1;
+	for (i = 0; i < size; i++)
+		INIT_LIST_HEAD(&connection->io_tasks_htbl[i]);
+
+	list_for_each_entry(ptask, &connection->io_tasks_list,
+			    tasks_list_entry)
+		list_move(&ptask->io_tasks_htbl_entry,
+			  &connection->io_tasks_htbl[ptask->imsg.sn &
+					connection->io_tasks_htbl_mask]);
+}
+
 /*---------------------------------------------------------------------------*/
 /* xio_connection_queue_io_task						     */
 /*---------------------------------------------------------------------------*/
@@ -801,6 +1818,14 @@ void xio_connection_queue_io_task(struct xio_connection *connection,
 				    struct xio_task *task)
 {
 	list_move_tail(&task->tasks_list_entry, &connection->io_tasks_list);
+	if (unlikely(connection->io_tasks_htbl == NULL)) {
+		/* indexes the task together with any already queued */
+		xio_connection_index_io_tasks(connection);
+		return;
+	}
+	list_move(&task->io_tasks_htbl_entry,
+		  &connection->io_tasks_htbl[task->imsg.sn &
+					     connection->io_tasks_htbl_mask]);
 }
 
 /*---------------------------------------------------------------------------*/
@@ -843,6 +1868,7 @@ int xio_release_response(struct xio_msg *msg)
 		connection = task->connection;
 		list_move_tail(&task->tasks_list_entry,
 			       &connection->post_io_tasks_list);
+		list_del_init(&task->io_tasks_htbl_entry);
 
 
 		xio_release_response_task(task);
@@ -881,6 +1907,7 @@ int xio_release_msg(struct xio_msg *msg)
 		connection = task->connection;
 		list_move_tail(&task->tasks_list_entry,
 			       &connection->post_io_tasks_list);
+		list_del_init(&task->io_tasks_htbl_entry);
 
 		pmsg = pmsg->next;
 
@@ -925,7 +1952,9 @@ static int xio_send_fin_req(struct xio_connection *connection)
 
 
 	/* insert to the tail of the queue */
-	xio_msg_list_insert_tail(&connection->reqs_msgq, msg, pdata);
+	xio_msg_list_insert_tail(
+			&xio_connection_tcq(connection, msg)->reqs_msgq,
+			msg, pdata);
 
 	xio_connection_fin_addref(connection);
 
@@ -957,7 +1986,9 @@ static int xio_send_fin_rsp(struct xio_connection *connection,
 
 
 	/* insert to the tail of the queue */
-	xio_msg_list_insert_tail(&connection->rsps_msgq, msg, pdata);
+	xio_msg_list_insert_tail(
+			&xio_connection_tcq(connection, msg)->rsps_msgq,
+			msg, pdata);
 
 	/* status is not importent - just send */
 	return xio_connection_xmit(connection);
@@ -1076,20 +2107,29 @@ int xio_cancel_request(struct xio_connection *connection,
 		       struct xio_msg *req)
 {
 	struct xio_msg *pmsg, *tmp_pmsg;
+	struct xio_msg_list *msgq;
 	uint64_t	stag;
 	struct xio_session_cancel_hdr hdr;
 
 
+	if (connection->mpath.nr)
+		connection = xio_connection_mpath_locate(connection, req);
+
+	if (XIO_HEDGE_MSG(req))
+		xio_hedge_on_user_cancel(req);
+
 	/* search the tx */
-	xio_msg_list_foreach_safe(pmsg, &connection->reqs_msgq,
-				  tmp_pmsg, pdata) {
+	msgq = &xio_connection_tcq(connection, req)->reqs_msgq;
+	xio_msg_list_foreach_safe(pmsg, msgq, tmp_pmsg, pdata) {
 		if (pmsg->sn == req->sn) {
 			ERROR_LOG("[%llu] - message found on reqs_msgq\n",
 				  req->sn);
-			xio_msg_list_remove(&connection->reqs_msgq,
-					    pmsg, pdata);
+			xio_msg_list_remove(msgq, pmsg, pdata);
+			xio_connection_txq_del(connection, pmsg);
+			xio_connection_tmo_disarm(connection, pmsg);
 			xio_session_notify_cancel(
 				connection, pmsg, XIO_E_MSG_CANCELED);
+			xio_connection_txq_update(connection);
 			return 0;
 		}
 	}
@@ -1131,9 +2171,19 @@ struct xio_task *xio_connection_find_io_task(struct xio_connection *connection,
 {
 	struct xio_task *ptask;
 
-	/* look in the tx_comp */
-	list_for_each_entry(ptask, &connection->io_tasks_list,
-			    tasks_list_entry) {
+	if (unlikely(connection->io_tasks_htbl == NULL)) {
+		list_for_each_entry(ptask, &connection->io_tasks_list,
+				    tasks_list_entry) {
+			if (ptask->imsg.sn == msg_sn)
+				return ptask;
+		}
+		return NULL;
+	}
+
+	list_for_each_entry(ptask,
+			    &connection->io_tasks_htbl[msg_sn &
+					connection->io_tasks_htbl_mask],
+			    io_tasks_htbl_entry) {
 		if (ptask->imsg.sn == msg_sn)
 			return ptask;
 	}
@@ -1190,14 +2240,79 @@ int xio_set_connection_params(struct xio_connection *connection,
 }
 
 /*---------------------------------------------------------------------------*/
-/* xio_connection_send_hello_req					     */
+/* xio_set_connection_paths						     */
+/*---------------------------------------------------------------------------*/
+int xio_set_connection_paths(struct xio_connection *connection,
+			     struct xio_connection **paths, int npaths)
+{
+	struct xio_connection	**array = NULL;
+	int			i, j;
+
+	if (connection == NULL || npaths < 0 || (npaths && paths == NULL) ||
+	    connection->mpath.owner) {
+		xio_set_error(EINVAL);
+		ERROR_LOG("invalid parameters\n");
+		return -1;
+	}
+	for (i = 0; i < npaths; i++) {
+		if (paths[i] == NULL || paths[i] == connection ||
+		    paths[i]->ctx != connection->ctx ||
+		    paths[i]->mpath.nr ||
+		    (paths[i]->mpath.owner &&
+		     paths[i]->mpath.owner != connection)) {
+			xio_set_error(EINVAL);
+			ERROR_LOG("invalid path %d\n", i);
+			return -1;
+		}
+		for (j = 0; j < i; j++) {
+			if (paths[j] == paths[i]) {
+				xio_set_error(EINVAL);
+				ERROR_LOG("duplicate path %d\n", i);
+				return -1;
+			}
+		}
+	}
+	if (npaths) {
+		array = kcalloc(npaths, sizeof(*array), GFP_KERNEL);
+		if (array == NULL) {
+			xio_set_error(ENOMEM);
+			ERROR_LOG("kcalloc failed. %m\n");
+			return -1;
+		}
+		memcpy(array, paths, npaths * sizeof(*array));
+	}
+
+	for (i = 0; i < connection->mpath.nr; i++)
+		connection->mpath.paths[i]->mpath.owner = NULL;
+	kfree(connection->mpath.paths);
+
+	connection->mpath.paths	= array;
+	connection->mpath.nr	= npaths;
+	for (i = 0; i < npaths; i++)
+		array[i]->mpath.owner = connection;
+
+	return 0;
+}
+
+/*---------------------------------------------------------------------------*/
+/* xio_connection_send_hello_req - hello, if not NULL, gets		     */
+/* the message taken for it, also when sending fails			     */
 /*---------------------------------------------------------------------------*/
-int xio_connection_send_hello_req(struct xio_connection *connection)
+int xio_connection_send_hello_req(struct xio_connection *connection,
+				  struct xio_msg **hello)
 {
 	struct xio_msg *msg;
 
 	msg = xio_msg_list_first(&connection->one_way_msg_pool);
+	if (msg == NULL) {
+		ERROR_LOG("one way msg pool is empty. connection:%p\n",
+			  connection);
+		xio_set_error(ENOMEM);
+		return -1;
+	}
 	xio_msg_list_remove(&connection->one_way_msg_pool, msg, pdata);
+	if (hello)
+		*hello = msg;
 
 	msg->type		= XIO_CONNECTION_HELLO_REQ;
 	msg->in.header.iov_len	= 0;
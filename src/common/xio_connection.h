@@ -39,7 +39,30 @@
 #define XIO_CONNECTION_H
 
 #include "xio_msg_list.h"
+#include "xio_hedge.h"
+#include "xio_migrate.h"
+#include "xio_resume.h"
 
+/* in flight tasks are indexed by sn; serial numbers are consecutive so a
+ * power of two table with mask hashing spreads them evenly. the table is
+ * allocated with the first queued task and sized from the conn's task pool
+ */
+#define XIO_IO_TASKS_HTBL_MIN		16
+#define XIO_IO_TASKS_HTBL_MAX		256
+
+/* request deadlines sit in a hashed timing wheel. one context timer per
+ * connection advances it a slot per tick while deadlines are armed
+ */
+#define XIO_TMO_WHEEL_SIZE		256
+#define XIO_TMO_WHEEL_MASK		(XIO_TMO_WHEEL_SIZE - 1)
+#define XIO_TMO_TICK_MSEC		4
+
+enum xio_msg_tmo_state {
+	XIO_MSG_TMO_NONE,
+	XIO_MSG_TMO_QUEUED,
+	XIO_MSG_TMO_IN_FLIGHT,
+	XIO_MSG_TMO_EXPIRED,	/* cancel sent, waiting for the answer */
+};
 
 enum xio_connection_state {
 		XIO_CONNECTION_STATE_INIT,
@@ -48,6 +71,43 @@ enum xio_connection_state {
 		XIO_CONNECTION_STATE_CLOSED,		/* user close */
 		XIO_CONNECTION_STATE_DISCONNECTED,	/* disconnect */
 		XIO_CONNECTION_STATE_ERROR,		/* error */
+		XIO_CONNECTION_STATE_RESUMING,		/* transport lost */
+};
+
+/* each traffic class has its own queues and deficit round robin state */
+struct xio_tc_queue {
+	struct xio_msg_list		reqs_msgq;
+	struct xio_msg_list		rsps_msgq;
+	int64_t				deficit;	/* bytes it may send */
+	int32_t				send_req_toggle;
+	uint32_t			reqs_in_flight;
+	uint32_t			quantum;	/* copied at creation */
+	uint32_t			reserve;
+};
+
+struct xio_tmo_wheel {
+	struct xio_msg_list		slot[XIO_TMO_WHEEL_SIZE];
+	xio_ctx_timer_handle_t		timer;
+	uint32_t			now;	/* current tick */
+	uint32_t			nr;	/* armed deadlines */
+};
+
+#define XIO_CANCELS_OWED		16
+
+/* sns of the cancels the library sent on its own, whose answer is owed */
+struct xio_cancels_owed {
+	uint64_t			sn[XIO_CANCELS_OWED];
+	uint32_t			nr;
+	int				pad;
+};
+
+/* multipath - a front connection stripes its messages over its paths */
+struct xio_mpath {
+	struct xio_connection		*owner;	/* front of a path */
+	struct xio_connection		**paths; /* front only */
+	int				nr;
+	uint32_t			cursor;
+	uint64_t			lat;	/* completion latency ewma */
 };
 
 struct xio_connection {
@@ -62,20 +122,33 @@ struct xio_connection {
 
 	int				conn_idx;
 	int				state;
-	int32_t				send_req_toggle;
-	int				pad;
+	int32_t				tc_cursor; /* class served next */
+	int				txq_high;  /* above high watermark */
+	uint32_t			txq_msgs;  /* messages waiting to */
+	uint32_t			pad;
+	uint64_t			txq_bytes; /* be sent and their size */
+	struct xio_tx_queue_attr	txq_attr;  /* copied at creation */
 
 	struct kref			kref;
 	struct kref			fin_kref;
-	struct xio_msg_list		reqs_msgq;
-	struct xio_msg_list		rsps_msgq;
+	struct xio_tc_queue		tcq[XIO_MSG_TCLASS_MAX];
 	struct xio_msg_list		in_flight_reqs_msgq;
 	struct xio_msg_list		in_flight_rsps_msgq;
+	struct xio_tmo_wheel		tmo_wheel;
+	struct xio_cancels_owed		cancels_owed;
+	struct xio_hedge_ctl		hedge;
+	struct xio_mpath		mpath;
+	struct xio_migration		*migration; /* moving to another ctx */
+	struct xio_resume_ctl		resume;
+	struct xio_histogram		latency[XIO_LATENCY_LAST];
 
 	struct xio_msg_list		one_way_msg_pool;
 	struct xio_msg			*msg_array;
 
 	struct list_head		io_tasks_list;
+	struct list_head		*io_tasks_htbl;	/* sn index */
+	uint32_t			io_tasks_htbl_mask;
+	uint32_t			pad1;
 	struct list_head		post_io_tasks_list;
 	struct list_head		pre_send_list;
 	struct list_head		connections_list_entry;
@@ -108,12 +181,51 @@ int xio_connection_send(struct xio_connection *conn,
 
 int xio_connection_xmit_msgs(struct xio_connection *conn);
 
+int xio_connection_send_copy(struct xio_connection *conn,
+			     struct xio_msg *msg);
+
+void xio_connection_detach_msgs(struct xio_connection *conn,
+				struct xio_msg_list *msgq);
+
+int xio_connection_requeue_msgs(struct xio_connection *conn,
+				struct xio_msg_list *msgq);
+
+int xio_connection_resume_rsp(struct xio_connection *old,
+			      struct xio_connection *conn,
+			      struct xio_task *task);
+
 void xio_connection_queue_io_task(struct xio_connection *connection,
 				    struct xio_task *task);
 
 struct xio_task *xio_connection_find_io_task(struct xio_connection *conn,
 					     uint64_t msg_sn);
 
+/* connection whose callbacks report on a path's messages */
+static inline struct xio_connection *xio_connection_owner(
+				struct xio_connection *conn)
+{
+	return conn->mpath.owner ? conn->mpath.owner : conn;
+}
+
+/* account a latency to the connection the user sees and to its context */
+static inline void xio_connection_latency(struct xio_connection *conn,
+					  enum xio_latency_type type,
+					  uint64_t cycles)
+{
+	xio_hist_record(&xio_connection_owner(conn)->latency[type], cycles);
+	xio_hist_record(&conn->ctx->stats.latency[type], cycles);
+}
+
+/* copy the transport's send stages of a message and account them */
+void xio_connection_stamp_sent(struct xio_connection *conn,
+			       struct xio_msg *msg,
+			       struct xio_task *task);
+
+/* copy the transport's receive stages of a message and account them */
+void xio_connection_stamp_recv(struct xio_connection *conn,
+			       struct xio_msg *msg,
+			       struct xio_task *task);
+
 static inline void xio_connection_set_state(
 				struct xio_connection *conn,
 				enum xio_connection_state state)
@@ -149,9 +261,29 @@ int xio_connection_flush_tasks(struct xio_connection *connection);
 
 int xio_connection_notify_msgs_flush(struct xio_connection *conn);
 
+void xio_connection_construct(void);
+
+int xio_connection_set_tclass_attr(const struct xio_tclass_attr *attr);
+
+int xio_connection_get_tclass_attr(struct xio_tclass_attr *attr);
+
+int xio_connection_set_tx_queue_attr(const struct xio_tx_queue_attr *attr);
+
+int xio_connection_get_tx_queue_attr(struct xio_tx_queue_attr *attr);
+
+void xio_connection_mpath_sample(struct xio_connection *conn,
+				 uint64_t cycles);
+
 int xio_connection_remove_in_flight(struct xio_connection *conn,
 				    struct xio_msg *msg);
 
+void xio_connection_tmo_disarm(struct xio_connection *conn,
+			       struct xio_msg *msg);
+
+void xio_connection_cancel_owed(struct xio_connection *conn, uint64_t sn);
+
+int xio_connection_cancel_answered(struct xio_connection *conn, uint64_t sn);
+
 int xio_connection_remove_msg_from_queue(struct xio_connection *connection,
 					 struct xio_msg *msg);
 
@@ -161,7 +293,8 @@ int xio_connection_send_cancel_response(
 		struct xio_task *task,
 		enum xio_status result);
 
-int xio_connection_send_hello_req(struct xio_connection *conn);
+int xio_connection_send_hello_req(struct xio_connection *conn,
+				  struct xio_msg **hello);
 
 int xio_connection_send_hello_rsp(struct xio_connection *conn,
 				  struct xio_task *task);
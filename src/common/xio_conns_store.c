@@ -36,56 +36,22 @@
  * POSSIBILITY OF SUCH DAMAGE.
  */
 #include "xio_os.h"
-#include "xio_hash.h"
+#include "xio_id_table.h"
 #include "xio_task.h"
 #include "xio_observer.h"
 #include "xio_conn.h"
 #include "xio_conns_store.h"
 
 
-static HT_HEAD(, xio_conn, HASHTABLE_PRIME_SMALL)  conns_store;
-static spinlock_t cs_lock;
-
-/*---------------------------------------------------------------------------*/
-/* xio_conns_store_add				                             */
-/*---------------------------------------------------------------------------*/
-static int conns_store_add(struct xio_conn *conn,
-			      int conn_id)
-{
-	struct xio_conn *c;
-	struct xio_key_int32  key = {
-		conn_id
-	};
-
-	HT_LOOKUP(&conns_store, &key, c, conns_htbl);
-	if (c != NULL)
-		return -1;
-
-	HT_INSERT(&conns_store, &key, conn, conns_htbl);
-
-	return 0;
-}
+static struct xio_id_table conns_store;
+static spinlock_t cs_lock;	/* protects the conn id provider */
 
 /*---------------------------------------------------------------------------*/
 /* xio_conns_store_remove				                     */
 /*---------------------------------------------------------------------------*/
 int xio_conns_store_remove(int conn_id)
 {
-	struct xio_conn *c;
-	struct xio_key_int32  key;
-
-	spin_lock(&cs_lock);
-	key.id = conn_id;
-	HT_LOOKUP(&conns_store, &key, c, conns_htbl);
-	if (c == NULL) {
-		spin_unlock(&cs_lock);
-		return -1;
-	}
-
-	HT_REMOVE(&conns_store, c, xio_conn, conns_htbl);
-	spin_unlock(&cs_lock);
-
-	return 0;
+	return xio_id_table_remove(&conns_store, conn_id);
 }
 
 /*---------------------------------------------------------------------------*/
@@ -93,15 +59,7 @@ int xio_conns_store_remove(int conn_id)
 /*---------------------------------------------------------------------------*/
 struct xio_conn *xio_conns_store_lookup(int conn_id)
 {
-	struct xio_conn *c;
-	struct xio_key_int32  key;
-
-	spin_lock(&cs_lock);
-	key.id = conn_id;
-	HT_LOOKUP(&conns_store, &key, c, conns_htbl);
-	spin_unlock(&cs_lock);
-
-	return c;
+	return xio_id_table_lookup(&conns_store, conn_id);
 }
 
 /*---------------------------------------------------------------------------*/
@@ -111,17 +69,39 @@ int xio_conns_store_add(struct xio_conn *conn,
 			int *conn_id)
 {
 	static int cid;  /* = 0 global conn provider */
+	int id;
 	int retval;
 
 	spin_lock(&cs_lock);
-	retval = conns_store_add(conn, cid);
-	if (retval == 0)
-		*conn_id = cid++;
+	id = cid++;
 	spin_unlock(&cs_lock);
 
+	retval = xio_id_table_insert(&conns_store, id, conn);
+	if (retval == 0)
+		*conn_id = id;
+
 	return retval;
 }
 
+struct xio_conns_store_find_arg {
+	struct xio_context	*ctx;
+	const char		*portal_uri;
+};
+
+/*---------------------------------------------------------------------------*/
+/* xio_conns_store_match						     */
+/*---------------------------------------------------------------------------*/
+static int xio_conns_store_match(void *val, void *arg)
+{
+	struct xio_conn				*conn = val;
+	struct xio_conns_store_find_arg		*find = arg;
+
+	return conn->transport_hndl->portal_uri &&
+	       (strcmp(conn->transport_hndl->portal_uri,
+		       find->portal_uri) == 0) &&
+	       (conn->transport_hndl->ctx == find->ctx);
+}
+
 /*---------------------------------------------------------------------------*/
 /* xio_conns_store_find				                             */
 /*---------------------------------------------------------------------------*/
@@ -129,21 +109,12 @@ struct xio_conn *xio_conns_store_find(
 		struct xio_context *ctx,
 		const char *portal_uri)
 {
-	struct xio_conn *conn;
+	struct xio_conns_store_find_arg find = {
+		ctx,
+		portal_uri
+	};
 
-	spin_lock(&cs_lock);
-	HT_FOREACH(conn, &conns_store, conns_htbl) {
-		if (conn->transport_hndl->portal_uri) {
-			if (
-		(strcmp(conn->transport_hndl->portal_uri, portal_uri) == 0) &&
-		(conn->transport_hndl->ctx == ctx)) {
-				spin_unlock(&cs_lock);
-				return conn;
-			}
-		}
-	}
-	spin_unlock(&cs_lock);
-	return  NULL;
+	return xio_id_table_find(&conns_store, xio_conns_store_match, &find);
 }
 
 /*---------------------------------------------------------------------------*/
@@ -151,7 +122,8 @@ struct xio_conn *xio_conns_store_find(
 /*---------------------------------------------------------------------------*/
 void conns_store_construct(void)
 {
-	HT_INIT(&conns_store, xio_int32_hash, xio_int32_cmp, xio_int32_cp);
+	if (xio_id_table_init(&conns_store))
+		ERROR_LOG("conns store construction failed\n");
 	spin_lock_init(&cs_lock);
 }
 
@@ -38,6 +38,9 @@
 #ifndef XIO_CONTEXT_H
 #define XIO_CONTEXT_H
 
+#include "xio_histogram.h"
+#include "xio_trace.h"
+
 #define xio_ctx_timer_handle_t	void *
 
 /*---------------------------------------------------------------------------*/
@@ -54,7 +57,9 @@ enum xio_counters {
 	XIO_STAT_RX_BYTES,
 	XIO_STAT_DELAY,
 	XIO_STAT_APPDELAY,
-	/* user can register 10 more messages */
+	XIO_STAT_CREDIT_STALLS,
+	XIO_STAT_NOP_TX,
+	/* user can register 8 more messages */
 	XIO_STAT_USER_FIRST,
 	XIO_STAT_LAST = 16
 };
@@ -64,8 +69,21 @@ enum xio_counters {
 /*---------------------------------------------------------------------------*/
 struct xio_statistics {
 	uint64_t	hertz;
-	uint64_t	counter[XIO_STAT_LAST];
+	uint64_t	*counter;	/* points to own */
 	char		*name[XIO_STAT_LAST];
+	uint64_t	own[XIO_STAT_LAST];
+	uint64_t	base[XIO_STAT_LAST];	/* netlink reports from here */
+	void		*shm_block;
+	xio_ctx_timer_handle_t	shm_timer;	/* copies to shm_block */
+	void		*metrics;	/* exporter's copy, see xio_metrics */
+	struct xio_histogram	latency[XIO_LATENCY_LAST];
+};
+
+/* work queued from any thread and run on the thread of the context */
+struct xio_ctx_work {
+	void				(*handler)(void *data);
+	void				*data;
+	struct list_head		work_list_entry;
 };
 
 struct xio_context {
@@ -83,6 +101,14 @@ struct xio_context {
 	/* list of sessions using this connection */
 	struct xio_observable		observable;
 	void				*netlink_sock;
+	struct xio_trace_ring		*trace;
+
+	/* accepted connections running on this context */
+	atomic_t			nr_conns;
+	int				work_fd;
+	struct list_head		work_list;
+	spinlock_t			work_lock;
+	int				pad;
 };
 
 /*---------------------------------------------------------------------------*/
@@ -136,6 +162,11 @@ int xio_ctx_timer_add(struct xio_context *ctx,
 int xio_ctx_timer_del(struct xio_context *ctx,
 		      xio_ctx_timer_handle_t timer_handle);
 
+/*---------------------------------------------------------------------------*/
+/* xio_context_add_work							     */
+/*---------------------------------------------------------------------------*/
+int xio_context_add_work(struct xio_context *ctx, struct xio_ctx_work *work);
+
 
 #endif /*XIO_CONTEXT_H */
 
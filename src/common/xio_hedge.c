@@ -0,0 +1,607 @@
+/*
+ * Copyright (c) 2013 Mellanox Technologies®. All rights reserved.
+ *
+ * This software is available to you under a choice of one of two licenses.
+ * You may choose to be licensed under the terms of the GNU General Public
+ * License (GPL) Version 2, available from the file COPYING in the main
+ * directory of this source tree, or the Mellanox Technologies® BSD license
+ * below:
+ *
+ *      - Redistribution and use in source and binary forms, with or without
+ *        modification, are permitted provided that the following conditions
+ *        are met:
+ *
+ *      - Redistributions of source code must retain the above copyright
+ *        notice, this list of conditions and the following disclaimer.
+ *
+ *      - Redistributions in binary form must reproduce the above
+ *        copyright notice, this list of conditions and the following
+ *        disclaimer in the documentation and/or other materials
+ *        provided with the distribution.
+ *
+ *      - Neither the name of the Mellanox Technologies® nor the names of its
+ *        contributors may be used to endorse or promote products derived from
+ *        this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+#include "xio_os.h"
+#include "libxio.h"
+#include "xio_common.h"
+#include "xio_task.h"
+#include "xio_msg_list.h"
+#include "xio_observer.h"
+#include "xio_context.h"
+#include "xio_conn.h"
+#include "xio_connection.h"
+#include "xio_session.h"
+#include "xio_hedge.h"
+
+/* hedging policy, off by default. a connection keeps its own copy */
+static spinlock_t hedge_lock;
+static struct xio_hedge_attr hedge_attr = {
+	0,		/* percentile */
+	1,		/* min_delay */
+	100,		/* max_delay */
+	0
+};
+
+/*---------------------------------------------------------------------------*/
+/* xio_hedge_bucket - 4 buckets per power of two, exact below 8		     */
+/*---------------------------------------------------------------------------*/
+static inline uint32_t xio_hedge_bucket(uint32_t usec)
+{
+	uint32_t msb;
+
+	if (usec < 8)
+		return usec;
+
+	msb = 31 - __builtin_clz(usec);
+
+	return 8 + (msb - 3) * 4 + ((usec >> (msb - 2)) & 3);
+}
+
+/*---------------------------------------------------------------------------*/
+/* xio_hedge_bucket_max - largest usec value falling in the bucket	     */
+/*---------------------------------------------------------------------------*/
+static inline uint64_t xio_hedge_bucket_max(uint32_t idx)
+{
+	uint32_t msb;
+	uint32_t sub;
+
+	if (idx < 8)
+		return idx;
+
+	msb = 3 + (idx - 8) / 4;
+	sub = (idx - 8) % 4;
+
+	return ((uint64_t)(5 + sub) << (msb - 2)) - 1;
+}
+
+/*---------------------------------------------------------------------------*/
+/* xio_hedge_recalc							     */
+/*---------------------------------------------------------------------------*/
+static void xio_hedge_recalc(struct xio_hedge_ctl *ctl)
+{
+	uint64_t	target;
+	uint64_t	seen = 0;
+	uint64_t	usec;
+	uint32_t	i;
+
+	target = ((uint64_t)ctl->total * ctl->attr.percentile + 999) / 1000;
+	for (i = 0; i < XIO_HEDGE_HIST_SIZE - 1; i++) {
+		seen += ctl->hist[i];
+		if (seen >= target)
+			break;
+	}
+	usec = xio_hedge_bucket_max(i);
+	ctl->delay = (usec + 999) / 1000;
+	if (ctl->delay == 0)
+		ctl->delay = 1;
+}
+
+/*---------------------------------------------------------------------------*/
+/* xio_hedge_delay - msec to wait before sending the copy		     */
+/*---------------------------------------------------------------------------*/
+static inline uint32_t xio_hedge_delay(struct xio_hedge_ctl *ctl)
+{
+	uint32_t delay = ctl->delay ? ctl->delay : ctl->attr.max_delay;
+
+	if (delay < ctl->attr.min_delay)
+		delay = ctl->attr.min_delay;
+	if (delay > ctl->attr.max_delay)
+		delay = ctl->attr.max_delay;
+
+	return delay;
+}
+
+/*---------------------------------------------------------------------------*/
+/* xio_hedge_init							     */
+/*---------------------------------------------------------------------------*/
+void xio_hedge_init(struct xio_hedge_ctl *ctl)
+{
+	INIT_LIST_HEAD(&ctl->active);
+	INIT_LIST_HEAD(&ctl->pending);
+
+	spin_lock(&hedge_lock);
+	ctl->attr = hedge_attr;
+	spin_unlock(&hedge_lock);
+}
+
+/*---------------------------------------------------------------------------*/
+/* xio_hedge_construct							     */
+/*---------------------------------------------------------------------------*/
+void xio_hedge_construct(void)
+{
+	spin_lock_init(&hedge_lock);
+}
+
+/*---------------------------------------------------------------------------*/
+/* xio_hedge_set_attr							     */
+/*---------------------------------------------------------------------------*/
+int xio_hedge_set_attr(const struct xio_hedge_attr *attr)
+{
+	if (attr->percentile > 1000 || attr->max_delay == 0 ||
+	    attr->min_delay > attr->max_delay) {
+		xio_set_error(EINVAL);
+		return -1;
+	}
+	spin_lock(&hedge_lock);
+	hedge_attr = *attr;
+	spin_unlock(&hedge_lock);
+
+	return 0;
+}
+
+/*---------------------------------------------------------------------------*/
+/* xio_hedge_get_attr							     */
+/*---------------------------------------------------------------------------*/
+int xio_hedge_get_attr(struct xio_hedge_attr *attr)
+{
+	spin_lock(&hedge_lock);
+	*attr = hedge_attr;
+	spin_unlock(&hedge_lock);
+
+	return 0;
+}
+
+/*---------------------------------------------------------------------------*/
+/* xio_hedge_sample							     */
+/*---------------------------------------------------------------------------*/
+void xio_hedge_sample(struct xio_connection *connection, uint64_t cycles)
+{
+	struct xio_hedge_ctl	*ctl = &connection->hedge;
+	uint64_t		hertz = connection->ctx->stats.hertz;
+	uint64_t		usec;
+	uint32_t		i;
+
+	if (ctl->attr.percentile == 0 || ctl->alt == NULL || hertz == 0)
+		return;
+
+	usec = cycles * 1000000 / hertz;
+	if (usec > 0xffffffffULL)
+		usec = 0xffffffffULL;
+	ctl->hist[xio_hedge_bucket(usec)]++;
+
+	/* halve the history so that old samples fade out */
+	if (++ctl->total >= XIO_HEDGE_DECAY) {
+		ctl->total = 0;
+		for (i = 0; i < XIO_HEDGE_HIST_SIZE; i++) {
+			ctl->hist[i] >>= 1;
+			ctl->total += ctl->hist[i];
+		}
+	}
+	if ((++ctl->samples % XIO_HEDGE_RECALC) == 0)
+		xio_hedge_recalc(ctl);
+}
+
+/*---------------------------------------------------------------------------*/
+/* xio_hedge_put - free the hedge once it has no outstanding copies	     */
+/*---------------------------------------------------------------------------*/
+static inline void xio_hedge_put(struct xio_hedge *hedge)
+{
+	if (hedge->live == 0)
+		kfree(hedge);
+}
+
+/*---------------------------------------------------------------------------*/
+/* xio_hedge_complete - detach the hedge from the user's request	     */
+/*---------------------------------------------------------------------------*/
+static void xio_hedge_complete(struct xio_hedge *hedge)
+{
+	list_del(&hedge->entry);
+	if (hedge->state == XIO_HEDGE_PENDING)
+		list_del(&hedge->pending_entry);
+	hedge->state		= XIO_HEDGE_DONE;
+	hedge->orig->hedge	= NULL;
+	hedge->orig		= NULL;
+}
+
+/*---------------------------------------------------------------------------*/
+/* xio_hedge_copy							     */
+/*---------------------------------------------------------------------------*/
+static inline uint32_t xio_hedge_copy(struct xio_hedge *hedge,
+				      struct xio_msg *msg)
+{
+	return (msg == &hedge->dup) ? XIO_HEDGE_DUP : XIO_HEDGE_ORIG;
+}
+
+/*---------------------------------------------------------------------------*/
+/* xio_hedge_cancel - cancel a copy that is no longer needed. the answer    */
+/* may come back right away and free the hedge				     */
+/*---------------------------------------------------------------------------*/
+static void xio_hedge_cancel(struct xio_hedge *hedge, uint32_t copy)
+{
+	struct xio_connection	*connection;
+	struct xio_msg		*msg;
+
+	if (copy == XIO_HEDGE_DUP) {
+		connection	= hedge->alt;
+		msg		= &hedge->dup;
+	} else {
+		connection	= hedge->conn;
+		msg		= &hedge->shadow;
+	}
+
+	/* a closing connection flushes the copy anyway */
+	if (connection->state != XIO_CONNECTION_STATE_ONLINE)
+		return;
+
+	hedge->cancel |= copy;
+	xio_connection_cancel_owed(connection, msg->sn);
+	xio_cancel_request(connection, msg);
+}
+
+/*---------------------------------------------------------------------------*/
+/* xio_hedge_fire - send the copy on the partner connection		     */
+/*---------------------------------------------------------------------------*/
+static void xio_hedge_fire(struct xio_connection *connection,
+			   struct xio_hedge *hedge)
+{
+	struct xio_connection	*alt = connection->hedge.alt;
+
+	list_del(&hedge->pending_entry);
+	hedge->state = XIO_HEDGE_SENT;
+
+	if (alt == NULL || alt->state != XIO_CONNECTION_STATE_ONLINE)
+		return;
+
+	memcpy(&hedge->dup, hedge->orig, sizeof(hedge->dup));
+	hedge->dup.hedge	= hedge;
+	hedge->dup.next		= NULL;
+	hedge->alt		= alt;
+	hedge->live		|= XIO_HEDGE_DUP;
+
+	DEBUG_LOG("[%llu] - hedging request\n", hedge->orig->sn);
+	if (xio_connection_send_copy(alt, &hedge->dup) != 0)
+		hedge->live &= ~XIO_HEDGE_DUP;
+}
+
+/*---------------------------------------------------------------------------*/
+/* xio_hedge_timer_add							     */
+/*---------------------------------------------------------------------------*/
+static void xio_hedge_timeout(void *data);
+
+static void xio_hedge_timer_add(struct xio_connection *connection,
+				uint64_t now)
+{
+	struct xio_hedge_ctl	*ctl = &connection->hedge;
+	uint64_t		hertz = connection->ctx->stats.hertz;
+	struct xio_hedge	*hedge;
+	uint64_t		msec = 1;
+
+	hedge = list_first_entry(&ctl->pending, struct xio_hedge,
+				 pending_entry);
+	if ((int64_t)(hedge->fire - now) > 0 && hertz)
+		msec = ((hedge->fire - now) * 1000 + hertz - 1) / hertz;
+
+	xio_ctx_timer_add(connection->ctx, msec, connection,
+			  xio_hedge_timeout, &ctl->timer);
+}
+
+/*---------------------------------------------------------------------------*/
+/* xio_hedge_timeout							     */
+/*---------------------------------------------------------------------------*/
+static void xio_hedge_timeout(void *data)
+{
+	struct xio_connection	*connection = data;
+	struct xio_hedge_ctl	*ctl = &connection->hedge;
+	struct xio_hedge	*hedge;
+	uint64_t		now = get_cycles();
+
+	/* the delay moves slowly so the list is close to sorted. an entry
+	 * due behind a later one waits at most for the difference
+	 */
+	while (!list_empty(&ctl->pending)) {
+		hedge = list_first_entry(&ctl->pending, struct xio_hedge,
+					 pending_entry);
+		if ((int64_t)(hedge->fire - now) > 0)
+			break;
+		xio_hedge_fire(connection, hedge);
+	}
+
+	if (!list_empty(&ctl->pending) && ctl->timer == NULL)
+		xio_hedge_timer_add(connection, now);
+}
+
+/*---------------------------------------------------------------------------*/
+/* xio_hedge_arm							     */
+/*---------------------------------------------------------------------------*/
+void xio_hedge_arm(struct xio_connection *connection, struct xio_msg *msg)
+{
+	struct xio_hedge_ctl	*ctl = &connection->hedge;
+	struct xio_hedge	*hedge;
+	uint64_t		now;
+
+	msg->hedge = NULL;
+	if (!(msg->flags & XIO_MSG_FLAG_HEDGE) ||
+	    ctl->attr.percentile == 0 || ctl->alt == NULL)
+		return;
+
+	/* deadlines, receipts and user supplied response buffers tie a
+	 * request to a single connection
+	 */
+	if (msg->timeout || msg->in.data_iovlen ||
+	    (msg->flags & XIO_MSG_FLAG_REQUEST_READ_RECEIPT) ||
+	    xio_session_not_queueing(connection->session))
+		return;
+
+	/* not fatal - the request just goes out once */
+	hedge = kcalloc(1, sizeof(*hedge), GFP_KERNEL);
+	if (hedge == NULL)
+		return;
+
+	now		= get_cycles();
+	hedge->conn	= connection;
+	hedge->orig	= msg;
+	hedge->state	= XIO_HEDGE_PENDING;
+	hedge->live	= XIO_HEDGE_ORIG;
+	hedge->fire	= now + (uint64_t)xio_hedge_delay(ctl) *
+			  connection->ctx->stats.hertz / 1000;
+	list_add_tail(&hedge->entry, &ctl->active);
+	list_add_tail(&hedge->pending_entry, &ctl->pending);
+	msg->hedge = hedge;
+
+	if (ctl->timer == NULL)
+		xio_hedge_timer_add(connection, now);
+}
+
+/*---------------------------------------------------------------------------*/
+/* xio_hedge_on_send							     */
+/*---------------------------------------------------------------------------*/
+void xio_hedge_on_send(struct xio_msg *msg, struct xio_task *task)
+{
+	struct xio_hedge *hedge = msg->hedge;
+
+	if (msg == hedge->orig)
+		hedge->task = task;
+}
+
+/*---------------------------------------------------------------------------*/
+/* xio_hedge_on_requeue							     */
+/*---------------------------------------------------------------------------*/
+void xio_hedge_on_requeue(struct xio_msg *msg)
+{
+	struct xio_hedge *hedge = msg->hedge;
+
+	if (msg == hedge->orig)
+		hedge->task = NULL;
+}
+
+/*---------------------------------------------------------------------------*/
+/* xio_hedge_shadow - put the shadow in orig's place so that the user may   */
+/* reuse orig while the losing copy is canceled				     */
+/*---------------------------------------------------------------------------*/
+static void xio_hedge_shadow(struct xio_hedge *hedge, struct xio_msg *orig)
+{
+	struct xio_msg *shadow = &hedge->shadow;
+
+	memcpy(shadow, orig, sizeof(*shadow));
+	shadow->hedge = hedge;
+	xio_msg_list_insert_before(orig, shadow, pdata);
+	xio_msg_list_remove(&hedge->conn->in_flight_reqs_msgq, orig, pdata);
+	hedge->task->omsg = shadow;
+	hedge->task = NULL;
+}
+
+/*---------------------------------------------------------------------------*/
+/* xio_hedge_on_response						     */
+/*---------------------------------------------------------------------------*/
+struct xio_msg *xio_hedge_on_response(struct xio_connection *connection,
+				      struct xio_msg *msg,
+				      struct xio_connection **owner)
+{
+	struct xio_hedge	*hedge = msg->hedge;
+	uint32_t		copy = xio_hedge_copy(hedge, msg);
+	struct xio_msg		*orig = hedge->orig;
+
+	/* an answer to our cancel may still come. it will not match */
+	hedge->live	&= ~copy;
+	hedge->cancel	&= ~copy;
+
+	if (orig == NULL) {
+		/* the other copy answered first */
+		xio_release_response(msg);
+		xio_hedge_put(hedge);
+		return NULL;
+	}
+
+	*owner = hedge->conn;
+	xio_hedge_complete(hedge);
+
+	if (copy == XIO_HEDGE_DUP) {
+		if (hedge->live && hedge->task) {
+			xio_hedge_shadow(hedge, orig);
+		} else if (hedge->live) {
+			/* never went out */
+			xio_connection_remove_msg_from_queue(*owner, orig);
+			hedge->live = 0;
+			xio_connection_xmit_msgs(*owner);
+		}
+		orig->request	= msg->request;
+		orig->type	= msg->type;
+		orig->next	= NULL;
+	}
+	hedge->task = NULL;
+
+	if (hedge->live)
+		xio_hedge_cancel(hedge, hedge->live);
+	else
+		kfree(hedge);
+
+	return orig;
+}
+
+/*---------------------------------------------------------------------------*/
+/* xio_hedge_on_failure							     */
+/*---------------------------------------------------------------------------*/
+void xio_hedge_on_failure(struct xio_connection *connection,
+			  struct xio_msg *msg, enum xio_status result)
+{
+	struct xio_hedge	*hedge = msg->hedge;
+	uint32_t		copy = xio_hedge_copy(hedge, msg);
+	struct xio_connection	*owner;
+	struct xio_msg		*orig;
+	int			user_cancel;
+
+	if (hedge->cancel & copy) {
+		/* canceled before our cancel went out */
+		hedge->cancel &= ~copy;
+		xio_connection_cancel_answered(connection, msg->sn);
+	}
+	hedge->live &= ~copy;
+	if (copy == XIO_HEDGE_ORIG)
+		hedge->task = NULL;
+
+	orig = hedge->orig;
+	if (orig == NULL) {
+		xio_hedge_put(hedge);
+		return;
+	}
+
+	/* the other copy may still succeed, unless the user's connection
+	 * is going away
+	 */
+	if (hedge->live && (copy == XIO_HEDGE_DUP ||
+			    connection->state == XIO_CONNECTION_STATE_ONLINE))
+		return;
+
+	owner		= hedge->conn;
+	user_cancel	= hedge->user_cancel;
+	xio_hedge_complete(hedge);
+	if (hedge->live)
+		xio_hedge_cancel(hedge, hedge->live);
+	else
+		kfree(hedge);
+
+	if (user_cancel)
+		xio_session_notify_cancel(owner, orig, XIO_E_MSG_CANCELED);
+	else
+		xio_session_notify_msg_error(owner, orig, result);
+}
+
+/*---------------------------------------------------------------------------*/
+/* xio_hedge_on_cancel							     */
+/*---------------------------------------------------------------------------*/
+int xio_hedge_on_cancel(struct xio_connection *connection,
+			struct xio_msg *msg, enum xio_status result,
+			int in_flight)
+{
+	struct xio_hedge	*hedge = msg->hedge;
+	uint32_t		copy = xio_hedge_copy(hedge, msg);
+
+	/* the user's own cancel is answered as usual */
+	if (!(hedge->cancel & copy))
+		return 0;
+
+	hedge->cancel &= ~copy;
+
+	/* too late - the copy's response is on its way */
+	if (result != XIO_E_MSG_CANCELED)
+		return 1;
+
+	if (in_flight)
+		xio_connection_remove_in_flight(connection, msg);
+	xio_hedge_on_failure(connection, msg, result);
+
+	return 1;
+}
+
+/*---------------------------------------------------------------------------*/
+/* xio_hedge_on_user_cancel						     */
+/*---------------------------------------------------------------------------*/
+void xio_hedge_on_user_cancel(struct xio_msg *msg)
+{
+	struct xio_hedge *hedge = msg->hedge;
+
+	/* our own cancel of a copy */
+	if (msg != hedge->orig)
+		return;
+
+	if (hedge->state == XIO_HEDGE_PENDING) {
+		/* no copy yet - a plain request from now on */
+		xio_hedge_complete(hedge);
+		kfree(hedge);
+		return;
+	}
+
+	hedge->user_cancel = 1;
+	if ((hedge->live & XIO_HEDGE_DUP) && !(hedge->cancel & XIO_HEDGE_DUP))
+		xio_hedge_cancel(hedge, XIO_HEDGE_DUP);
+}
+
+/*---------------------------------------------------------------------------*/
+/* xio_hedge_release							     */
+/*---------------------------------------------------------------------------*/
+void xio_hedge_release(struct xio_connection *connection)
+{
+	struct xio_hedge_ctl	*ctl = &connection->hedge;
+	struct xio_hedge	*hedge, *tmp_hedge;
+	struct xio_connection	*pconnection;
+
+	if (ctl->timer) {
+		xio_ctx_timer_del(connection->ctx, ctl->timer);
+		ctl->timer = NULL;
+	}
+
+	/* copies on the partner drain on their own */
+	list_for_each_entry_safe(hedge, tmp_hedge, &ctl->active, entry) {
+		xio_hedge_complete(hedge);
+		hedge->live &= ~XIO_HEDGE_ORIG;
+		hedge->task = NULL;
+		xio_hedge_put(hedge);
+	}
+
+	list_for_each_entry(pconnection, &connection->ctx->ctx_list,
+			    ctx_list_entry) {
+		if (pconnection->hedge.alt == connection)
+			pconnection->hedge.alt = NULL;
+	}
+}
+
+/*---------------------------------------------------------------------------*/
+/* xio_set_hedge_connection						     */
+/*---------------------------------------------------------------------------*/
+int xio_set_hedge_connection(struct xio_connection *connection,
+			     struct xio_connection *alt)
+{
+	if (connection == NULL || alt == connection ||
+	    (alt && alt->ctx != connection->ctx)) {
+		xio_set_error(EINVAL);
+		ERROR_LOG("invalid hedge connection\n");
+		return -1;
+	}
+	connection->hedge.alt = alt;
+
+	return 0;
+}
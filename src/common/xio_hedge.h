@@ -0,0 +1,168 @@
+/*
+ * Copyright (c) 2013 Mellanox Technologies®. All rights reserved.
+ *
+ * This software is available to you under a choice of one of two licenses.
+ * You may choose to be licensed under the terms of the GNU General Public
+ * License (GPL) Version 2, available from the file COPYING in the main
+ * directory of this source tree, or the Mellanox Technologies® BSD license
+ * below:
+ *
+ *      - Redistribution and use in source and binary forms, with or without
+ *        modification, are permitted provided that the following conditions
+ *        are met:
+ *
+ *      - Redistributions of source code must retain the above copyright
+ *        notice, this list of conditions and the following disclaimer.
+ *
+ *      - Redistributions in binary form must reproduce the above
+ *        copyright notice, this list of conditions and the following
+ *        disclaimer in the documentation and/or other materials
+ *        provided with the distribution.
+ *
+ *      - Neither the name of the Mellanox Technologies® nor the names of its
+ *        contributors may be used to endorse or promote products derived from
+ *        this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+#ifndef XIO_HEDGE_H
+#define XIO_HEDGE_H
+
+/*---------------------------------------------------------------------------*/
+/* request hedging. a flagged request still unanswered after its	     */
+/* connection's response time percentile is copied to the partner	     */
+/* connection. the first answer completes the request and the other copy    */
+/* is canceled. response times are kept in a log-linear usec histogram	     */
+/* that halves itself as it fills so the delay follows the current load.    */
+/*---------------------------------------------------------------------------*/
+#define XIO_HEDGE_HIST_SIZE		128
+#define XIO_HEDGE_RECALC		64	/* samples between updates */
+#define XIO_HEDGE_DECAY			4096	/* samples before halving */
+
+/* copies of a hedged request */
+#define XIO_HEDGE_ORIG			0x1
+#define XIO_HEDGE_DUP			0x2
+
+#define XIO_HEDGE_MSG(msg) \
+		((msg)->type == XIO_MSG_TYPE_REQ && (msg)->hedge)
+
+enum xio_hedge_state {
+	XIO_HEDGE_PENDING,		/* waiting for the delay */
+	XIO_HEDGE_SENT,			/* copy sent, or could not be */
+	XIO_HEDGE_DONE,			/* request completed, copies drain */
+};
+
+struct xio_connection;
+
+struct xio_hedge {
+	struct list_head		entry;		/* on the active list */
+	struct list_head		pending_entry;
+	struct xio_connection		*conn;		/* the request's */
+	struct xio_connection		*alt;		/* the copy's */
+	struct xio_msg			*orig;		/* NULL when done */
+	struct xio_task			*task;		/* orig's, in flight */
+	uint64_t			fire;		/* cycles */
+	uint32_t			state;
+	uint32_t			live;		/* copies outstanding */
+	uint32_t			cancel;		/* copies we canceled */
+	int				user_cancel;
+	struct xio_msg			dup;		/* sent on alt */
+	struct xio_msg			shadow;		/* orig once dup won */
+};
+
+/* per connection hedging state */
+struct xio_hedge_ctl {
+	struct list_head		active;		/* not yet completed */
+	struct list_head		pending;	/* copy not sent yet */
+	struct xio_connection		*alt;		/* partner */
+	xio_ctx_timer_handle_t		timer;
+	uint32_t			delay;		/* msec, 0 - unknown */
+	uint32_t			samples;
+	uint32_t			total;		/* in the histogram */
+	uint32_t			pad;
+	struct xio_hedge_attr		attr;		/* copied at creation */
+	uint32_t			hist[XIO_HEDGE_HIST_SIZE];
+};
+
+/*---------------------------------------------------------------------------*/
+/* xio_hedge_init							     */
+/*---------------------------------------------------------------------------*/
+void xio_hedge_init(struct xio_hedge_ctl *ctl);
+
+/*---------------------------------------------------------------------------*/
+/* xio_hedge_construct							     */
+/*---------------------------------------------------------------------------*/
+void xio_hedge_construct(void);
+
+/*---------------------------------------------------------------------------*/
+/* xio_hedge_release							     */
+/*---------------------------------------------------------------------------*/
+void xio_hedge_release(struct xio_connection *connection);
+
+/*---------------------------------------------------------------------------*/
+/* xio_hedge_set_attr							     */
+/*---------------------------------------------------------------------------*/
+int xio_hedge_set_attr(const struct xio_hedge_attr *attr);
+
+/*---------------------------------------------------------------------------*/
+/* xio_hedge_get_attr							     */
+/*---------------------------------------------------------------------------*/
+int xio_hedge_get_attr(struct xio_hedge_attr *attr);
+
+/*---------------------------------------------------------------------------*/
+/* xio_hedge_sample - response time of a request sent on the connection    */
+/*---------------------------------------------------------------------------*/
+void xio_hedge_sample(struct xio_connection *connection, uint64_t cycles);
+
+/*---------------------------------------------------------------------------*/
+/* xio_hedge_arm - called for each request as it is queued		     */
+/*---------------------------------------------------------------------------*/
+void xio_hedge_arm(struct xio_connection *connection, struct xio_msg *msg);
+
+/*---------------------------------------------------------------------------*/
+/* xio_hedge_on_send							     */
+/*---------------------------------------------------------------------------*/
+void xio_hedge_on_send(struct xio_msg *msg, struct xio_task *task);
+
+/*---------------------------------------------------------------------------*/
+/* xio_hedge_on_requeue							     */
+/*---------------------------------------------------------------------------*/
+void xio_hedge_on_requeue(struct xio_msg *msg);
+
+/*---------------------------------------------------------------------------*/
+/* xio_hedge_on_response - returns the request to complete or NULL when    */
+/* the other copy already did						     */
+/*---------------------------------------------------------------------------*/
+struct xio_msg *xio_hedge_on_response(struct xio_connection *connection,
+				      struct xio_msg *msg,
+				      struct xio_connection **owner);
+
+/*---------------------------------------------------------------------------*/
+/* xio_hedge_on_failure - a copy failed or was canceled		     */
+/*---------------------------------------------------------------------------*/
+void xio_hedge_on_failure(struct xio_connection *connection,
+			  struct xio_msg *msg, enum xio_status result);
+
+/*---------------------------------------------------------------------------*/
+/* xio_hedge_on_cancel - returns 1 if the answer was to our own cancel	     */
+/*---------------------------------------------------------------------------*/
+int xio_hedge_on_cancel(struct xio_connection *connection,
+			struct xio_msg *msg, enum xio_status result,
+			int in_flight);
+
+/*---------------------------------------------------------------------------*/
+/* xio_hedge_on_user_cancel						     */
+/*---------------------------------------------------------------------------*/
+void xio_hedge_on_user_cancel(struct xio_msg *msg);
+
+#endif /* XIO_HEDGE_H */
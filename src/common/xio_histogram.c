@@ -0,0 +1,200 @@
+/*
+ * Copyright (c) 2013 Mellanox Technologies®. All rights reserved.
+ *
+ * This software is available to you under a choice of one of two licenses.
+ * You may choose to be licensed under the terms of the GNU General Public
+ * License (GPL) Version 2, available from the file COPYING in the main
+ * directory of this source tree, or the Mellanox Technologies® BSD license
+ * below:
+ *
+ *      - Redistribution and use in source and binary forms, with or without
+ *        modification, are permitted provided that the following conditions
+ *        are met:
+ *
+ *      - Redistributions of source code must retain the above copyright
+ *        notice, this list of conditions and the following disclaimer.
+ *
+ *      - Redistributions in binary form must reproduce the above
+ *        copyright notice, this list of conditions and the following
+ *        disclaimer in the documentation and/or other materials
+ *        provided with the distribution.
+ *
+ *      - Neither the name of the Mellanox Technologies® nor the names of its
+ *        contributors may be used to endorse or promote products derived from
+ *        this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+#include "xio_os.h"
+#include "libxio.h"
+#include "xio_common.h"
+#include "xio_observer.h"
+#include "xio_context.h"
+#include "xio_task.h"
+#include "xio_msg_list.h"
+#include "xio_conn.h"
+#include "xio_connection.h"
+#include "xio_histogram.h"
+
+/*---------------------------------------------------------------------------*/
+/* xio_hist_bucket_max - largest value falling in the bucket		     */
+/*---------------------------------------------------------------------------*/
+static inline uint64_t xio_hist_bucket_max(uint32_t idx)
+{
+	uint32_t grp = idx >> XIO_HIST_SUB_BITS;
+	uint64_t sub = idx & (XIO_HIST_SUB - 1);
+
+	if (grp == 0)
+		return idx;
+
+	return ((XIO_HIST_SUB + sub + 1) << (grp - 1)) - 1;
+}
+
+/*---------------------------------------------------------------------------*/
+/* xio_hist_percentile							     */
+/*---------------------------------------------------------------------------*/
+uint64_t xio_hist_percentile(const struct xio_histogram *hist,
+			     uint32_t permille)
+{
+	uint64_t	rank, seen = 0;
+	uint32_t	i;
+
+	if (hist->count == 0)
+		return 0;
+
+	/* smallest bucket holding at least permille of the samples */
+	rank = (hist->count * permille + 999) / 1000;
+	if (rank == 0)
+		rank = 1;
+
+	for (i = 0; i < XIO_HIST_BUCKETS; i++) {
+		seen += hist->bucket[i];
+		if (seen >= rank)
+			return min(xio_hist_bucket_max(i), hist->max);
+	}
+
+	return hist->max;
+}
+
+/*---------------------------------------------------------------------------*/
+/* xio_hist_cycles_to_nsec						     */
+/*---------------------------------------------------------------------------*/
+static inline uint64_t xio_hist_cycles_to_nsec(uint64_t cycles,
+					       uint64_t hertz)
+{
+	if (hertz == 0)
+		return cycles;
+
+	/* split to keep the product in range for long delays */
+	return (cycles / hertz) * 1000000000ULL +
+	       (cycles % hertz) * 1000000000ULL / hertz;
+}
+
+/*---------------------------------------------------------------------------*/
+/* xio_hist_summary							     */
+/*---------------------------------------------------------------------------*/
+void xio_hist_summary(const struct xio_histogram *hist, uint64_t hertz,
+		      struct xio_latency_stats *stats)
+{
+	stats->count	= hist->count;
+	stats->mean	= hist->count ?
+			  xio_hist_cycles_to_nsec(hist->sum / hist->count,
+						  hertz) : 0;
+	stats->p50	= xio_hist_cycles_to_nsec(
+				xio_hist_percentile(hist, 500), hertz);
+	stats->p90	= xio_hist_cycles_to_nsec(
+				xio_hist_percentile(hist, 900), hertz);
+	stats->p99	= xio_hist_cycles_to_nsec(
+				xio_hist_percentile(hist, 990), hertz);
+	stats->p999	= xio_hist_cycles_to_nsec(
+				xio_hist_percentile(hist, 999), hertz);
+	stats->max	= xio_hist_cycles_to_nsec(hist->max, hertz);
+}
+
+/*---------------------------------------------------------------------------*/
+/* xio_hist_fold							     */
+/*---------------------------------------------------------------------------*/
+void xio_hist_fold(const struct xio_histogram *hist, uint64_t hertz,
+		   const uint64_t *bound, int nbounds, uint64_t *cum)
+{
+	uint64_t	nsec;
+	uint32_t	i;
+	int		j = 0;
+
+	memset(cum, 0, nbounds * sizeof(*cum));
+
+	/* a bucket counts under the first bound holding all of it */
+	for (i = 0; i < XIO_HIST_BUCKETS && j < nbounds; i++) {
+		if (!hist->bucket[i])
+			continue;
+		nsec = xio_hist_cycles_to_nsec(
+				min(xio_hist_bucket_max(i), hist->max), hertz);
+		while (j < nbounds && bound[j] < nsec)
+			j++;
+		if (j < nbounds)
+			cum[j] += hist->bucket[i];
+	}
+	for (j = 1; j < nbounds; j++)
+		cum[j] += cum[j - 1];
+}
+
+/*---------------------------------------------------------------------------*/
+/* xio_connection_get_latency						     */
+/*---------------------------------------------------------------------------*/
+int xio_connection_get_latency(struct xio_connection *connection,
+			       enum xio_latency_type type,
+			       struct xio_latency_stats *stats)
+{
+	if (!connection || !stats || type >= XIO_LATENCY_LAST) {
+		xio_set_error(EINVAL);
+		return -1;
+	}
+	xio_hist_summary(&connection->latency[type],
+			 connection->ctx->stats.hertz, stats);
+
+	return 0;
+}
+
+/*---------------------------------------------------------------------------*/
+/* xio_context_get_latency						     */
+/*---------------------------------------------------------------------------*/
+int xio_context_get_latency(struct xio_context *ctx,
+			    enum xio_latency_type type,
+			    struct xio_latency_stats *stats)
+{
+	if (!ctx || !stats || type >= XIO_LATENCY_LAST) {
+		xio_set_error(EINVAL);
+		return -1;
+	}
+	xio_hist_summary(&ctx->stats.latency[type], ctx->stats.hertz, stats);
+
+	return 0;
+}
+
+/*---------------------------------------------------------------------------*/
+/* xio_context_reset_latency						     */
+/*---------------------------------------------------------------------------*/
+int xio_context_reset_latency(struct xio_context *ctx)
+{
+	struct xio_connection	*connection;
+
+	if (!ctx) {
+		xio_set_error(EINVAL);
+		return -1;
+	}
+	memset(ctx->stats.latency, 0, sizeof(ctx->stats.latency));
+	list_for_each_entry(connection, &ctx->ctx_list, ctx_list_entry)
+		memset(connection->latency, 0, sizeof(connection->latency));
+
+	return 0;
+}
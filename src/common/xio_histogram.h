@@ -0,0 +1,109 @@
+/*
+ * Copyright (c) 2013 Mellanox Technologies®. All rights reserved.
+ *
+ * This software is available to you under a choice of one of two licenses.
+ * You may choose to be licensed under the terms of the GNU General Public
+ * License (GPL) Version 2, available from the file COPYING in the main
+ * directory of this source tree, or the Mellanox Technologies® BSD license
+ * below:
+ *
+ *      - Redistribution and use in source and binary forms, with or without
+ *        modification, are permitted provided that the following conditions
+ *        are met:
+ *
+ *      - Redistributions of source code must retain the above copyright
+ *        notice, this list of conditions and the following disclaimer.
+ *
+ *      - Redistributions in binary form must reproduce the above
+ *        copyright notice, this list of conditions and the following
+ *        disclaimer in the documentation and/or other materials
+ *        provided with the distribution.
+ *
+ *      - Neither the name of the Mellanox Technologies® nor the names of its
+ *        contributors may be used to endorse or promote products derived from
+ *        this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+#ifndef XIO_HISTOGRAM_H
+#define XIO_HISTOGRAM_H
+
+/*---------------------------------------------------------------------------*/
+/* log-linear latency histograms in cycles. values below 8 have a bucket    */
+/* each, every power of two above is split in 8 so a bucket is at most	     */
+/* 12.5% wide. recording is a shift, a count leading zeros and three adds.  */
+/* time units are applied only when a summary is read			     */
+/*---------------------------------------------------------------------------*/
+#define XIO_HIST_SUB_BITS		3
+#define XIO_HIST_SUB			(1 << XIO_HIST_SUB_BITS)
+#define XIO_HIST_MSB_MAX		44	/* ~4.8 hours at 1GHz */
+#define XIO_HIST_GROUPS		(XIO_HIST_MSB_MAX - XIO_HIST_SUB_BITS + 1)
+#define XIO_HIST_BUCKETS		(XIO_HIST_GROUPS << XIO_HIST_SUB_BITS)
+
+struct xio_histogram {
+	uint64_t			count;
+	uint64_t			sum;
+	uint64_t			max;
+	uint32_t			bucket[XIO_HIST_BUCKETS];
+};
+
+/*---------------------------------------------------------------------------*/
+/* xio_hist_bucket							     */
+/*---------------------------------------------------------------------------*/
+static inline uint32_t xio_hist_bucket(uint64_t cycles)
+{
+	uint32_t msb;
+
+	if (cycles < XIO_HIST_SUB)
+		return cycles;
+
+	msb = 63 - __builtin_clzll(cycles);
+	if (msb >= XIO_HIST_MSB_MAX)
+		return XIO_HIST_BUCKETS - 1;
+
+	return ((msb - XIO_HIST_SUB_BITS + 1) << XIO_HIST_SUB_BITS) +
+	       ((cycles >> (msb - XIO_HIST_SUB_BITS)) & (XIO_HIST_SUB - 1));
+}
+
+/*---------------------------------------------------------------------------*/
+/* xio_hist_record							     */
+/*---------------------------------------------------------------------------*/
+static inline void xio_hist_record(struct xio_histogram *hist,
+				   uint64_t cycles)
+{
+	hist->count++;
+	hist->sum += cycles;
+	if (unlikely(cycles > hist->max))
+		hist->max = cycles;
+	hist->bucket[xio_hist_bucket(cycles)]++;
+}
+
+/*---------------------------------------------------------------------------*/
+/* xio_hist_percentile - upper bound of the bucket holding the permille	     */
+/*---------------------------------------------------------------------------*/
+uint64_t xio_hist_percentile(const struct xio_histogram *hist,
+			     uint32_t permille);
+
+/*---------------------------------------------------------------------------*/
+/* xio_hist_summary - fill stats, in nsec				     */
+/*---------------------------------------------------------------------------*/
+void xio_hist_summary(const struct xio_histogram *hist, uint64_t hertz,
+		      struct xio_latency_stats *stats);
+
+/*---------------------------------------------------------------------------*/
+/* xio_hist_fold - samples at or below each bound, bounds ascending nsec    */
+/*---------------------------------------------------------------------------*/
+void xio_hist_fold(const struct xio_histogram *hist, uint64_t hertz,
+		   const uint64_t *bound, int nbounds, uint64_t *cum);
+
+#endif /* XIO_HISTOGRAM_H */
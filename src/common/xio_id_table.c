@@ -0,0 +1,290 @@
+/*
+ * Copyright (c) 2013 Mellanox Technologies®. All rights reserved.
+ *
+ * This software is available to you under a choice of one of two licenses.
+ * You may choose to be licensed under the terms of the GNU General Public
+ * License (GPL) Version 2, available from the file COPYING in the main
+ * directory of this source tree, or the Mellanox Technologies® BSD license
+ * below:
+ *
+ *      - Redistribution and use in source and binary forms, with or without
+ *        modification, are permitted provided that the following conditions
+ *        are met:
+ *
+ *      - Redistributions of source code must retain the above copyright
+ *        notice, this list of conditions and the following disclaimer.
+ *
+ *      - Redistributions in binary form must reproduce the above
+ *        copyright notice, this list of conditions and the following
+ *        disclaimer in the documentation and/or other materials
+ *        provided with the distribution.
+ *
+ *      - Neither the name of the Mellanox Technologies® nor the names of its
+ *        contributors may be used to endorse or promote products derived from
+ *        this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+#include "xio_os.h"
+#include "libxio.h"
+#include "xio_common.h"
+#include "xio_hash.h"
+#include "xio_id_table.h"
+
+/*---------------------------------------------------------------------------*/
+/* xio_id_table_alloc							     */
+/*---------------------------------------------------------------------------*/
+static struct xio_id_table_slots *xio_id_table_alloc(uint32_t size)
+{
+	struct xio_id_table_slots *slots;
+
+	slots = kcalloc(1, sizeof(*slots) +
+			size * sizeof(struct xio_id_table_slot), GFP_KERNEL);
+	if (slots == NULL) {
+		xio_set_error(ENOMEM);
+		ERROR_LOG("kcalloc failed. %m\n");
+		return NULL;
+	}
+	slots->size = size;
+
+	return slots;
+}
+
+/*---------------------------------------------------------------------------*/
+/* xio_id_table_place							     */
+/*---------------------------------------------------------------------------*/
+static int xio_id_table_place(struct xio_id_table *table,
+			      struct xio_id_table_slots *slots,
+			      uint32_t id, void *val)
+{
+	struct xio_id_table_slot	*slot;
+	uint32_t			mask = slots->size - 1;
+	uint32_t			i;
+
+	/* linear probing - the load factor keeps an empty slot around */
+	for (i = int32_hash(id) & mask; ; i = (i + 1) & mask) {
+		slot = &slots->slot[i];
+		if (!slot->used) {
+			slot->id = id;
+			/* readers check used before they read the id */
+			smp_wmb();
+			slot->used = 1;
+			table->used++;
+			break;
+		}
+		/* a tombstone is only reused by its own id, so a reader
+		 * never sees an id paired with another id's object
+		 */
+		if (slot->id == id) {
+			if (slot->val)
+				return -1;
+			break;
+		}
+	}
+	rcu_assign_pointer(slot->val, val);
+	table->nr++;
+
+	return 0;
+}
+
+/*---------------------------------------------------------------------------*/
+/* xio_id_table_rehash							     */
+/*---------------------------------------------------------------------------*/
+static void xio_id_table_rehash(struct xio_id_table *table,
+				struct xio_id_table_slots *old_slots,
+				struct xio_id_table_slots *new_slots)
+{
+	struct xio_id_table_slot	*slot;
+	uint32_t			i;
+
+	table->nr	= 0;
+	table->used	= 0;
+	for (i = 0; i < old_slots->size; i++) {
+		slot = &old_slots->slot[i];
+		if (slot->used && slot->val)
+			xio_id_table_place(table, new_slots,
+					   slot->id, slot->val);
+	}
+}
+
+/*---------------------------------------------------------------------------*/
+/* xio_id_table_init							     */
+/*---------------------------------------------------------------------------*/
+int xio_id_table_init(struct xio_id_table *table)
+{
+	memset(table, 0, sizeof(*table));
+
+	table->slots = xio_id_table_alloc(XIO_ID_TABLE_MIN_SIZE);
+	if (table->slots == NULL)
+		return -1;
+
+	if (init_srcu_struct(&table->srcu)) {
+		xio_set_error(ENOMEM);
+		ERROR_LOG("init_srcu_struct failed\n");
+		kfree(table->slots);
+		table->slots = NULL;
+		return -1;
+	}
+	spin_lock_init(&table->lock);
+
+	return 0;
+}
+
+/*---------------------------------------------------------------------------*/
+/* xio_id_table_destroy							     */
+/*---------------------------------------------------------------------------*/
+void xio_id_table_destroy(struct xio_id_table *table)
+{
+	cleanup_srcu_struct(&table->srcu);
+	kfree(table->slots);
+	table->slots = NULL;
+}
+
+/*---------------------------------------------------------------------------*/
+/* xio_id_table_insert							     */
+/*---------------------------------------------------------------------------*/
+int xio_id_table_insert(struct xio_id_table *table, uint32_t id, void *val)
+{
+	struct xio_id_table_slots	*slots;
+	struct xio_id_table_slots	*new_slots = NULL;
+	struct xio_id_table_slots	*old_slots = NULL;
+	uint32_t			new_size;
+	int				retval;
+
+retry:
+	spin_lock(&table->lock);
+	slots = table->slots;
+
+	/* keep the load (tombstones included) under 3/4. grow when live
+	 * ids fill half the table, otherwise just drop the tombstones
+	 */
+	if ((table->used + 1) * 4 > slots->size * 3) {
+		new_size = ((table->nr + 1) * 2 > slots->size) ?
+			   slots->size << 1 : slots->size;
+		if (new_slots == NULL || new_slots->size != new_size) {
+			/* allocate outside the lock and re-evaluate */
+			spin_unlock(&table->lock);
+			kfree(new_slots);
+			new_slots = xio_id_table_alloc(new_size);
+			if (new_slots == NULL)
+				return -1;
+			goto retry;
+		}
+		xio_id_table_rehash(table, slots, new_slots);
+		rcu_assign_pointer(table->slots, new_slots);
+		old_slots = slots;
+		slots = new_slots;
+		new_slots = NULL;
+	}
+	retval = xio_id_table_place(table, slots, id, val);
+	spin_unlock(&table->lock);
+
+	kfree(new_slots);
+	if (old_slots) {
+		/* wait for readers still probing the old array */
+		synchronize_srcu(&table->srcu);
+		kfree(old_slots);
+	}
+
+	return retval;
+}
+
+/*---------------------------------------------------------------------------*/
+/* xio_id_table_remove							     */
+/*---------------------------------------------------------------------------*/
+int xio_id_table_remove(struct xio_id_table *table, uint32_t id)
+{
+	struct xio_id_table_slots	*slots;
+	struct xio_id_table_slot	*slot;
+	uint32_t			mask;
+	uint32_t			i;
+	int				retval = -1;
+
+	spin_lock(&table->lock);
+	slots = table->slots;
+	mask = slots->size - 1;
+	for (i = int32_hash(id) & mask; slots->slot[i].used;
+	     i = (i + 1) & mask) {
+		slot = &slots->slot[i];
+		if (slot->id == id) {
+			if (slot->val) {
+				/* leave a tombstone - the probe chain must
+				 * stay intact for concurrent readers
+				 */
+				rcu_assign_pointer(slot->val, NULL);
+				table->nr--;
+				retval = 0;
+			}
+			break;
+		}
+	}
+	spin_unlock(&table->lock);
+
+	return retval;
+}
+
+/*---------------------------------------------------------------------------*/
+/* xio_id_table_lookup							     */
+/*---------------------------------------------------------------------------*/
+void *xio_id_table_lookup(struct xio_id_table *table, uint32_t id)
+{
+	struct xio_id_table_slots	*slots;
+	struct xio_id_table_slot	*slot;
+	void				*val = NULL;
+	uint32_t			mask;
+	uint32_t			i;
+	int				idx;
+
+	idx = srcu_read_lock(&table->srcu);
+	slots = srcu_dereference(table->slots, &table->srcu);
+	mask = slots->size - 1;
+	for (i = int32_hash(id) & mask; ; i = (i + 1) & mask) {
+		slot = &slots->slot[i];
+		if (!ACCESS_ONCE(slot->used))
+			break;
+		smp_rmb();
+		if (slot->id == id) {
+			val = srcu_dereference(slot->val, &table->srcu);
+			break;
+		}
+	}
+	srcu_read_unlock(&table->srcu, idx);
+
+	return val;
+}
+
+/*---------------------------------------------------------------------------*/
+/* xio_id_table_find							     */
+/*---------------------------------------------------------------------------*/
+void *xio_id_table_find(struct xio_id_table *table,
+			xio_id_table_match_fn match, void *arg)
+{
+	struct xio_id_table_slots	*slots;
+	void				*val = NULL;
+	uint32_t			i;
+	int				idx;
+
+	idx = srcu_read_lock(&table->srcu);
+	slots = srcu_dereference(table->slots, &table->srcu);
+	for (i = 0; i < slots->size; i++) {
+		if (!ACCESS_ONCE(slots->slot[i].used))
+			continue;
+		val = srcu_dereference(slots->slot[i].val, &table->srcu);
+		if (val && match(val, arg))
+			break;
+		val = NULL;
+	}
+	srcu_read_unlock(&table->srcu, idx);
+
+	return val;
+}
@@ -0,0 +1,103 @@
+/*
+ * Copyright (c) 2013 Mellanox Technologies®. All rights reserved.
+ *
+ * This software is available to you under a choice of one of two licenses.
+ * You may choose to be licensed under the terms of the GNU General Public
+ * License (GPL) Version 2, available from the file COPYING in the main
+ * directory of this source tree, or the Mellanox Technologies® BSD license
+ * below:
+ *
+ *      - Redistribution and use in source and binary forms, with or without
+ *        modification, are permitted provided that the following conditions
+ *        are met:
+ *
+ *      - Redistributions of source code must retain the above copyright
+ *        notice, this list of conditions and the following disclaimer.
+ *
+ *      - Redistributions in binary form must reproduce the above
+ *        copyright notice, this list of conditions and the following
+ *        disclaimer in the documentation and/or other materials
+ *        provided with the distribution.
+ *
+ *      - Neither the name of the Mellanox Technologies® nor the names of its
+ *        contributors may be used to endorse or promote products derived from
+ *        this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+#ifndef XIO_ID_TABLE_H
+#define XIO_ID_TABLE_H
+
+/*---------------------------------------------------------------------------*/
+/* resizable open addressing table that maps 32 bit ids to objects.	     */
+/* lookups are lock free - readers run under srcu and never touch the lock; */
+/* writers serialize on the table lock and retire replaced slot arrays only */
+/* after a grace period.						     */
+/*---------------------------------------------------------------------------*/
+#define XIO_ID_TABLE_MIN_SIZE		64
+
+struct xio_id_table_slot {
+	uint32_t			id;
+	uint32_t			used;	/* set once, never cleared */
+	void				*val;	/* NULL once removed */
+};
+
+struct xio_id_table_slots {
+	uint32_t			size;	/* power of two */
+	uint32_t			pad;
+	struct xio_id_table_slot	slot[0];
+};
+
+struct xio_id_table {
+	struct xio_id_table_slots	*slots;	/* srcu protected */
+	struct srcu_struct		srcu;
+	spinlock_t			lock;	/* serializes writers */
+	uint32_t			nr;	/* live ids */
+	uint32_t			used;	/* live ids and tombstones */
+	uint32_t			pad;
+};
+
+typedef int (*xio_id_table_match_fn)(void *val, void *arg);
+
+/*---------------------------------------------------------------------------*/
+/* xio_id_table_init							     */
+/*---------------------------------------------------------------------------*/
+int xio_id_table_init(struct xio_id_table *table);
+
+/*---------------------------------------------------------------------------*/
+/* xio_id_table_destroy							     */
+/*---------------------------------------------------------------------------*/
+void xio_id_table_destroy(struct xio_id_table *table);
+
+/*---------------------------------------------------------------------------*/
+/* xio_id_table_insert							     */
+/*---------------------------------------------------------------------------*/
+int xio_id_table_insert(struct xio_id_table *table, uint32_t id, void *val);
+
+/*---------------------------------------------------------------------------*/
+/* xio_id_table_remove							     */
+/*---------------------------------------------------------------------------*/
+int xio_id_table_remove(struct xio_id_table *table, uint32_t id);
+
+/*---------------------------------------------------------------------------*/
+/* xio_id_table_lookup							     */
+/*---------------------------------------------------------------------------*/
+void *xio_id_table_lookup(struct xio_id_table *table, uint32_t id);
+
+/*---------------------------------------------------------------------------*/
+/* xio_id_table_find - first live object the match function accepts	     */
+/*---------------------------------------------------------------------------*/
+void *xio_id_table_find(struct xio_id_table *table,
+			xio_id_table_match_fn match, void *arg);
+
+#endif /* XIO_ID_TABLE_H */
@@ -0,0 +1,475 @@
+/*
+ * Copyright (c) 2013 Mellanox Technologies®. All rights reserved.
+ *
+ * This software is available to you under a choice of one of two licenses.
+ * You may choose to be licensed under the terms of the GNU General Public
+ * License (GPL) Version 2, available from the file COPYING in the main
+ * directory of this source tree, or the Mellanox Technologies® BSD license
+ * below:
+ *
+ *      - Redistribution and use in source and binary forms, with or without
+ *        modification, are permitted provided that the following conditions
+ *        are met:
+ *
+ *      - Redistributions of source code must retain the above copyright
+ *        notice, this list of conditions and the following disclaimer.
+ *
+ *      - Redistributions in binary form must reproduce the above
+ *        copyright notice, this list of conditions and the following
+ *        disclaimer in the documentation and/or other materials
+ *        provided with the distribution.
+ *
+ *      - Neither the name of the Mellanox Technologies® nor the names of its
+ *        contributors may be used to endorse or promote products derived from
+ *        this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+#include "xio_os.h"
+#include "libxio.h"
+#include "xio_common.h"
+#include "xio_task.h"
+#include "xio_msg_list.h"
+#include "xio_observer.h"
+#include "xio_context.h"
+#include "xio_conn.h"
+#include "xio_connection.h"
+#include "xio_session.h"
+#include "xio_migrate.h"
+
+enum xio_migration_state {
+	XIO_MIGRATION_CONNECT,		/* posted to the target context */
+	XIO_MIGRATION_DONE,		/* posted back to the source */
+	XIO_MIGRATION_DRAIN,		/* old connection drains */
+};
+
+struct xio_migration {
+	struct xio_session		*session;
+	struct xio_connection		*old;	/* NULL once released */
+	struct xio_connection		*new;
+	struct xio_context		*src;
+	struct xio_context		*dst;
+	void				*user_context;
+	struct xio_msg_list		msgq;	/* not sent yet */
+	struct xio_ctx_work		work;
+	xio_ctx_timer_handle_t		timer;
+	int				conn_idx;
+	uint32_t			state;
+};
+
+struct xio_rebalance_member {
+	struct xio_rebalancer		*rb;
+	struct xio_context		*ctx;
+	xio_ctx_timer_handle_t		timer;
+	uint64_t			last;	/* messages counted so far */
+	uint64_t			load;	/* messages last interval */
+	struct list_head		entry;
+};
+
+struct xio_rebalancer {
+	struct xio_rebalance_attr	attr;
+	struct list_head		members;
+	spinlock_t			lock;
+	int				pad;
+};
+
+static void xio_migrate_work(void *data);
+
+/*---------------------------------------------------------------------------*/
+/* xio_migrate_eligible							     */
+/*---------------------------------------------------------------------------*/
+static int xio_migrate_eligible(struct xio_connection *connection)
+{
+	/* servers spread their connections with a worker pool. striped
+	 * and hedged connections are tied to partners on the same context
+	 */
+	if (connection->session->type != XIO_SESSION_CLIENT) {
+		xio_set_error(EINVAL);
+		return 0;
+	}
+	if (connection->state != XIO_CONNECTION_STATE_ONLINE ||
+	    connection->migration) {
+		xio_set_error(EBUSY);
+		return 0;
+	}
+	if (connection->mpath.nr || connection->mpath.owner ||
+	    connection->hedge.alt || !list_empty(&connection->hedge.active)) {
+		xio_set_error(EBUSY);
+		return 0;
+	}
+
+	return 1;
+}
+
+/*---------------------------------------------------------------------------*/
+/* xio_migrate_post - hand the migration to the other side		     */
+/*---------------------------------------------------------------------------*/
+static int xio_migrate_post(struct xio_migration *mig,
+			    struct xio_context *ctx, uint32_t state)
+{
+	mig->state = state;
+	mig->work.handler = xio_migrate_work;
+	mig->work.data = mig;
+
+	return xio_context_add_work(ctx, &mig->work);
+}
+
+/*---------------------------------------------------------------------------*/
+/* xio_migrate_drain - close the old connection once it is idle		     */
+/*---------------------------------------------------------------------------*/
+static void xio_migrate_drain(void *data)
+{
+	struct xio_migration	*mig = data;
+	struct xio_connection	*old = mig->old;
+
+	if (!xio_msg_list_empty(&old->in_flight_reqs_msgq)) {
+		xio_ctx_timer_add(mig->src, XIO_MIGRATE_DRAIN_MSEC, mig,
+				  xio_migrate_drain, &mig->timer);
+		return;
+	}
+
+	old->migration = NULL;
+	kfree(mig);
+
+	xio_disconnect(old);
+}
+
+/*---------------------------------------------------------------------------*/
+/* xio_migrate_connect - runs on the target context			     */
+/*---------------------------------------------------------------------------*/
+static void xio_migrate_connect(struct xio_migration *mig)
+{
+	mig->new = xio_connect(mig->session, mig->dst, mig->conn_idx,
+			       NULL, mig->user_context);
+	if (mig->new) {
+		xio_connection_requeue_msgs(mig->new, &mig->msgq);
+		xio_session_notify_new_connection(mig->session, mig->new);
+	}
+
+	if (xio_migrate_post(mig, mig->src, XIO_MIGRATION_DONE))
+		ERROR_LOG("migration %p lost, source context:%p\n",
+			  mig, mig->src);
+}
+
+/*---------------------------------------------------------------------------*/
+/* xio_migrate_done - runs on the source context			     */
+/*---------------------------------------------------------------------------*/
+static void xio_migrate_done(struct xio_migration *mig)
+{
+	struct xio_connection	*old = mig->old;
+	struct xio_session	*session = mig->session;
+	struct xio_msg		*pmsg;
+
+	if (old == NULL) {
+		/* the old connection went away meanwhile. fail what it
+		 * handed over the way its close would have
+		 */
+		if (!xio_msg_list_empty(&mig->msgq))
+			ERROR_LOG("migration failed, connection closed. " \
+				  "session:%p\n", session);
+		while (!xio_msg_list_empty(&mig->msgq)) {
+			pmsg = xio_msg_list_first(&mig->msgq);
+			xio_msg_list_remove(&mig->msgq, pmsg, pdata);
+			if (session->ses_ops.on_msg_error)
+				session->ses_ops.on_msg_error(
+						session, XIO_E_MSG_FLUSHED,
+						pmsg, mig->user_context);
+		}
+		kfree(mig);
+		return;
+	}
+
+	if (mig->new == NULL) {
+		ERROR_LOG("migration failed. session:%p, connection:%p, " \
+			  "ctx:%p\n", mig->session, old, mig->dst);
+		old->migration = NULL;
+		xio_connection_requeue_msgs(old, &mig->msgq);
+		kfree(mig);
+		return;
+	}
+
+	mig->state = XIO_MIGRATION_DRAIN;
+	xio_migrate_drain(mig);
+}
+
+/*---------------------------------------------------------------------------*/
+/* xio_migrate_work							     */
+/*---------------------------------------------------------------------------*/
+static void xio_migrate_work(void *data)
+{
+	struct xio_migration	*mig = data;
+
+	if (mig->state == XIO_MIGRATION_CONNECT)
+		xio_migrate_connect(mig);
+	else
+		xio_migrate_done(mig);
+}
+
+/*---------------------------------------------------------------------------*/
+/* xio_connection_migrate						     */
+/*---------------------------------------------------------------------------*/
+int xio_connection_migrate(struct xio_connection *connection,
+			   struct xio_context *ctx)
+{
+	struct xio_migration	*mig;
+
+	if (!connection || !connection->session || !ctx) {
+		xio_set_error(EINVAL);
+		ERROR_LOG("invalid parameters\n");
+		return -1;
+	}
+	if (ctx == connection->ctx)
+		return 0;
+	if (!xio_migrate_eligible(connection)) {
+		ERROR_LOG("connection %p cannot migrate\n", connection);
+		return -1;
+	}
+
+	mig = kcalloc(1, sizeof(*mig), GFP_KERNEL);
+	if (mig == NULL) {
+		xio_set_error(ENOMEM);
+		ERROR_LOG("kcalloc failed. %m\n");
+		return -1;
+	}
+	mig->session		= connection->session;
+	mig->old		= connection;
+	mig->src		= connection->ctx;
+	mig->dst		= ctx;
+	mig->user_context	= connection->cb_user_context;
+	mig->conn_idx		= connection->conn_idx;
+	xio_msg_list_init(&mig->msgq);
+
+	xio_connection_detach_msgs(connection, &mig->msgq);
+	connection->migration = mig;
+
+	if (xio_migrate_post(mig, ctx, XIO_MIGRATION_CONNECT)) {
+		ERROR_LOG("failed to post migration to ctx:%p\n", ctx);
+		connection->migration = NULL;
+		xio_connection_requeue_msgs(connection, &mig->msgq);
+		kfree(mig);
+		return -1;
+	}
+
+	return 0;
+}
+
+/*---------------------------------------------------------------------------*/
+/* xio_migrate_release							     */
+/*---------------------------------------------------------------------------*/
+void xio_migrate_release(struct xio_connection *connection)
+{
+	struct xio_migration	*mig = connection->migration;
+
+	if (mig == NULL)
+		return;
+	connection->migration = NULL;
+
+	if (mig->state == XIO_MIGRATION_DRAIN) {
+		if (mig->timer)
+			xio_ctx_timer_del(mig->src, mig->timer);
+		kfree(mig);
+		return;
+	}
+	/* the target context still owns it */
+	mig->old = NULL;
+}
+
+/*---------------------------------------------------------------------------*/
+/* xio_rebalance_busiest - connection worth moving, NULL if none	     */
+/*---------------------------------------------------------------------------*/
+static struct xio_connection *xio_rebalance_busiest(struct xio_context *ctx)
+{
+	struct xio_connection	*connection, *busiest = NULL;
+	struct xio_msg		*pmsg;
+	uint32_t		load, max_load = 0;
+	int			eligible = 0;
+
+	list_for_each_entry(connection, &ctx->ctx_list, ctx_list_entry) {
+		if (connection->session->type != XIO_SESSION_CLIENT ||
+		    connection->state != XIO_CONNECTION_STATE_ONLINE ||
+		    connection->migration || connection->mpath.nr ||
+		    connection->mpath.owner || connection->hedge.alt)
+			continue;
+		eligible++;
+
+		load = connection->txq_msgs;
+		xio_msg_list_foreach(pmsg, &connection->in_flight_reqs_msgq,
+				     pdata)
+			load++;
+		if (busiest == NULL || load > max_load) {
+			busiest = connection;
+			max_load = load;
+		}
+	}
+
+	/* moving a lone connection only shifts the hot spot */
+	return (eligible > 1) ? busiest : NULL;
+}
+
+/*---------------------------------------------------------------------------*/
+/* xio_rebalance_tick - runs on the member's context			     */
+/*---------------------------------------------------------------------------*/
+static void xio_rebalance_tick(void *data)
+{
+	struct xio_rebalance_member	*member = data;
+	struct xio_rebalancer		*rb = member->rb;
+	struct xio_rebalance_member	*pmember;
+	struct xio_statistics		*stats = &member->ctx->stats;
+	struct xio_context		*target = NULL;
+	struct xio_connection		*connection;
+	uint64_t			now, min_load = 0;
+
+	now = stats->counter[XIO_STAT_TX_MSG] +
+	      stats->counter[XIO_STAT_RX_MSG];
+	member->load = now - member->last;
+	member->last = now;
+
+	spin_lock(&rb->lock);
+	list_for_each_entry(pmember, &rb->members, entry) {
+		if (pmember == member)
+			continue;
+		if (target == NULL || pmember->load < min_load) {
+			target = pmember->ctx;
+			min_load = pmember->load;
+		}
+	}
+	spin_unlock(&rb->lock);
+
+	/* one move per interval lets the loads settle */
+	if (target && member->load &&
+	    member->load * 100 > min_load * (100 + rb->attr.imbalance)) {
+		connection = xio_rebalance_busiest(member->ctx);
+		if (connection) {
+			DEBUG_LOG("rebalance connection:%p, ctx:%p -> %p\n",
+				  connection, member->ctx, target);
+			xio_connection_migrate(connection, target);
+		}
+	}
+
+	xio_ctx_timer_add(member->ctx, rb->attr.interval, member,
+			  xio_rebalance_tick, &member->timer);
+}
+
+/*---------------------------------------------------------------------------*/
+/* xio_rebalancer_create						     */
+/*---------------------------------------------------------------------------*/
+struct xio_rebalancer *xio_rebalancer_create(struct xio_rebalance_attr *attr)
+{
+	struct xio_rebalancer	*rb;
+
+	if (!attr || attr->interval <= 0 || attr->imbalance < 0) {
+		xio_set_error(EINVAL);
+		ERROR_LOG("invalid rebalance attributes\n");
+		return NULL;
+	}
+
+	rb = kcalloc(1, sizeof(*rb), GFP_KERNEL);
+	if (rb == NULL) {
+		xio_set_error(ENOMEM);
+		ERROR_LOG("kcalloc failed. %m\n");
+		return NULL;
+	}
+	rb->attr = *attr;
+	INIT_LIST_HEAD(&rb->members);
+	spin_lock_init(&rb->lock);
+
+	return rb;
+}
+
+/*---------------------------------------------------------------------------*/
+/* xio_rebalancer_destroy						     */
+/*---------------------------------------------------------------------------*/
+int xio_rebalancer_destroy(struct xio_rebalancer *rb)
+{
+	if (!rb) {
+		xio_set_error(EINVAL);
+		return -1;
+	}
+	if (!list_empty(&rb->members)) {
+		xio_set_error(EBUSY);
+		ERROR_LOG("rebalancer %p still has contexts\n", rb);
+		return -1;
+	}
+	kfree(rb);
+
+	return 0;
+}
+
+/*---------------------------------------------------------------------------*/
+/* xio_rebalancer_add_ctx						     */
+/*---------------------------------------------------------------------------*/
+int xio_rebalancer_add_ctx(struct xio_rebalancer *rb, struct xio_context *ctx)
+{
+	struct xio_rebalance_member	*member;
+
+	if (!rb || !ctx) {
+		xio_set_error(EINVAL);
+		return -1;
+	}
+
+	member = kcalloc(1, sizeof(*member), GFP_KERNEL);
+	if (member == NULL) {
+		xio_set_error(ENOMEM);
+		ERROR_LOG("kcalloc failed. %m\n");
+		return -1;
+	}
+	member->rb	= rb;
+	member->ctx	= ctx;
+	member->last	= ctx->stats.counter[XIO_STAT_TX_MSG] +
+			  ctx->stats.counter[XIO_STAT_RX_MSG];
+
+	if (xio_ctx_timer_add(ctx, rb->attr.interval, member,
+			      xio_rebalance_tick, &member->timer)) {
+		kfree(member);
+		return -1;
+	}
+
+	spin_lock(&rb->lock);
+	list_add_tail(&member->entry, &rb->members);
+	spin_unlock(&rb->lock);
+
+	return 0;
+}
+
+/*---------------------------------------------------------------------------*/
+/* xio_rebalancer_del_ctx						     */
+/*---------------------------------------------------------------------------*/
+int xio_rebalancer_del_ctx(struct xio_rebalancer *rb, struct xio_context *ctx)
+{
+	struct xio_rebalance_member	*member, *found = NULL;
+
+	if (!rb || !ctx) {
+		xio_set_error(EINVAL);
+		return -1;
+	}
+
+	spin_lock(&rb->lock);
+	list_for_each_entry(member, &rb->members, entry) {
+		if (member->ctx == ctx) {
+			found = member;
+			list_del(&member->entry);
+			break;
+		}
+	}
+	spin_unlock(&rb->lock);
+
+	if (found == NULL) {
+		xio_set_error(ENOENT);
+		return -1;
+	}
+	if (found->timer)
+		xio_ctx_timer_del(ctx, found->timer);
+	kfree(found);
+
+	return 0;
+}
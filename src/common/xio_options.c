@@ -40,9 +40,14 @@
 #include "libxio.h"
 #include "xio_common.h"
 #include "xio_mem.h"
+#include "xio_stats_shm.h"
+#include "xio_metrics.h"
 #include "xio_observer.h"
 #include "xio_transport.h"
 #include "xio_log.h"
+#include "xio_context.h"
+#include "xio_msg_list.h"
+#include "xio_connection.h"
 
 /*---------------------------------------------------------------------------*/
 /* xio_set_opt								     */
@@ -70,6 +75,44 @@ static int xio_general_set_opt(void *xio_obj, int optname,
 			return xio_set_mem_allocator(
 					(struct xio_mem_allocator *)optval);
 		break;
+	case XIO_OPTNAME_TCLASS_ATTR:
+		if (optlen != sizeof(struct xio_tclass_attr))
+			break;
+		return xio_connection_set_tclass_attr(
+				(const struct xio_tclass_attr *)optval);
+	case XIO_OPTNAME_TX_QUEUE_ATTR:
+		if (optlen != sizeof(struct xio_tx_queue_attr))
+			break;
+		return xio_connection_set_tx_queue_attr(
+				(const struct xio_tx_queue_attr *)optval);
+	case XIO_OPTNAME_HEDGE_ATTR:
+		if (optlen != sizeof(struct xio_hedge_attr))
+			break;
+		return xio_hedge_set_attr(
+				(const struct xio_hedge_attr *)optval);
+	case XIO_OPTNAME_RESUME_ATTR:
+		if (optlen != sizeof(struct xio_resume_attr))
+			break;
+		return xio_resume_set_attr(
+				(const struct xio_resume_attr *)optval);
+	case XIO_OPTNAME_ENABLE_SHM_STATS:
+		if (optlen != sizeof(int))
+			break;
+		return xio_stats_shm_set_enable(*((int *)optval));
+	case XIO_OPTNAME_TRACE_ATTR:
+		if (optlen != sizeof(struct xio_trace_attr))
+			break;
+		return xio_trace_set_attr(
+				(const struct xio_trace_attr *)optval);
+	case XIO_OPTNAME_LOG_ATTR:
+		if (optlen != sizeof(struct xio_log_attr))
+			break;
+		return xio_log_set_attr((const struct xio_log_attr *)optval);
+	case XIO_OPTNAME_METRICS_ATTR:
+		if (optlen != sizeof(struct xio_metrics_attr))
+			break;
+		return xio_metrics_set_attr(
+				(const struct xio_metrics_attr *)optval);
 	default:
 		break;
 	}
@@ -89,6 +132,40 @@ static int xio_general_get_opt(void  *xio_obj, int optname,
 		*optlen = sizeof(enum xio_log_level);
 		return 0;
 		break;
+	case XIO_OPTNAME_TCLASS_ATTR:
+		if (*optlen != sizeof(struct xio_tclass_attr))
+			break;
+		return xio_connection_get_tclass_attr(
+				(struct xio_tclass_attr *)optval);
+	case XIO_OPTNAME_TX_QUEUE_ATTR:
+		if (*optlen != sizeof(struct xio_tx_queue_attr))
+			break;
+		return xio_connection_get_tx_queue_attr(
+				(struct xio_tx_queue_attr *)optval);
+	case XIO_OPTNAME_HEDGE_ATTR:
+		if (*optlen != sizeof(struct xio_hedge_attr))
+			break;
+		return xio_hedge_get_attr((struct xio_hedge_attr *)optval);
+	case XIO_OPTNAME_RESUME_ATTR:
+		if (*optlen != sizeof(struct xio_resume_attr))
+			break;
+		return xio_resume_get_attr((struct xio_resume_attr *)optval);
+	case XIO_OPTNAME_ENABLE_SHM_STATS:
+		if (*optlen != sizeof(int))
+			break;
+		return xio_stats_shm_get_enable((int *)optval);
+	case XIO_OPTNAME_TRACE_ATTR:
+		if (*optlen != sizeof(struct xio_trace_attr))
+			break;
+		return xio_trace_get_attr((struct xio_trace_attr *)optval);
+	case XIO_OPTNAME_LOG_ATTR:
+		if (*optlen != sizeof(struct xio_log_attr))
+			break;
+		return xio_log_get_attr((struct xio_log_attr *)optval);
+	case XIO_OPTNAME_METRICS_ATTR:
+		if (*optlen != sizeof(struct xio_metrics_attr))
+			break;
+		return xio_metrics_get_attr((struct xio_metrics_attr *)optval);
 	default:
 		break;
 	}
@@ -0,0 +1,437 @@
+/*
+ * Copyright (c) 2013 Mellanox Technologies®. All rights reserved.
+ *
+ * This software is available to you under a choice of one of two licenses.
+ * You may choose to be licensed under the terms of the GNU General Public
+ * License (GPL) Version 2, available from the file COPYING in the main
+ * directory of this source tree, or the Mellanox Technologies® BSD license
+ * below:
+ *
+ *      - Redistribution and use in source and binary forms, with or without
+ *        modification, are permitted provided that the following conditions
+ *        are met:
+ *
+ *      - Redistributions of source code must retain the above copyright
+ *        notice, this list of conditions and the following disclaimer.
+ *
+ *      - Redistributions in binary form must reproduce the above
+ *        copyright notice, this list of conditions and the following
+ *        disclaimer in the documentation and/or other materials
+ *        provided with the distribution.
+ *
+ *      - Neither the name of the Mellanox Technologies® nor the names of its
+ *        contributors may be used to endorse or promote products derived from
+ *        this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+#include "xio_os.h"
+#include "libxio.h"
+#include "xio_common.h"
+#include "xio_task.h"
+#include "xio_msg_list.h"
+#include "xio_observer.h"
+#include "xio_context.h"
+#include "xio_conn.h"
+#include "xio_connection.h"
+#include "xio_session.h"
+#include "xio_session_priv.h"
+#include "xio_resume.h"
+
+/* resumption policy, used by resilient sessions only. a connection keeps
+ * its own copy
+ */
+static spinlock_t resume_lock;
+static struct xio_resume_attr resume_attr = {
+	2000,		/* window */
+	1,		/* min_delay */
+	100,		/* max_delay */
+	0
+};
+
+static void xio_resume_timeout(void *data);
+
+/*---------------------------------------------------------------------------*/
+/* xio_resume_construct							     */
+/*---------------------------------------------------------------------------*/
+void xio_resume_construct(void)
+{
+	spin_lock_init(&resume_lock);
+}
+
+/*---------------------------------------------------------------------------*/
+/* xio_resume_init							     */
+/*---------------------------------------------------------------------------*/
+void xio_resume_init(struct xio_resume_ctl *ctl)
+{
+	spin_lock(&resume_lock);
+	ctl->attr = resume_attr;
+	spin_unlock(&resume_lock);
+}
+
+/*---------------------------------------------------------------------------*/
+/* xio_resume_set_attr							     */
+/*---------------------------------------------------------------------------*/
+int xio_resume_set_attr(const struct xio_resume_attr *attr)
+{
+	if (attr->max_delay == 0 || attr->min_delay == 0 ||
+	    attr->min_delay > attr->max_delay) {
+		xio_set_error(EINVAL);
+		return -1;
+	}
+	spin_lock(&resume_lock);
+	resume_attr = *attr;
+	spin_unlock(&resume_lock);
+
+	return 0;
+}
+
+/*---------------------------------------------------------------------------*/
+/* xio_resume_get_attr							     */
+/*---------------------------------------------------------------------------*/
+int xio_resume_get_attr(struct xio_resume_attr *attr)
+{
+	spin_lock(&resume_lock);
+	*attr = resume_attr;
+	spin_unlock(&resume_lock);
+
+	return 0;
+}
+
+/*---------------------------------------------------------------------------*/
+/* xio_resume_left - msec left of the window				     */
+/*---------------------------------------------------------------------------*/
+static uint32_t xio_resume_left(struct xio_connection *connection)
+{
+	struct xio_resume_ctl	*ctl = &connection->resume;
+	uint64_t		hertz = connection->ctx->stats.hertz;
+	int64_t			left = ctl->deadline - get_cycles();
+
+	if (left <= 0 || hertz == 0)
+		return 0;
+
+	return (left * 1000 + hertz - 1) / hertz;
+}
+
+/*---------------------------------------------------------------------------*/
+/* xio_resume_arm							     */
+/*---------------------------------------------------------------------------*/
+static void xio_resume_arm(struct xio_connection *connection, uint32_t msec)
+{
+	struct xio_resume_ctl	*ctl = &connection->resume;
+
+	if (ctl->timer) {
+		xio_ctx_timer_del(connection->ctx, ctl->timer);
+		ctl->timer = NULL;
+	}
+	xio_ctx_timer_add(connection->ctx, msec, connection,
+			  xio_resume_timeout, &ctl->timer);
+}
+
+/*---------------------------------------------------------------------------*/
+/* xio_resume_detach - drop the failed transport of a client connection	     */
+/*---------------------------------------------------------------------------*/
+static void xio_resume_detach(struct xio_connection *connection)
+{
+	struct xio_resume_ctl	*ctl = &connection->resume;
+	struct xio_conn		*conn = connection->conn;
+
+	ctl->connecting = 0;
+	if (ctl->hello) {
+		xio_connection_release_hello(connection, ctl->hello);
+		ctl->hello = NULL;
+	}
+	if (conn == NULL)
+		return;
+
+	xio_connection_flush_tasks(connection);
+	connection->conn = NULL;
+	connection->session->last_connection = NULL;
+	xio_conn_close(conn, &connection->session->observer);
+}
+
+/*---------------------------------------------------------------------------*/
+/* xio_resume_expire - the window passed, fail as without resumption	     */
+/*---------------------------------------------------------------------------*/
+static void xio_resume_expire(struct xio_connection *connection)
+{
+	struct xio_session	*session = connection->session;
+
+	DEBUG_LOG("resume window passed. session:%p, connection:%p\n",
+		  session, connection);
+
+	if (session->type == XIO_SESSION_CLIENT)
+		xio_resume_detach(connection);
+
+	connection->state = XIO_CONNECTION_STATE_DISCONNECTED;
+	xio_session_notify_connection_disconnected(session, connection,
+						   XIO_E_SESSION_DISCONECTED);
+	xio_session_disconnect(session, connection);
+}
+
+/*---------------------------------------------------------------------------*/
+/* xio_resume_retry - schedule the next attempt				     */
+/*---------------------------------------------------------------------------*/
+static void xio_resume_retry(struct xio_connection *connection)
+{
+	struct xio_resume_ctl	*ctl = &connection->resume;
+	uint32_t		left = xio_resume_left(connection);
+
+	xio_resume_detach(connection);
+	if (left == 0) {
+		xio_resume_expire(connection);
+		return;
+	}
+
+	xio_resume_arm(connection, min(ctl->delay, left));
+	ctl->delay = min(ctl->delay * 2, ctl->attr.max_delay);
+}
+
+/*---------------------------------------------------------------------------*/
+/* xio_resume_connect - open a new transport to the session's portal	     */
+/*---------------------------------------------------------------------------*/
+static void xio_resume_connect(struct xio_connection *connection)
+{
+	struct xio_resume_ctl	*ctl = &connection->resume;
+	struct xio_session	*session = connection->session;
+	struct xio_conn		*conn;
+	char			uri_portal[64];
+	char			*portal;
+
+	if (session->portals_array_len) {
+		portal = session->portals_array[connection->conn_idx %
+						session->portals_array_len];
+	} else {
+		if (xio_uri_get_portal(session->uri, uri_portal,
+				       sizeof(uri_portal)) != 0) {
+			xio_resume_retry(connection);
+			return;
+		}
+		portal = uri_portal;
+	}
+
+	ctl->attempts++;
+	conn = xio_conn_open(connection->ctx, portal, &session->observer,
+			     session->session_id);
+	if (conn == NULL) {
+		xio_resume_retry(connection);
+		return;
+	}
+	xio_connection_set_conn(connection, conn);
+	if (xio_conn_connect(conn, portal, &session->observer, NULL)) {
+		xio_resume_retry(connection);
+		return;
+	}
+	ctl->connecting = 1;
+
+	/* the hello attaches the transport to the peer session */
+	if (xio_connection_send_hello_req(connection, &ctl->hello)) {
+		xio_resume_retry(connection);
+		return;
+	}
+
+	xio_resume_arm(connection, xio_resume_left(connection));
+}
+
+/*---------------------------------------------------------------------------*/
+/* xio_resume_timeout							     */
+/*---------------------------------------------------------------------------*/
+static void xio_resume_timeout(void *data)
+{
+	struct xio_connection	*connection = data;
+	struct xio_resume_ctl	*ctl = &connection->resume;
+	uint32_t		left = xio_resume_left(connection);
+
+	ctl->timer = NULL;
+	if (left == 0) {
+		xio_resume_expire(connection);
+		return;
+	}
+
+	if (connection->session->type == XIO_SESSION_CLIENT &&
+	    !ctl->connecting)
+		xio_resume_connect(connection);
+	else
+		xio_resume_arm(connection, left);
+}
+
+/*---------------------------------------------------------------------------*/
+/* xio_resume_on_conn_down						     */
+/*---------------------------------------------------------------------------*/
+int xio_resume_on_conn_down(struct xio_session *session,
+			    struct xio_conn *conn)
+{
+	struct xio_connection	*connection;
+	struct xio_resume_ctl	*ctl;
+	uint64_t		hertz;
+
+	spin_lock(&session->connections_list_lock);
+	connection = xio_session_find_connection(session, conn);
+	spin_unlock(&session->connections_list_lock);
+	if (connection == NULL)
+		return 0;
+
+	if (connection->state == XIO_CONNECTION_STATE_RESUMING) {
+		/* a client attempt failed. the server's failed transport
+		 * reports more than once
+		 */
+		if (session->type == XIO_SESSION_CLIENT &&
+		    connection->conn == conn)
+			xio_resume_retry(connection);
+		return 1;
+	}
+
+	if (!xio_session_is_resilient(session) ||
+	    connection->resume.attr.window == 0 ||
+	    session->state != XIO_SESSION_STATE_ONLINE ||
+	    connection->state != XIO_CONNECTION_STATE_ONLINE)
+		return 0;
+
+	DEBUG_LOG("connection resumes. session:%p, connection:%p\n",
+		  session, connection);
+
+	ctl = &connection->resume;
+	hertz = connection->ctx->stats.hertz;
+	ctl->deadline = get_cycles() + ctl->attr.window * hertz / 1000;
+	ctl->delay = ctl->attr.min_delay;
+	ctl->attempts = 0;
+
+	/* requests in flight are sent again, ahead of the queue */
+	xio_connection_flush_msgs(connection);
+	connection->state = XIO_CONNECTION_STATE_RESUMING;
+
+	if (session->type == XIO_SESSION_CLIENT) {
+		xio_resume_detach(connection);
+		xio_resume_connect(connection);
+	} else {
+		/* requests served here may be replayed by the peer */
+		xio_resume_arm(connection, ctl->attr.window);
+	}
+
+	return 1;
+}
+
+/*---------------------------------------------------------------------------*/
+/* xio_resume_done							     */
+/*---------------------------------------------------------------------------*/
+void xio_resume_done(struct xio_connection *connection)
+{
+	struct xio_resume_ctl	*ctl = &connection->resume;
+
+	DEBUG_LOG("connection resumed. connection:%p, attempts:%d\n",
+		  connection, ctl->attempts);
+
+	if (ctl->timer) {
+		xio_ctx_timer_del(connection->ctx, ctl->timer);
+		ctl->timer = NULL;
+	}
+	ctl->connecting = 0;
+	ctl->hello = NULL;
+	xio_connection_set_state(connection, XIO_CONNECTION_STATE_ONLINE);
+}
+
+/*---------------------------------------------------------------------------*/
+/* xio_resume_on_req							     */
+/*---------------------------------------------------------------------------*/
+int xio_resume_on_req(struct xio_connection *connection,
+		      struct xio_task *task)
+{
+	struct xio_session	*session = connection->session;
+	struct xio_connection	*old;
+	int			found = 0;
+	int			answered = 0;
+
+	if (!xio_session_is_resilient(session) ||
+	    session->type != XIO_SESSION_SERVER ||
+	    task->tlv_type != XIO_MSG_REQ ||
+	    (task->imsg.flags & XIO_MSG_FLAG_REQUEST_READ_RECEIPT))
+		return 0;
+
+	/* the sn is unique in the session. failed connections of other
+	 * contexts belong to other threads and are left alone
+	 */
+	spin_lock(&session->connections_list_lock);
+	list_for_each_entry(old, &session->connections_list,
+			    connections_list_entry) {
+		if (old->state != XIO_CONNECTION_STATE_RESUMING ||
+		    old->ctx != connection->ctx)
+			continue;
+		answered = xio_connection_resume_rsp(old, connection, task);
+		if (answered ||
+		    xio_connection_find_io_task(old, task->imsg.sn)) {
+			found = 1;
+			break;
+		}
+	}
+	spin_unlock(&session->connections_list_lock);
+
+	if (!found)
+		return 0;
+
+	DEBUG_LOG("replayed request. session:%p, sn:%llu, answered:%d\n",
+		  session, (unsigned long long)task->imsg.sn, answered);
+
+	xio_connection_queue_io_task(connection, task);
+	if (!answered)
+		task->state = XIO_TASK_STATE_DELIVERED;
+
+	xio_connection_xmit_msgs(connection);
+
+	return 1;
+}
+
+/*---------------------------------------------------------------------------*/
+/* xio_resume_rebind							     */
+/*---------------------------------------------------------------------------*/
+struct xio_task *xio_resume_rebind(struct xio_task *task,
+				   struct xio_msg *rsp)
+{
+	struct xio_connection	*old = task->connection;
+	struct xio_session	*session = old->session;
+	struct xio_connection	*pconnection;
+	struct xio_task		*ptask = NULL;
+
+	spin_lock(&session->connections_list_lock);
+	list_for_each_entry(pconnection, &session->connections_list,
+			    connections_list_entry) {
+		if (pconnection->state != XIO_CONNECTION_STATE_ONLINE ||
+		    pconnection->ctx != old->ctx)
+			continue;
+		ptask = xio_connection_find_io_task(pconnection,
+						    task->imsg.sn);
+		if (ptask)
+			break;
+	}
+	spin_unlock(&session->connections_list_lock);
+
+	/* not replayed yet - the answer waits on the failed connection */
+	if (ptask == NULL)
+		return task;
+
+	rsp->request = &ptask->imsg;
+
+	return ptask;
+}
+
+/*---------------------------------------------------------------------------*/
+/* xio_resume_release							     */
+/*---------------------------------------------------------------------------*/
+void xio_resume_release(struct xio_connection *connection)
+{
+	struct xio_resume_ctl	*ctl = &connection->resume;
+
+	if (ctl->timer) {
+		xio_ctx_timer_del(connection->ctx, ctl->timer);
+		ctl->timer = NULL;
+	}
+}
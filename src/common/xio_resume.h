@@ -0,0 +1,119 @@
+/*
+ * Copyright (c) 2013 Mellanox Technologies®. All rights reserved.
+ *
+ * This software is available to you under a choice of one of two licenses.
+ * You may choose to be licensed under the terms of the GNU General Public
+ * License (GPL) Version 2, available from the file COPYING in the main
+ * directory of this source tree, or the Mellanox Technologies® BSD license
+ * below:
+ *
+ *      - Redistribution and use in source and binary forms, with or without
+ *        modification, are permitted provided that the following conditions
+ *        are met:
+ *
+ *      - Redistributions of source code must retain the above copyright
+ *        notice, this list of conditions and the following disclaimer.
+ *
+ *      - Redistributions in binary form must reproduce the above
+ *        copyright notice, this list of conditions and the following
+ *        disclaimer in the documentation and/or other materials
+ *        provided with the distribution.
+ *
+ *      - Neither the name of the Mellanox Technologies® nor the names of its
+ *        contributors may be used to endorse or promote products derived from
+ *        this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+#ifndef XIO_RESUME_H
+#define XIO_RESUME_H
+
+/*---------------------------------------------------------------------------*/
+/* session resumption. with XIO_SESSION_FLAG_RESILIENT a client connection  */
+/* whose transport fails keeps its messages, reconnects in the background   */
+/* and introduces itself to the existing server session with a hello. the  */
+/* requests that were in flight are sent again with their sn. a resilient   */
+/* server keeps the failed connection for the resume window and answers a  */
+/* replayed request it still serves once, on the new connection. requests  */
+/* already answered are served again - delivery is at least once	     */
+/*---------------------------------------------------------------------------*/
+struct xio_connection;
+struct xio_session;
+struct xio_conn;
+struct xio_task;
+struct xio_msg;
+
+/* per connection resumption state */
+struct xio_resume_ctl {
+	xio_ctx_timer_handle_t		timer;
+	uint64_t			deadline;	/* cycles */
+	struct xio_msg			*hello;		/* not answered yet */
+	uint32_t			delay;		/* msec, next retry */
+	uint32_t			attempts;
+	int				connecting;	/* attempt pending */
+	int				pad;
+	struct xio_resume_attr		attr;		/* copied at creation */
+};
+
+/*---------------------------------------------------------------------------*/
+/* xio_resume_construct							     */
+/*---------------------------------------------------------------------------*/
+void xio_resume_construct(void);
+
+/*---------------------------------------------------------------------------*/
+/* xio_resume_init							     */
+/*---------------------------------------------------------------------------*/
+void xio_resume_init(struct xio_resume_ctl *ctl);
+
+/*---------------------------------------------------------------------------*/
+/* xio_resume_set_attr							     */
+/*---------------------------------------------------------------------------*/
+int xio_resume_set_attr(const struct xio_resume_attr *attr);
+
+/*---------------------------------------------------------------------------*/
+/* xio_resume_get_attr							     */
+/*---------------------------------------------------------------------------*/
+int xio_resume_get_attr(struct xio_resume_attr *attr);
+
+/*---------------------------------------------------------------------------*/
+/* xio_resume_on_conn_down - transport of conn failed. returns 1 when the   */
+/* connection resumes instead of closing				     */
+/*---------------------------------------------------------------------------*/
+int xio_resume_on_conn_down(struct xio_session *session,
+			    struct xio_conn *conn);
+
+/*---------------------------------------------------------------------------*/
+/* xio_resume_done - hello answered, the connection is back		     */
+/*---------------------------------------------------------------------------*/
+void xio_resume_done(struct xio_connection *connection);
+
+/*---------------------------------------------------------------------------*/
+/* xio_resume_on_req - a request arrived on a resilient server session.	     */
+/* returns 1 when it replays a request still served on a failed connection  */
+/*---------------------------------------------------------------------------*/
+int xio_resume_on_req(struct xio_connection *connection,
+		      struct xio_task *task);
+
+/*---------------------------------------------------------------------------*/
+/* xio_resume_rebind - task of a response whose connection failed. returns  */
+/* the task of the replayed request, or task itself			     */
+/*---------------------------------------------------------------------------*/
+struct xio_task *xio_resume_rebind(struct xio_task *task,
+				   struct xio_msg *rsp);
+
+/*---------------------------------------------------------------------------*/
+/* xio_resume_release							     */
+/*---------------------------------------------------------------------------*/
+void xio_resume_release(struct xio_connection *connection);
+
+#endif /* XIO_RESUME_H */
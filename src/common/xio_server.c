@@ -43,6 +43,7 @@
 #include "xio_transport.h"
 #include "xio_task.h"
 #include "xio_context.h"
+#include "xio_hash.h"
 #include "xio_session.h"
 #include "xio_conn.h"
 #include "xio_connection.h"
@@ -57,11 +58,145 @@ struct xio_server {
 	uint32_t			session_flags;
 	uint32_t			pad;
 	void				*cb_private_data;
+
+	/* contexts that run the accepted connections */
+	struct list_head		workers_list;
+	spinlock_t			workers_lock;
+	int				nr_workers;
+	enum xio_accept_policy		policy;
+	unsigned int			rr_cursor;
+};
+
+struct xio_server_worker {
+	struct xio_context		*ctx;
+	atomic_t			pending;  /* picked, not yet opened */
+	int				pad;
+	struct list_head		workers_list_entry;
 };
 
 static int xio_on_conn_event(void *observer, void *notifier, int event,
 			void *event_data);
 
+/*---------------------------------------------------------------------------*/
+/* xio_server_peer_hash							     */
+/*---------------------------------------------------------------------------*/
+static unsigned int xio_server_peer_hash(struct sockaddr_storage *peer)
+{
+	const uint32_t	*addr;
+	uint32_t	key = 0;
+	int		i, n;
+
+	/* the port differs per connection - hash the host only */
+	if (peer->ss_family == AF_INET6) {
+		addr = (const uint32_t *)
+			&((struct sockaddr_in6 *)peer)->sin6_addr;
+		n = 4;
+	} else {
+		addr = (const uint32_t *)
+			&((struct sockaddr_in *)peer)->sin_addr;
+		n = 1;
+	}
+	for (i = 0; i < n; i++)
+		key ^= addr[i];
+
+	return int32_hash(key);
+}
+
+/*---------------------------------------------------------------------------*/
+/* xio_server_pick_worker						     */
+/*---------------------------------------------------------------------------*/
+static struct xio_context *xio_server_pick_worker(
+		struct xio_server *server,
+		struct sockaddr_storage *peer)
+{
+	struct xio_server_worker	*worker, *best = NULL;
+	struct xio_context		*ctx;
+	int				load, best_load = 0;
+	int				idx = 0;
+
+	spin_lock(&server->workers_lock);
+	if (server->nr_workers == 0) {
+		spin_unlock(&server->workers_lock);
+		return NULL;
+	}
+
+	switch (server->policy) {
+	case XIO_ACCEPT_LEAST_LOADED:
+		/* connections already running plus those on their way */
+		list_for_each_entry(worker, &server->workers_list,
+				    workers_list_entry) {
+			load = atomic_read(&worker->ctx->nr_conns) +
+			       atomic_read(&worker->pending);
+			if (best == NULL || load < best_load) {
+				best = worker;
+				best_load = load;
+			}
+		}
+		break;
+	case XIO_ACCEPT_PEER_HASH:
+		idx = xio_server_peer_hash(peer) % server->nr_workers;
+		break;
+	case XIO_ACCEPT_ROUND_ROBIN:
+	default:
+		idx = server->rr_cursor++ % server->nr_workers;
+		break;
+	}
+
+	if (best == NULL) {
+		list_for_each_entry(worker, &server->workers_list,
+				    workers_list_entry) {
+			if (idx-- == 0) {
+				best = worker;
+				break;
+			}
+		}
+	}
+	atomic_inc(&best->pending);
+	ctx = best->ctx;
+	spin_unlock(&server->workers_lock);
+
+	return ctx;
+}
+
+/*---------------------------------------------------------------------------*/
+/* xio_server_put_worker						     */
+/*---------------------------------------------------------------------------*/
+static void xio_server_put_worker(struct xio_server *server,
+				  struct xio_context *ctx)
+{
+	struct xio_server_worker	*worker;
+
+	spin_lock(&server->workers_lock);
+	list_for_each_entry(worker, &server->workers_list,
+			    workers_list_entry) {
+		if (worker->ctx == ctx) {
+			__atomic_add_unless(&worker->pending, -1, 0);
+			break;
+		}
+	}
+	spin_unlock(&server->workers_lock);
+}
+
+/*---------------------------------------------------------------------------*/
+/* xio_on_accept_ctx							     */
+/*---------------------------------------------------------------------------*/
+static void xio_on_accept_ctx(struct xio_server *server,
+			      union xio_conn_event_data *event_data)
+{
+	/* the transport could not open the connection on its pick */
+	if (event_data->accept_ctx.release) {
+		xio_server_put_worker(server, event_data->accept_ctx.ctx);
+		return;
+	}
+
+	event_data->accept_ctx.ctx =
+		xio_server_pick_worker(server,
+				       event_data->accept_ctx.peer_addr);
+
+	TRACE_LOG("server: accept on ctx:%p, server:%p\n",
+		  event_data->accept_ctx.ctx, server);
+}
+
 /*---------------------------------------------------------------------------*/
 /* xio_on_new_conn							     */
 /*---------------------------------------------------------------------------*/
@@ -69,13 +204,17 @@ static int xio_on_new_conn(struct xio_server *server,
 			   struct xio_conn *conn,
 			   union xio_conn_event_data *event_data)
 {
-	int		retval;
+	struct xio_conn			*child_conn =
+		event_data->new_connection.child_conn;
+	int				retval;
+
+	/* the connection arrived on its worker */
+	xio_server_put_worker(server, child_conn->transport_hndl->ctx);
 
 	/* set the server as observer */
-	xio_conn_set_server_observer(event_data->new_connection.child_conn,
-				     &server->observer);
+	xio_conn_set_server_observer(child_conn, &server->observer);
 
-	retval = xio_conn_accept(event_data->new_connection.child_conn);
+	retval = xio_conn_accept(child_conn);
 	if (retval != 0) {
 		ERROR_LOG("failed to accept connection\n");
 		return -1;
@@ -93,7 +232,7 @@ static int xio_on_new_message(struct xio_server *server,
 	struct xio_session		*session;
 	struct xio_connection		*connection;
 	struct xio_task			*task = event_data->msg.task;
-
+	struct xio_context		*ctx = conn->transport_hndl->ctx;
 
 	struct xio_session_attr attr = {
 		&server->ops,
@@ -128,7 +267,7 @@ static int xio_on_new_message(struct xio_server *server,
 
 		connection =
 			xio_session_alloc_connection(session,
-						     server->ctx, 0,
+						     ctx, 0,
 						     server->cb_private_data);
 		if (!connection) {
 			ERROR_LOG("server failed to allocate new connection\n");
@@ -160,7 +299,7 @@ static int xio_on_new_message(struct xio_server *server,
 			   server, session, conn, session->session_id);
 
 		connection = xio_session_alloc_connection(task->session,
-						  server->ctx, 0,
+						  ctx, 0,
 						  server->cb_private_data);
 
 		connection = xio_session_assign_conn(task->session, conn);
@@ -216,6 +355,9 @@ static int xio_on_conn_event(void *observer, void *notifier, int event,
 			  "server:%p, conn:%p\n", observer, notifier);
 		xio_on_new_conn(server, conn, event_data);
 		break;
+	case XIO_CONN_EVENT_ACCEPT_CTX:
+		xio_on_accept_ctx(server, event_data);
+		break;
 
 	case XIO_CONN_EVENT_DISCONNECTED:
 	case XIO_CONN_EVENT_CLOSED:
@@ -272,6 +414,9 @@ struct xio_server *xio_bind(struct xio_context *ctx,
 
 	server->session_flags = session_flags;
 	memcpy(&server->ops, ops, sizeof(*ops));
+	INIT_LIST_HEAD(&server->workers_list);
+	spin_lock_init(&server->workers_lock);
+	server->policy = XIO_ACCEPT_ROUND_ROBIN;
 
 	XIO_OBSERVER_INIT(&server->observer, server, xio_on_conn_event);
 
@@ -307,13 +452,108 @@ cleanup:
 /*---------------------------------------------------------------------------*/
 int xio_unbind(struct xio_server *server)
 {
-	int retval = 0;
+	struct xio_server_worker	*worker, *next;
+	int				retval = 0;
 
 	xio_conn_close(server->listener, NULL);
+	list_for_each_entry_safe(worker, next, &server->workers_list,
+				 workers_list_entry) {
+		list_del(&worker->workers_list_entry);
+		kfree(worker);
+	}
 	kfree(server->uri);
 	kfree(server);
 
 	return retval;
 }
 
+/*---------------------------------------------------------------------------*/
+/* xio_bind_worker							     */
+/*---------------------------------------------------------------------------*/
+int xio_bind_worker(struct xio_server *server, struct xio_context *ctx)
+{
+	struct xio_server_worker	*worker, *tmp;
+
+	if ((server == NULL) || (ctx == NULL)) {
+		xio_set_error(EINVAL);
+		return -1;
+	}
+
+	worker = kcalloc(1, sizeof(*worker), GFP_KERNEL);
+	if (worker == NULL) {
+		xio_set_error(ENOMEM);
+		return -1;
+	}
+	worker->ctx = ctx;
+	atomic_set(&worker->pending, 0);
+
+	/* runs on the worker's thread - prepare it to take over
+	 * connection requests that arrive on the listener */
+	if (xio_conn_attach_ctx(server->listener, ctx) != 0) {
+		ERROR_LOG("failed to attach worker ctx:%p\n", ctx);
+		kfree(worker);
+		return -1;
+	}
+
+	spin_lock(&server->workers_lock);
+	list_for_each_entry(tmp, &server->workers_list, workers_list_entry) {
+		if (tmp->ctx == ctx) {
+			spin_unlock(&server->workers_lock);
+			kfree(worker);
+			xio_set_error(EEXIST);
+			return -1;
+		}
+	}
+	list_add_tail(&worker->workers_list_entry, &server->workers_list);
+	server->nr_workers++;
+	spin_unlock(&server->workers_lock);
+
+	return 0;
+}
+
+/*---------------------------------------------------------------------------*/
+/* xio_unbind_worker							     */
+/*---------------------------------------------------------------------------*/
+int xio_unbind_worker(struct xio_server *server, struct xio_context *ctx)
+{
+	struct xio_server_worker	*worker;
+
+	if ((server == NULL) || (ctx == NULL)) {
+		xio_set_error(EINVAL);
+		return -1;
+	}
+
+	spin_lock(&server->workers_lock);
+	list_for_each_entry(worker, &server->workers_list,
+			    workers_list_entry) {
+		if (worker->ctx == ctx) {
+			list_del(&worker->workers_list_entry);
+			server->nr_workers--;
+			spin_unlock(&server->workers_lock);
+			kfree(worker);
+			return 0;
+		}
+	}
+	spin_unlock(&server->workers_lock);
+
+	xio_set_error(ENOENT);
+	return -1;
+}
+
+/*---------------------------------------------------------------------------*/
+/* xio_set_accept_policy						     */
+/*---------------------------------------------------------------------------*/
+int xio_set_accept_policy(struct xio_server *server,
+			  enum xio_accept_policy policy)
+{
+	if ((server == NULL) ||
+	    (policy != XIO_ACCEPT_ROUND_ROBIN &&
+	     policy != XIO_ACCEPT_LEAST_LOADED &&
+	     policy != XIO_ACCEPT_PEER_HASH)) {
+		xio_set_error(EINVAL);
+		return -1;
+	}
+	server->policy = policy;
 
+	return 0;
+}
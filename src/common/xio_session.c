@@ -147,13 +147,21 @@ struct xio_connection *xio_session_find_connection(
 		struct xio_session *session,
 		struct xio_conn *conn)
 {
-	struct xio_connection		*connection;
+	struct xio_connection		*connection = session->last_connection;
 	struct xio_context		*ctx = conn->transport_hndl->ctx;
 
+	/* the ctx list is only appended to, so the first match found by the
+	 * scan stays the first match until it is released
+	 */
+	if (connection && connection->conn == conn)
+		return connection;
+
 	list_for_each_entry(connection, &ctx->ctx_list, ctx_list_entry) {
 		if (connection->conn == conn &&
-		    connection->session == session)
+		    connection->session == session) {
+			session->last_connection = connection;
 			return connection;
+		}
 	}
 
 	return NULL;
@@ -500,6 +508,10 @@ static int xio_on_req_recv(struct xio_connection *connection,
 	msg->next	= NULL;
 	task->connection = connection;
 
+	/* the peer resent a request still served here */
+	if (xio_resume_on_req(connection, task))
+		return 0;
+
 	xio_connection_queue_io_task(connection, task);
 
 	task->state = XIO_TASK_STATE_DELIVERED;
@@ -511,13 +523,18 @@ static int xio_on_req_recv(struct xio_connection *connection,
 	if (hdr.flags & XIO_MSG_FLAG_REQUEST_READ_RECEIPT)
 		xio_task_addref(task);
 
-	msg->timestamp = get_cycles();
+	memset(msg->stamp, 0, sizeof(msg->stamp));
+	xio_connection_stamp_recv(connection, msg, task);
+	msg->timestamp = msg->stamp[XIO_STAGE_DELIVER];
 	xio_stat_inc(stats, XIO_STAT_RX_MSG);
 	xio_stat_add(stats, XIO_STAT_RX_BYTES,
 		     vmsg->header.iov_len +
-		     xio_iovex_length(vmsg->data_iov, vmsg->data_iovlen));
+		     xio_iovex_length(xio_vmsg_data_iov(vmsg),
+				      vmsg->data_iovlen));
 
 	/* notify the upper layer */
+	xio_trace(connection->ctx, XIO_TRACE_ON_REQ, msg->sn,
+		  task->ltid, task->rtid);
 	if (connection->ses_ops.on_msg)
 		connection->ses_ops.on_msg(
 				connection->session, msg,
@@ -549,15 +566,24 @@ static int xio_on_rsp_recv(struct xio_connection *connection,
 	struct xio_msg		*msg = &task->imsg;
 	struct xio_msg		*omsg;
 	struct xio_task		*sender_task = task->sender_task;
+	struct xio_connection	*owner = xio_connection_owner(connection);
 	struct xio_statistics *stats = &connection->ctx->stats;
+	uint64_t		rtt;
 
 
 	if (connection->state != XIO_CONNECTION_STATE_ONLINE)
 		return 0;
 
-	/* read session header */
-	if (xio_session_read_header(task, &hdr) != 0)
+	if (task->imm_rsp) {
+		/* the transport matched a status only response by its task
+		 * id. no session header was sent
+		 */
+		hdr.serial_num		= sender_task->omsg->sn;
+		hdr.flags		= XIO_MSG_RSP_FLAG_LAST;
+		hdr.receipt_result	= 0;
+	} else if (xio_session_read_header(task, &hdr) != 0) {
 		return -1;
+	}
 
 	msg->sn = hdr.serial_num;
 
@@ -566,9 +592,14 @@ static int xio_on_rsp_recv(struct xio_connection *connection,
 	omsg->request	= msg;
 	omsg->next	= NULL;
 
-	xio_stat_add(stats, XIO_STAT_DELAY,
-		     get_cycles() - omsg->timestamp);
+	rtt = get_cycles() - omsg->timestamp;
+	xio_stat_add(stats, XIO_STAT_DELAY, rtt);
 	xio_stat_inc(stats, XIO_STAT_RX_MSG);
+	if (omsg->type == XIO_MSG_TYPE_REQ) {
+		xio_hedge_sample(connection, rtt);
+		xio_connection_mpath_sample(connection, rtt);
+		xio_connection_latency(connection, XIO_LATENCY_RTT, rtt);
+	}
 
 	task->connection = connection;
 
@@ -578,6 +609,16 @@ static int xio_on_rsp_recv(struct xio_connection *connection,
 	/* store the task in io queue */
 	xio_connection_queue_io_task(connection, task);
 
+	/* a hedged request completes once, on the connection it was sent */
+	if (task->tlv_type == XIO_MSG_TYPE_RSP && omsg->hedge) {
+		omsg = xio_hedge_on_response(connection, omsg, &owner);
+		if (omsg == NULL) {
+			xio_connection_xmit_msgs(connection);
+			return 0;
+		}
+		owner = xio_connection_owner(owner);
+	}
+
 	/* remove the message from in flight queue */
 
 	if (task->tlv_type == XIO_ONE_WAY_RSP) {
@@ -587,23 +628,25 @@ static int xio_on_rsp_recv(struct xio_connection *connection,
 
 		omsg->sn	  = msg->sn; /* one way do have response */
 		omsg->receipt_res = hdr.receipt_result;
-		if (connection->ses_ops.on_msg_delivered)
-			connection->ses_ops.on_msg_delivered(
-				    connection->session,
+		xio_connection_stamp_sent(connection, omsg, sender_task);
+		xio_connection_stamp_recv(connection, omsg, task);
+		if (owner->ses_ops.on_msg_delivered)
+			owner->ses_ops.on_msg_delivered(
+				    owner->session,
 				    omsg,
 				    task->imsg.more_in_batch,
-				    connection->cb_user_context);
+				    owner->cb_user_context);
 		sender_task->omsg = NULL;
 		xio_release_response_task(task);
 	} else {
 		if (hdr.flags & XIO_MSG_RSP_FLAG_FIRST) {
-			if (connection->ses_ops.on_msg_delivered) {
+			if (owner->ses_ops.on_msg_delivered) {
 				omsg->receipt_res = hdr.receipt_result;
-				connection->ses_ops.on_msg_delivered(
-						connection->session,
+				owner->ses_ops.on_msg_delivered(
+						owner->session,
 						omsg,
 						task->imsg.more_in_batch,
-						connection->cb_user_context);
+						owner->cb_user_context);
 			}
 			/* standalone receipt */
 			if ((hdr.flags &
@@ -617,15 +660,20 @@ static int xio_on_rsp_recv(struct xio_connection *connection,
 			struct xio_vmsg *vmsg = &msg->in;
 			xio_stat_add(stats, XIO_STAT_RX_BYTES,
 				     vmsg->header.iov_len +
-				     xio_iovex_length(vmsg->data_iov,
+				     xio_iovex_length(xio_vmsg_data_iov(vmsg),
 						      vmsg->data_iovlen));
 
-			if (connection->ses_ops.on_msg)
-				connection->ses_ops.on_msg(
-					connection->session,
+			xio_connection_stamp_sent(connection, omsg,
+						  sender_task);
+			xio_connection_stamp_recv(connection, omsg, task);
+			xio_trace(connection->ctx, XIO_TRACE_ON_RSP,
+				  omsg->sn, sender_task->ltid, 0);
+			if (owner->ses_ops.on_msg)
+				owner->ses_ops.on_msg(
+					owner->session,
 					omsg,
 					task->imsg.more_in_batch,
-					connection->cb_user_context);
+					owner->cb_user_context);
 		}
 	}
 
@@ -644,6 +692,7 @@ static int xio_on_rsp_send_comp(
 {
 	/* remove the message from in flight queue */
 	xio_connection_remove_in_flight(connection, task->omsg);
+	xio_connection_stamp_sent(connection, task->omsg, task);
 
 	/*
 	 * completion of receipt
@@ -683,8 +732,12 @@ static int xio_on_ow_req_send_comp(
 	if (!(task->omsg_flags & XIO_MSG_FLAG_REQUEST_READ_RECEIPT)) {
 		struct xio_statistics *stats = &connection->ctx->stats;
 		struct xio_msg *omsg = task->omsg;
+
+		/* no receipt follows, the message leaves the window here */
+		xio_connection_remove_in_flight(connection, omsg);
 		xio_stat_add(stats, XIO_STAT_DELAY,
 			     get_cycles() - omsg->timestamp);
+		xio_connection_stamp_sent(connection, omsg, task);
 		xio_tasks_pool_put(task);
 	}
 
@@ -703,6 +756,9 @@ int xio_on_conn_disconnected(struct xio_session *session,
 {
 	struct xio_connection *connection, *tmp_connection;
 
+	if (xio_resume_on_conn_down(session, conn))
+		return 0;
+
 	if (session->lead_connection &&
 	    session->lead_connection->conn == conn)
 		connection = session->lead_connection;
@@ -768,14 +824,13 @@ int xio_on_conn_message_error(struct xio_session *session,
 {
 	struct xio_task *task = event_data->msg_error.task;
 
-	xio_connection_remove_msg_from_queue(task->connection, task->omsg);
-
-	if (task->session->ses_ops.on_msg_error)
-		task->session->ses_ops.on_msg_error(
-				task->session,
-				event_data->msg_error.reason,
-				task->omsg,
-				task->connection->cb_user_context);
+	/* a resuming connection keeps the message for the replay */
+	if (task->connection->state != XIO_CONNECTION_STATE_RESUMING) {
+		xio_connection_remove_msg_from_queue(task->connection,
+						     task->omsg);
+		xio_session_notify_msg_error(task->connection, task->omsg,
+					     event_data->msg_error.reason);
+	}
 
 	if (IS_REQUEST(task->tlv_type))
 		xio_tasks_pool_put(task);
@@ -798,9 +853,12 @@ int xio_on_conn_error(struct xio_session *session,
 
 	};
 	struct xio_session  *the_session = session;
+	struct xio_connection *connection;
 
-	struct xio_connection *connection =
-				xio_session_find_connection(session, conn);
+	if (xio_resume_on_conn_down(session, conn))
+		return 0;
+
+	connection = xio_session_find_connection(session, conn);
 
 	/* enable the teardown */
 	session->disable_teardown  = 0;
@@ -1008,6 +1066,17 @@ int xio_on_assign_in_buf(struct xio_session *session,
 		}
 	}
 
+#ifndef __KERNEL__
+	/* data is delivered in chunks - no buffer is needed */
+	if (event_data->assign_in_buf.is_streamed &&
+	    connection->ses_ops.on_msg_data_chunk) {
+		event_data->assign_in_buf.is_assigned = 0;
+		return 0;
+	}
+#endif
+	/* no chunk callback (never in the kernel) - take a whole buffer */
+	event_data->assign_in_buf.is_streamed = 0;
+
 	if (connection->ses_ops.assign_data_in_buf) {
 		connection->ses_ops.assign_data_in_buf(&task->imsg,
 		connection->cb_user_context);
@@ -1019,6 +1088,42 @@ int xio_on_assign_in_buf(struct xio_session *session,
 	return 0;
 }
 
+/*---------------------------------------------------------------------------*/
+/* xio_on_msg_chunk							     */
+/*---------------------------------------------------------------------------*/
+int xio_on_msg_chunk(struct xio_session *session,
+		     struct xio_conn *conn,
+		     union xio_conn_event_data *event_data)
+{
+	struct xio_task		*task  = event_data->chunk.task;
+	struct xio_connection	*connection;
+#ifndef __KERNEL__
+	struct xio_iovec	chunk;
+#endif
+
+	if (session == NULL)
+		session = xio_find_session(task);
+
+	connection = xio_session_find_connection(session, conn);
+	if (connection == NULL) {
+		ERROR_LOG("failed to find connection :%p. " \
+			  "dropping chunk\n", conn);
+		return -1;
+	}
+
+#ifndef __KERNEL__
+	chunk.iov_base	= event_data->chunk.data;
+	chunk.iov_len	= event_data->chunk.length;
+
+	if (connection->ses_ops.on_msg_data_chunk)
+		connection->ses_ops.on_msg_data_chunk(
+				session, &task->imsg,
+				event_data->chunk.offset, &chunk,
+				connection->cb_user_context);
+#endif
+	return 0;
+}
+
 /*---------------------------------------------------------------------------*/
 /* xio_on_cancel_request						     */
 /*---------------------------------------------------------------------------*/
@@ -1090,6 +1195,9 @@ int xio_on_cancel_response(struct xio_session *sess,
 	struct xio_connection		*connection;
 	struct xio_msg			msg;
 	struct xio_msg			*pmsg;
+	struct xio_msg			*tmo_msg = NULL;
+	int				expired = 0;
+	int				owed;
 
 
 	if (event_data->cancel.task == NULL) {
@@ -1108,6 +1216,8 @@ int xio_on_cancel_response(struct xio_session *sess,
 		pmsg		= &msg;		/* fake a message */
 		msg.sn		= hdr.sn;
 		msg.status	= 0;
+		msg.type	= XIO_MSG_TYPE_REQ;
+		msg.hedge	= NULL;
 	} else {
 		session		= event_data->cancel.task->session;
 		pmsg		= event_data->cancel.task->omsg;
@@ -1120,16 +1230,52 @@ int xio_on_cancel_response(struct xio_session *sess,
 		return -1;
 	}
 
+	/* cancels the library sent on deadline expiry or for a losing
+	 * hedge copy are not reported as such
+	 */
+	owed = xio_connection_cancel_answered(connection, hdr.sn);
+	if (event_data->cancel.task == NULL) {
+		xio_msg_list_foreach(tmo_msg, &connection->in_flight_reqs_msgq,
+				     pdata) {
+			if (tmo_msg->sn == hdr.sn)
+				break;
+		}
+		/* the request completed before the cancel arrived */
+		if (tmo_msg == NULL && owed)
+			return 0;
+	} else {
+		tmo_msg = pmsg;
+	}
+	if (tmo_msg && tmo_msg->tmo.state == XIO_MSG_TMO_EXPIRED) {
+		tmo_msg->tmo.state = XIO_MSG_TMO_NONE;
+		expired = 1;
+	}
+
 	/* need to release the last reference since answer is not expected */
-	if (event_data->cancel.result == XIO_E_MSG_CANCELED)
+	if (event_data->cancel.result == XIO_E_MSG_CANCELED &&
+	    event_data->cancel.task) {
 		xio_tasks_pool_put(event_data->cancel.task);
+		xio_connection_remove_in_flight(connection, pmsg);
+	}
+
+	if (tmo_msg && XIO_HEDGE_MSG(tmo_msg)) {
+		if (xio_hedge_on_cancel(connection, tmo_msg,
+					event_data->cancel.result,
+					event_data->cancel.task == NULL))
+			return 0;
+		pmsg = tmo_msg;
+	}
+
+	if (expired) {
+		if (event_data->cancel.result == XIO_E_MSG_CANCELED)
+			xio_session_notify_msg_error(connection, tmo_msg,
+						     XIO_E_TIMEOUT);
+		return 0;
+	}
 
 	if (connection->ses_ops.on_cancel)
-		connection->ses_ops.on_cancel(
-				session,
-				pmsg,
-				event_data->cancel.result,
-				connection->cb_user_context);
+		xio_session_notify_cancel(connection, pmsg,
+					  event_data->cancel.result);
 	else
 		ERROR_LOG("cancel is not supported\n");
 
@@ -1356,6 +1502,13 @@ struct xio_connection *xio_get_connection(
 int xio_session_notify_cancel(struct xio_connection *connection,
 			      struct xio_msg *req, enum xio_status result)
 {
+	/* the copies of a hedged request are reported once */
+	if (XIO_HEDGE_MSG(req) && result == XIO_E_MSG_CANCELED) {
+		xio_hedge_on_failure(connection, req, result);
+		return 0;
+	}
+	connection = xio_connection_owner(connection);
+
 	/* notify the upper layer */
 	if (connection->ses_ops.on_cancel)
 		connection->ses_ops.on_cancel(
@@ -1372,6 +1525,13 @@ int xio_session_notify_cancel(struct xio_connection *connection,
 int xio_session_notify_msg_error(struct xio_connection *connection,
 				 struct xio_msg *msg, enum xio_status result)
 {
+	/* the copies of a hedged request are reported once */
+	if (XIO_HEDGE_MSG(msg)) {
+		xio_hedge_on_failure(connection, msg, result);
+		return 0;
+	}
+	connection = xio_connection_owner(connection);
+
 	/* notify the upper layer */
 	if (connection->ses_ops.on_msg_error)
 		connection->ses_ops.on_msg_error(
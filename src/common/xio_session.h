@@ -39,7 +39,6 @@
 #define XIO_SESSION_H
 
 #include "xio_hash.h"
-#include "sys/hashtable.h"
 
 /*---------------------------------------------------------------------------*/
 /* forward declarations			                                     */
@@ -73,7 +72,6 @@ struct xio_session {
 
 	struct list_head		sessions_list_entry;
 	struct list_head		connections_list;
-	HT_ENTRY(xio_session, xio_key_int32) sessions_htbl;
 
 	struct xio_session_ops		ses_ops;
 	struct xio_transport_msg_validators_cls	*validators_cls;
@@ -106,6 +104,7 @@ struct xio_session {
 	int				disable_teardown;
 	struct xio_connection		*lead_connection;
 	struct xio_connection		*redir_connection;
+	struct xio_connection		*last_connection; /* lookup hint */
 };
 
 /*---------------------------------------------------------------------------*/
@@ -192,6 +191,11 @@ static inline int xio_session_not_queueing(struct xio_session *session)
 	return session->session_flags & XIO_SESSION_FLAG_DONTQUEUE;
 }
 
+static inline int xio_session_is_resilient(struct xio_session *session)
+{
+	return session->session_flags & XIO_SESSION_FLAG_RESILIENT;
+}
+
 int xio_session_notify_cancel(struct xio_connection *connection,
 			      struct xio_msg *req, enum xio_status result);
 
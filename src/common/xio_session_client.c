@@ -128,6 +128,9 @@ int xio_on_connection_hello_rsp_recv(struct xio_connection *connection,
 	task->sender_task = NULL;
 	xio_tasks_pool_put(task);
 
+	if (connection->state == XIO_CONNECTION_STATE_RESUMING)
+		xio_resume_done(connection);
+
 	xio_connection_xmit_msgs(connection);
 
 	return 0;
@@ -528,6 +531,7 @@ int xio_on_setup_rsp_recv(struct xio_connection *connection,
 			xio_connection_set_conn(tmp_connection,
 						connection->conn);
 			connection->conn = NULL;
+			session->last_connection = NULL;
 			session->lead_connection = tmp_connection;
 
 			/* close the lead/redirected connection */
@@ -607,6 +611,9 @@ int xio_on_conn_refused(struct xio_session *session,
 {
 	struct xio_connection *connection;
 
+	if (xio_resume_on_conn_down(session, conn))
+		return 0;
+
 	/* enable the teardown */
 	session->disable_teardown  = 0;
 	session->lead_connection = NULL;
@@ -707,7 +714,7 @@ int xio_on_client_conn_established(struct xio_session *session,
 		session->disable_teardown = 0;
 
 		/* introduce the connection to the session */
-		xio_connection_send_hello_req(connection);
+		xio_connection_send_hello_req(connection, NULL);
 
 		/* set the new connection to online */
 		xio_connection_set_state(connection,
@@ -744,6 +751,9 @@ int xio_on_client_conn_established(struct xio_session *session,
 			  "connection:%p, session:%p, conn:%p\n",
 			   connection, connection->session,
 			   connection->conn);
+		/* a resumed connection waits for the hello answer */
+		if (connection->state == XIO_CONNECTION_STATE_RESUMING)
+			break;
 		/* now try to send */
 		xio_connection_set_state(connection,
 					 XIO_CONNECTION_STATE_ONLINE);
@@ -787,6 +797,9 @@ int xio_on_conn_event_client(void *observer, void *sender, int event,
 */
 		xio_on_assign_in_buf(session, conn, event_data);
 		break;
+	case XIO_CONN_EVENT_MESSAGE_CHUNK:
+		xio_on_msg_chunk(session, conn, event_data);
+		break;
 	case XIO_CONN_EVENT_CANCEL_REQUEST:
 		DEBUG_LOG("session: [notification] - cancel request. " \
 			 "session:%p, conn:%p\n", observer, sender);
@@ -897,6 +910,7 @@ struct xio_connection *xio_connect(struct xio_session  *session,
 				conn_idx,
 				conn_user_context);
 		session->lead_connection->conn = conn;
+		session->last_connection = NULL;
 
 		connection  = session->lead_connection;
 
@@ -955,7 +969,7 @@ struct xio_connection *xio_connect(struct xio_session  *session,
 		}
 		connection = tmp_connection;
 		if (session->state == XIO_SESSION_STATE_ONLINE)
-			xio_connection_send_hello_req(connection);
+			xio_connection_send_hello_req(connection, NULL);
 	}
 	mutex_unlock(&session->lock);
 
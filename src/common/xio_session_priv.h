@@ -91,6 +91,13 @@ int xio_on_assign_in_buf(struct xio_session *session,
 			 struct xio_conn *conn,
 			 union xio_conn_event_data *event_data);
 
+/*---------------------------------------------------------------------------*/
+/* xio_on_msg_chunk							     */
+/*---------------------------------------------------------------------------*/
+int xio_on_msg_chunk(struct xio_session *session,
+		     struct xio_conn *conn,
+		     union xio_conn_event_data *event_data);
+
 /*---------------------------------------------------------------------------*/
 /* xio_on_cancel_request						     */
 /*---------------------------------------------------------------------------*/
@@ -301,6 +308,8 @@ static inline void xio_connection_set_conn(struct xio_connection *connection,
 				      connection->session->session_id);
 	}
 
+	/* rebinding changes what a conn lookup resolves to */
+	connection->session->last_connection = NULL;
 	connection->conn = conn;
 }
 
@@ -597,6 +597,9 @@ int xio_on_conn_event_server(void *observer, void *sender, int event,
 */
 		xio_on_assign_in_buf(session, conn, event_data);
 		break;
+	case XIO_CONN_EVENT_MESSAGE_CHUNK:
+		xio_on_msg_chunk(session, conn, event_data);
+		break;
 	case XIO_CONN_EVENT_CANCEL_REQUEST:
 		DEBUG_LOG("session: [notification] - cancel request. " \
 			 "session:%p, conn:%p\n", observer, sender);
@@ -38,55 +38,22 @@
 #include "xio_os.h"
 #include "libxio.h"
 #include "xio_common.h"
-#include "xio_hash.h"
+#include "xio_id_table.h"
 #include "xio_observer.h"
 #include "xio_transport.h"
 #include "xio_task.h"
 #include "xio_session.h"
 #include "xio_sessions_store.h"
 
-static HT_HEAD(, xio_session, HASHTABLE_PRIME_SMALL)  sessions_store;
-static spinlock_t ss_lock;
-
-/*---------------------------------------------------------------------------*/
-/* sessions_store_add							     */
-/*---------------------------------------------------------------------------*/
-static int sessions_store_add(struct xio_session *session,
-			      uint32_t session_id)
-{
-	struct xio_session *s;
-	struct xio_key_int32  key = {
-		session_id
-	};
-	HT_LOOKUP(&sessions_store, &key, s, sessions_htbl);
-	if (s != NULL)
-		return -1;
-
-	HT_INSERT(&sessions_store, &key, session, sessions_htbl);
-
-	return 0;
-}
+static struct xio_id_table sessions_store;
+static spinlock_t ss_lock;	/* protects the session id provider */
 
 /*---------------------------------------------------------------------------*/
 /* xio_sessions_store_remove				                     */
 /*---------------------------------------------------------------------------*/
 int xio_sessions_store_remove(uint32_t session_id)
 {
-	struct xio_session *s;
-	struct xio_key_int32  key;
-
-	spin_lock(&ss_lock);
-	key.id = session_id;
-	HT_LOOKUP(&sessions_store, &key, s, sessions_htbl);
-	if (s == NULL) {
-		spin_unlock(&ss_lock);
-		return -1;
-	}
-
-	HT_REMOVE(&sessions_store, s, xio_session, sessions_htbl);
-	spin_unlock(&ss_lock);
-
-	return 0;
+	return xio_id_table_remove(&sessions_store, session_id);
 }
 
 /*---------------------------------------------------------------------------*/
@@ -94,15 +61,7 @@ int xio_sessions_store_remove(uint32_t session_id)
 /*---------------------------------------------------------------------------*/
 struct xio_session *xio_sessions_store_lookup(uint32_t session_id)
 {
-	struct xio_session *s;
-	struct xio_key_int32  key;
-
-	spin_lock(&ss_lock);
-	key.id = session_id;
-	HT_LOOKUP(&sessions_store, &key, s, sessions_htbl);
-	spin_unlock(&ss_lock);
-
-	return s;
+	return xio_id_table_lookup(&sessions_store, session_id);
 }
 
 /*---------------------------------------------------------------------------*/
@@ -112,14 +71,17 @@ int xio_sessions_store_add(struct xio_session *session,
 		uint32_t *session_id)
 {
 	static uint32_t sid;  /* = 0 global session provider */
+	uint32_t id;
 	int retval;
 
 	spin_lock(&ss_lock);
-	retval = sessions_store_add(session, sid);
-	if (retval == 0)
-		*session_id = sid++;
+	id = sid++;
 	spin_unlock(&ss_lock);
 
+	retval = xio_id_table_insert(&sessions_store, id, session);
+	if (retval == 0)
+		*session_id = id;
+
 	return retval;
 }
 
@@ -128,7 +90,8 @@ int xio_sessions_store_add(struct xio_session *session,
 /*---------------------------------------------------------------------------*/
 void sessions_store_construct(void)
 {
-	HT_INIT(&sessions_store, xio_int32_hash, xio_int32_cmp, xio_int32_cp);
+	if (xio_id_table_init(&sessions_store))
+		ERROR_LOG("sessions store construction failed\n");
 	spin_lock_init(&ss_lock);
 }
 
@@ -40,6 +40,7 @@
 
 #include "libxio.h"
 #include "xio_mbuf.h"
+#include "xio_trace.h"
 
 enum xio_task_state {
 	XIO_TASK_STATE_INIT,
@@ -56,6 +57,7 @@ typedef void (*release_task_fn)(struct kref *kref);
 /*---------------------------------------------------------------------------*/
 struct xio_task {
 	struct list_head	tasks_list_entry;
+	struct list_head	io_tasks_htbl_entry; /* connection's sn index */
 	void			*dd_data;
 	struct xio_mbuf		mbuf;
 	struct xio_task		*sender_task;  /* client only on receiver */
@@ -76,7 +78,8 @@ struct xio_task {
 	uint32_t		ltid;		/* local task id	*/
 	uint32_t		rtid;		/* remote task id	*/
 	uint32_t		omsg_flags;
-	uint32_t		pad;
+	uint32_t		imm_rsp;	/* response without header */
+	uint64_t		stamp[XIO_STAGE_LAST]; /* by the transport */
 	struct xio_msg		imsg;		/* message to the user */
 
 };
@@ -169,5 +172,24 @@ static inline struct xio_task *xio_tasks_pool_lookup(
 	return  ((id < q->max) ? q->array[id] : NULL);
 }
 
+/*---------------------------------------------------------------------------*/
+/* xio_task_trace - transport tracepoint, the sn comes from the message     */
+/*---------------------------------------------------------------------------*/
+static inline void xio_task_trace(struct xio_context *ctx,
+				  struct xio_task *task,
+				  uint32_t req_event, uint32_t rsp_event)
+{
+	if (likely(!xio_trace_on))
+		return;
+
+	if (IS_REQUEST(task->tlv_type))
+		xio_trace_record(ctx, req_event,
+				 task->omsg ? task->omsg->sn : 0,
+				 task->ltid, task->rtid);
+	else if (IS_RESPONSE(task->tlv_type))
+		xio_trace_record(ctx, rsp_event, task->imsg.sn,
+				 task->ltid, task->rtid);
+}
+
 #endif
 
@@ -0,0 +1,177 @@
+/*
+ * Copyright (c) 2013 Mellanox Technologies®. All rights reserved.
+ *
+ * This software is available to you under a choice of one of two licenses.
+ * You may choose to be licensed under the terms of the GNU General Public
+ * License (GPL) Version 2, available from the file COPYING in the main
+ * directory of this source tree, or the Mellanox Technologies® BSD license
+ * below:
+ *
+ *      - Redistribution and use in source and binary forms, with or without
+ *        modification, are permitted provided that the following conditions
+ *        are met:
+ *
+ *      - Redistributions of source code must retain the above copyright
+ *        notice, this list of conditions and the following disclaimer.
+ *
+ *      - Redistributions in binary form must reproduce the above
+ *        copyright notice, this list of conditions and the following
+ *        disclaimer in the documentation and/or other materials
+ *        provided with the distribution.
+ *
+ *      - Neither the name of the Mellanox Technologies® nor the names of its
+ *        contributors may be used to endorse or promote products derived from
+ *        this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+#include "xio_os.h"
+#include "libxio.h"
+#include "xio_common.h"
+#include "xio_observer.h"
+#include "xio_context.h"
+#include "xio_trace.h"
+
+int xio_trace_on;
+
+static struct xio_trace_attr trace_attr;
+
+/*---------------------------------------------------------------------------*/
+/* xio_trace_set_attr							     */
+/*---------------------------------------------------------------------------*/
+int xio_trace_set_attr(const struct xio_trace_attr *attr)
+{
+	if (attr->ring_size & (attr->ring_size - 1)) {
+		xio_set_error(EINVAL);
+		ERROR_LOG("trace ring size %u is not a power of 2\n",
+			  attr->ring_size);
+		return -1;
+	}
+	trace_attr = *attr;
+	ACCESS_ONCE(xio_trace_on) = !!attr->enable;
+
+	return 0;
+}
+
+/*---------------------------------------------------------------------------*/
+/* xio_trace_get_attr							     */
+/*---------------------------------------------------------------------------*/
+int xio_trace_get_attr(struct xio_trace_attr *attr)
+{
+	*attr = trace_attr;
+
+	return 0;
+}
+
+/*---------------------------------------------------------------------------*/
+/* xio_trace_ctx_init							     */
+/*---------------------------------------------------------------------------*/
+int xio_trace_ctx_init(struct xio_context *ctx)
+{
+	struct xio_trace_ring	*ring;
+	uint32_t		size = trace_attr.ring_size;
+
+	if (!size)
+		return 0;
+
+	ring = kcalloc(1, sizeof(*ring) + size * sizeof(ring->rec[0]),
+		       GFP_KERNEL);
+	if (!ring) {
+		xio_set_error(ENOMEM);
+		ERROR_LOG("trace ring allocation failed\n");
+		return -1;
+	}
+	ring->mask = size - 1;
+	ctx->trace = ring;
+
+	return 0;
+}
+
+/*---------------------------------------------------------------------------*/
+/* xio_trace_ctx_close							     */
+/*---------------------------------------------------------------------------*/
+void xio_trace_ctx_close(struct xio_context *ctx)
+{
+	kfree(ctx->trace);
+	ctx->trace = NULL;
+}
+
+/*---------------------------------------------------------------------------*/
+/* xio_trace_record							     */
+/*---------------------------------------------------------------------------*/
+void xio_trace_record(struct xio_context *ctx, uint32_t event,
+		      uint64_t sn, uint32_t ltid, uint32_t rtid)
+{
+	struct xio_trace_ring	*ring = ctx->trace;
+	struct xio_trace_rec	*rec;
+
+	if (!ring)
+		return;
+
+	rec		= &ring->rec[ring->head & ring->mask];
+	rec->cycles	= get_cycles();
+	rec->sn		= sn;
+	rec->ltid	= ltid;
+	rec->rtid	= rtid;
+	rec->event	= event;
+	rec->reserved	= 0;
+
+	/* a reader that sees the new head sees the record */
+	smp_wmb();
+	ACCESS_ONCE(ring->head) = ring->head + 1;
+}
+
+/*---------------------------------------------------------------------------*/
+/* xio_context_get_trace						     */
+/*---------------------------------------------------------------------------*/
+int xio_context_get_trace(struct xio_context *ctx,
+			  struct xio_trace_rec *recs, int nrecs)
+{
+	struct xio_trace_ring	*ring;
+	uint64_t		first, last, head;
+	uint64_t		i;
+	int			n = 0;
+
+	if (!ctx || (!recs && nrecs)) {
+		xio_set_error(EINVAL);
+		return -1;
+	}
+	ring = ctx->trace;
+	if (!ring || !nrecs)
+		return 0;
+
+	/* copy without stopping the writer, then drop whatever it
+	 * overwrote meanwhile
+	 */
+	last = ACCESS_ONCE(ring->head);
+	smp_rmb();
+	first = last > ring->mask ? last - ring->mask - 1 : 0;
+	if (last - first > (uint64_t)nrecs)
+		first = last - nrecs;
+	for (i = first; i < last; i++)
+		recs[n++] = ring->rec[i & ring->mask];
+	smp_rmb();
+	head = ACCESS_ONCE(ring->head);
+
+	/* the slot of record head is being written as well */
+	if (head + 1 > first + ring->mask + 1) {
+		uint64_t lost = head + 1 - (first + ring->mask + 1);
+
+		if (lost >= (uint64_t)n)
+			return 0;
+		memmove(recs, recs + lost, (n - lost) * sizeof(*recs));
+		n -= lost;
+	}
+
+	return n;
+}
@@ -0,0 +1,80 @@
+/*
+ * Copyright (c) 2013 Mellanox Technologies®. All rights reserved.
+ *
+ * This software is available to you under a choice of one of two licenses.
+ * You may choose to be licensed under the terms of the GNU General Public
+ * License (GPL) Version 2, available from the file COPYING in the main
+ * directory of this source tree, or the Mellanox Technologies® BSD license
+ * below:
+ *
+ *      - Redistribution and use in source and binary forms, with or without
+ *        modification, are permitted provided that the following conditions
+ *        are met:
+ *
+ *      - Redistributions of source code must retain the above copyright
+ *        notice, this list of conditions and the following disclaimer.
+ *
+ *      - Redistributions in binary form must reproduce the above
+ *        copyright notice, this list of conditions and the following
+ *        disclaimer in the documentation and/or other materials
+ *        provided with the distribution.
+ *
+ *      - Neither the name of the Mellanox Technologies® nor the names of its
+ *        contributors may be used to endorse or promote products derived from
+ *        this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+#ifndef XIO_TRACE_H
+#define XIO_TRACE_H
+
+/*---------------------------------------------------------------------------*/
+/* task lifecycle tracepoints. each context owns a ring of fixed size	     */
+/* records written only by its thread; the oldest records are overwritten. */
+/* with tracing off a tracepoint costs a load and a not taken branch	     */
+/*---------------------------------------------------------------------------*/
+struct xio_trace_ring {
+	uint64_t			head;	/* records ever written */
+	uint32_t			mask;
+	uint32_t			pad;
+	struct xio_trace_rec		rec[0];
+};
+
+extern int xio_trace_on;
+
+void xio_trace_record(struct xio_context *ctx, uint32_t event,
+		      uint64_t sn, uint32_t ltid, uint32_t rtid);
+
+/*---------------------------------------------------------------------------*/
+/* xio_trace								     */
+/*---------------------------------------------------------------------------*/
+static inline void xio_trace(struct xio_context *ctx, uint32_t event,
+			     uint64_t sn, uint32_t ltid, uint32_t rtid)
+{
+	if (unlikely(xio_trace_on))
+		xio_trace_record(ctx, event, sn, ltid, rtid);
+}
+
+/*---------------------------------------------------------------------------*/
+/* xio_trace_set_attr							     */
+/*---------------------------------------------------------------------------*/
+int xio_trace_set_attr(const struct xio_trace_attr *attr);
+int xio_trace_get_attr(struct xio_trace_attr *attr);
+
+/*---------------------------------------------------------------------------*/
+/* xio_trace_ctx_init - give a new context a ring if tracing is configured  */
+/*---------------------------------------------------------------------------*/
+int xio_trace_ctx_init(struct xio_context *ctx);
+void xio_trace_ctx_close(struct xio_context *ctx);
+
+#endif /* XIO_TRACE_H */
@@ -52,6 +52,7 @@ struct xio_tasks_pool_ops;
 /*---------------------------------------------------------------------------*/
 enum xio_transport_event {
 	XIO_TRANSPORT_NEW_CONNECTION,
+	XIO_TRANSPORT_ACCEPT_CTX,
 	XIO_TRANSPORT_ESTABLISHED,
 	XIO_TRANSPORT_DISCONNECTED,
 	XIO_TRANSPORT_CLOSED,
@@ -59,6 +60,7 @@ enum xio_transport_event {
 	XIO_TRANSPORT_NEW_MESSAGE,
 	XIO_TRANSPORT_SEND_COMPLETION,
 	XIO_TRANSPORT_ASSIGN_IN_BUF,
+	XIO_TRANSPORT_MESSAGE_CHUNK,
 	XIO_TRANSPORT_CANCEL_REQUEST,
 	XIO_TRANSPORT_CANCEL_RESPONSE,
 	XIO_TRANSPORT_MESSAGE_ERROR,
@@ -81,8 +83,14 @@ union xio_transport_event_data {
 	struct {
 		struct xio_task	 *task;
 		int		 is_assigned;
-		int		 pad;
+		int		 is_streamed;	/* in: stream is possible */
 	} assign_in_buf;
+	struct {
+		struct xio_task	 *task;
+		void		 *data;
+		size_t		 offset;
+		size_t		 length;
+	} chunk;
 	struct {
 		void		*ulp_msg;
 		size_t		ulp_msg_sz;
@@ -93,6 +101,12 @@ union xio_transport_event_data {
 	struct {
 		struct xio_transport_base	*child_trans_hndl;
 	} new_connection;
+	struct {
+		struct sockaddr_storage		*peer_addr;
+		struct xio_context		*ctx;	/* out: NULL - local */
+		int				release; /* hand back ctx */
+		int				pad;
+	} accept_ctx;
 	struct {
 		uint32_t	cid;
 	} established;
@@ -114,7 +128,7 @@ struct xio_transport_base {
 	char				*portal_uri;
 	struct sockaddr_storage		peer_addr;
 	enum   xio_proto		proto;
-	int				pad;
+	int				tx_window; /* max reqs in flight */
 };
 
 struct xio_transport_msg_validators_cls {
@@ -191,6 +205,10 @@ struct xio_transport {
 
 	int	(*accept)(struct xio_transport_base *trans_hndl);
 
+	/* let ctx run connections accepted by another context's listener */
+	int	(*attach_ctx)(struct xio_transport_base *trans_hndl,
+			      struct xio_context *ctx);
+
 	int	(*poll)(struct xio_transport_base *trans_hndl,
 			long min_nr, long nr,
 			struct timespec *timeout);
@@ -216,6 +234,10 @@ struct xio_transport {
 			      struct xio_task *task, enum xio_status result,
 			      void *ulp_msg, size_t ulp_msg_len);
 
+	/* queue gauges, optional */
+	int	(*get_stats)(struct xio_transport_base *trans_hndl,
+			     struct xio_transport_stats *stats);
+
 	struct list_head transports_list_entry;
 };
 
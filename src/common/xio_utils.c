@@ -39,6 +39,7 @@
 #include "libxio.h"
 #include "xio_common.h"
 #include "xio_protocol.h"
+#include "xio_mem.h"
 
 
 /*---------------------------------------------------------------------------*/
@@ -234,30 +235,6 @@ inline size_t xio_iovex_length(const struct xio_iovec_ex *iov,
 	return nbytes;
 }
 
-/*
-void *xio_memcpy(void* dest, const void* src, size_t count)
-{
-	char* dst8 = (char*)dest;
-	char* src8 = (char*)src;
-
-	if (count & 1) {
-		dst8[0] = src8[0];
-		dst8 += 1;
-		src8 += 1;
-	}
-
-	count /= 2;
-	while (count--) {
-		dst8[0] = src8[0];
-		dst8[1] = src8[1];
-
-		dst8 += 2;
-		src8 += 2;
-	}
-	return dest;
-}
-
-*/
 
 
 /**
@@ -291,7 +268,84 @@ size_t memcpyv(struct xio_iovec *dst, int dsize,
 
 	while (1) {
 		if (slen < dlen) {
-			memcpy(daddr, saddr, slen);
+			xio_memcpy(daddr, saddr, slen);
+			dst_len	+= slen;
+
+			s++;
+			if (s == ssize) {
+				dst[d].iov_len = dst_len;
+				d++;
+				break;
+			}
+			dlen	-= slen;
+			daddr	+= slen;
+			saddr	= src[s].iov_base;
+			slen	= src[s].iov_len;
+		} else if (dlen < slen) {
+			xio_memcpy(daddr, saddr, dlen);
+			dst[d].iov_len = dst_len + dlen;
+			dst_len = 0;
+
+			d++;
+			if (d == dsize)
+				break;
+			slen	-= dlen;
+			saddr	+= dlen;
+			daddr	= dst[d].iov_base;
+			dlen	= dst[d].iov_len;
+
+		} else {
+			xio_memcpy(daddr, saddr, dlen);
+			dst[d].iov_len = dst_len + dlen;
+			dst_len = 0;
+
+			d++;
+			s++;
+			if ((d == dsize) || (s == ssize))
+				break;
+
+			daddr	= dst[d].iov_base;
+			dlen	= dst[d].iov_len;
+			saddr	= src[s].iov_base;
+			slen	= src[s].iov_len;
+		}
+	}
+
+	/* not enough buffers to complete */
+	if (s < ssize) {
+		ERROR_LOG("dest iovec exausted\n");
+		return 0;
+	}
+
+	return d;
+}
+
+/*---------------------------------------------------------------------------*/
+/* memcpyv_ex								     */
+/*---------------------------------------------------------------------------*/
+/*
+ * same as memcpyv but for extended io vectors
+ */
+size_t memcpyv_ex(struct xio_iovec_ex *dst, int dsize,
+		  struct xio_iovec_ex *src, int ssize)
+{
+	void		*daddr	= dst[0].iov_base;
+	void		*saddr	= src[0].iov_base;
+	size_t		dlen	= dst[0].iov_len;
+	size_t		slen	= src[0].iov_len;
+	size_t		d	= 0,
+			s	= 0,
+			dst_len = 0;
+
+	if (dsize < 1 || ssize < 1) {
+		ERROR_LOG("iovec size < 1 dsize:%d, ssize:%d\n",
+			  dsize, ssize);
+		return 0;
+	}
+
+	while (1) {
+		if (slen < dlen) {
+			xio_memcpy(daddr, saddr, slen);
 			dst_len	+= slen;
 
 			s++;
@@ -305,7 +359,7 @@ size_t memcpyv(struct xio_iovec *dst, int dsize,
 			saddr	= src[s].iov_base;
 			slen	= src[s].iov_len;
 		} else if (dlen < slen) {
-			memcpy(daddr, saddr, dlen);
+			xio_memcpy(daddr, saddr, dlen);
 			dst[d].iov_len = dst_len + dlen;
 			dst_len = 0;
 
@@ -318,7 +372,7 @@ size_t memcpyv(struct xio_iovec *dst, int dsize,
 			dlen	= dst[d].iov_len;
 
 		} else {
-			memcpy(daddr, saddr, dlen);
+			xio_memcpy(daddr, saddr, dlen);
 			dst[d].iov_len = dst_len + dlen;
 			dst_len = 0;
 
@@ -343,3 +397,36 @@ size_t memcpyv(struct xio_iovec *dst, int dsize,
 	return d;
 }
 
+/*---------------------------------------------------------------------------*/
+/* memclonev_ex								     */
+/*---------------------------------------------------------------------------*/
+size_t memclonev_ex(struct xio_iovec_ex *dst, int dsize,
+		    struct xio_iovec_ex *src, int ssize)
+{
+	int			nr = 0;
+	int			sz;
+
+	sz = (dsize < ssize) ? dsize : ssize;
+
+	while (nr < sz) {
+		dst[nr].iov_base = src[nr].iov_base;
+		dst[nr].iov_len = src[nr].iov_len;
+		nr++;
+	}
+
+	return sz;
+}
+
+/*---------------------------------------------------------------------------*/
+/* xio_vmsg_set_data_iovlen						     */
+/*---------------------------------------------------------------------------*/
+void xio_vmsg_set_data_iovlen(struct xio_vmsg *vmsg, size_t iovlen)
+{
+	/* shrinking external vector is moved into the embedded array */
+	if (vmsg->data_iovlen > XIO_MAX_IOV && iovlen <= XIO_MAX_IOV)
+		memcpy(vmsg->data_iov, vmsg->pdata_iov,
+		       iovlen * sizeof(struct xio_iovec_ex));
+
+	vmsg->data_iovlen = iovlen;
+}
+
@@ -327,6 +327,8 @@ static int xio_rdma_xmit(struct xio_rdma_transport *rdma_hndl)
 			rdma_hndl->reqs_in_flight_nr++;
 		else
 			rdma_hndl->rsps_in_flight_nr++;
+		xio_task_trace(rdma_hndl->base.ctx, task,
+			       XIO_TRACE_XMIT_REQ, XIO_TRACE_XMIT_RSP);
 		list_move_tail(&task->tasks_list_entry,
 			       &rdma_hndl->in_flight_list);
 		if (req_nr == 16)
@@ -777,6 +779,8 @@ static int xio_rdma_tx_comp_handler(struct xio_rdma_transport *rdma_hndl,
 		if (rdma_task->ib_op == XIO_IB_RDMA_WRITE)
 			rdma_hndl->sqe_avail++;
 
+		xio_task_trace(rdma_hndl->base.ctx, ptask,
+			       XIO_TRACE_TX_COMP_REQ, XIO_TRACE_TX_COMP_RSP);
 		if (IS_REQUEST(ptask->tlv_type)) {
 			rdma_hndl->max_sn++;
 			rdma_hndl->reqs_in_flight_nr--;
@@ -1463,9 +1467,9 @@ static int xio_rdma_write_req_header(struct xio_rdma_transport *rdma_hndl,
 	/* credits	shall be coded later */
 	PACK_SVAL(req_hdr, tmp_req_hdr, tid);
 	tmp_req_hdr->opcode	   = req_hdr->opcode;
-	tmp_req_hdr->recv_num_sge  = req_hdr->recv_num_sge;
-	tmp_req_hdr->read_num_sge  = req_hdr->read_num_sge;
-	tmp_req_hdr->write_num_sge = req_hdr->write_num_sge;
+	PACK_SVAL(req_hdr, tmp_req_hdr, recv_num_sge);
+	PACK_SVAL(req_hdr, tmp_req_hdr, read_num_sge);
+	PACK_SVAL(req_hdr, tmp_req_hdr, write_num_sge);
 
 	PACK_SVAL(req_hdr, tmp_req_hdr, ulp_hdr_len);
 	PACK_SVAL(req_hdr, tmp_req_hdr, ulp_pad_len);
@@ -1545,6 +1549,12 @@ static int xio_rdma_read_req_header(struct xio_rdma_transport *rdma_hndl,
 	req_hdr->flags    = tmp_req_hdr->flags;
 	UNPACK_SVAL(tmp_req_hdr, req_hdr, req_hdr_len);
 
+	if (req_hdr->version != XIO_REQ_HEADER_VERSION) {
+		ERROR_LOG("request header version mismatch. " \
+			  "arrived:%d  expected:%d\n",
+			  req_hdr->version, XIO_REQ_HEADER_VERSION);
+		return -1;
+	}
 	if (req_hdr->req_hdr_len != sizeof(struct xio_req_hdr)) {
 		ERROR_LOG(
 		"header length's read failed. arrived:%d  expected:%zud\n",
@@ -1555,9 +1565,19 @@ static int xio_rdma_read_req_header(struct xio_rdma_transport *rdma_hndl,
 	UNPACK_SVAL(tmp_req_hdr, req_hdr, credits);
 	UNPACK_SVAL(tmp_req_hdr, req_hdr, tid);
 	req_hdr->opcode		= tmp_req_hdr->opcode;
-	req_hdr->recv_num_sge	= tmp_req_hdr->recv_num_sge;
-	req_hdr->read_num_sge	= tmp_req_hdr->read_num_sge;
-	req_hdr->write_num_sge	= tmp_req_hdr->write_num_sge;
+	UNPACK_SVAL(tmp_req_hdr, req_hdr, recv_num_sge);
+	UNPACK_SVAL(tmp_req_hdr, req_hdr, read_num_sge);
+	UNPACK_SVAL(tmp_req_hdr, req_hdr, write_num_sge);
+
+	/* the kernel keeps no extended scatter gather lists */
+	if (req_hdr->recv_num_sge > XIO_MAX_IOV ||
+	    req_hdr->read_num_sge > XIO_MAX_IOV ||
+	    req_hdr->write_num_sge > XIO_MAX_IOV) {
+		ERROR_LOG("too many sges. recv:%d read:%d write:%d max:%d\n",
+			  req_hdr->recv_num_sge, req_hdr->read_num_sge,
+			  req_hdr->write_num_sge, XIO_MAX_IOV);
+		return -1;
+	}
 
 	UNPACK_SVAL(tmp_req_hdr, req_hdr, ulp_hdr_len);
 	UNPACK_SVAL(tmp_req_hdr, req_hdr, ulp_pad_len);
@@ -2321,6 +2341,8 @@ static int xio_rdma_on_recv_rsp(struct xio_rdma_transport *rdma_hndl,
 	rdma_sender_task = task->sender_task->dd_data;
 
 	omsg = task->sender_task->omsg;
+	xio_trace(rdma_hndl->base.ctx, XIO_TRACE_RECV_RSP, omsg->sn,
+		  task->sender_task->ltid, 0);
 	imsg = &task->imsg;
 
 	ulp_hdr = xio_mbuf_get_curr_ptr(&task->mbuf);
@@ -2740,6 +2762,8 @@ static int xio_rdma_on_recv_req(struct xio_rdma_transport *rdma_hndl,
 
 	/* save originator identifier */
 	task->rtid		= req_hdr.tid;
+	xio_trace(rdma_hndl->base.ctx, XIO_TRACE_RECV_REQ, 0,
+		  task->ltid, task->rtid);
 	task->imsg.more_in_batch = rdma_task->more_in_batch;
 
 	imsg = &task->imsg;
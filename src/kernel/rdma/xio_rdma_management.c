@@ -1858,6 +1858,7 @@ static int xio_rdma_is_valid_in_req(struct xio_msg *msg)
 	struct xio_vmsg *vmsg = &msg->in;
 	int		i;
 
+	/* no extended lists (pdata_iov) in the kernel */
 	if (vmsg->data_iovlen >= XIO_MAX_IOV)
 		return 0;
 
@@ -1882,6 +1883,7 @@ static int xio_rdma_is_valid_out_msg(struct xio_msg *msg)
 	struct xio_vmsg *vmsg = &msg->out;
 	int		i;
 
+	/* no extended lists (pdata_iov) in the kernel */
 	if (vmsg->data_iovlen >= XIO_MAX_IOV)
 		return 0;
 
@@ -123,8 +123,11 @@ struct xio_sge {
 	u32	stag;		/* r_key	   */
 };
 
-#define XIO_REQ_HEADER_VERSION	1
+#define XIO_REQ_HEADER_VERSION	2
 
+/* same layout as user space. the counts are 16 bit on the wire but the
+ * kernel still accepts at most XIO_MAX_IOV descriptors of each kind
+ */
 struct __attribute__((__packed__)) xio_req_hdr {
 	uint8_t			version;	/* request version	*/
 	uint8_t			flags;
@@ -135,12 +138,15 @@ struct __attribute__((__packed__)) xio_req_hdr {
 	uint16_t		credits;	/* peer send credits	*/
 	uint16_t		tid;		/* originator identifier*/
 	uint8_t			opcode;		/* opcode  for peers	*/
-	uint8_t			recv_num_sge;
-	uint8_t			read_num_sge;
-	uint8_t			write_num_sge;
+	uint8_t			pad;
 
+	uint16_t		recv_num_sge;
+	uint16_t		read_num_sge;
+	uint16_t		write_num_sge;
 	uint16_t		ulp_hdr_len;	/* ulp header length	*/
+
 	uint16_t		ulp_pad_len;	/* pad_len length	*/
+	uint16_t		pad1;
 	uint32_t		remain_data_len;/* remaining data length */
 	uint64_t		ulp_imm_len;	/* ulp data length	*/
 };
@@ -122,6 +122,9 @@ struct xio_context *xio_context_create(unsigned int flags,
 	ctx->cpuid  = cpu_hint;
 	ctx->nodeid = cpu_to_node(cpu_hint);
 	ctx->polling_timeout = polling_timeout;
+	if (xio_trace_ctx_init(ctx))
+		goto cleanup1;
+
 	ctx->sched_work = xio_schedwork_init(ctx);
 	if (!ctx->sched_work) {
 		xio_set_error(ENOMEM);
@@ -152,6 +155,7 @@ struct xio_context *xio_context_create(unsigned int flags,
 	if (!ctx->ev_loop)
 		goto cleanup2;
 
+	ctx->stats.counter = ctx->stats.own;
 	ctx->stats.hertz = HZ;
 	/* Init default counters' name */
 	ctx->stats.name[XIO_STAT_TX_MSG]   = kstrdup("TX_MSG", GFP_KERNEL);
@@ -160,6 +164,9 @@ struct xio_context *xio_context_create(unsigned int flags,
 	ctx->stats.name[XIO_STAT_RX_BYTES] = kstrdup("RX_BYTES", GFP_KERNEL);
 	ctx->stats.name[XIO_STAT_DELAY]    = kstrdup("DELAY", GFP_KERNEL);
 	ctx->stats.name[XIO_STAT_APPDELAY] = kstrdup("APPDELAY", GFP_KERNEL);
+	ctx->stats.name[XIO_STAT_CREDIT_STALLS] =
+					kstrdup("CREDIT_STALLS", GFP_KERNEL);
+	ctx->stats.name[XIO_STAT_NOP_TX]   = kstrdup("NOP_TX", GFP_KERNEL);
 
 	return ctx;
 
@@ -167,6 +174,7 @@ cleanup2:
 	xio_schedwork_close(ctx->sched_work);
 
 cleanup1:
+	xio_trace_ctx_close(ctx);
 	kfree(ctx);
 
 cleanup0:
@@ -198,6 +206,7 @@ void xio_context_destroy(struct xio_context *ctx)
 
 	ctx->ev_loop = NULL;
 
+	xio_trace_ctx_close(ctx);
 	kfree(ctx);
 }
 
@@ -257,6 +266,42 @@ int xio_context_add_event(struct xio_context *ctx, struct xio_ev_data *data)
 	return ev_loop->add_event(ev_loop->loop_object, data);
 }
 
+struct xio_ctx_work_ev {
+	struct xio_ev_data	ev_data;
+	struct xio_ctx_work	*work;
+};
+
+/*---------------------------------------------------------------------------*/
+/* xio_context_work_handler						     */
+/*---------------------------------------------------------------------------*/
+static void xio_context_work_handler(void *data)
+{
+	struct xio_ctx_work_ev	*wev = data;
+	struct xio_ctx_work	*work = wev->work;
+
+	kfree(wev);
+	work->handler(work->data);
+}
+
+/*---------------------------------------------------------------------------*/
+/* xio_context_add_work							     */
+/*---------------------------------------------------------------------------*/
+int xio_context_add_work(struct xio_context *ctx, struct xio_ctx_work *work)
+{
+	struct xio_ctx_work_ev	*wev;
+
+	wev = kzalloc(sizeof(*wev), GFP_ATOMIC);
+	if (!wev) {
+		xio_set_error(ENOMEM);
+		return -1;
+	}
+	wev->ev_data.handler	= xio_context_work_handler;
+	wev->ev_data.data	= wev;
+	wev->work		= work;
+
+	return xio_context_add_event(ctx, &wev->ev_data);
+}
+
 /*---------------------------------------------------------------------------*/
 /* xio_ctx_timer_add                                                         */
 /*---------------------------------------------------------------------------*/
@@ -47,6 +47,8 @@
 #include "xio_conn.h"
 #include "xio_context.h"
 
+void xio_connection_construct(void);
+
 MODULE_AUTHOR("Eyal Solomon, Shlomo Pongratz");
 MODULE_DESCRIPTION("XIO generic part "
 	   "v" DRV_VERSION " (" DRV_RELDATE ")");
@@ -60,6 +62,7 @@ static int __init xio_init_module(void)
 {
 	sessions_store_construct();
 	conns_store_construct();
+	xio_connection_construct();
 
 	return 0;
 }
@@ -106,11 +109,25 @@ EXPORT_SYMBOL(xio_session_event_str);
 EXPORT_SYMBOL(xio_bind);
 EXPORT_SYMBOL(xio_accept);
 EXPORT_SYMBOL(xio_unbind);
+EXPORT_SYMBOL(xio_bind_worker);
+EXPORT_SYMBOL(xio_unbind_worker);
+EXPORT_SYMBOL(xio_set_accept_policy);
 EXPORT_SYMBOL(xio_connect);
 EXPORT_SYMBOL(xio_disconnect);
 
 EXPORT_SYMBOL(xio_get_connection);
 EXPORT_SYMBOL(xio_connection_destroy);
+EXPORT_SYMBOL(xio_connection_migrate);
+EXPORT_SYMBOL(xio_rebalancer_create);
+EXPORT_SYMBOL(xio_rebalancer_destroy);
+EXPORT_SYMBOL(xio_rebalancer_add_ctx);
+EXPORT_SYMBOL(xio_rebalancer_del_ctx);
+EXPORT_SYMBOL(xio_connection_get_latency);
+EXPORT_SYMBOL(xio_context_get_latency);
+EXPORT_SYMBOL(xio_context_reset_latency);
+EXPORT_SYMBOL(xio_context_get_trace);
+EXPORT_SYMBOL(xio_trace_on);
+EXPORT_SYMBOL(xio_trace_record);
 
 EXPORT_SYMBOL(xio_send_request);
 EXPORT_SYMBOL(xio_send_response);
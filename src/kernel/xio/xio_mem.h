@@ -54,6 +54,12 @@ static inline void xio_disable_huge_pages(int disable)
 		return;
 	disable_huge_pages = disable;
 }
+
+static inline void *xio_memcpy(void *dst, const void *src, size_t len)
+{
+	return memcpy(dst, src, len);
+}
+
 static inline int xio_set_mem_allocator(struct xio_mem_allocator *allocator) {
 	if (allocator_assigned)
 		return -1;
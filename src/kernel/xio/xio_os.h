@@ -45,6 +45,7 @@
 #include <linux/slab.h>
 #include <linux/list.h>
 #include <linux/llist.h>
+#include <linux/srcu.h>
 
 #include <linux/net.h>
 #include <linux/in.h>
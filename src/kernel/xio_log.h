@@ -92,4 +92,14 @@ static inline int xio_set_log_fn(void * /*xio_log_fn*/ fn)
 	return -1;
 }
 
+static inline int xio_log_set_attr(const struct xio_log_attr *attr)
+{
+	return -1;
+}
+
+static inline int xio_log_get_attr(struct xio_log_attr *attr)
+{
+	return -1;
+}
+
 #endif /* XIO_LOG_H */
@@ -0,0 +1,122 @@
+#ifndef _LINUX_SRCU_H
+#define _LINUX_SRCU_H
+
+/*---------------------------------------------------------------------------*/
+/* user space stand-in for the kernel's sleepable RCU.			     */
+/* readers bump a counter of the current epoch in a per-cpu slot, writers   */
+/* flip the epoch twice and wait for each side to drain. each slot owns a   */
+/* cache line so readers running on different cpus never share one.	     */
+/*---------------------------------------------------------------------------*/
+#define SRCU_NR_SLOTS		64
+#define SRCU_CACHE_LINE		64
+
+#ifndef smp_mb
+#define smp_mb()		__sync_synchronize()
+#endif
+
+#ifndef smp_rmb
+#define smp_rmb()		__atomic_thread_fence(__ATOMIC_ACQUIRE)
+#endif
+
+#ifndef smp_wmb
+#define smp_wmb()		__atomic_thread_fence(__ATOMIC_RELEASE)
+#endif
+
+#ifndef ACCESS_ONCE
+#define ACCESS_ONCE(x)		(*(volatile typeof(x) *)&(x))
+#endif
+
+#define rcu_assign_pointer(p, v)	__atomic_store_n(&(p), (v),	\
+							 __ATOMIC_RELEASE)
+
+#define srcu_dereference(p, sp)		__atomic_load_n(&(p),		\
+							__ATOMIC_CONSUME)
+
+struct srcu_slot {
+	volatile long		c[2];
+	char			pad[SRCU_CACHE_LINE - 2 * sizeof(long)];
+};
+
+struct srcu_struct {
+	struct srcu_slot	*slot;
+	volatile unsigned int	completed;
+	int			pad;
+	pthread_mutex_t		mutex;	/* serializes synchronize_srcu */
+};
+
+static inline int init_srcu_struct(struct srcu_struct *sp)
+{
+	void *slot;
+
+	if (posix_memalign(&slot, SRCU_CACHE_LINE,
+			   SRCU_NR_SLOTS * sizeof(struct srcu_slot)))
+		return -ENOMEM;
+
+	memset(slot, 0, SRCU_NR_SLOTS * sizeof(struct srcu_slot));
+	sp->slot = slot;
+	sp->completed = 0;
+	pthread_mutex_init(&sp->mutex, NULL);
+
+	return 0;
+}
+
+static inline void cleanup_srcu_struct(struct srcu_struct *sp)
+{
+	pthread_mutex_destroy(&sp->mutex);
+	free(sp->slot);
+	sp->slot = NULL;
+}
+
+static inline int srcu_read_lock(struct srcu_struct *sp)
+{
+	int cpu = sched_getcpu();
+	int idx;
+
+	cpu = (cpu < 0) ? 0 : (cpu & (SRCU_NR_SLOTS - 1));
+	idx = sp->completed & 1;
+	/* full barrier - the protected loads cannot move above it */
+	__sync_fetch_and_add(&sp->slot[cpu].c[idx], 1);
+
+	return (cpu << 1) | idx;
+}
+
+static inline void srcu_read_unlock(struct srcu_struct *sp, int idx)
+{
+	__sync_fetch_and_sub(&sp->slot[idx >> 1].c[idx & 1], 1);
+}
+
+static inline void srcu_wait_idx(struct srcu_struct *sp, unsigned int idx)
+{
+	long	sum;
+	int	i;
+
+	do {
+		sum = 0;
+		for (i = 0; i < SRCU_NR_SLOTS; i++)
+			sum += sp->slot[i].c[idx];
+		if (sum)
+			sched_yield();
+	} while (sum);
+}
+
+static inline void synchronize_srcu(struct srcu_struct *sp)
+{
+	unsigned int	idx;
+	int		flip;
+
+	/* a reader may sample the index and count itself on it only after
+	 * a single flip was waited out, so flip twice and drain each side
+	 */
+	pthread_mutex_lock(&sp->mutex);
+	smp_mb();
+	for (flip = 0; flip < 2; flip++) {
+		idx = sp->completed & 1;
+		sp->completed++;
+		smp_mb();
+		srcu_wait_idx(sp, idx);
+		smp_mb();
+	}
+	pthread_mutex_unlock(&sp->mutex);
+}
+
+#endif /* _LINUX_SRCU_H */
@@ -75,6 +75,12 @@ static int xio_rdma_on_recv_cancel_rsp(struct xio_rdma_transport *rdma_hndl,
 static int xio_rdma_send_nop(struct xio_rdma_transport *rdma_hndl);
 static int xio_sched_rdma_wr_req(struct xio_rdma_transport *rdma_hndl,
 				 struct xio_task *task);
+static void xio_rdma_stream_start(struct xio_rdma_transport *rdma_hndl,
+				  struct xio_task *task);
+static void xio_rdma_stream_progress(struct xio_rdma_transport *rdma_hndl,
+				     struct xio_rdma_stream *stream);
+static void xio_rdma_on_stream_chunk(struct xio_rdma_transport *rdma_hndl,
+				     struct xio_task *task);
 
 
 /*---------------------------------------------------------------------------*/
@@ -209,6 +215,18 @@ static inline uint16_t tx_window_sz(struct xio_rdma_transport *rdma_hndl)
 	return rdma_hndl->max_sn - rdma_hndl->sn;
 }
 
+/*---------------------------------------------------------------------------*/
+/* xio_rdma_credit_stall						     */
+/*---------------------------------------------------------------------------*/
+static inline void xio_rdma_credit_stall(struct xio_rdma_transport *rdma_hndl)
+{
+	/* count each transition into the stalled state once */
+	if (rdma_hndl->credit_stalled)
+		return;
+	rdma_hndl->credit_stalled = 1;
+	xio_ctx_stat_inc(rdma_hndl->base.ctx, XIO_STAT_CREDIT_STALLS);
+}
+
 /*---------------------------------------------------------------------------*/
 /* xio_rdma_xmit							     */
 /*---------------------------------------------------------------------------*/
@@ -225,6 +243,8 @@ static int xio_rdma_xmit(struct xio_rdma_transport *rdma_hndl)
 	uint16_t		window;
 	uint16_t		retval;
 	uint16_t		req_nr = 0;
+	uint16_t		credits;
+	uint64_t		now;
 
 	tx_window = tx_window_sz(rdma_hndl);
 	window = min(rdma_hndl->peer_credits, tx_window);
@@ -235,11 +255,18 @@ static int xio_rdma_xmit(struct xio_rdma_transport *rdma_hndl)
 		  rdma_hndl->peer_credits,
 		  rdma_hndl->sqe_avail);
 
+	xio_rdma_gauges_tick(rdma_hndl);
 	if (window == 0) {
+		rdma_hndl->gauges.window_stalls++;
+		if (rdma_hndl->peer_credits == 0) {
+			rdma_hndl->gauges.credit_stalls++;
+			xio_rdma_credit_stall(rdma_hndl);
+		}
 		xio_set_error(EAGAIN);
 		return -1;
 	}
-
+	rdma_hndl->credit_stalled = 0;
+	now = get_cycles();
 
 	/* if "ready to send queue" is not empty */
 	while (rdma_hndl->tx_ready_tasks_num) {
@@ -301,12 +328,25 @@ static int xio_rdma_xmit(struct xio_rdma_transport *rdma_hndl)
 				break;
 			curr_wr = &rdma_task->txd;
 		}
-		xio_rdma_write_sn(task, rdma_hndl->sn, rdma_hndl->ack_sn,
-				  rdma_hndl->credits);
-		rdma_task->sn = rdma_hndl->sn;
-		rdma_hndl->sn++;
-		rdma_hndl->sim_peer_credits += rdma_hndl->credits;
-		rdma_hndl->credits = 0;
+		if (rdma_task->imm_data) {
+			/* immediate response carries no serial number */
+			credits = min(rdma_hndl->credits,
+				      XIO_IMM_RSP_MAX_CREDITS);
+			rdma_task->txd.send_wr.imm_data = htonl(XIO_IMM_RSP(
+				task->rtid,
+				XIO_IMM_RSP_LEN(rdma_task->imm_data),
+				credits));
+			rdma_hndl->sim_peer_credits += credits;
+			rdma_hndl->credits -= credits;
+		} else {
+			xio_rdma_write_sn(task, rdma_hndl->sn,
+					  rdma_hndl->ack_sn,
+					  rdma_hndl->credits);
+			rdma_task->sn = rdma_hndl->sn;
+			rdma_hndl->sn++;
+			rdma_hndl->sim_peer_credits += rdma_hndl->credits;
+			rdma_hndl->credits = 0;
+		}
 		rdma_hndl->peer_credits--;
 
 		prev_wr->send_wr.next = &curr_wr->send_wr;
@@ -319,6 +359,10 @@ static int xio_rdma_xmit(struct xio_rdma_transport *rdma_hndl)
 			rdma_hndl->reqs_in_flight_nr++;
 		else
 			rdma_hndl->rsps_in_flight_nr++;
+		task->stamp[XIO_STAGE_POST]	 = now;
+		task->stamp[XIO_STAGE_SEND_COMP] = 0;
+		xio_task_trace(rdma_hndl->base.ctx, task,
+			       XIO_TRACE_XMIT_REQ, XIO_TRACE_XMIT_RSP);
 		list_move_tail(&task->tasks_list_entry,
 			       &rdma_hndl->in_flight_list);
 	}
@@ -336,6 +380,8 @@ static int xio_rdma_xmit(struct xio_rdma_transport *rdma_hndl)
 			return -1;
 		}
 	}
+	if (rdma_hndl->tx_ready_tasks_num && rdma_hndl->peer_credits == 0)
+		xio_rdma_credit_stall(rdma_hndl);
 
 	return 0;
 }
@@ -351,17 +397,29 @@ static int xio_xmit_rdma_rd(struct xio_rdma_transport *rdma_hndl)
 	struct xio_rdma_task	*tmp_rdma_task;
 	struct xio_rdma_task	*prev_rdma_task = NULL;
 	struct xio_work_req	*first_wr = NULL;
+	struct xio_task		*stream_task = NULL;
 	int num_reqs = 0;
 	int err;
 
+	/* reads queued behind a streamed message wait for it */
+	if (rdma_hndl->rd_stream) {
+		xio_rdma_stream_progress(rdma_hndl, rdma_hndl->rd_stream);
+		return 0;
+	}
+
 	while (!list_empty(&rdma_hndl->rdma_rd_list) &&
 	       rdma_hndl->sqe_avail > num_reqs) {
 		task = list_first_entry(
 				&rdma_hndl->rdma_rd_list,
 				struct xio_task,  tasks_list_entry);
+		rdma_task = task->dd_data;
+		if (rdma_task->stream) {
+			/* post the reads before it, then start streaming */
+			stream_task = task;
+			break;
+		}
 		list_move_tail(&task->tasks_list_entry,
 			       &rdma_hndl->rdma_rd_in_flight_list);
-		rdma_task = task->dd_data;
 
 		/* pending "sends" that were delayed for rdma read completion
 		 *  are moved to wait in the in_filght list
@@ -375,7 +433,7 @@ static int xio_xmit_rdma_rd(struct xio_rdma_transport *rdma_hndl)
 
 			if (tmp_rdma_task->ib_op != XIO_IB_RECV)
 				break;
-			list_move_tail(&task->tasks_list_entry,
+			list_move_tail(&tmp_task->tasks_list_entry,
 				       &rdma_hndl->rdma_rd_in_flight_list);
 			rdma_hndl->rdma_in_flight++;
 		}
@@ -399,9 +457,11 @@ static int xio_xmit_rdma_rd(struct xio_rdma_transport *rdma_hndl)
 			ERROR_LOG("xio_post_send failed\n");
 
 		/* ToDo: error handling */
-	} else if (!list_empty(&rdma_hndl->rdma_rd_list)) {
+	} else if (!list_empty(&rdma_hndl->rdma_rd_list) && !stream_task) {
 		rdma_hndl->kick_rdma_rd = 1;
 	}
+	if (stream_task)
+		xio_rdma_stream_start(rdma_hndl, stream_task);
 
 	return 0;
 }
@@ -603,6 +663,13 @@ static int xio_rdma_idle_handler(struct xio_rdma_transport *rdma_hndl)
 	      rdma_hndl->sim_peer_credits < MAX_RECV_WR))
 		return 0;
 
+	/* let the credits wait for the next outgoing message unless
+	 * enough were collected or the peer is about to run dry
+	 */
+	if (rdma_hndl->credits < rdma_hndl->credits_batch &&
+	    rdma_hndl->sim_peer_credits > rdma_hndl->credits_low_wm)
+		return 0;
+
 	TRACE_LOG("peer_credits:%d, credits:%d sim_peer_credits:%d\n",
 		  rdma_hndl->peer_credits, rdma_hndl->credits,
 		  rdma_hndl->sim_peer_credits);
@@ -632,6 +699,7 @@ static int xio_rdma_rx_handler(struct xio_rdma_transport *rdma_hndl,
 	xio_prefetch(task2->mbuf.buf.head);
 
 
+	task->stamp[XIO_STAGE_RECV_COMP] = get_cycles();
 	rdma_hndl->rqe_avail--;
 	rdma_hndl->sim_peer_credits--;
 
@@ -640,9 +708,15 @@ static int xio_rdma_rx_handler(struct xio_rdma_transport *rdma_hndl,
 	    (rdma_hndl->rqe_avail <= rdma_hndl->rq_depth + 1))
 		xio_rdma_rearm_rq(rdma_hndl);
 
-	retval = xio_mbuf_read_first_tlv(&task->mbuf);
-
-	task->tlv_type = xio_mbuf_tlv_type(&task->mbuf);
+	rdma_task = task->dd_data;
+	if (rdma_task->imm_data) {
+		/* immediate response - there is no tlv to parse */
+		retval = 0;
+		task->tlv_type = XIO_MSG_RSP;
+	} else {
+		retval = xio_mbuf_read_first_tlv(&task->mbuf);
+		task->tlv_type = xio_mbuf_tlv_type(&task->mbuf);
+	}
 	list_move_tail(&task->tasks_list_entry, &rdma_hndl->io_list);
 
 
@@ -705,6 +779,7 @@ static int xio_rdma_tx_comp_handler(struct xio_rdma_transport *rdma_hndl,
 	struct xio_rdma_task	*rdma_task;
 	int			found = 0;
 	int			removed = 0;
+	uint64_t		now = get_cycles();
 
 
 	list_for_each_entry_safe(ptask, next_ptask, &rdma_hndl->in_flight_list,
@@ -727,13 +802,17 @@ static int xio_rdma_tx_comp_handler(struct xio_rdma_transport *rdma_hndl,
 		if (rdma_task->ib_op == XIO_IB_RDMA_WRITE)
 			rdma_hndl->sqe_avail++;
 
+		ptask->stamp[XIO_STAGE_SEND_COMP] = now;
+		xio_task_trace(rdma_hndl->base.ctx, ptask,
+			       XIO_TRACE_TX_COMP_REQ, XIO_TRACE_TX_COMP_RSP);
 		if (IS_REQUEST(ptask->tlv_type)) {
 			rdma_hndl->max_sn++;
 			rdma_hndl->reqs_in_flight_nr--;
 			xio_rdma_on_req_send_comp(rdma_hndl, ptask);
 			xio_tasks_pool_put(ptask);
 		} else if (IS_RESPONSE(ptask->tlv_type)) {
-			rdma_hndl->max_sn++;
+			if (!rdma_task->imm_data)
+				rdma_hndl->max_sn++;
 			rdma_hndl->rsps_in_flight_nr--;
 			xio_rdma_on_rsp_send_comp(rdma_hndl, ptask);
 		} else if (IS_NOP(ptask->tlv_type)) {
@@ -769,6 +848,40 @@ static int xio_rdma_tx_comp_handler(struct xio_rdma_transport *rdma_hndl,
 	return 0;
 }
 
+/*---------------------------------------------------------------------------*/
+/* xio_rdma_notify_fenced						     */
+/*---------------------------------------------------------------------------*/
+static void xio_rdma_notify_fenced(struct xio_rdma_transport *rdma_hndl)
+{
+	union xio_transport_event_data	event_data;
+	struct xio_task			*task;
+	struct xio_rdma_task		*rdma_task;
+
+	while (rdma_hndl->rdma_in_flight) {
+		task = list_first_entry(
+				&rdma_hndl->rdma_rd_in_flight_list,
+				struct xio_task,  tasks_list_entry);
+
+		rdma_task = task->dd_data;
+
+		if (rdma_task->ib_op != XIO_IB_RECV)
+			break;
+
+		/* tasks that arrived in Send/Receive while pending
+		 * "RDMA READ" tasks were in flight was fenced.
+		 */
+		rdma_hndl->rdma_in_flight--;
+		list_move_tail(&task->tasks_list_entry,
+			       &rdma_hndl->io_list);
+		event_data.msg.op	= XIO_WC_OP_RECV;
+		event_data.msg.task	= task;
+
+		xio_rdma_notify_observer(rdma_hndl,
+					 XIO_TRANSPORT_NEW_MESSAGE,
+					 &event_data);
+	}
+}
+
 /*---------------------------------------------------------------------------*/
 /* xio_rdma_rd_comp_handler						     */
 /*---------------------------------------------------------------------------*/
@@ -786,6 +899,10 @@ static void xio_rdma_rd_comp_handler(
 	rdma_hndl->sqe_avail++;
 
 	if (rdma_task->phantom_idx == 0) {
+		if (rdma_task->stream) {
+			xio_rdma_on_stream_chunk(rdma_hndl, task);
+			return;
+		}
 		if (task->state == XIO_TASK_STATE_CANCEL_PENDING) {
 			TRACE_LOG("[%d] - **** message is canceled\n",
 				  rdma_task->sn);
@@ -807,29 +924,7 @@ static void xio_rdma_rd_comp_handler(
 		xio_rdma_notify_observer(rdma_hndl, XIO_TRANSPORT_NEW_MESSAGE,
 					 &event_data);
 
-		while (rdma_hndl->rdma_in_flight) {
-			task = list_first_entry(
-					&rdma_hndl->rdma_rd_in_flight_list,
-					struct xio_task,  tasks_list_entry);
-
-			rdma_task = task->dd_data;
-
-			if (rdma_task->ib_op != XIO_IB_RECV)
-				break;
-
-			/* tasks that arrived in Send/Receive while pending
-			 * "RDMA READ" tasks were in flight was fenced.
-			 */
-			rdma_hndl->rdma_in_flight--;
-			list_move_tail(&task->tasks_list_entry,
-				       &rdma_hndl->io_list);
-			event_data.msg.op	= XIO_WC_OP_RECV;
-			event_data.msg.task	= task;
-
-			xio_rdma_notify_observer(rdma_hndl,
-						 XIO_TRANSPORT_NEW_MESSAGE,
-						 &event_data);
-		}
+		xio_rdma_notify_fenced(rdma_hndl);
 	} else {
 		xio_tasks_pool_put(task);
 		xio_xmit_rdma_rd(rdma_hndl);
@@ -859,9 +954,13 @@ static inline void xio_handle_wc(struct ibv_wc *wc, int has_more)
 		  ibv_wc_opcode_str(wc->opcode), wc->opcode);
 	*/
 
+	xio_rdma_gauges_tick(rdma_hndl);
+
 	switch (wc->opcode) {
 	case IBV_WC_RECV:
 		rdma_task->more_in_batch = has_more;
+		rdma_task->imm_data = (wc->wc_flags & IBV_WC_WITH_IMM) ?
+					ntohl(wc->imm_data) : 0;
 		xio_rdma_rx_handler(rdma_hndl, task);
 		break;
 	case IBV_WC_SEND:
@@ -1070,9 +1169,10 @@ static int xio_rdma_write_req_header(struct xio_rdma_transport *rdma_hndl,
 	struct xio_req_hdr		*tmp_req_hdr;
 	struct xio_sge			*tmp_sge;
 	struct xio_sge			sge;
+	struct xio_iovec_ex		*in_iov;
 	size_t				hdr_len;
 	struct ibv_mr			*mr;
-	uint8_t				i;
+	int				i;
 	XIO_TO_RDMA_TASK(task, rdma_task);
 
 
@@ -1080,6 +1180,17 @@ static int xio_rdma_write_req_header(struct xio_rdma_transport *rdma_hndl,
 	xio_mbuf_set_trans_hdr(&task->mbuf);
 	tmp_req_hdr = xio_mbuf_get_curr_ptr(&task->mbuf);
 
+	/* long sg lists may not leave room for the descriptors */
+	hdr_len	= sizeof(struct xio_req_hdr);
+	hdr_len += sizeof(struct xio_sge)*(req_hdr->recv_num_sge +
+					   req_hdr->read_num_sge +
+					   req_hdr->write_num_sge);
+	if (hdr_len > xio_mbuf_tlv_space_left(&task->mbuf)) {
+		ERROR_LOG("sge descriptors exceed send buffer. hdr_len:%zd\n",
+			  hdr_len);
+		goto cleanup;
+	}
+
 	/* pack relevant values */
 	tmp_req_hdr->version  = req_hdr->version;
 	tmp_req_hdr->flags    = req_hdr->flags;
@@ -1089,9 +1200,9 @@ static int xio_rdma_write_req_header(struct xio_rdma_transport *rdma_hndl,
 	/* credits	shall be coded later */
 	PACK_SVAL(req_hdr, tmp_req_hdr, tid);
 	tmp_req_hdr->opcode	   = req_hdr->opcode;
-	tmp_req_hdr->recv_num_sge  = req_hdr->recv_num_sge;
-	tmp_req_hdr->read_num_sge  = req_hdr->read_num_sge;
-	tmp_req_hdr->write_num_sge = req_hdr->write_num_sge;
+	PACK_SVAL(req_hdr, tmp_req_hdr, recv_num_sge);
+	PACK_SVAL(req_hdr, tmp_req_hdr, read_num_sge);
+	PACK_SVAL(req_hdr, tmp_req_hdr, write_num_sge);
 
 	PACK_SVAL(req_hdr, tmp_req_hdr, ulp_hdr_len);
 	PACK_SVAL(req_hdr, tmp_req_hdr, ulp_pad_len);
@@ -1102,9 +1213,10 @@ static int xio_rdma_write_req_header(struct xio_rdma_transport *rdma_hndl,
 			   sizeof(struct xio_req_hdr));
 
 	/* IN: requester expect small input written via send */
+	in_iov = xio_vmsg_data_iov(&task->omsg->in);
 	for (i = 0;  i < req_hdr->recv_num_sge; i++) {
 		sge.addr = 0;
-		sge.length = task->omsg->in.data_iov[i].iov_len;
+		sge.length = in_iov[i].iov_len;
 		sge.stag = 0;
 		PACK_LLVAL(&sge, tmp_sge, addr);
 		PACK_LVAL(&sge, tmp_sge, length);
@@ -1151,10 +1263,6 @@ static int xio_rdma_write_req_header(struct xio_rdma_transport *rdma_hndl,
 		PACK_LVAL(&sge, tmp_sge, stag);
 		tmp_sge++;
 	}
-	hdr_len	= sizeof(struct xio_req_hdr);
-	hdr_len += sizeof(struct xio_sge)*(req_hdr->recv_num_sge +
-					   req_hdr->read_num_sge +
-					   req_hdr->write_num_sge);
 #ifdef EYAL_TODO
 	print_hex_dump_bytes("post_send: ", DUMP_PREFIX_ADDRESS,
 			     task->mbuf.curr,
@@ -1190,6 +1298,13 @@ static int xio_rdma_read_req_header(struct xio_rdma_transport *rdma_hndl,
 	req_hdr->flags    = tmp_req_hdr->flags;
 	UNPACK_SVAL(tmp_req_hdr, req_hdr, req_hdr_len);
 
+	/* version 1 peers carry 8 bit sge counts in another layout */
+	if (req_hdr->version != XIO_REQ_HEADER_VERSION) {
+		ERROR_LOG("request header version mismatch. " \
+			  "arrived:%d  expected:%d\n",
+			  req_hdr->version, XIO_REQ_HEADER_VERSION);
+		return -1;
+	}
 	if (req_hdr->req_hdr_len != sizeof(struct xio_req_hdr)) {
 		ERROR_LOG(
 		"header length's read failed. arrived:%d  expected:%zd\n",
@@ -1200,9 +1315,9 @@ static int xio_rdma_read_req_header(struct xio_rdma_transport *rdma_hndl,
 	UNPACK_SVAL(tmp_req_hdr, req_hdr, credits);
 	UNPACK_SVAL(tmp_req_hdr, req_hdr, tid);
 	req_hdr->opcode		= tmp_req_hdr->opcode;
-	req_hdr->recv_num_sge	= tmp_req_hdr->recv_num_sge;
-	req_hdr->read_num_sge	= tmp_req_hdr->read_num_sge;
-	req_hdr->write_num_sge	= tmp_req_hdr->write_num_sge;
+	UNPACK_SVAL(tmp_req_hdr, req_hdr, recv_num_sge);
+	UNPACK_SVAL(tmp_req_hdr, req_hdr, read_num_sge);
+	UNPACK_SVAL(tmp_req_hdr, req_hdr, write_num_sge);
 
 	UNPACK_SVAL(tmp_req_hdr, req_hdr, ulp_hdr_len);
 	UNPACK_SVAL(tmp_req_hdr, req_hdr, ulp_pad_len);
@@ -1215,6 +1330,14 @@ static int xio_rdma_read_req_header(struct xio_rdma_transport *rdma_hndl,
 
 	rdma_task->sn = req_hdr->sn;
 
+	/* peer sent more descriptors than fit in the task */
+	if (xio_rdma_task_reserve_sgl(
+			rdma_hndl, task,
+			max(req_hdr->recv_num_sge,
+			    max(req_hdr->read_num_sge,
+				req_hdr->write_num_sge))) != 0)
+		return -1;
+
 	/* params for SEND */
 	for (i = 0;  i < req_hdr->recv_num_sge; i++) {
 		UNPACK_LLVAL(tmp_sge, &rdma_task->req_recv_sge[i], addr);
@@ -1447,12 +1570,13 @@ static int xio_rdma_write_send_data(
 	XIO_TO_RDMA_TASK(task, rdma_task);
 	size_t			i;
 	struct ibv_mr		*mr;
+	struct xio_iovec_ex	*data_iov = xio_vmsg_data_iov(&task->omsg->out);
 
-	/* user provided mr */
-	if (task->omsg->out.data_iov[0].mr) {
+	/* user provided mr and the vector fits a single send */
+	if (data_iov[0].mr &&
+	    task->omsg->out.data_iovlen < rdma_hndl->max_sge) {
 		struct ibv_sge	*sge = &rdma_task->txd.sge[1];
-		struct xio_iovec_ex *iov =
-			&task->omsg->out.data_iov[0];
+		struct xio_iovec_ex *iov = &data_iov[0];
 		for (i = 0; i < task->omsg->out.data_iovlen; i++)  {
 			if (iov->mr == NULL) {
 				ERROR_LOG("failed to find mr on iov\n");
@@ -1479,15 +1603,17 @@ static int xio_rdma_write_send_data(
 		rdma_task->txd.send_wr.num_sge =
 			task->omsg->out.data_iovlen + 1;
 	} else {
-		/* copy to internal buffer */
-		for (i = 0; i < task->omsg->out.data_iovlen; i++) {
-			/* copy the data into internal buffer */
-			if (xio_mbuf_write_array(
-				&task->mbuf,
-				task->omsg->out.data_iov[i].iov_base,
-				task->omsg->out.data_iov[i].iov_len) != 0)
-				goto cleanup;
+		/* gather the vector into the internal buffer */
+		if (xio_iovex_length(data_iov, task->omsg->out.data_iovlen) >
+		    xio_mbuf_tlv_space_left(&task->mbuf)) {
+			ERROR_LOG("send data exceeds the internal buffer\n");
+			goto cleanup;
 		}
+		xio_mbuf_inc(&task->mbuf,
+			     xio_memcpy_gather(
+				     xio_mbuf_get_curr_ptr(&task->mbuf),
+				     data_iov,
+				     task->omsg->out.data_iovlen));
 		rdma_task->txd.send_wr.num_sge = 1;
 	}
 
@@ -1509,6 +1635,7 @@ static int xio_rdma_prep_req_out_data(
 {
 	XIO_TO_RDMA_TASK(task, rdma_task);
 	struct xio_vmsg		*vmsg = &task->omsg->out;
+	struct xio_iovec_ex	*data_iov = xio_vmsg_data_iov(vmsg);
 	uint64_t		xio_hdr_len;
 	uint64_t		ulp_out_hdr_len;
 	uint64_t		ulp_pad_len = 0;
@@ -1519,8 +1646,7 @@ static int xio_rdma_prep_req_out_data(
 
 	/* calculate headers */
 	ulp_out_hdr_len	= vmsg->header.iov_len;
-	ulp_out_imm_len	= xio_iovex_length(vmsg->data_iov,
-					   vmsg->data_iovlen);
+	ulp_out_imm_len	= xio_iovex_length(data_iov, vmsg->data_iovlen);
 
 	xio_hdr_len = xio_mbuf_get_curr_offset(&task->mbuf);
 	xio_hdr_len += sizeof(struct xio_req_hdr);
@@ -1562,17 +1688,21 @@ static int xio_rdma_prep_req_out_data(
 		/* the data is outgoing via SEND but the peer will do
 		 * RDMA_READ */
 		rdma_task->ib_op = XIO_IB_RDMA_READ;
+		if (xio_rdma_task_reserve_sgl(rdma_hndl, task,
+					      vmsg->data_iovlen) != 0)
+			goto cleanup;
+
 		/* user provided mr */
-		if (task->omsg->out.data_iov[0].mr) {
+		if (data_iov[0].mr) {
 			for (i = 0; i < vmsg->data_iovlen; i++) {
 				rdma_task->write_sge[i].addr =
-					vmsg->data_iov[i].iov_base;
+					data_iov[i].iov_base;
 				rdma_task->write_sge[i].cache = NULL;
 				rdma_task->write_sge[i].mr =
-					task->omsg->out.data_iov[i].mr;
+					data_iov[i].mr;
 
 				rdma_task->write_sge[i].length =
-					vmsg->data_iov[i].iov_len;
+					data_iov[i].iov_len;
 			}
 		} else {
 			if (rdma_hndl->rdma_mempool == NULL) {
@@ -1588,24 +1718,24 @@ static int xio_rdma_prep_req_out_data(
 			for (i = 0; i < vmsg->data_iovlen; i++) {
 				retval = xio_rdma_mempool_alloc(
 						rdma_hndl->rdma_mempool,
-						vmsg->data_iov[i].iov_len,
+						data_iov[i].iov_len,
 						&rdma_task->write_sge[i]);
 				if (retval) {
 					rdma_task->write_num_sge = i;
 					xio_set_error(ENOMEM);
 					ERROR_LOG(
 					"mempool is empty for %zd bytes\n",
-					vmsg->data_iov[i].iov_len);
+					data_iov[i].iov_len);
 					goto cleanup;
 				}
 
 				rdma_task->write_sge[i].length =
-					vmsg->data_iov[i].iov_len;
+					data_iov[i].iov_len;
 
 				/* copy the data to the buffer */
-				memcpy(rdma_task->write_sge[i].addr,
-				       vmsg->data_iov[i].iov_base,
-				       vmsg->data_iov[i].iov_len);
+				xio_memcpy(rdma_task->write_sge[i].addr,
+					   data_iov[i].iov_base,
+					   data_iov[i].iov_len);
 			}
 		}
 		rdma_task->write_num_sge = vmsg->data_iovlen;
@@ -1643,11 +1773,12 @@ static int xio_rdma_prep_req_in_data(
 	size_t				hdr_len;
 	size_t				data_len;
 	struct xio_vmsg			*vmsg = &task->omsg->in;
+	struct xio_iovec_ex		*data_iov = xio_vmsg_data_iov(vmsg);
 	int				i, retval;
 
 
 
-	data_len  = xio_iovex_length(vmsg->data_iov, vmsg->data_iovlen);
+	data_len  = xio_iovex_length(data_iov, vmsg->data_iovlen);
 	hdr_len  = vmsg->header.iov_len;
 
 	if (data_len + hdr_len + OMX_MAX_HDR_SZ < rdma_hndl->max_send_buf_sz) {
@@ -1658,18 +1789,22 @@ static int xio_rdma_prep_req_in_data(
 			rdma_task->read_num_sge = 0;
 		}
 	} else  {
+		if (xio_rdma_task_reserve_sgl(rdma_hndl, task,
+					      vmsg->data_iovlen) != 0)
+			goto cleanup;
+
 		/* user provided buffers with length for RDMA WRITE */
 		/* user provided mr */
-		if (vmsg->data_iov[0].mr)  {
+		if (data_iov[0].mr)  {
 			for (i = 0; i < vmsg->data_iovlen; i++) {
 				rdma_task->read_sge[i].addr =
-					vmsg->data_iov[i].iov_base;
+					data_iov[i].iov_base;
 				rdma_task->read_sge[i].cache = NULL;
 				rdma_task->read_sge[i].mr =
-					vmsg->data_iov[i].mr;
+					data_iov[i].mr;
 
 				rdma_task->read_sge[i].length =
-					vmsg->data_iov[i].iov_len;
+					data_iov[i].iov_len;
 			}
 		} else  {
 			if (rdma_hndl->rdma_mempool == NULL) {
@@ -1684,7 +1819,7 @@ static int xio_rdma_prep_req_in_data(
 			for (i = 0; i < vmsg->data_iovlen; i++) {
 				retval = xio_rdma_mempool_alloc(
 						rdma_hndl->rdma_mempool,
-						vmsg->data_iov[i].iov_len,
+						data_iov[i].iov_len,
 						&rdma_task->read_sge[i]);
 
 				if (retval) {
@@ -1692,11 +1827,11 @@ static int xio_rdma_prep_req_in_data(
 					xio_set_error(ENOMEM);
 					ERROR_LOG(
 					"mempool is empty for %zd bytes\n",
-					vmsg->data_iov[i].iov_len);
+					data_iov[i].iov_len);
 					goto cleanup;
 				}
 				rdma_task->read_sge[i].length =
-					vmsg->data_iov[i].iov_len;
+					data_iov[i].iov_len;
 			}
 		}
 		rdma_task->read_num_sge = vmsg->data_iovlen;
@@ -1836,6 +1971,44 @@ static int xio_rdma_send_req(struct xio_rdma_transport *rdma_hndl,
 	return retval;
 }
 
+/*---------------------------------------------------------------------------*/
+/* xio_rdma_prep_imm_rsp						     */
+/*---------------------------------------------------------------------------*/
+static void xio_rdma_prep_imm_rsp(struct xio_rdma_transport *rdma_hndl,
+				  struct xio_task *task, size_t ulp_imm_len)
+{
+	XIO_TO_RDMA_TASK(task, rdma_task);
+	struct xio_iovec_ex	*data_iov;
+	uint8_t			*buf = task->mbuf.buf.head;
+	int			i;
+
+	/* the few payload bytes are the only data on the wire */
+	data_iov = xio_vmsg_data_iov(&task->omsg->out);
+	for (i = 0; i < task->omsg->out.data_iovlen; i++) {
+		memcpy(buf, data_iov[i].iov_base, data_iov[i].iov_len);
+		buf += data_iov[i].iov_len;
+	}
+
+	/* the immediate value is completed with the credits upon xmit */
+	rdma_task->ib_op		= XIO_IB_SEND;
+	rdma_task->imm_data		= XIO_IMM_RSP(task->rtid,
+						      ulp_imm_len, 0);
+	rdma_task->txd.send_wr.opcode	= IBV_WR_SEND_WITH_IMM;
+	rdma_task->txd.sge[0].length	= ulp_imm_len;
+	rdma_task->txd.send_wr.num_sge	= ulp_imm_len ? 1 : 0;
+
+	rdma_task->txd.send_wr.send_flags = 0;
+	if (++rdma_hndl->rsp_sig_cnt >= SOFT_CQ_MOD) {
+		rdma_task->txd.send_wr.send_flags |= IBV_SEND_SIGNALED;
+		rdma_hndl->rsp_sig_cnt = 0;
+	}
+	if (ulp_imm_len < rdma_hndl->max_inline_data)
+		rdma_task->txd.send_wr.send_flags |= IBV_SEND_INLINE;
+
+	list_move_tail(&task->tasks_list_entry, &rdma_hndl->tx_ready_list);
+	rdma_hndl->tx_ready_tasks_num++;
+}
+
 /*---------------------------------------------------------------------------*/
 /* xio_rdma_send_rsp							     */
 /*---------------------------------------------------------------------------*/
@@ -1875,11 +2048,21 @@ static int xio_rdma_send_rsp(struct xio_rdma_transport *rdma_hndl,
 
 	/* calculate headers */
 	ulp_hdr_len	= task->omsg->out.header.iov_len;
-	ulp_imm_len	= xio_iovex_length(task->omsg->out.data_iov,
+	ulp_imm_len	= xio_iovex_length(xio_vmsg_data_iov(&task->omsg->out),
 					   task->omsg->out.data_iovlen);
 	xio_hdr_len = xio_mbuf_get_curr_offset(&task->mbuf);
 	xio_hdr_len += sizeof(rsp_hdr);
 
+	/* status only and tiny responses are sent as immediate data */
+	if ((rdma_hndl->setup_flags & XIO_RDMA_SETUP_IMM_RSP) &&
+	    task->tlv_type == XIO_MSG_RSP && !task->is_control &&
+	    task->omsg_flags == XIO_MSG_RSP_FLAG_LAST &&
+	    ulp_hdr_len == 0 && ulp_imm_len <= XIO_IMM_RSP_MAX_LEN) {
+		xio_rdma_prep_imm_rsp(rdma_hndl, task, ulp_imm_len);
+		retval = 0;
+		goto xmit;
+	}
+
 	if (rdma_hndl->max_send_buf_sz	 < (xio_hdr_len + ulp_hdr_len)) {
 		ERROR_LOG("header size %lu exceeds max header %lu\n",
 			  ulp_hdr_len,
@@ -1976,6 +2159,7 @@ static int xio_rdma_send_rsp(struct xio_rdma_transport *rdma_hndl,
 		rdma_hndl->tx_ready_tasks_num++;
 	}
 
+xmit:
 	/* transmit only if  available */
 	if (task->omsg->more_in_batch == 0) {
 		must_send = 1;
@@ -2069,27 +2253,47 @@ static int xio_rdma_on_recv_rsp(struct xio_rdma_transport *rdma_hndl,
 	struct xio_msg		*imsg;
 	struct xio_msg		*omsg;
 	void			*ulp_hdr;
+	struct xio_iovec_ex	*idata_iov;
+	struct xio_iovec_ex	*odata_iov;
+	size_t			remain_len;
 	XIO_TO_RDMA_TASK(task, rdma_task);
 	XIO_TO_RDMA_TASK(task, rdma_sender_task);
 	int			i;
 
-	/* read the response header */
-	retval = xio_rdma_read_rsp_header(rdma_hndl, task, &rsp_hdr);
-	if (retval != 0) {
-		xio_set_error(XIO_E_MSG_INVALID);
-		goto cleanup;
-	}
-	/* update receive + send window */
-	if (rdma_hndl->exp_sn == rsp_hdr.sn) {
-		rdma_hndl->exp_sn++;
-		rdma_hndl->ack_sn = rsp_hdr.sn;
-		rdma_hndl->peer_credits += rsp_hdr.credits;
+	if (rdma_task->imm_data) {
+		/* immediate response - the header is implied */
+		memset(&rsp_hdr, 0, sizeof(rsp_hdr));
+		rsp_hdr.tid		= XIO_IMM_RSP_TID(rdma_task->imm_data);
+		rsp_hdr.opcode		= XIO_IB_SEND;
+		rsp_hdr.status		= XIO_E_SUCCESS;
+		rsp_hdr.ulp_imm_len	= XIO_IMM_RSP_LEN(rdma_task->imm_data);
+		rdma_hndl->peer_credits +=
+			XIO_IMM_RSP_CREDITS(rdma_task->imm_data);
+		task->imm_rsp		= 1;
+
+		/* the payload is at the start of the buffer */
+		ulp_hdr = task->mbuf.buf.head;
 	} else {
-		ERROR_LOG("ERROR: expected sn:%d, arrived sn:%d\n",
-			  rdma_hndl->exp_sn, rsp_hdr.sn);
+		/* read the response header */
+		retval = xio_rdma_read_rsp_header(rdma_hndl, task, &rsp_hdr);
+		if (retval != 0) {
+			xio_set_error(XIO_E_MSG_INVALID);
+			goto cleanup;
+		}
+		/* update receive + send window */
+		if (rdma_hndl->exp_sn == rsp_hdr.sn) {
+			rdma_hndl->exp_sn++;
+			rdma_hndl->ack_sn = rsp_hdr.sn;
+			rdma_hndl->peer_credits += rsp_hdr.credits;
+		} else {
+			ERROR_LOG("ERROR: expected sn:%d, arrived sn:%d\n",
+				  rdma_hndl->exp_sn, rsp_hdr.sn);
+		}
+		/* read the sn */
+		rdma_task->sn = rsp_hdr.sn;
+
+		ulp_hdr = xio_mbuf_get_curr_ptr(&task->mbuf);
 	}
-	/* read the sn */
-	rdma_task->sn = rsp_hdr.sn;
 
 	task->imsg.more_in_batch = rdma_task->more_in_batch;
 
@@ -2104,9 +2308,10 @@ static int xio_rdma_on_recv_rsp(struct xio_rdma_transport *rdma_hndl,
 	task->sender_task->state = XIO_TASK_STATE_RESPONSE_RECV;
 
 	omsg = task->sender_task->omsg;
+	xio_trace(rdma_hndl->base.ctx, XIO_TRACE_RECV_RSP, omsg->sn,
+		  task->sender_task->ltid, 0);
 	imsg = &task->imsg;
 
-	ulp_hdr = xio_mbuf_get_curr_ptr(&task->mbuf);
 	/* msg from received message */
 	if (rsp_hdr.ulp_hdr_len) {
 		imsg->in.header.iov_base	= ulp_hdr;
@@ -2155,13 +2360,14 @@ static int xio_rdma_on_recv_rsp(struct xio_rdma_transport *rdma_hndl,
 			imsg->in.data_iovlen		= 0;
 		}
 		if (omsg->in.data_iovlen) {
+			odata_iov = xio_vmsg_data_iov(&omsg->in);
 			/* deep copy */
 			if (imsg->in.data_iovlen) {
 				size_t idata_len  = xio_iovex_length(
 					imsg->in.data_iov,
 					imsg->in.data_iovlen);
 				size_t odata_len  = xio_iovex_length(
-					omsg->in.data_iov,
+					odata_iov,
 					omsg->in.data_iovlen);
 
 				if (idata_len > odata_len) {
@@ -2170,55 +2376,86 @@ static int xio_rdma_on_recv_rsp(struct xio_rdma_transport *rdma_hndl,
 				} else {
 					omsg->status = XIO_E_SUCCESS;
 				}
-				if (omsg->in.data_iov[0].iov_base)  {
+				if (odata_iov[0].iov_base)  {
 					/* user provided buffer so do copy */
-					omsg->in.data_iovlen = memcpyv(
-					  (struct xio_iovec *)omsg->in.data_iov,
-					  omsg->in.data_iovlen,
-					  (struct xio_iovec *)imsg->in.data_iov,
-					  imsg->in.data_iovlen);
+					xio_vmsg_set_data_iovlen(
+					  &omsg->in,
+					  memcpyv_ex(
+					    odata_iov,
+					    omsg->in.data_iovlen,
+					    imsg->in.data_iov,
+					    imsg->in.data_iovlen));
 				} else {
 					/* use provided only length - set user
 					 * pointers */
-					omsg->in.data_iovlen =  memclonev(
-					(struct xio_iovec *)omsg->in.data_iov,
-					omsg->in.data_iovlen,
-					(struct xio_iovec *)imsg->in.data_iov,
-					imsg->in.data_iovlen);
+					xio_vmsg_set_data_iovlen(
+					  &omsg->in,
+					  memclonev_ex(
+					    odata_iov,
+					    omsg->in.data_iovlen,
+					    imsg->in.data_iov,
+					    imsg->in.data_iovlen));
 				}
 			} else {
-				omsg->in.data_iovlen = imsg->in.data_iovlen;
+				xio_vmsg_set_data_iovlen(&omsg->in,
+							 imsg->in.data_iovlen);
 			}
 		} else {
 			omsg->in.data_iovlen =
-				memclonev((struct xio_iovec *)omsg->in.data_iov,
-					  XIO_MAX_IOV,
-					  (struct xio_iovec *)imsg->in.data_iov,
-					  imsg->in.data_iovlen);
+				memclonev_ex(omsg->in.data_iov,
+					     XIO_MAX_IOV,
+					     imsg->in.data_iov,
+					     imsg->in.data_iovlen);
 		}
 		break;
 	case XIO_IB_RDMA_WRITE:
-		imsg->in.data_iov[0].iov_base	=
-			ptr_from_int64(rdma_sender_task->read_sge[0].addr);
-		imsg->in.data_iov[0].iov_len	= rsp_hdr.ulp_imm_len;
-		imsg->in.data_iovlen		= 1;
+		/* the peer wrote the data over the buffers that were
+		 * advertised in the request
+		 */
+		if (xio_rdma_task_reserve_sgl(
+				rdma_hndl, task,
+				rdma_sender_task->read_num_sge) != 0)
+			goto cleanup;
+
+		imsg->in.data_iovlen	= rdma_sender_task->read_num_sge;
+		idata_iov		= xio_vmsg_data_iov(&imsg->in);
+		remain_len		= rsp_hdr.ulp_imm_len;
+		for (i = 0; i < rdma_sender_task->read_num_sge &&
+			    remain_len; i++) {
+			idata_iov[i].iov_base	=
+				rdma_sender_task->read_sge[i].addr;
+			idata_iov[i].iov_len	=
+				min(remain_len,
+				    rdma_sender_task->read_sge[i].length);
+			idata_iov[i].mr		=
+				rdma_sender_task->read_sge[i].mr;
+			remain_len -= idata_iov[i].iov_len;
+		}
+		xio_vmsg_set_data_iovlen(&imsg->in, i);
+
+		idata_iov = xio_vmsg_data_iov(&imsg->in);
+		odata_iov = xio_vmsg_data_iov(&omsg->in);
 
 		/* user provided mr */
-		if (omsg->in.data_iov[0].mr)  {
+		if (odata_iov[0].mr)  {
 			/* data was copied directly to user buffer */
-			/* need to update the buffer length */
-			omsg->in.data_iov[0].iov_len =
-				imsg->in.data_iov[0].iov_len;
+			/* need to update the buffers length */
+			for (i = 0; i < imsg->in.data_iovlen; i++)
+				odata_iov[i].iov_len = idata_iov[i].iov_len;
+			xio_vmsg_set_data_iovlen(&omsg->in,
+						 imsg->in.data_iovlen);
 		} else  {
 			/* user provided buffer but not mr */
 			/* deep copy */
 
-			if (omsg->in.data_iov[0].iov_base)  {
-				omsg->in.data_iovlen = memcpyv(
-					(struct xio_iovec *)omsg->in.data_iov,
-					omsg->in.data_iovlen,
-					(struct xio_iovec *)imsg->in.data_iov,
-					imsg->in.data_iovlen);
+			if (odata_iov[0].iov_base)  {
+				xio_vmsg_set_data_iovlen(
+					&omsg->in,
+					memcpyv_ex(
+						odata_iov,
+						omsg->in.data_iovlen,
+						idata_iov,
+						imsg->in.data_iovlen));
 
 				/* put buffers back to pool */
 				for (i = 0; i < rdma_sender_task->read_num_sge;
@@ -2231,11 +2468,13 @@ static int xio_rdma_on_recv_rsp(struct xio_rdma_transport *rdma_hndl,
 			} else {
 				/* use provided only length - set user
 				 * pointers */
-				omsg->in.data_iovlen = memclonev(
-					(struct xio_iovec *)omsg->in.data_iov,
-					omsg->in.data_iovlen,
-					(struct xio_iovec *)imsg->in.data_iov,
-					imsg->in.data_iovlen);
+				xio_vmsg_set_data_iovlen(
+					&omsg->in,
+					memclonev_ex(
+						odata_iov,
+						omsg->in.data_iovlen,
+						idata_iov,
+						imsg->in.data_iovlen));
 			}
 		}
 		break;
@@ -2267,20 +2506,48 @@ cleanup:
 /* xio_rdma_notify_assign_in_buf					     */
 /*---------------------------------------------------------------------------*/
 static int xio_rdma_assign_in_buf(struct xio_rdma_transport *rdma_hndl,
-			    struct xio_task *task, int *is_assigned)
+			    struct xio_task *task, int *is_assigned,
+			    int *is_streamed)
 {
 	union xio_transport_event_data event_data = {
 			.assign_in_buf.task	   = task,
-			.assign_in_buf.is_assigned = 0
+			.assign_in_buf.is_assigned = 0,
+			.assign_in_buf.is_streamed = *is_streamed
 	};
 
 	xio_rdma_notify_observer(rdma_hndl,
 				 XIO_TRANSPORT_ASSIGN_IN_BUF, &event_data);
 
 	*is_assigned = event_data.assign_in_buf.is_assigned;
+	*is_streamed = event_data.assign_in_buf.is_streamed;
 	return 0;
 }
 
+/*---------------------------------------------------------------------------*/
+/* xio_rdma_hint_out_data						     */
+/*---------------------------------------------------------------------------*/
+static void xio_rdma_hint_out_data(struct xio_task *task)
+{
+	XIO_TO_RDMA_TASK(task, rdma_task);
+	struct xio_iovec_ex	*out_iov;
+	struct xio_sge		*sge;
+	int			i;
+
+	if (rdma_task->req_read_num_sge) {
+		task->imsg.out.data_iovlen = rdma_task->req_read_num_sge;
+		sge = rdma_task->req_read_sge;
+	} else {
+		task->imsg.out.data_iovlen = rdma_task->req_recv_num_sge;
+		sge = rdma_task->req_recv_sge;
+	}
+	out_iov = xio_vmsg_data_iov(&task->imsg.out);
+	for (i = 0;  i < task->imsg.out.data_iovlen; i++) {
+		out_iov[i].iov_base	= NULL;
+		out_iov[i].iov_len	= sge[i].length;
+		out_iov[i].mr		= NULL;
+	}
+}
+
 /*---------------------------------------------------------------------------*/
 /* xio_prep_rdma_op							     */
 /*---------------------------------------------------------------------------*/
@@ -2296,23 +2563,16 @@ static int xio_prep_rdma_op(
 		struct list_head *target_list,
 		int	*tasks_used)
 {
-	struct xio_task		*tmp_task;
-	struct xio_rdma_task	*tmp_rdma_task;
-
-	XIO_TO_RDMA_TASK(task, rdma_task);
-	struct xio_work_req	*rdmad = &rdma_task->rdmad;
+	struct xio_task		*tmp_task = NULL;
+	struct xio_rdma_task	*tmp_rdma_task = NULL;
+	struct xio_work_req	*rdmad = NULL;
 	struct xio_task		*ptask, *next_ptask;
-
-
-	uint64_t laddr  = lsg_list[0].addr;
-	uint64_t raddr  = rsg_list[0].addr;
-
-	uint32_t llen	= lsg_list[0].length;
-	uint32_t rlen	= rsg_list[0].length;
-	uint32_t lkey	= lsg_list[0].stag;
-	uint32_t rkey	= rsg_list[0].stag;
-	int	l = 0, r = 0, k = 0;
-	uint32_t	tot_len = 0;
+	uint64_t		laddr, raddr;
+	uint32_t		llen, rlen, lkey, rkey, len;
+	uint32_t		tot_len = 0;
+	size_t			l, r;
+	int			k, w, nwr;
+	int			max_sge;
 
 	LIST_HEAD(tmp_list);
 
@@ -2323,159 +2583,109 @@ static int xio_prep_rdma_op(
 			  lsize, rsize);
 		return -1;
 	}
-	if (rsize == 1) {
-		tmp_task = task;
-	} else {
-		/* take new task */
-		tmp_task = xio_rdma_primary_task_alloc(rdma_hndl);
-		if (!tmp_task) {
-			ERROR_LOG("primary task pool is empty\n");
-			return -1;
+
+	/* a work request is bounded by one remote element and by the
+	 * device scatter/gather limit for the operation
+	 */
+	max_sge = (xio_ib_op == XIO_IB_RDMA_READ) ?
+			rdma_hndl->max_sge_rd : rdma_hndl->max_sge;
+	if (max_sge < 1 || max_sge > MAX_SGE)
+		max_sge = 1;
+
+	/* first pass - count the work requests */
+	nwr = 0;
+	l = 0; r = 0; k = 0;
+	llen = lsg_list[0].length;
+	rlen = rsg_list[0].length;
+	while (l < lsize && r < rsize) {
+		len = min(llen, rlen);
+		llen -= len;
+		rlen -= len;
+		k++;
+		if (llen == 0 && ++l < lsize)
+			llen = lsg_list[l].length;
+		if (rlen == 0 || k == max_sge || l == lsize) {
+			nwr++;
+			k = 0;
+			if (rlen == 0 && ++r < rsize)
+				rlen = rsg_list[r].length;
 		}
 	}
-	(*tasks_used)++;
-	tmp_rdma_task =
-		(struct xio_rdma_task *)tmp_task->dd_data;
-	rdmad = &tmp_rdma_task->rdmad;
 
-	while (1) {
-		if (rlen < llen) {
-			rdmad->send_wr.num_sge		= k + 1;
-			rdmad->send_wr.wr_id		=
-					uint64_from_ptr(tmp_task);
-			rdmad->send_wr.next		= NULL;
-			rdmad->send_wr.opcode		= opcode;
-			rdmad->send_wr.send_flags	=
-					(signaled ? IBV_SEND_SIGNALED : 0);
-			rdmad->send_wr.wr.rdma.remote_addr = raddr;
-			rdmad->send_wr.wr.rdma.rkey	   = rkey;
-
-			rdmad->sge[k].addr		= laddr;
-			rdmad->sge[k].length		= rlen;
-			rdmad->sge[k].lkey		= lkey;
-			k				= 0;
-
-			tot_len				+= rlen;
-			tmp_rdma_task->ib_op		= xio_ib_op;
-			tmp_rdma_task->phantom_idx	= rsize - r - 1;
-
-			/* close the task */
-			list_move_tail(&tmp_task->tasks_list_entry, &tmp_list);
-			/* advance the remote index */
-			r++;
-			if (r == rsize) {
-				break;
-			} else if (r < rsize - 1) {
-				/* take new task */
-				tmp_task =
-					xio_rdma_primary_task_alloc(rdma_hndl);
+	/* second pass - build the work requests. the original task carries
+	 * the last one, all preceding are phantoms
+	 */
+	w = 0;
+	l = 0; r = 0; k = 0;
+	laddr = lsg_list[0].addr;
+	llen  = lsg_list[0].length;
+	lkey  = lsg_list[0].stag;
+	raddr = rsg_list[0].addr;
+	rlen  = rsg_list[0].length;
+	rkey  = rsg_list[0].stag;
+
+	while (l < lsize && r < rsize) {
+		if (k == 0) {
+			/* open a new work request */
+			if (w == nwr - 1) {
+				tmp_task = task;
+			} else {
+				tmp_task = xio_rdma_primary_task_alloc(
+								rdma_hndl);
 				if (!tmp_task) {
 					ERROR_LOG(
 					      "primary task pool is empty\n");
 					goto cleanup;
 				}
-			} else {
-				tmp_task = task;
 			}
-			(*tasks_used)++;
-
 			tmp_rdma_task =
 				(struct xio_rdma_task *)tmp_task->dd_data;
 			rdmad = &tmp_rdma_task->rdmad;
+			rdmad->send_wr.wr.rdma.remote_addr = raddr;
+			rdmad->send_wr.wr.rdma.rkey	   = rkey;
+		}
+		len = min(llen, rlen);
 
-			llen	-= rlen;
-			laddr	+= rlen;
-			raddr	= rsg_list[r].addr;
-			rlen	= rsg_list[r].length;
-			rkey	= rsg_list[r].stag;
-		} else if (llen < rlen) {
-			rdmad->sge[k].addr	= laddr;
-			rdmad->sge[k].length	= llen;
-			rdmad->sge[k].lkey	= lkey;
-			tot_len			+= llen;
-
-			/* advance the local index */
-			l++;
-			if (l == lsize) {
-				rdmad->send_wr.num_sge		   = k + 1;
-				rdmad->send_wr.wr_id		   =
-						uint64_from_ptr(tmp_task);
-				rdmad->send_wr.next		   = NULL;
-				rdmad->send_wr.opcode		   = opcode;
-				rdmad->send_wr.send_flags	=
-					   (signaled ? IBV_SEND_SIGNALED : 0);
-				rdmad->send_wr.wr.rdma.remote_addr = raddr;
-				rdmad->send_wr.wr.rdma.rkey	   = rkey;
-				tmp_rdma_task->ib_op		   = xio_ib_op;
-				tmp_rdma_task->phantom_idx	   =
-								rsize - r - 1;
-				/* close the task */
-				list_move_tail(&tmp_task->tasks_list_entry,
-					       &tmp_list);
-				break;
-			}
-			k++;
-			rlen	-= llen;
-			raddr	+= llen;
+		rdmad->sge[k].addr	= laddr;
+		rdmad->sge[k].length	= len;
+		rdmad->sge[k].lkey	= lkey;
+		k++;
+
+		tot_len	+= len;
+		llen	-= len;
+		laddr	+= len;
+		rlen	-= len;
+		raddr	+= len;
+
+		/* advance the local index */
+		if (llen == 0 && ++l < lsize) {
 			laddr	= lsg_list[l].addr;
 			llen	= lsg_list[l].length;
 			lkey	= lsg_list[l].stag;
-		} else {
-			rdmad->send_wr.num_sge		= k + 1;
+		}
+		if (rlen == 0 || k == max_sge || l == lsize) {
+			/* close the task */
+			rdmad->send_wr.num_sge		= k;
 			rdmad->send_wr.wr_id		=
-						uint64_from_ptr(tmp_task);
+					uint64_from_ptr(tmp_task);
 			rdmad->send_wr.next		= NULL;
 			rdmad->send_wr.opcode		= opcode;
 			rdmad->send_wr.send_flags	=
 					(signaled ? IBV_SEND_SIGNALED : 0);
-			rdmad->send_wr.wr.rdma.remote_addr = raddr;
-			rdmad->send_wr.wr.rdma.rkey	   = rkey;
-
-			rdmad->sge[k].addr		= laddr;
-			rdmad->sge[k].length		= llen;
-			rdmad->sge[k].lkey		= lkey;
-			k				= 0;
-
-			tot_len			       += llen;
 			tmp_rdma_task->ib_op		= xio_ib_op;
-			tmp_rdma_task->phantom_idx	= rsize - r - 1;
+			tmp_rdma_task->phantom_idx	= nwr - w - 1;
 
-			/* close the task */
-			list_move_tail(&tmp_task->tasks_list_entry,
-				       &tmp_list);
-			/* advance the remote index */
-			r++;
-			if (r == rsize) {
-				break;
-			} else if (r < rsize - 1) {
-				/* take new task */
-				tmp_task = xio_rdma_primary_task_alloc(
-								   rdma_hndl);
-				if (!tmp_task) {
-					ERROR_LOG(
-					       "primary task pool is empty\n");
-					goto cleanup;
-				}
-			} else {
-				tmp_task = task;
-			}
+			list_move_tail(&tmp_task->tasks_list_entry, &tmp_list);
 			(*tasks_used)++;
-			tmp_rdma_task =
-				(struct xio_rdma_task *)tmp_task->dd_data;
-			rdmad = &tmp_rdma_task->rdmad;
-
-			/* advance the local index */
-			l++;
-			if (l == lsize)
-				break;
+			w++;
+			k = 0;
 
-			laddr	= lsg_list[l].addr;
-			llen	= lsg_list[l].length;
-			lkey	= lsg_list[l].stag;
-
-			raddr	= rsg_list[r].addr;
-			rlen	= rsg_list[r].length;
-			rkey	= rsg_list[r].stag;
+			/* advance the remote index */
+			if (rlen == 0 && ++r < rsize) {
+				raddr	= rsg_list[r].addr;
+				rlen	= rsg_list[r].length;
+				rkey	= rsg_list[r].stag;
+			}
 		}
 	}
 	if (tot_len < op_size) {
@@ -2488,17 +2698,293 @@ static int xio_prep_rdma_op(
 	return 0;
 cleanup:
 
-	/* list does not contain the oringinal task */
+	/* the original task is always the last to be taken */
 	list_for_each_entry_safe(ptask, next_ptask, &tmp_list,
 				 tasks_list_entry) {
 		/* the tmp tasks are returend back to pool */
-		xio_tasks_pool_put(task);
+		if (ptask != task)
+			xio_tasks_pool_put(ptask);
 	}
 	(*tasks_used) = 0;
 
 	return -1;
 }
 
+/*---------------------------------------------------------------------------*/
+/* xio_rdma_stream_init							     */
+/*---------------------------------------------------------------------------*/
+static int xio_rdma_stream_init(struct xio_rdma_transport *rdma_hndl,
+				struct xio_task *task, size_t rlen)
+{
+	XIO_TO_RDMA_TASK(task, rdma_task);
+	struct xio_rdma_stream	*stream;
+	int			i, retval;
+
+	stream = ucalloc(1, sizeof(*stream));
+	if (stream == NULL) {
+		xio_set_error(ENOMEM);
+		ERROR_LOG("ucalloc failed. %m\n");
+		task->imsg.status = ENOMEM;
+		return -1;
+	}
+	stream->task		= task;
+	stream->total_len	= rlen;
+	stream->chunk_sz	= rdma_options.stream_chunk_sz;
+	stream->window		= rdma_options.stream_window;
+
+	/* the chunk buffers are the only memory held by the transfer */
+	for (i = 0; i < stream->window; i++) {
+		retval = xio_rdma_mempool_alloc(rdma_hndl->rdma_mempool,
+						stream->chunk_sz,
+						&stream->bufs[i]);
+		if (retval) {
+			ERROR_LOG("mempool is empty for %u bytes\n",
+				  stream->chunk_sz);
+			task->imsg.status = ENOMEM;
+			xio_rdma_stream_free(stream);
+			return -1;
+		}
+	}
+	rdma_task->stream	= stream;
+	rdma_task->ib_op	= XIO_IB_RDMA_READ;
+
+	/* wait for the preceding rdma reads */
+	list_move_tail(&task->tasks_list_entry, &rdma_hndl->rdma_rd_list);
+
+	xio_xmit_rdma_rd(rdma_hndl);
+
+	return 0;
+}
+
+/*---------------------------------------------------------------------------*/
+/* xio_rdma_stream_post							     */
+/*---------------------------------------------------------------------------*/
+static int xio_rdma_stream_post(struct xio_rdma_transport *rdma_hndl,
+				struct xio_rdma_stream *stream)
+{
+	XIO_TO_RDMA_TASK(stream->task, rdma_task);
+	struct xio_task		*ctask, *ptask;
+	struct xio_rdma_task	*prdma_task, *prev_rdma_task = NULL;
+	struct xio_work_req	*first_wr = NULL;
+	struct xio_rdma_mp_mem	*buf;
+	struct xio_sge		*rsge;
+	struct xio_sge		lsg;
+	struct xio_sge		rsg_list[XIO_MAX_EXT_IOV];
+	struct ibv_mr		*mr;
+	uint32_t		len, rlen, ridx, roff;
+	size_t			rsize;
+	int			tasks_used, num_reqs = 0;
+	int			retval;
+
+	LIST_HEAD(tmp_list);
+
+	while (stream->in_flight < stream->window &&
+	       stream->posted_len < stream->total_len &&
+	       stream->task->state != XIO_TASK_STATE_CANCEL_PENDING) {
+		len = min(stream->chunk_sz,
+			  stream->total_len - stream->posted_len);
+
+		/* slice the peer's list at the read cursor */
+		ridx	= stream->rsge_idx;
+		roff	= stream->rsge_off;
+		rsize	= 0;
+		for (rlen = 0; rlen < len; rsize++) {
+			rsge = &rdma_task->req_write_sge[ridx];
+			rsg_list[rsize].addr	= rsge->addr + roff;
+			rsg_list[rsize].length	= min(rsge->length - roff,
+						      len - rlen);
+			rsg_list[rsize].stag	= rsge->stag;
+
+			rlen += rsg_list[rsize].length;
+			roff += rsg_list[rsize].length;
+			if (roff == rsge->length) {
+				ridx++;
+				roff = 0;
+			}
+		}
+		if (rdma_hndl->sqe_avail <= num_reqs + (int)rsize)
+			break;
+
+		ctask = xio_rdma_primary_task_alloc(rdma_hndl);
+		if (!ctask) {
+			ERROR_LOG("primary task pool is empty\n");
+			break;
+		}
+
+		buf = &stream->bufs[stream->posted_nr % stream->window];
+		mr = xio_rdma_mr_lookup(buf->mr, rdma_hndl->tcq->dev);
+		lsg.addr	= uint64_from_ptr(buf->addr);
+		lsg.length	= len;
+		lsg.stag	= mr->lkey;
+
+		retval = xio_prep_rdma_op(ctask, rdma_hndl,
+					  XIO_IB_RDMA_READ,
+					  IBV_WR_RDMA_READ,
+					  &lsg, 1,
+					  rsg_list, rsize,
+					  len,
+					  1,
+					  &tmp_list, &tasks_used);
+		if (retval) {
+			xio_tasks_pool_put(ctask);
+			break;
+		}
+		((struct xio_rdma_task *)ctask->dd_data)->stream = stream;
+
+		num_reqs		+= tasks_used;
+		stream->rsge_idx	= ridx;
+		stream->rsge_off	= roff;
+		stream->posted_len	+= len;
+		stream->posted_nr++;
+		stream->in_flight++;
+	}
+	if (num_reqs == 0)
+		return 0;
+
+	/* chain the chunks and post them at once */
+	list_for_each_entry(ptask, &tmp_list, tasks_list_entry) {
+		prdma_task = ptask->dd_data;
+		if (first_wr == NULL)
+			first_wr = &prdma_task->rdmad;
+		else
+			prev_rdma_task->rdmad.send_wr.next =
+						&prdma_task->rdmad.send_wr;
+		prev_rdma_task = prdma_task;
+	}
+	list_splice_tail(&tmp_list, &rdma_hndl->rdma_rd_in_flight_list);
+
+	rdma_hndl->rdma_in_flight += num_reqs;
+	retval = xio_post_send(rdma_hndl, first_wr, num_reqs);
+	if (retval)
+		ERROR_LOG("xio_post_send failed\n");
+
+	return retval;
+}
+
+/*---------------------------------------------------------------------------*/
+/* xio_rdma_stream_complete						     */
+/*---------------------------------------------------------------------------*/
+static void xio_rdma_stream_complete(struct xio_rdma_transport *rdma_hndl,
+				     struct xio_rdma_stream *stream)
+{
+	union xio_transport_event_data	event_data;
+	struct xio_task			*task = stream->task;
+	struct xio_transport_base	*transport =
+					(struct xio_transport_base *)rdma_hndl;
+
+	/* release the chunk buffers and the message's fence */
+	xio_rdma_stream_free(stream);
+	rdma_hndl->rdma_in_flight--;
+
+	if (task->state == XIO_TASK_STATE_CANCEL_PENDING) {
+		TRACE_LOG("**** streamed message is canceled\n");
+		xio_rdma_cancel_rsp(transport, task, XIO_E_MSG_CANCELED,
+				    NULL, 0);
+		xio_tasks_pool_put(task);
+	} else {
+		/* the data was handed over in chunks */
+		xio_vmsg_set_data_iovlen(&task->imsg.in, 0);
+		list_move_tail(&task->tasks_list_entry, &rdma_hndl->io_list);
+
+		event_data.msg.op	= XIO_WC_OP_RECV;
+		event_data.msg.task	= task;
+
+		xio_rdma_notify_observer(rdma_hndl, XIO_TRANSPORT_NEW_MESSAGE,
+					 &event_data);
+	}
+	xio_rdma_notify_fenced(rdma_hndl);
+
+	xio_xmit_rdma_rd(rdma_hndl);
+}
+
+/*---------------------------------------------------------------------------*/
+/* xio_rdma_stream_progress						     */
+/*---------------------------------------------------------------------------*/
+static void xio_rdma_stream_progress(struct xio_rdma_transport *rdma_hndl,
+				     struct xio_rdma_stream *stream)
+{
+	if (stream->done_len == stream->total_len ||
+	    (stream->in_flight == 0 &&
+	     stream->task->state == XIO_TASK_STATE_CANCEL_PENDING)) {
+		xio_rdma_stream_complete(rdma_hndl, stream);
+		return;
+	}
+	xio_rdma_stream_post(rdma_hndl, stream);
+
+	/* out of send queue elements or tasks - retry on next completion */
+	rdma_hndl->kick_rdma_rd = (stream->in_flight == 0);
+}
+
+/*---------------------------------------------------------------------------*/
+/* xio_rdma_stream_start						     */
+/*---------------------------------------------------------------------------*/
+static void xio_rdma_stream_start(struct xio_rdma_transport *rdma_hndl,
+				  struct xio_task *task)
+{
+	XIO_TO_RDMA_TASK(task, rdma_task);
+	struct xio_task		*tmp_task;
+	struct xio_rdma_task	*tmp_rdma_task;
+
+	/* the message is never posted. it stays in flight as a fence
+	 * for the receives that follow it
+	 */
+	list_move_tail(&task->tasks_list_entry,
+		       &rdma_hndl->rdma_rd_in_flight_list);
+	rdma_hndl->rdma_in_flight++;
+
+	while (!list_empty(&rdma_hndl->rdma_rd_list)) {
+		tmp_task = list_first_entry(
+				&rdma_hndl->rdma_rd_list,
+				struct xio_task,  tasks_list_entry);
+		tmp_rdma_task = tmp_task->dd_data;
+
+		if (tmp_rdma_task->ib_op != XIO_IB_RECV)
+			break;
+		list_move_tail(&tmp_task->tasks_list_entry,
+			       &rdma_hndl->rdma_rd_in_flight_list);
+		rdma_hndl->rdma_in_flight++;
+	}
+	rdma_hndl->rd_stream = rdma_task->stream;
+
+	xio_rdma_stream_progress(rdma_hndl, rdma_task->stream);
+}
+
+/*---------------------------------------------------------------------------*/
+/* xio_rdma_on_stream_chunk						     */
+/*---------------------------------------------------------------------------*/
+static void xio_rdma_on_stream_chunk(struct xio_rdma_transport *rdma_hndl,
+				     struct xio_task *task)
+{
+	XIO_TO_RDMA_TASK(task, rdma_task);
+	struct xio_rdma_stream		*stream = rdma_task->stream;
+	struct xio_rdma_mp_mem		*buf;
+	union xio_transport_event_data	event_data;
+	uint32_t			len;
+
+	/* the reading task is done */
+	xio_tasks_pool_put(task);
+
+	buf = &stream->bufs[stream->done_nr % stream->window];
+	len = min(stream->chunk_sz, stream->total_len - stream->done_len);
+
+	if (stream->task->state != XIO_TASK_STATE_CANCEL_PENDING) {
+		event_data.chunk.task	= stream->task;
+		event_data.chunk.data	= buf->addr;
+		event_data.chunk.offset	= stream->done_len;
+		event_data.chunk.length	= len;
+
+		xio_rdma_notify_observer(rdma_hndl,
+					 XIO_TRANSPORT_MESSAGE_CHUNK,
+					 &event_data);
+	}
+	stream->done_len += len;
+	stream->done_nr++;
+	stream->in_flight--;
+
+	/* the buffer is free - read the next chunk into it */
+	xio_rdma_stream_progress(rdma_hndl, stream);
+}
+
 /*---------------------------------------------------------------------------*/
 /* xio_sched_rdma_rd_req						     */
 /*---------------------------------------------------------------------------*/
@@ -2508,9 +2994,11 @@ static int xio_sched_rdma_rd_req(struct xio_rdma_transport *rdma_hndl,
 	XIO_TO_RDMA_TASK(task, rdma_task);
 	int			i, retval;
 	int			user_assign_flag = 0;
+	int			stream_flag;
 	size_t			llen = 0, rlen = 0;
 	int			tasks_used = 0;
-	struct xio_sge		lsg_list[XIO_MAX_IOV];
+	struct xio_sge		lsg_list[XIO_MAX_EXT_IOV];
+	struct xio_iovec_ex	*in_iov;
 	size_t			lsg_list_len;
 	struct ibv_mr		*mr;
 
@@ -2521,35 +3009,29 @@ static int xio_sched_rdma_rd_req(struct xio_rdma_transport *rdma_hndl,
 	/* option 2: use internal buffer pool				   */
 
 	/* hint the upper layer of sizes */
+	task->imsg.in.data_iovlen = rdma_task->req_write_num_sge;
+	in_iov = xio_vmsg_data_iov(&task->imsg.in);
 	for (i = 0;  i < rdma_task->req_write_num_sge; i++) {
-		task->imsg.in.data_iov[i].iov_base  = NULL;
-		task->imsg.in.data_iov[i].iov_len  =
-					rdma_task->req_write_sge[i].length;
+		in_iov[i].iov_base  = NULL;
+		in_iov[i].iov_len  = rdma_task->req_write_sge[i].length;
+		in_iov[i].mr  = NULL;
 		rlen += rdma_task->req_write_sge[i].length;
 		rdma_task->read_sge[i].cache = NULL;
 	}
-	task->imsg.in.data_iovlen = rdma_task->req_write_num_sge;
-
-	for (i = 0;  i < rdma_task->req_read_num_sge; i++) {
-		task->imsg.out.data_iov[i].iov_base  = NULL;
-		task->imsg.out.data_iov[i].iov_len  =
-					rdma_task->req_read_sge[i].length;
+	for (i = 0;  i < rdma_task->req_read_num_sge; i++)
 		rdma_task->write_sge[i].cache = NULL;
-	}
-	for (i = 0;  i < rdma_task->req_recv_num_sge; i++) {
-		task->imsg.out.data_iov[i].iov_base  = NULL;
-		task->imsg.out.data_iov[i].iov_len  =
-					rdma_task->req_recv_sge[i].length;
-		task->imsg.out.data_iov[i].mr  = NULL;
-	}
-	if (rdma_task->req_read_num_sge)
-		task->imsg.out.data_iovlen = rdma_task->req_read_num_sge;
-	else if (rdma_task->req_recv_num_sge)
-		task->imsg.out.data_iovlen = rdma_task->req_read_num_sge;
-	else
-		task->imsg.out.data_iovlen = 0;
 
-	xio_rdma_assign_in_buf(rdma_hndl, task, &user_assign_flag);
+	xio_rdma_hint_out_data(task);
+
+	/* offer streaming for messages longer than a chunk */
+	stream_flag = (rdma_hndl->rdma_mempool &&
+		       rlen > (size_t)rdma_options.stream_chunk_sz);
+
+	xio_rdma_assign_in_buf(rdma_hndl, task, &user_assign_flag,
+			       &stream_flag);
+
+	if (stream_flag)
+		return xio_rdma_stream_init(rdma_hndl, task, rlen);
 
 	if (user_assign_flag) {
 		/* if user does not have buffers ignore */
@@ -2559,14 +3041,22 @@ static int xio_sched_rdma_rd_req(struct xio_rdma_transport *rdma_hndl,
 			task->imsg.status = XIO_E_PARTIAL_MSG;
 			return -1;
 		}
+		if (task->imsg.in.data_iovlen > XIO_MAX_EXT_IOV ||
+		    xio_vmsg_data_iov(&task->imsg.in) == NULL) {
+			ERROR_LOG("application provided invalid iovec\n");
+			ERROR_LOG("rdma read is ignored\n");
+			task->imsg.status = EINVAL;
+			return -1;
+		}
+		in_iov = xio_vmsg_data_iov(&task->imsg.in);
 		for (i = 0;  i < task->imsg.in.data_iovlen; i++) {
-			if (task->imsg.in.data_iov[i].mr == NULL) {
+			if (in_iov[i].mr == NULL) {
 				ERROR_LOG("application has not provided mr\n");
 				ERROR_LOG("rdma read is ignored\n");
 				task->imsg.status = EINVAL;
 				return -1;
 			}
-			llen += task->imsg.in.data_iov[i].iov_len;
+			llen += in_iov[i].iov_len;
 		}
 		if (rlen  > llen) {
 			ERROR_LOG("application provided too small iovec\n");
@@ -2600,24 +3090,20 @@ static int xio_sched_rdma_rd_req(struct xio_rdma_transport *rdma_hndl,
 				task->imsg.status = ENOMEM;
 				goto cleanup;
 			}
-			task->imsg.in.data_iov[i].iov_base =
-					rdma_task->read_sge[i].addr;
-			task->imsg.in.data_iov[i].iov_len  =
-					rdma_task->read_sge[i].length;
-			task->imsg.in.data_iov[i].mr =
-					rdma_task->read_sge[i].mr;
+			in_iov[i].iov_base = rdma_task->read_sge[i].addr;
+			in_iov[i].iov_len  = rdma_task->read_sge[i].length;
+			in_iov[i].mr = rdma_task->read_sge[i].mr;
 
-			llen += task->imsg.in.data_iov[i].iov_len;
+			llen += in_iov[i].iov_len;
 		}
 		task->imsg.in.data_iovlen = rdma_task->req_write_num_sge;
 		rdma_task->read_num_sge = rdma_task->req_write_num_sge;
 	}
 
 	for (i = 0;  i < task->imsg.in.data_iovlen; i++) {
-		lsg_list[i].addr = uint64_from_ptr(
-					task->imsg.in.data_iov[i].iov_base);
-		lsg_list[i].length = task->imsg.in.data_iov[i].iov_len;
-		mr = xio_rdma_mr_lookup(task->imsg.in.data_iov[i].mr,
+		lsg_list[i].addr = uint64_from_ptr(in_iov[i].iov_base);
+		lsg_list[i].length = in_iov[i].iov_len;
+		mr = xio_rdma_mr_lookup(in_iov[i].mr,
 					rdma_hndl->tcq->dev);
 		lsg_list[i].stag	= mr->rkey;
 	}
@@ -2665,15 +3151,20 @@ static int xio_sched_rdma_wr_req(struct xio_rdma_transport *rdma_hndl,
 {
 	XIO_TO_RDMA_TASK(task, rdma_task);
 	int			i, retval = 0;
-	struct xio_sge		lsg_list[XIO_MAX_IOV];
+	struct xio_sge		lsg_list[XIO_MAX_EXT_IOV];
+	struct xio_iovec_ex	*out_iov = xio_vmsg_data_iov(&task->omsg->out);
 	struct ibv_mr		*mr;
 	size_t			lsg_list_len;
 	size_t			rlen = 0, llen = 0;
 	int			tasks_used = 0;
 
 
+	if (xio_rdma_task_reserve_sgl(rdma_hndl, task,
+				      task->omsg->out.data_iovlen) != 0)
+		goto cleanup;
+
 	/* user did not provided mr */
-	if (task->omsg->out.data_iov[0].mr == NULL) {
+	if (out_iov[0].mr == NULL) {
 		if (rdma_hndl->rdma_mempool == NULL) {
 			xio_set_error(XIO_E_NO_BUFS);
 			ERROR_LOG(
@@ -2686,19 +3177,19 @@ static int xio_sched_rdma_wr_req(struct xio_rdma_transport *rdma_hndl,
 		for (i = 0; i < task->omsg->out.data_iovlen; i++) {
 			retval = xio_rdma_mempool_alloc(
 					rdma_hndl->rdma_mempool,
-					task->omsg->out.data_iov[i].iov_len,
+					out_iov[i].iov_len,
 					&rdma_task->write_sge[i]);
 			if (retval) {
 				rdma_task->write_num_sge = i;
 				xio_set_error(ENOMEM);
 				ERROR_LOG("mempool is empty for %zd bytes\n",
-					  task->omsg->out.data_iov[i].iov_len);
+					  out_iov[i].iov_len);
 				goto cleanup;
 			}
 			lsg_list[i].addr	= uint64_from_ptr(
 						rdma_task->write_sge[i].addr);
 			lsg_list[i].length	=
-					  task->omsg->out.data_iov[i].iov_len;
+					  out_iov[i].iov_len;
 			mr = xio_rdma_mr_lookup(rdma_task->write_sge[i].mr,
 						rdma_hndl->tcq->dev);
 			lsg_list[i].stag	= mr->lkey;
@@ -2707,16 +3198,16 @@ static int xio_sched_rdma_wr_req(struct xio_rdma_transport *rdma_hndl,
 
 			/* copy the data to the buffer */
 			memcpy(rdma_task->write_sge[i].addr,
-			       task->omsg->out.data_iov[i].iov_base,
-			       task->omsg->out.data_iov[i].iov_len);
+			       out_iov[i].iov_base,
+			       out_iov[i].iov_len);
 		}
 	} else {
 		for (i = 0; i < task->omsg->out.data_iovlen; i++) {
 			lsg_list[i].addr	= uint64_from_ptr(
-					task->omsg->out.data_iov[i].iov_base);
+					out_iov[i].iov_base);
 			lsg_list[i].length	=
-					   task->omsg->out.data_iov[i].iov_len;
-			mr = xio_rdma_mr_lookup(task->omsg->out.data_iov[i].mr,
+					   out_iov[i].iov_len;
+			mr = xio_rdma_mr_lookup(out_iov[i].mr,
 						rdma_hndl->tcq->dev);
 			lsg_list[i].stag	= mr->lkey;
 
@@ -2779,7 +3270,6 @@ static int xio_rdma_on_recv_req(struct xio_rdma_transport *rdma_hndl,
 	struct xio_req_hdr	req_hdr;
 	struct xio_msg		*imsg;
 	void			*ulp_hdr;
-	int			i;
 
 	/* read header */
 	retval = xio_rdma_read_req_header(rdma_hndl, task, &req_hdr);
@@ -2798,6 +3288,8 @@ static int xio_rdma_on_recv_req(struct xio_rdma_transport *rdma_hndl,
 
 	/* save originator identifier */
 	task->rtid		= req_hdr.tid;
+	xio_trace(rdma_hndl->base.ctx, XIO_TRACE_RECV_REQ, 0,
+		  task->ltid, task->rtid);
 	task->imsg.more_in_batch = rdma_task->more_in_batch;
 
 	imsg = &task->imsg;
@@ -2812,24 +3304,7 @@ static int xio_rdma_on_recv_req(struct xio_rdma_transport *rdma_hndl,
 		imsg->in.header.iov_base	= NULL;
 
 	/* hint upper layer about expected response */
-	for (i = 0;  i < rdma_task->req_read_num_sge; i++) {
-		imsg->out.data_iov[i].iov_base  = NULL;
-		imsg->out.data_iov[i].iov_len  =
-					rdma_task->req_read_sge[i].length;
-		imsg->out.data_iov[i].mr  = NULL;
-	}
-	for (i = 0;  i < rdma_task->req_recv_num_sge; i++) {
-		imsg->out.data_iov[i].iov_base  = NULL;
-		imsg->out.data_iov[i].iov_len  =
-					rdma_task->req_recv_sge[i].length;
-		imsg->out.data_iov[i].mr  = NULL;
-	}
-	if (rdma_task->req_read_num_sge)
-		imsg->out.data_iovlen = rdma_task->req_read_num_sge;
-	else if (rdma_task->req_recv_num_sge)
-		imsg->out.data_iovlen = rdma_task->req_read_num_sge;
-	else
-		imsg->out.data_iovlen = 0;
+	xio_rdma_hint_out_data(task);
 
 	switch (req_hdr.opcode) {
 	case XIO_IB_SEND:
@@ -2919,6 +3394,9 @@ static void xio_rdma_write_setup_msg(struct xio_rdma_transport *rdma_hndl,
 	PACK_SVAL(msg, tmp_msg, sq_depth);
 	PACK_SVAL(msg, tmp_msg, rq_depth);
 	PACK_SVAL(msg, tmp_msg, credits);
+	PACK_SVAL(msg, tmp_msg, flags);
+	tmp_msg->pad	= 0;
+	tmp_msg->pad1	= 0;
 
 #ifdef EYAL_TODO
 	print_hex_dump_bytes("post_send: ", DUMP_PREFIX_ADDRESS,
@@ -2955,6 +3433,13 @@ static void xio_rdma_read_setup_msg(struct xio_rdma_transport *rdma_hndl,
 	UNPACK_SVAL(tmp_msg, msg, rq_depth);
 	UNPACK_SVAL(tmp_msg, msg, credits);
 
+	/* the flags are honored only if the peer sent the trailer */
+	if ((uint8_t *)tmp_msg + sizeof(*msg) <=
+	    (uint8_t *)task->mbuf.tlv.tail)
+		UNPACK_SVAL(tmp_msg, msg, flags);
+	else
+		msg->flags = 0;
+
 #ifdef EYAL_TODO
 	print_hex_dump_bytes("post_send: ", DUMP_PREFIX_ADDRESS,
 			     task->mbuf.curr,
@@ -2978,6 +3463,7 @@ static int xio_rdma_send_setup_req(struct xio_rdma_transport *rdma_hndl,
 	req.sq_depth		= rdma_hndl->sq_depth;
 	req.rq_depth		= rdma_hndl->rq_depth;
 	req.credits		= 0;
+	req.flags		= XIO_RDMA_SETUP_IMM_RSP;
 
 	xio_rdma_write_setup_msg(rdma_hndl, task, &req);
 
@@ -3084,6 +3570,7 @@ static int xio_rdma_on_setup_msg(struct xio_rdma_transport *rdma_hndl,
 				      rdma_hndl->max_send_buf_sz);
 		rsp->sq_depth	= min(req.sq_depth, rdma_hndl->rq_depth);
 		rsp->rq_depth	= min(req.rq_depth, rdma_hndl->sq_depth);
+		rsp->flags	= req.flags & XIO_RDMA_SETUP_IMM_RSP;
 	}
 
 	/* save the values */
@@ -3092,6 +3579,9 @@ static int xio_rdma_on_setup_msg(struct xio_rdma_transport *rdma_hndl,
 	rdma_hndl->sq_depth		= rsp->sq_depth;
 	rdma_hndl->membuf_sz		= rsp->buffer_sz;
 	rdma_hndl->max_send_buf_sz	= rsp->buffer_sz;
+	rdma_hndl->setup_flags		= rsp->flags;
+	rdma_hndl->credits_batch	= max(rdma_hndl->rq_depth / 4, 1);
+	rdma_hndl->credits_low_wm	= rdma_hndl->rq_depth / 8;
 
 	/* initialize send window */
 	rdma_hndl->sn = 0;
@@ -3205,6 +3695,8 @@ static int xio_rdma_send_nop(struct xio_rdma_transport *rdma_hndl)
 	rdma_hndl->peer_credits--;
 	xio_post_send(rdma_hndl, &rdma_task->txd, 1);
 
+	xio_ctx_stat_inc(rdma_hndl->base.ctx, XIO_STAT_NOP_TX);
+
 	return 0;
 }
 
@@ -3408,6 +3900,10 @@ static int xio_rdma_cancel_req_handler(struct xio_rdma_transport *rdma_hndl,
 					 &rdma_hndl->rdma_rd_in_flight_list,
 					 tasks_list_entry) {
 			rdma_task = ptask->dd_data;
+			/* skip the tasks reading chunks of a stream */
+			if (rdma_task->stream &&
+			    rdma_task->stream->task != ptask)
+				continue;
 			if (rdma_task->phantom_idx == 0 &&
 			    rdma_task->sn == cancel_hdr->sn) {
 				TRACE_LOG("[%u] - message found on " \
@@ -3751,3 +4247,34 @@ int xio_rdma_cancel_rsp(struct xio_transport_base *transport,
 				    &cancel_hdr, ulp_msg, ulp_msg_sz);
 }
 
+/*---------------------------------------------------------------------------*/
+/* xio_rdma_get_stats							     */
+/*---------------------------------------------------------------------------*/
+int xio_rdma_get_stats(struct xio_transport_base *transport,
+		       struct xio_transport_stats *stats)
+{
+	struct xio_rdma_transport	*rdma_hndl =
+		(struct xio_rdma_transport *)transport;
+	struct xio_rdma_gauges		*g = &rdma_hndl->gauges;
+	uint64_t			now = get_cycles();
+	double				area, span;
+	int				i;
+
+	memset(stats, 0, sizeof(*stats));
+	stats->window_stalls	= g->window_stalls;
+	stats->credit_stalls	= g->credit_stalls;
+	xio_rdma_gauges_read(rdma_hndl, stats->gauge);
+
+	/* nothing sent or completed yet, the mean is the value now */
+	span = g->start ? now - g->start : 0;
+	for (i = 0; i < XIO_TRANSPORT_GAUGE_LAST; i++) {
+		if (span <= 0) {
+			stats->avg_milli[i] = stats->gauge[i] * 1000ULL;
+			continue;
+		}
+		area = g->area[i] + g->last[i] * (double)(now - g->stamp);
+		stats->avg_milli[i] = area * 1000 / span + 0.5;
+	}
+
+	return 0;
+}
@@ -38,6 +38,7 @@
 #include "xio_os.h"
 #include <infiniband/verbs.h>
 #include <rdma/rdma_cma.h>
+#include <sys/eventfd.h>
 
 #include "libxio.h"
 #include "xio_common.h"
@@ -60,6 +61,10 @@
 #define XIO_OPTVAL_DEF_RDMA_BUF_THRESHOLD		SEND_BUF_SZ
 #define XIO_OPTVAL_MIN_RDMA_BUF_THRESHOLD		1024
 #define XIO_OPTVAL_MAX_RDMA_BUF_THRESHOLD		65536
+#define XIO_OPTVAL_DEF_RDMA_STREAM_CHUNK_SZ		XIO_256K_BLOCK_SZ
+#define XIO_OPTVAL_MIN_RDMA_STREAM_CHUNK_SZ		4096
+#define XIO_OPTVAL_MAX_RDMA_STREAM_CHUNK_SZ		XIO_1M_BLOCK_SZ
+#define XIO_OPTVAL_DEF_RDMA_STREAM_WINDOW		4
 
 /*---------------------------------------------------------------------------*/
 /* globals								     */
@@ -84,6 +89,8 @@ struct xio_rdma_options			rdma_options = {
 	.enable_dma_latency		= XIO_OPTVAL_DEF_ENABLE_DMA_LATENCY,
 	.rdma_buf_threshold		= XIO_OPTVAL_DEF_RDMA_BUF_THRESHOLD,
 	.rdma_buf_attr_rdonly		= 0,
+	.stream_chunk_sz		= XIO_OPTVAL_DEF_RDMA_STREAM_CHUNK_SZ,
+	.stream_window			= XIO_OPTVAL_DEF_RDMA_STREAM_WINDOW,
 };
 
 /*---------------------------------------------------------------------------*/
@@ -97,6 +104,7 @@ static void xio_rdma_close(struct xio_transport_base *transport);
 static struct rdma_event_channel *xio_cm_channel_get(struct xio_context *ctx);
 static void xio_rdma_post_close(struct xio_transport_base *transport);
 static int xio_rdma_flush_all_tasks(struct xio_rdma_transport *rdma_hndl);
+static void xio_rdma_handoff_flush(struct xio_cm_channel *channel);
 
 
 /*---------------------------------------------------------------------------*/
@@ -591,12 +599,41 @@ static struct xio_rdma_mempool *xio_rdma_mempool_array_get(
 	return mempool_array[ctx->nodeid];
 }
 
+/*---------------------------------------------------------------------------*/
+/* xio_rdma_mempool_node_usage						     */
+/*---------------------------------------------------------------------------*/
+int xio_rdma_mempool_node_usage(int node,
+				struct xio_rdma_mempool_usage *usage)
+{
+	struct xio_rdma_mempool *mpool;
+
+	if (!mempool_array || node >= mempool_array_len)
+		return -1;
+
+	/* pools are created on the fly and live as long as the array */
+	mpool = ACCESS_ONCE(mempool_array[node]);
+	if (!mpool)
+		return 1;
+
+	xio_rdma_mempool_usage(mpool, usage);
+
+	return 0;
+}
+
 /*---------------------------------------------------------------------------*/
 /* xio_cm_channel_release						     */
 /*---------------------------------------------------------------------------*/
 static void xio_cm_channel_release(struct xio_cm_channel *channel)
 {
+	pthread_rwlock_wrlock(&cm_lock);
 	list_del(&channel->channels_list_entry);
+	pthread_rwlock_unlock(&cm_lock);
+
+	if (channel->accept_fd != -1) {
+		xio_context_del_ev_handler(channel->ctx, channel->accept_fd);
+		xio_rdma_handoff_flush(channel);
+		close(channel->accept_fd);
+	}
 	xio_context_del_ev_handler(channel->ctx, channel->cm_channel->fd);
 	rdma_destroy_event_channel(channel->cm_channel);
 
@@ -613,6 +650,10 @@ static void xio_cm_list_release()
 	pthread_rwlock_wrlock(&cm_lock);
 	list_for_each_entry_safe(channel, next, &cm_list, channels_list_entry) {
 		list_del(&channel->channels_list_entry);
+		if (channel->accept_fd != -1) {
+			xio_rdma_handoff_flush(channel);
+			close(channel->accept_fd);
+		}
 		rdma_destroy_event_channel(channel->cm_channel);
 		ufree(channel);
 	}
@@ -746,7 +787,8 @@ static int xio_setup_qp(struct xio_rdma_transport *rdma_hndl)
 	qp_init_attr.recv_cq			= tcq->cq;
 	qp_init_attr.cap.max_send_wr		= MAX_SEND_WR;
 	qp_init_attr.cap.max_recv_wr		= MAX_RECV_WR + EXTRA_RQE;
-	qp_init_attr.cap.max_send_sge		= MAX_SGE;
+	qp_init_attr.cap.max_send_sge		= min(MAX_SGE,
+						      dev->device_attr.max_sge);
 	qp_init_attr.cap.max_recv_sge		= 1;
 	qp_init_attr.cap.max_inline_data	= MAX_INLINE_DATA;
 
@@ -769,6 +811,12 @@ static int xio_setup_qp(struct xio_rdma_transport *rdma_hndl)
 		ERROR_LOG("ibv_query_qp failed. (errno=%d %m)\n", errno);
 	rdma_hndl->max_inline_data = qp_attr.cap.max_inline_data;
 
+	/* longer local sg lists are chained over several work requests */
+	rdma_hndl->max_sge	= min(qp_init_attr.cap.max_send_sge, MAX_SGE);
+	rdma_hndl->max_sge_rd	= min(rdma_hndl->max_sge,
+				      dev->device_attr.max_sge_rd);
+	if (rdma_hndl->max_sge_rd == 0)
+		rdma_hndl->max_sge_rd = 1;
 
 	list_add(&rdma_hndl->trans_list_entry, &tcq->trans_list);
 
@@ -865,6 +913,14 @@ static void xio_rdma_task_init(struct xio_task *task,
 
 	rdma_task->rdma_hndl = rdma_hndl;
 
+	rdma_task->ext_sgl		= NULL;
+	rdma_task->stream		= NULL;
+	rdma_task->read_sge		= rdma_task->read_sge_arr;
+	rdma_task->write_sge		= rdma_task->write_sge_arr;
+	rdma_task->req_read_sge		= rdma_task->req_read_sge_arr;
+	rdma_task->req_write_sge	= rdma_task->req_write_sge_arr;
+	rdma_task->req_recv_sge		= rdma_task->req_recv_sge_arr;
+
 	xio_rxd_init(&rdma_task->rxd, task, buf, size, srmr);
 	xio_txd_init(&rdma_task->txd, task, buf, size, srmr);
 	xio_rdmad_init(&rdma_task->rdmad, task);
@@ -873,6 +929,121 @@ static void xio_rdma_task_init(struct xio_task *task,
 	xio_mbuf_init(&task->mbuf, buf, size, 0);
 }
 
+/*---------------------------------------------------------------------------*/
+/* xio_rdma_task_reserve_sgl						     */
+/*---------------------------------------------------------------------------*/
+int xio_rdma_task_reserve_sgl(struct xio_rdma_transport *rdma_hndl,
+			      struct xio_task *task, size_t nents)
+{
+	struct xio_rdma_ext_sgl	*ext_sgl;
+	XIO_TO_RDMA_TASK(task, rdma_task);
+
+	if (nents <= XIO_MAX_IOV || rdma_task->ext_sgl)
+		return 0;
+
+	if (nents > XIO_MAX_EXT_IOV) {
+		xio_set_error(XIO_E_MSG_SIZE);
+		ERROR_LOG("sg list too long. nents:%zd, max:%d\n",
+			  nents, XIO_MAX_EXT_IOV);
+		return -1;
+	}
+
+	if (!list_empty(&rdma_hndl->ext_sgl_list)) {
+		ext_sgl = list_first_entry(&rdma_hndl->ext_sgl_list,
+					   struct xio_rdma_ext_sgl,
+					   ext_sgl_list_entry);
+		list_del_init(&ext_sgl->ext_sgl_list_entry);
+	} else {
+		ext_sgl = ucalloc(1, sizeof(*ext_sgl));
+		if (ext_sgl == NULL) {
+			xio_set_error(ENOMEM);
+			ERROR_LOG("ucalloc failed. %m\n");
+			return -1;
+		}
+		INIT_LIST_HEAD(&ext_sgl->ext_sgl_list_entry);
+	}
+
+	/* carry over lists that were already filled */
+	memcpy(ext_sgl->read_sge, rdma_task->read_sge,
+	       rdma_task->read_num_sge * sizeof(*ext_sgl->read_sge));
+	memcpy(ext_sgl->write_sge, rdma_task->write_sge,
+	       rdma_task->write_num_sge * sizeof(*ext_sgl->write_sge));
+	memcpy(ext_sgl->req_read_sge, rdma_task->req_read_sge,
+	       rdma_task->req_read_num_sge * sizeof(struct xio_sge));
+	memcpy(ext_sgl->req_write_sge, rdma_task->req_write_sge,
+	       rdma_task->req_write_num_sge * sizeof(struct xio_sge));
+	memcpy(ext_sgl->req_recv_sge, rdma_task->req_recv_sge,
+	       rdma_task->req_recv_num_sge * sizeof(struct xio_sge));
+
+	rdma_task->ext_sgl		= ext_sgl;
+	rdma_task->read_sge		= ext_sgl->read_sge;
+	rdma_task->write_sge		= ext_sgl->write_sge;
+	rdma_task->req_read_sge		= ext_sgl->req_read_sge;
+	rdma_task->req_write_sge	= ext_sgl->req_write_sge;
+	rdma_task->req_recv_sge		= ext_sgl->req_recv_sge;
+
+	/* long vectors delivered to the application */
+	task->imsg.in.pdata_iov		= ext_sgl->in_iov;
+	task->imsg.out.pdata_iov	= ext_sgl->out_iov;
+
+	return 0;
+}
+
+/*---------------------------------------------------------------------------*/
+/* xio_rdma_task_release_sgl						     */
+/*---------------------------------------------------------------------------*/
+static void xio_rdma_task_release_sgl(struct xio_rdma_transport *rdma_hndl,
+				      struct xio_task *task)
+{
+	XIO_TO_RDMA_TASK(task, rdma_task);
+
+	if (rdma_task->ext_sgl == NULL)
+		return;
+
+	list_add(&rdma_task->ext_sgl->ext_sgl_list_entry,
+		 &rdma_hndl->ext_sgl_list);
+
+	rdma_task->ext_sgl		= NULL;
+	rdma_task->read_sge		= rdma_task->read_sge_arr;
+	rdma_task->write_sge		= rdma_task->write_sge_arr;
+	rdma_task->req_read_sge		= rdma_task->req_read_sge_arr;
+	rdma_task->req_write_sge	= rdma_task->req_write_sge_arr;
+	rdma_task->req_recv_sge		= rdma_task->req_recv_sge_arr;
+
+	task->imsg.in.pdata_iov		= NULL;
+	task->imsg.out.pdata_iov	= NULL;
+}
+
+/*---------------------------------------------------------------------------*/
+/* xio_rdma_stream_free							     */
+/*---------------------------------------------------------------------------*/
+void xio_rdma_stream_free(struct xio_rdma_stream *stream)
+{
+	XIO_TO_RDMA_TASK(stream->task, rdma_task);
+	struct xio_rdma_transport	*rdma_hndl = rdma_task->rdma_hndl;
+	struct xio_task			*ptask;
+	struct xio_rdma_task		*prdma_task;
+	int				i;
+
+	if (rdma_hndl->rd_stream == stream)
+		rdma_hndl->rd_stream = NULL;
+
+	/* detach chunk readers that are still in flight (flush) */
+	list_for_each_entry(ptask, &rdma_hndl->rdma_rd_in_flight_list,
+			    tasks_list_entry) {
+		prdma_task = ptask->dd_data;
+		if (prdma_task->stream == stream)
+			prdma_task->stream = NULL;
+	}
+
+	for (i = 0; i < stream->window; i++) {
+		if (stream->bufs[i].cache)
+			xio_rdma_mempool_free(&stream->bufs[i]);
+	}
+	rdma_task->stream = NULL;
+	ufree(stream);
+}
+
 /*---------------------------------------------------------------------------*/
 /* xio_rdma_flush_task_list						     */
 /*---------------------------------------------------------------------------*/
@@ -957,6 +1128,8 @@ void xio_rdma_calc_pool_size(struct xio_rdma_transport *rdma_hndl)
 	rdma_hndl->alloc_sz  = rdma_hndl->num_tasks*rdma_hndl->membuf_sz;
 
 	rdma_hndl->max_tx_ready_tasks_num = 2*rdma_hndl->sq_depth;
+	/* xio_rdma_send_req keeps one slot for responses */
+	rdma_hndl->base.tx_window = rdma_hndl->max_tx_ready_tasks_num - 1;
 
 	TRACE_LOG("pool size:  alloc_sz:%zd, num_tasks:%d, buf_sz:%zd\n",
 		  rdma_hndl->alloc_sz,
@@ -1262,7 +1435,19 @@ static int xio_rdma_task_pre_put(
 	}
 	rdma_task->write_num_sge = 0;
 
+	xio_rdma_task_release_sgl((struct xio_rdma_transport *)trans_hndl,
+				  task);
+
+	/* chunk readers only point at the stream of their message */
+	if (rdma_task->stream) {
+		if (rdma_task->stream->task == task)
+			xio_rdma_stream_free(rdma_task->stream);
+		rdma_task->stream = NULL;
+	}
+
 	rdma_task->txd.send_wr.num_sge = 1;
+	rdma_task->txd.send_wr.opcode = IBV_WR_SEND;
+	rdma_task->imm_data = 0;
 	rdma_task->ib_op = XIO_IB_NULL;
 	rdma_task->phantom_idx = 0;
 	rdma_task->sn = 0;
@@ -1302,6 +1487,7 @@ static void xio_rdma_post_close(struct xio_transport_base *transport)
 {
 	struct xio_rdma_transport *rdma_hndl =
 		(struct xio_rdma_transport *)transport;
+	struct xio_rdma_ext_sgl	*ext_sgl, *next_ext_sgl;
 
 	TRACE_LOG("rdma transport: [post close] handle:%p, qp:%p\n",
 		  rdma_hndl, rdma_hndl->qp);
@@ -1312,6 +1498,13 @@ static void xio_rdma_post_close(struct xio_transport_base *transport)
 	if (rdma_hndl->cm_id)
 		rdma_destroy_id(rdma_hndl->cm_id);
 
+	list_for_each_entry_safe(ext_sgl, next_ext_sgl,
+				 &rdma_hndl->ext_sgl_list,
+				 ext_sgl_list_entry) {
+		list_del(&ext_sgl->ext_sgl_list_entry);
+		ufree(ext_sgl);
+	}
+
 	ufree(rdma_hndl->base.portal_uri);
 
 	ufree(rdma_hndl);
@@ -1385,6 +1578,219 @@ notify_err1:
 	xio_rdma_notify_observer_error(rdma_hndl, xio_errno());
 }
 
+/*---------------------------------------------------------------------------*/
+/* xio_rdma_release_ctx							     */
+/*---------------------------------------------------------------------------*/
+static void xio_rdma_release_ctx(struct xio_rdma_transport *parent_hndl,
+				 struct xio_context *ctx)
+{
+	union xio_transport_event_data	event_data;
+
+	/* the connection will not open on the context the server picked */
+	event_data.accept_ctx.peer_addr = NULL;
+	event_data.accept_ctx.ctx	= ctx;
+	event_data.accept_ctx.release	= 1;
+	xio_rdma_notify_observer(parent_hndl,
+				 XIO_TRANSPORT_ACCEPT_CTX,
+				 &event_data);
+}
+
+/*---------------------------------------------------------------------------*/
+/* xio_rdma_new_child							     */
+/*---------------------------------------------------------------------------*/
+static int xio_rdma_new_child(struct xio_rdma_transport *parent_hndl,
+			      struct xio_rdma_transport *child_hndl)
+{
+	union xio_transport_event_data	event_data;
+	struct xio_context		*ctx = child_hndl->base.ctx;
+	int	retval;
+
+	retval = xio_setup_qp(child_hndl);
+	if (retval != 0) {
+		ERROR_LOG("failed to setup qp\n");
+		xio_rdma_close((struct xio_transport_base *)child_hndl);
+		xio_rdma_release_ctx(parent_hndl, ctx);
+		return -1;
+	}
+
+	event_data.new_connection.child_trans_hndl =
+		(struct xio_transport_base *)child_hndl;
+	xio_rdma_notify_observer(parent_hndl,
+				 XIO_TRANSPORT_NEW_CONNECTION,
+				 &event_data);
+
+	return 0;
+}
+
+/*---------------------------------------------------------------------------*/
+/* xio_cm_channel_lookup - caller holds cm_lock				     */
+/*---------------------------------------------------------------------------*/
+static struct xio_cm_channel *xio_cm_channel_lookup(struct xio_context *ctx)
+{
+	struct xio_cm_channel	*channel;
+
+	list_for_each_entry(channel, &cm_list, channels_list_entry) {
+		if (channel->ctx == ctx)
+			return channel;
+	}
+
+	return NULL;
+}
+
+/*---------------------------------------------------------------------------*/
+/* xio_rdma_handoff							     */
+/*---------------------------------------------------------------------------*/
+static int xio_rdma_handoff(struct xio_rdma_transport *parent_hndl,
+			    struct xio_rdma_transport *child_hndl)
+{
+	struct xio_cm_channel	*channel;
+	struct xio_rdma_handoff	*handoff;
+	int			retval = -1;
+
+	handoff = ucalloc(1, sizeof(*handoff));
+	if (!handoff) {
+		xio_set_error(ENOMEM);
+		ERROR_LOG("ucalloc failed. %m\n");
+		return -1;
+	}
+	handoff->parent_hndl	= parent_hndl;
+	handoff->child_hndl	= child_hndl;
+
+	/* the lock keeps the worker from releasing its channel meanwhile */
+	pthread_rwlock_rdlock(&cm_lock);
+	channel = xio_cm_channel_lookup(child_hndl->base.ctx);
+	if (!channel || channel->accept_fd == -1) {
+		xio_set_error(ENODEV);
+		goto unlock;
+	}
+
+	/* the request event is accounted on the listener's id so the
+	 * new id may move before the event is acked. from now on its
+	 * events are delivered on the worker's thread */
+	if (rdma_migrate_id(child_hndl->cm_id, channel->cm_channel)) {
+		xio_set_error(errno);
+		ERROR_LOG("rdma_migrate_id failed. (errno=%d %m)\n", errno);
+		goto unlock;
+	}
+
+	/* the worker notifies the listener - keep it around until then */
+	atomic_inc(&parent_hndl->base.refcnt);
+
+	spin_lock(&channel->accept_lock);
+	list_add_tail(&handoff->accept_list_entry, &channel->accept_list);
+	spin_unlock(&channel->accept_lock);
+
+	eventfd_write(channel->accept_fd, 1);
+	retval = 0;
+
+unlock:
+	pthread_rwlock_unlock(&cm_lock);
+	if (retval)
+		ufree(handoff);
+
+	return retval;
+}
+
+/*---------------------------------------------------------------------------*/
+/* xio_rdma_accept_ev_handler						     */
+/*---------------------------------------------------------------------------*/
+static void xio_rdma_accept_ev_handler(int fd, int events, void *user_context)
+{
+	struct xio_cm_channel	*channel = user_context;
+	struct xio_rdma_handoff	*handoff, *next;
+	eventfd_t		val;
+	LIST_HEAD(accept_list);
+
+	eventfd_read(fd, &val);
+
+	spin_lock(&channel->accept_lock);
+	list_splice_init(&channel->accept_list, &accept_list);
+	spin_unlock(&channel->accept_lock);
+
+	list_for_each_entry_safe(handoff, next, &accept_list,
+				 accept_list_entry) {
+		list_del(&handoff->accept_list_entry);
+		if (xio_rdma_new_child(handoff->parent_hndl,
+				       handoff->child_hndl))
+			ERROR_LOG("failed to open handed over connection\n");
+		xio_rdma_close((struct xio_transport_base *)
+			       handoff->parent_hndl);
+		ufree(handoff);
+	}
+}
+
+/*---------------------------------------------------------------------------*/
+/* xio_rdma_handoff_flush						     */
+/*---------------------------------------------------------------------------*/
+static void xio_rdma_handoff_flush(struct xio_cm_channel *channel)
+{
+	struct xio_rdma_handoff	*handoff, *next;
+
+	/* the worker is going down - refuse what it did not take yet */
+	list_for_each_entry_safe(handoff, next, &channel->accept_list,
+				 accept_list_entry) {
+		list_del(&handoff->accept_list_entry);
+		xio_rdma_release_ctx(handoff->parent_hndl,
+				     handoff->child_hndl->base.ctx);
+		rdma_reject(handoff->child_hndl->cm_id, NULL, 0);
+		rdma_destroy_id(handoff->child_hndl->cm_id);
+		ufree(handoff->child_hndl);
+		xio_rdma_close((struct xio_transport_base *)
+			       handoff->parent_hndl);
+		ufree(handoff);
+	}
+}
+
+/*---------------------------------------------------------------------------*/
+/* xio_rdma_attach_ctx							     */
+/*---------------------------------------------------------------------------*/
+static int xio_rdma_attach_ctx(struct xio_transport_base *trans_hndl,
+			       struct xio_context *ctx)
+{
+	struct xio_cm_channel	*channel;
+	int			fd;
+	int			retval;
+
+	/* create what handed over connections need on the worker's own
+	 * thread - the listener only looks these up */
+	if (rdma_options.enable_mem_pool &&
+	    xio_rdma_mempool_array_get(ctx) == NULL)
+		return -1;
+
+	if (xio_cm_channel_get(ctx) == NULL)
+		return -1;
+
+	pthread_rwlock_rdlock(&cm_lock);
+	channel = xio_cm_channel_lookup(ctx);
+	pthread_rwlock_unlock(&cm_lock);
+	if (channel == NULL || channel->accept_fd != -1)
+		return 0;
+
+	fd = eventfd(0, EFD_NONBLOCK);
+	if (fd < 0) {
+		xio_set_error(errno);
+		ERROR_LOG("eventfd failed. %m\n");
+		return -1;
+	}
+
+	retval = xio_context_add_ev_handler(ctx, fd, XIO_POLLIN,
+					    xio_rdma_accept_ev_handler,
+					    channel);
+	if (retval != 0) {
+		xio_set_error(errno);
+		ERROR_LOG("Adding to event loop failed (errno=%d %m)\n",
+			  errno);
+		close(fd);
+		return -1;
+	}
+
+	pthread_rwlock_wrlock(&cm_lock);
+	channel->accept_fd = fd;
+	pthread_rwlock_unlock(&cm_lock);
+
+	return 0;
+}
+
 /*---------------------------------------------------------------------------*/
 /* on_cm_connect_request						     */
 /*---------------------------------------------------------------------------*/
@@ -1392,20 +1798,43 @@ static void  on_cm_connect_request(struct rdma_cm_event *ev,
 		struct xio_rdma_transport *parent_hndl)
 {
 	struct xio_rdma_transport	*child_hndl;
+	struct xio_cm_channel		*channel;
+	struct xio_context		*ctx = parent_hndl->base.ctx;
+	struct xio_context		*picked;
 	union xio_transport_event_data	event_data;
-	int	retval = 0;
+
+	/* the server may run the connection on one of its workers */
+	event_data.accept_ctx.peer_addr =
+		(struct sockaddr_storage *)&ev->id->route.addr.dst_addr;
+	event_data.accept_ctx.ctx = NULL;
+	event_data.accept_ctx.release = 0;
+	xio_rdma_notify_observer(parent_hndl,
+				 XIO_TRANSPORT_ACCEPT_CTX,
+				 &event_data);
+	picked = event_data.accept_ctx.ctx;
+	if (picked && picked != ctx) {
+		pthread_rwlock_rdlock(&cm_lock);
+		channel = xio_cm_channel_lookup(picked);
+		if (channel && channel->accept_fd != -1)
+			ctx = picked;
+		pthread_rwlock_unlock(&cm_lock);
+		/* the worker went away - the listener runs it instead */
+		if (ctx != picked)
+			xio_rdma_release_ctx(parent_hndl, picked);
+	}
 
 	child_hndl = (struct xio_rdma_transport *)xio_rdma_open(
 		parent_hndl->transport,
-		parent_hndl->base.ctx,
+		ctx,
 		NULL);
 	if (child_hndl == NULL) {
 		ERROR_LOG("failed to open rdma transport\n");
+		if (ctx == picked)
+			xio_rdma_release_ctx(parent_hndl, ctx);
 		goto notify_err1;
 	}
 
 	child_hndl->cm_id	= ev->id;
-	child_hndl->tcq		= parent_hndl->tcq;
 	ev->id->context		= child_hndl;
 	child_hndl->client_initiator_depth =
 		ev->param.conn.initiator_depth;
@@ -1418,22 +1847,22 @@ static void  on_cm_connect_request(struct rdma_cm_event *ev,
 	       sizeof(child_hndl->base.peer_addr));
 	child_hndl->base.proto = XIO_PROTO_RDMA;
 
-	retval = xio_setup_qp(child_hndl);
-	if (retval != 0) {
-		ERROR_LOG("failed to setup qp\n");
-		goto notify_err2;
+	if (ctx != parent_hndl->base.ctx) {
+		if (xio_rdma_handoff(parent_hndl, child_hndl) != 0) {
+			ERROR_LOG("failed to hand over connection\n");
+			goto notify_err2;
+		}
+		return;
 	}
 
-	event_data.new_connection.child_trans_hndl =
-		(struct xio_transport_base *)child_hndl;
-	xio_rdma_notify_observer(parent_hndl,
-				 XIO_TRANSPORT_NEW_CONNECTION,
-				 &event_data);
+	if (xio_rdma_new_child(parent_hndl, child_hndl) != 0)
+		goto notify_err1;
 
 	return;
 
 notify_err2:
 	xio_rdma_close((struct xio_transport_base *)child_hndl);
+	xio_rdma_release_ctx(parent_hndl, ctx);
 
 notify_err1:
 	xio_rdma_notify_observer_error(parent_hndl, xio_errno());
@@ -1680,6 +2109,9 @@ static struct rdma_event_channel *xio_cm_channel_get(struct xio_context *ctx)
 		goto cleanup;
 	}
 	channel->ctx = ctx;
+	channel->accept_fd = -1;
+	INIT_LIST_HEAD(&channel->accept_list);
+	spin_lock_init(&channel->accept_lock);
 
 	pthread_rwlock_wrlock(&cm_lock);
 	list_add(&channel->channels_list_entry, &cm_list);
@@ -1752,6 +2184,7 @@ static struct xio_transport_base *xio_rdma_open(
 	INIT_LIST_HEAD(&rdma_hndl->rx_list);
 	INIT_LIST_HEAD(&rdma_hndl->io_list);
 	INIT_LIST_HEAD(&rdma_hndl->rdma_rd_list);
+	INIT_LIST_HEAD(&rdma_hndl->ext_sgl_list);
 
 	TRACE_LOG("xio_rdma_open: [new] handle:%p\n", rdma_hndl);
 
@@ -2060,6 +2493,26 @@ static int xio_rdma_set_opt(void *xio_obj,
 			ALIGN(rdma_options.rdma_buf_threshold, 1024);
 		return 0;
 		break;
+	case XIO_OPTNAME_RDMA_STREAM_CHUNK_SZ:
+		VALIDATE_SZ(sizeof(int));
+		if (*(int *)optval < XIO_OPTVAL_MIN_RDMA_STREAM_CHUNK_SZ ||
+		    *(int *)optval > XIO_OPTVAL_MAX_RDMA_STREAM_CHUNK_SZ) {
+			xio_set_error(EINVAL);
+			return -1;
+		}
+		rdma_options.stream_chunk_sz = *((int *)optval);
+		return 0;
+		break;
+	case XIO_OPTNAME_RDMA_STREAM_WINDOW:
+		VALIDATE_SZ(sizeof(int));
+		if (*(int *)optval < 1 ||
+		    *(int *)optval > XIO_MAX_STREAM_WINDOW) {
+			xio_set_error(EINVAL);
+			return -1;
+		}
+		rdma_options.stream_window = *((int *)optval);
+		return 0;
+		break;
 	default:
 		break;
 	}
@@ -2090,6 +2543,14 @@ static int xio_rdma_get_opt(void  *xio_obj,
 				XIO_OPTVAL_MIN_RDMA_BUF_THRESHOLD;
 		*optlen = sizeof(int);
 		return 0;
+	case XIO_OPTNAME_RDMA_STREAM_CHUNK_SZ:
+		*((int *)optval) = rdma_options.stream_chunk_sz;
+		*optlen = sizeof(int);
+		return 0;
+	case XIO_OPTNAME_RDMA_STREAM_WINDOW:
+		*((int *)optval) = rdma_options.stream_window;
+		*optlen = sizeof(int);
+		return 0;
 	default:
 		break;
 	}
@@ -2209,8 +2670,13 @@ static int xio_rdma_is_valid_in_req(struct xio_msg *msg)
 	int		i;
 	int		mr_found = 0;
 	struct xio_vmsg *vmsg = &msg->in;
+	struct xio_iovec_ex *iov;
+
+	if (vmsg->data_iovlen > XIO_MAX_EXT_IOV)
+		return 0;
 
-	if (vmsg->data_iovlen >= XIO_MAX_IOV)
+	iov = xio_vmsg_data_iov(vmsg);
+	if (iov == NULL)
 		return 0;
 
 	if ((vmsg->header.iov_base != NULL)  &&
@@ -2218,13 +2684,13 @@ static int xio_rdma_is_valid_in_req(struct xio_msg *msg)
 		return 0;
 
 	for (i = 0; i < vmsg->data_iovlen; i++) {
-		if (vmsg->data_iov[i].mr)
+		if (iov[i].mr)
 			mr_found++;
-		if (vmsg->data_iov[i].iov_base == NULL) {
-			if (vmsg->data_iov[i].mr)
+		if (iov[i].iov_base == NULL) {
+			if (iov[i].mr)
 				return 0;
 		} else {
-			if (vmsg->data_iov[i].iov_len == 0)
+			if (iov[i].iov_len == 0)
 				return 0;
 		}
 	}
@@ -2242,8 +2708,13 @@ static int xio_rdma_is_valid_out_msg(struct xio_msg *msg)
 	int		i;
 	int		mr_found = 0;
 	struct xio_vmsg *vmsg = &msg->out;
+	struct xio_iovec_ex *iov;
+
+	if (vmsg->data_iovlen > XIO_MAX_EXT_IOV)
+		return 0;
 
-	if (vmsg->data_iovlen >= XIO_MAX_IOV)
+	iov = xio_vmsg_data_iov(vmsg);
+	if (iov == NULL)
 		return 0;
 
 	if (((vmsg->header.iov_base != NULL)  &&
@@ -2253,10 +2724,10 @@ static int xio_rdma_is_valid_out_msg(struct xio_msg *msg)
 			return 0;
 
 	for (i = 0; i < vmsg->data_iovlen; i++) {
-		if (vmsg->data_iov[i].mr)
+		if (iov[i].mr)
 			mr_found++;
-		if ((vmsg->data_iov[i].iov_base == NULL) ||
-		    (vmsg->data_iov[i].iov_len == 0))
+		if ((iov[i].iov_base == NULL) ||
+		    (iov[i].iov_len == 0))
 				return 0;
 	}
 	if ((mr_found != vmsg->data_iovlen) && mr_found)
@@ -2302,6 +2773,7 @@ static struct xio_transport xio_rdma_transport = {
 	.connect		= xio_rdma_connect,
 	.listen			= xio_rdma_listen,
 	.accept			= xio_rdma_accept,
+	.attach_ctx		= xio_rdma_attach_ctx,
 	.reject			= xio_rdma_reject,
 	.close			= xio_rdma_close,
 	.send			= xio_rdma_send,
@@ -2310,6 +2782,7 @@ static struct xio_transport xio_rdma_transport = {
 	.get_opt		= xio_rdma_get_opt,
 	.cancel_req		= xio_rdma_cancel_req,
 	.cancel_rsp		= xio_rdma_cancel_rsp,
+	.get_stats		= xio_rdma_get_stats,
 	.reg_observer		= xio_transport_reg_observer,
 	.unreg_observer		= xio_transport_unreg_observer,
 	.get_pools_setup_ops	= xio_rdma_get_pools_ops,
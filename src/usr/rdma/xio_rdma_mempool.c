@@ -75,7 +75,7 @@ struct xio_mem_slot {
 	int				max_mb_nr;	/* max allowed size */
 	int				alloc_mb_nr;	/* number of items
 							   per allcoation */
-	int				pad;
+	volatile int			used_mb_nr;	/* handed out */
 };
 
 struct xio_rdma_mempool {
@@ -401,6 +401,9 @@ retry:
 		pthread_spin_unlock(&slot->lock);
 	}
 
+	/* shares the line of free_blocks_list, already contended */
+	__sync_fetch_and_add(&slot->used_mb_nr, 1);
+
 	mp_mem->addr	= block->buf;
 	mp_mem->mr	= block->omr;
 	mp_mem->cache	= block;
@@ -422,6 +425,24 @@ void xio_rdma_mempool_free(struct xio_rdma_mp_mem *mp_mem)
 
 	block = mp_mem->cache;
 
+	__sync_fetch_and_sub(&block->parent_slot->used_mb_nr, 1);
 	release(block->parent_slot, block);
 }
 
+/*---------------------------------------------------------------------------*/
+/* xio_rdma_mempool_usage						     */
+/*---------------------------------------------------------------------------*/
+void xio_rdma_mempool_usage(struct xio_rdma_mempool *p,
+			    struct xio_rdma_mempool_usage *usage)
+{
+	int i;
+
+	/* plain reads, a gauge may be a block or two off */
+	for (i = 0; i < XIO_MEM_SLOTS_NR; i++) {
+		usage[i].mb_size	= p->slot[i].mb_size;
+		usage[i].max_mb_nr	= p->slot[i].max_mb_nr;
+		usage[i].curr_mb_nr	= ACCESS_ONCE(p->slot[i].curr_mb_nr);
+		usage[i].used_mb_nr	= p->slot[i].used_mb_nr;
+	}
+}
+
@@ -81,6 +81,24 @@ int xio_rdma_mempool_alloc(struct xio_rdma_mempool *mpool,
 			     size_t length, struct xio_rdma_mp_mem *mp_mem);
 void xio_rdma_mempool_free(struct xio_rdma_mp_mem *mp_mem);
 
+/* occupancy of the XIO_MEM_SLOTS_NR block sizes of a pool */
+struct xio_rdma_mempool_usage {
+	size_t		mb_size;
+	int		max_mb_nr;
+	int		curr_mb_nr;	/* allocated */
+	int		used_mb_nr;	/* handed out */
+	int		pad;
+};
+
+void xio_rdma_mempool_usage(struct xio_rdma_mempool *mpool,
+			    struct xio_rdma_mempool_usage *usage);
+
+/* usage of the pool of a numa node. 1 when the node has no pool yet, -1
+ * past the last node
+ */
+int xio_rdma_mempool_node_usage(int node,
+				struct xio_rdma_mempool_usage *usage);
+
 
 #endif
 
@@ -58,6 +58,9 @@ extern struct list_head		dev_list;
 
 #define MAX_SGE				(XIO_MAX_IOV + 1)
 
+/* streaming of large incoming messages */
+#define XIO_MAX_STREAM_WINDOW		16
+
 #define MAX_SEND_WR			256
 #define MAX_RECV_WR			256
 #define EXTRA_RQE			32
@@ -138,6 +141,8 @@ struct xio_rdma_options {
 	int			enable_dma_latency;
 	int			rdma_buf_threshold;
 	int			rdma_buf_attr_rdonly;
+	int			stream_chunk_sz;
+	int			stream_window;
 };
 
 struct xio_sge {
@@ -147,7 +152,7 @@ struct xio_sge {
 
 };
 
-#define XIO_REQ_HEADER_VERSION	1
+#define XIO_REQ_HEADER_VERSION	2
 
 struct __attribute__((__packed__)) xio_req_hdr {
 	uint8_t			version;	/* request version	*/
@@ -159,12 +164,15 @@ struct __attribute__((__packed__)) xio_req_hdr {
 	uint16_t		credits;	/* peer send credits	*/
 	uint16_t		tid;		/* originator identifier*/
 	uint8_t			opcode;		/* opcode  for peers	*/
-	uint8_t			recv_num_sge;
-	uint8_t			read_num_sge;
-	uint8_t			write_num_sge;
+	uint8_t			pad;
 
+	uint16_t		recv_num_sge;
+	uint16_t		read_num_sge;
+	uint16_t		write_num_sge;
 	uint16_t		ulp_hdr_len;	/* ulp header length	*/
+
 	uint16_t		ulp_pad_len;	/* pad_len length	*/
+	uint16_t		pad1;
 	uint32_t		remain_data_len;/* remaining data length */
 	uint64_t		ulp_imm_len;	/* ulp data length	*/
 };
@@ -195,10 +203,34 @@ struct __attribute__((__packed__)) xio_rdma_setup_msg {
 	uint16_t		credits;	/* peer send credits	*/
 	uint16_t		sq_depth;
 	uint16_t		rq_depth;
-	uint16_t		pad;
+	uint16_t		pad;		/* garbage from old peers */
 	uint64_t		buffer_sz;
+	/* trailer - older peers send a tlv that ends before it */
+	uint16_t		flags;		/* XIO_RDMA_SETUP_ flags */
+	uint16_t		pad1;
 };
 
+/* the sender accepts responses carried in immediate data */
+#define XIO_RDMA_SETUP_IMM_RSP	0x1
+
+/* responses with no header and up to XIO_IMM_RSP_MAX_LEN bytes of data are
+ * sent as SEND with immediate. the immediate value carries the
+ * originator's task id, the payload length and the piggybacked credits.
+ * the payload itself is the send data. no xio_rsp_hdr nor serial number
+ * goes on the wire
+ */
+#define XIO_IMM_RSP_MAX_LEN		4
+#define XIO_IMM_RSP_MAX_CREDITS		0x7ff
+#define XIO_IMM_RSP_MARK		0x80000000
+
+#define XIO_IMM_RSP(tid, len, credits)	(XIO_IMM_RSP_MARK |		\
+					 ((uint32_t)(credits) << 19) |	\
+					 ((uint32_t)(len) << 16) |	\
+					 ((tid) & 0xffff))
+#define XIO_IMM_RSP_TID(imm)		((imm) & 0xffff)
+#define XIO_IMM_RSP_LEN(imm)		(((imm) >> 16) & 0x7)
+#define XIO_IMM_RSP_CREDITS(imm)	(((imm) >> 19) & XIO_IMM_RSP_MAX_CREDITS)
+
 struct __attribute__((__packed__)) xio_nop_hdr {
 	uint16_t		hdr_len;	 /* req header length	*/
 	uint16_t		sn;		/* serial number	*/
@@ -236,7 +268,7 @@ struct xio_rdma_task {
 	uint32_t			req_recv_num_sge;
 	uint16_t			sn;
 	uint16_t			more_in_batch;
-	uint32_t			pad;
+	uint32_t			imm_data;	/* immediate response */
 
 
 	/* The buffer mapped with the 3 xio_work_req
@@ -246,18 +278,66 @@ struct xio_rdma_task {
 	struct xio_work_req		rxd;
 	struct xio_work_req		rdmad;
 
+	/* The sge lists below point either to the embedded arrays or,
+	 * for messages longer than XIO_MAX_IOV, to ext_sgl
+	 */
+	struct xio_rdma_ext_sgl		*ext_sgl;
+
+	/* set on a streamed message and on the tasks reading its chunks */
+	struct xio_rdma_stream		*stream;
+
 	/* User (from vmsg) or pool buffer used for */
-	struct xio_rdma_mp_mem		read_sge[XIO_MAX_IOV];
-	struct xio_rdma_mp_mem		write_sge[XIO_MAX_IOV];
+	struct xio_rdma_mp_mem		*read_sge;
+	struct xio_rdma_mp_mem		*write_sge;
 
 	/* What this side got from the peer for RDMA R/W
 	 */
-	struct xio_sge			req_read_sge[XIO_MAX_IOV];
-	struct xio_sge			req_write_sge[XIO_MAX_IOV];
+	struct xio_sge			*req_read_sge;
+	struct xio_sge			*req_write_sge;
 
 	/* What this side got from the peer for SEND
 	 */
-	struct xio_sge			req_recv_sge[XIO_MAX_IOV];
+	struct xio_sge			*req_recv_sge;
+
+	struct xio_rdma_mp_mem		read_sge_arr[XIO_MAX_IOV];
+	struct xio_rdma_mp_mem		write_sge_arr[XIO_MAX_IOV];
+	struct xio_sge			req_read_sge_arr[XIO_MAX_IOV];
+	struct xio_sge			req_write_sge_arr[XIO_MAX_IOV];
+	struct xio_sge			req_recv_sge_arr[XIO_MAX_IOV];
+};
+
+/* sge lists for messages with more than XIO_MAX_IOV fragments. cached
+ * on the transport and attached to tasks on demand
+ */
+struct xio_rdma_ext_sgl {
+	struct list_head		ext_sgl_list_entry;
+	struct xio_rdma_mp_mem		read_sge[XIO_MAX_EXT_IOV];
+	struct xio_rdma_mp_mem		write_sge[XIO_MAX_EXT_IOV];
+	struct xio_sge			req_read_sge[XIO_MAX_EXT_IOV];
+	struct xio_sge			req_write_sge[XIO_MAX_EXT_IOV];
+	struct xio_sge			req_recv_sge[XIO_MAX_EXT_IOV];
+
+	/* vectors handed to the application in the task's imsg */
+	struct xio_iovec_ex		in_iov[XIO_MAX_EXT_IOV];
+	struct xio_iovec_ex		out_iov[XIO_MAX_EXT_IOV];
+};
+
+/* state of a message whose data is read in chunks. chunks complete in
+ * order, so chunk n always lands in bufs[n % window]
+ */
+struct xio_rdma_stream {
+	struct xio_task			*task;		/* streamed message */
+	uint64_t			total_len;
+	uint64_t			posted_len;
+	uint64_t			done_len;
+	uint32_t			posted_nr;	/* chunks posted    */
+	uint32_t			done_nr;	/* chunks delivered */
+	uint32_t			chunk_sz;
+	uint16_t			window;
+	uint16_t			in_flight;
+	uint32_t			rsge_idx;	/* remote read cursor */
+	uint32_t			rsge_off;
+	struct xio_rdma_mp_mem		bufs[XIO_MAX_STREAM_WINDOW];
 };
 
 struct xio_cq  {
@@ -315,6 +395,20 @@ struct xio_rdma_tasks_pool {
 	int				pad;
 };
 
+/* queue gauges integrated over time. a tick charges the values seen by
+ * the previous one for the cycles since, kept in double so long lived
+ * connections do not overflow
+ */
+struct xio_rdma_gauges {
+	uint64_t			start;	/* first tick */
+	uint64_t			stamp;	/* last tick */
+	uint64_t			window_stalls;
+	uint64_t			credit_stalls;
+	double				area[XIO_TRANSPORT_GAUGE_LAST];
+	uint32_t			last[XIO_TRANSPORT_GAUGE_LAST];
+	uint32_t			pad;
+};
+
 struct xio_rdma_transport {
 	struct xio_transport_base	base;
 	struct xio_cq			*tcq;
@@ -331,6 +425,10 @@ struct xio_rdma_transport {
 	struct list_head		io_list;
 	struct list_head		rdma_rd_list;
 	struct list_head		rdma_rd_in_flight_list;
+	struct list_head		ext_sgl_list;
+
+	/* streamed message being read. other rdma reads wait behind it */
+	struct xio_rdma_stream		*rd_stream;
 
 	/* rx parameters */
 	int				rq_depth;	 /* max rcv allowed  */
@@ -346,7 +444,8 @@ struct xio_rdma_transport {
 							     peer sends */
 	uint16_t			peer_credits;
 
-	uint16_t			pad;
+	uint16_t			setup_flags;	  /* negotiated
+							     XIO_RDMA_SETUP_ */
 
 	/* fast path params */
 	int				rdma_in_flight;
@@ -377,7 +476,16 @@ struct xio_rdma_transport {
 	uint16_t			max_exp_sn; /* upper edge of
 						       receiver's window + 1 */
 
+	/* credits are piggybacked on outgoing messages. a nop is sent
+	 * only once credits_batch credits were collected or the peer
+	 * is left with no more than credits_low_wm credits
+	 */
+	uint16_t			credits_batch;
+	uint16_t			credits_low_wm;
+	uint16_t			credit_stalled; /* out of peer credits
+							   with queued tx */
 	uint16_t			pad1;
+	uint16_t			pad2;
 
 	/* control path params */
 	int				sq_depth;     /* max snd allowed  */
@@ -385,12 +493,15 @@ struct xio_rdma_transport {
 	uint16_t			client_initiator_depth;
 	uint16_t			client_responder_resources;
 
-	uint16_t			pad2[2];
+	uint16_t			max_sge;     /* sges per rdma write */
+	uint16_t			max_sge_rd;  /* sges per rdma read  */
 
 	/* connection's flow control */
 	size_t				alloc_sz;
 	size_t				membuf_sz;
 
+	struct xio_rdma_gauges		gauges;
+
 	struct xio_transport		*transport;
 	struct rdma_event_channel	*cm_channel;
 	struct rdma_cm_id		*cm_id;
@@ -398,6 +509,7 @@ struct xio_rdma_transport {
 	struct xio_tasks_pool_cls	primary_pool_cls;
 
 	struct xio_rdma_setup_msg	setup_rsp;
+	uint32_t			pad3;
 };
 
 struct xio_cm_channel {
@@ -405,6 +517,17 @@ struct xio_cm_channel {
 	struct xio_context		*ctx;
 	struct xio_observer		observer;
 	struct list_head		channels_list_entry;
+
+	/* connection requests handed over by listeners on other contexts */
+	struct list_head		accept_list;
+	spinlock_t			accept_lock;
+	int				accept_fd;  /* eventfd, -1 if none */
+};
+
+struct xio_rdma_handoff {
+	struct xio_rdma_transport	*parent_hndl;
+	struct xio_rdma_transport	*child_hndl;
+	struct list_head		accept_list_entry;
 };
 
 struct xio_dev_tdata {
@@ -412,6 +535,41 @@ struct xio_dev_tdata {
 	void				*async_loop;
 };
 
+/*---------------------------------------------------------------------------*/
+/* xio_rdma_gauges_read							     */
+/*---------------------------------------------------------------------------*/
+static inline void xio_rdma_gauges_read(struct xio_rdma_transport *rdma_hndl,
+					uint32_t *val)
+{
+	val[XIO_TRANSPORT_TX_READY]	  = rdma_hndl->tx_ready_tasks_num;
+	val[XIO_TRANSPORT_REQS_IN_FLIGHT] = rdma_hndl->reqs_in_flight_nr;
+	val[XIO_TRANSPORT_RSPS_IN_FLIGHT] = rdma_hndl->rsps_in_flight_nr;
+	val[XIO_TRANSPORT_SQE_AVAIL]	  = rdma_hndl->sqe_avail;
+	val[XIO_TRANSPORT_RQE_AVAIL]	  = rdma_hndl->rqe_avail;
+	val[XIO_TRANSPORT_CQE_AVAIL]	  = rdma_hndl->tcq ?
+					    rdma_hndl->tcq->cqe_avail : 0;
+	val[XIO_TRANSPORT_PEER_CREDITS]	  = rdma_hndl->peer_credits;
+}
+
+/*---------------------------------------------------------------------------*/
+/* xio_rdma_gauges_tick - where the gauges change, at xmit and completion   */
+/*---------------------------------------------------------------------------*/
+static inline void xio_rdma_gauges_tick(struct xio_rdma_transport *rdma_hndl)
+{
+	struct xio_rdma_gauges	*g = &rdma_hndl->gauges;
+	uint64_t		now = get_cycles();
+	double			dt = now - g->stamp;
+	int			i;
+
+	if (unlikely(!g->start))
+		g->start = now;
+	else
+		for (i = 0; i < XIO_TRANSPORT_GAUGE_LAST; i++)
+			g->area[i] += g->last[i] * dt;
+	g->stamp = now;
+	xio_rdma_gauges_read(rdma_hndl, g->last);
+}
+
 /*
  * The next routines deal with comparing 16 bit unsigned ints
  * and worry about wraparound (automatic with unsigned arithmetic).
@@ -515,6 +673,9 @@ int xio_rdma_cancel_rsp(struct xio_transport_base *transport,
 			struct xio_task *task, enum xio_status result,
 			void *ulp_msg, size_t ulp_msg_sz);
 
+int xio_rdma_get_stats(struct xio_transport_base *transport,
+		       struct xio_transport_stats *stats);
+
 /* xio_rdma_management.c */
 void xio_rdma_calc_pool_size(struct xio_rdma_transport *rdma_hndl);
 
@@ -528,4 +689,9 @@ struct xio_task *xio_rdma_primary_task_lookup(
 void xio_rdma_task_free(struct xio_rdma_transport *rdma_hndl,
 			struct xio_task *task);
 
+int xio_rdma_task_reserve_sgl(struct xio_rdma_transport *rdma_hndl,
+			      struct xio_task *task, size_t nents);
+
+void xio_rdma_stream_free(struct xio_rdma_stream *stream);
+
 #endif  /* XIO_RDMA_TRANSPORT_H */
@@ -36,6 +36,7 @@
  */
 
 #include "xio_os.h"
+#include <sys/eventfd.h>
 #include "libxio.h"
 #include "xio_observer.h"
 #include "xio_common.h"
@@ -43,6 +44,8 @@
 #include "xio_schedwork.h"
 #include "get_clock.h"
 #include "xio_ev_loop.h"
+#include "xio_stats_shm.h"
+#include "xio_metrics.h"
 
 
 /*---------------------------------------------------------------------------*/
@@ -65,6 +68,46 @@ void xio_context_unreg_observer(struct xio_context *ctx,
 	xio_observable_unreg_observer(&ctx->observable, observer);
 }
 
+/*---------------------------------------------------------------------------*/
+/* xio_context_work_handler						     */
+/*---------------------------------------------------------------------------*/
+static void xio_context_work_handler(int fd, int events, void *data)
+{
+	struct xio_context	*ctx = data;
+	struct xio_ctx_work	*work, *next;
+	eventfd_t		val;
+	LIST_HEAD(work_list);
+
+	eventfd_read(fd, &val);
+
+	spin_lock(&ctx->work_lock);
+	list_splice_init(&ctx->work_list, &work_list);
+	spin_unlock(&ctx->work_lock);
+
+	list_for_each_entry_safe(work, next, &work_list, work_list_entry) {
+		list_del(&work->work_list_entry);
+		work->handler(work->data);
+	}
+}
+
+/*---------------------------------------------------------------------------*/
+/* xio_context_add_work							     */
+/*---------------------------------------------------------------------------*/
+int xio_context_add_work(struct xio_context *ctx, struct xio_ctx_work *work)
+{
+	spin_lock(&ctx->work_lock);
+	list_add_tail(&work->work_list_entry, &ctx->work_list);
+	spin_unlock(&ctx->work_lock);
+
+	if (eventfd_write(ctx->work_fd, 1)) {
+		xio_set_error(errno);
+		ERROR_LOG("eventfd_write failed. %m\n");
+		return -1;
+	}
+
+	return 0;
+}
+
 static void xio_stats_handler(int fd, int events, void *data)
 {
 	struct xio_context *ctx = (struct xio_context *)data;
@@ -74,7 +117,10 @@ static void xio_stats_handler(int fd, int events, void *data)
 	struct iovec iov;
 	struct sockaddr_nl dest_addr;
 	uint64_t now = get_cycles();
+	uint64_t val;
 	char *ptr;
+	char *end = (char *)buf + sizeof(buf);
+	size_t len;
 	int i;
 
 	/* read netlink message */
@@ -91,9 +137,11 @@ static void xio_stats_handler(int fd, int events, void *data)
 
 	switch (nlh->nlmsg_type - NLMSG_MIN_TYPE) {
 	case 0: /* Format */
-		/* counting will start now */
-		memset(&ctx->stats.counter, 0,
-		       XIO_STAT_LAST * sizeof(uint64_t));
+		/* counting will start now. the counters themselves are
+		 * never reset, other readers may share them
+		 */
+		memcpy(ctx->stats.base, ctx->stats.counter,
+		       sizeof(ctx->stats.base));
 		/* First the cycles' hertz (assumed to be fixed) */
 		memcpy(ptr, &ctx->stats.hertz, sizeof(ctx->stats.hertz));
 		ptr += sizeof(ctx->stats.hertz);
@@ -103,9 +151,12 @@ static void xio_stats_handler(int fd, int events, void *data)
 		for (i = 0; i < XIO_STAT_LAST; i++) {
 			if (!ctx->stats.name[i])
 				continue;
-			strcpy(ptr, ctx->stats.name[i]);
 			/* keep the '\0' */
-			ptr += strlen(ptr) + 1;
+			len = strlen(ctx->stats.name[i]) + 1;
+			if (ptr + len > end)
+				break;
+			memcpy(ptr, ctx->stats.name[i], len);
+			ptr += len;
 		}
 		/* but not the last '\0' */
 		ptr--;
@@ -118,8 +169,8 @@ static void xio_stats_handler(int fd, int events, void *data)
 		for (i = 0; i < XIO_STAT_LAST; i++) {
 			if (!ctx->stats.name[i])
 				continue;
-			memcpy((void *)ptr, &ctx->stats.counter[i],
-			       sizeof(uint64_t));
+			val = ctx->stats.counter[i] - ctx->stats.base[i];
+			memcpy((void *)ptr, &val, sizeof(uint64_t));
 			ptr += sizeof(uint64_t);
 		}
 		break;
@@ -152,6 +203,7 @@ struct xio_context *xio_context_create(struct xio_context_attr *ctx_attr,
 	int				cpu;
 	struct sockaddr_nl		nladdr;
 	int				fd;
+	int				i;
 	socklen_t			addr_len;
 
 	xio_read_logging_level();
@@ -169,6 +221,7 @@ struct xio_context *xio_context_create(struct xio_context_attr *ctx_attr,
 		ERROR_LOG("calloc failed. %m\n");
 		return NULL;
 	}
+	ctx->stats.counter	= ctx->stats.own;
 	ctx->ev_loop		= xio_ev_loop_create();
 
 	ctx->cpuid		= cpu;
@@ -180,6 +233,9 @@ struct xio_context *xio_context_create(struct xio_context_attr *ctx_attr,
 	XIO_OBSERVABLE_INIT(&ctx->observable, ctx);
 	INIT_LIST_HEAD(&ctx->ctx_list);
 
+	if (xio_trace_ctx_init(ctx))
+		goto cleanup1;
+
 	ctx->sched_work = xio_schedwork_init(ctx);
 	if (!ctx->sched_work) {
 		xio_set_error(errno);
@@ -187,6 +243,32 @@ struct xio_context *xio_context_create(struct xio_context_attr *ctx_attr,
 		goto cleanup1;
 	}
 
+	/* other threads hand work to this one through the eventfd */
+	INIT_LIST_HEAD(&ctx->work_list);
+	spin_lock_init(&ctx->work_lock);
+	ctx->work_fd = eventfd(0, EFD_NONBLOCK);
+	if (ctx->work_fd < 0) {
+		xio_set_error(errno);
+		ERROR_LOG("eventfd failed. %m\n");
+		goto cleanup1;
+	}
+	xio_ev_loop_add(ctx->ev_loop, ctx->work_fd, XIO_POLLIN,
+			xio_context_work_handler, ctx);
+
+	ctx->stats.hertz = get_cpu_mhz(0) * 1000000.0 + 0.5;
+	/* Init default counters' name */
+	ctx->stats.name[XIO_STAT_TX_MSG] = strdup("TX_MSG");
+	ctx->stats.name[XIO_STAT_RX_MSG] = strdup("RX_MSG");
+	ctx->stats.name[XIO_STAT_TX_BYTES] = strdup("TX_BYTES");
+	ctx->stats.name[XIO_STAT_RX_BYTES] = strdup("RX_BYTES");
+	ctx->stats.name[XIO_STAT_DELAY] = strdup("DELAY");
+	ctx->stats.name[XIO_STAT_APPDELAY] = strdup("APPDELAY");
+	ctx->stats.name[XIO_STAT_CREDIT_STALLS] = strdup("CREDIT_STALLS");
+	ctx->stats.name[XIO_STAT_NOP_TX] = strdup("NOP_TX");
+
+	xio_stats_shm_attach(ctx);
+	xio_metrics_attach(ctx);
+
 	/* only root can bind netlink socket */
 	if (geteuid() != 0) {
 		DEBUG_LOG("statistics monitoring disabled. " \
@@ -246,15 +328,6 @@ struct xio_context *xio_context_create(struct xio_context_attr *ctx_attr,
 	xio_ev_loop_add(ctx->ev_loop, fd, XIO_POLLIN,
 			xio_stats_handler, ctx);
 
-	ctx->stats.hertz = get_cpu_mhz(0) * 1000000.0 + 0.5;
-	/* Init default counters' name */
-	ctx->stats.name[XIO_STAT_TX_MSG] = strdup("TX_MSG");
-	ctx->stats.name[XIO_STAT_RX_MSG] = strdup("RX_MSG");
-	ctx->stats.name[XIO_STAT_TX_BYTES] = strdup("TX_BYTES");
-	ctx->stats.name[XIO_STAT_RX_BYTES] = strdup("RX_BYTES");
-	ctx->stats.name[XIO_STAT_DELAY] = strdup("DELAY");
-	ctx->stats.name[XIO_STAT_APPDELAY] = strdup("APPDELAY");
-
 	ctx->netlink_sock = (void *)(unsigned long) fd;
 
 	return ctx;
@@ -262,6 +335,11 @@ struct xio_context *xio_context_create(struct xio_context_attr *ctx_attr,
 cleanup2:
 	close(fd);
 cleanup1:
+	xio_metrics_detach(ctx);
+	xio_stats_shm_detach(ctx);
+	for (i = 0; i < XIO_STAT_LAST; i++)
+		free(ctx->stats.name[i]);
+	xio_trace_ctx_close(ctx);
 	ufree(ctx);
 	return NULL;
 }
@@ -284,6 +362,11 @@ void xio_context_destroy(struct xio_context *ctx)
 		ctx->netlink_sock = NULL;
 	}
 
+	xio_ev_loop_del(ctx->ev_loop, ctx->work_fd);
+	close(ctx->work_fd);
+
+	xio_metrics_detach(ctx);
+	xio_stats_shm_detach(ctx);
 	for (i = 0; i < XIO_STAT_LAST; i++)
 		if (ctx->stats.name[i])
 			free(ctx->stats.name[i]);
@@ -291,6 +374,7 @@ void xio_context_destroy(struct xio_context *ctx)
 	xio_schedwork_close(ctx->sched_work);
 
 	xio_ev_loop_destroy(&ctx->ev_loop);
+	xio_trace_ctx_close(ctx);
 	ufree(ctx);
 }
 
@@ -347,6 +431,8 @@ int xio_add_counter(struct xio_context *ctx, char *name)
 				return -1;
 			}
 			ctx->stats.counter[i] = 0;
+			ctx->stats.base[i] = 0;
+			xio_stats_shm_update_names(ctx);
 			return i;
 		}
 	}
@@ -368,6 +454,7 @@ int xio_del_counter(struct xio_context *ctx, int counter)
 	/* free the name and mark as free for reuse */
 	free(ctx->stats.name[counter]);
 	ctx->stats.name[counter] = NULL;
+	xio_stats_shm_update_names(ctx);
 
 	return 0;
 }
@@ -397,6 +484,54 @@ struct xio_context_params *xio_context_get_params(struct xio_context *ctx)
 	return &ctx->params;
 }
 
+/*---------------------------------------------------------------------------*/
+/* xio_context_dump_trace						     */
+/*---------------------------------------------------------------------------*/
+int xio_context_dump_trace(struct xio_context *ctx, int fd)
+{
+	struct xio_trace_file_hdr	hdr;
+	struct xio_trace_rec		*recs = NULL;
+	ssize_t				len;
+	int				nrecs = 0;
+
+	if (!ctx) {
+		xio_set_error(EINVAL);
+		return -1;
+	}
+	if (ctx->trace) {
+		recs = umalloc((ctx->trace->mask + 1) * sizeof(*recs));
+		if (!recs) {
+			xio_set_error(ENOMEM);
+			ERROR_LOG("malloc failed. %m\n");
+			return -1;
+		}
+		nrecs = xio_context_get_trace(ctx, recs,
+					      ctx->trace->mask + 1);
+	}
+
+	memset(&hdr, 0, sizeof(hdr));
+	hdr.magic	= XIO_TRACE_MAGIC;
+	hdr.version	= XIO_TRACE_VERSION;
+	hdr.rec_size	= sizeof(struct xio_trace_rec);
+	hdr.hertz	= ctx->stats.hertz;
+	hdr.pid		= getpid();
+	hdr.cpu		= ctx->cpuid;
+	hdr.nrecs	= nrecs;
+
+	len = nrecs * sizeof(*recs);
+	errno = 0;
+	if (write(fd, &hdr, sizeof(hdr)) != sizeof(hdr) ||
+	    (len && write(fd, recs, len) != len)) {
+		xio_set_error(errno ? errno : EIO);
+		ERROR_LOG("trace dump write failed. %m\n");
+		ufree(recs);
+		return -1;
+	}
+	ufree(recs);
+
+	return 0;
+}
+
 /*---------------------------------------------------------------------------*/
 /* xio_context_get_poll_params						     */
 /*---------------------------------------------------------------------------*/
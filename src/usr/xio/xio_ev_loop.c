@@ -262,7 +262,7 @@ cleanup:
 /*---------------------------------------------------------------------------*/
 /* xio_ev_loop_run_helper                                                    */
 /*---------------------------------------------------------------------------*/
-inline int xio_ev_loop_run_helper(void *loop_hndl, int timeout)
+static inline int xio_ev_loop_run_helper(void *loop_hndl, int timeout)
 {
 	struct xio_ev_loop	*loop = loop_hndl;
 	int			nevent = 0, i;
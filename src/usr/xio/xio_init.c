@@ -42,9 +42,13 @@
 #include "xio_tls.h"
 #include "xio_sessions_store.h"
 #include "xio_conns_store.h"
+#include "xio_mem.h"
+#include "xio_stats_shm.h"
+#include "xio_metrics.h"
 
 int page_size;
 
+void xio_connection_construct(void);
 void xio_rdma_transport_constructor(void);
 void xio_rdma_transport_destructor(void);
 
@@ -57,8 +61,12 @@ static struct kref ini_kref;
 /*---------------------------------------------------------------------------*/
 static void xio_dtor()
 {
+	/* the exporter reads the mempools, stop it first */
+	xio_metrics_destructor();
 	xio_rdma_transport_destructor();
+	xio_stats_shm_destructor();
 	xio_thread_data_destruct();
+	xio_log_destructor();
 	ctor_key_once = PTHREAD_ONCE_INIT;
 }
 
@@ -80,7 +88,9 @@ static void xio_ctor()
 	xio_thread_data_construct();
 	sessions_store_construct();
 	conns_store_construct();
+	xio_connection_construct();
 	xio_rdma_transport_constructor();
+	xio_memcpy_init();
 	dtor_key_once = PTHREAD_ONCE_INIT;
 }
 
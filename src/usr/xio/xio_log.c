@@ -45,7 +45,7 @@ void xio_vlog(const char *file, unsigned line, const char *function,
 
 int			xio_logging_level = XIO_LOG_LEVEL_ERROR;
 xio_log_fn		xio_vlog_fn = xio_vlog;
-
+uint32_t		xio_log_rate_burst;
 
 
 #define LOG_TIME_FMT "%04d/%02d/%02d-%02d:%02d:%02d.%05ld"
@@ -53,29 +53,69 @@ xio_log_fn		xio_vlog_fn = xio_vlog;
 			      t.tm_hour, t.tm_min, t.tm_sec, usec
 
 /*---------------------------------------------------------------------------*/
-/* xio_vlog								     */
+/* asynchronous delivery. every logging thread owns a single producer ring  */
+/* of formatted messages, the flusher thread is the only consumer. the     */
+/* caller pays for vsnprintf and a vdso clock read, the flusher for the    */
+/* calendar time, stdio and the write. a full ring drops the message and   */
+/* counts it rather than stall the data path				     */
 /*---------------------------------------------------------------------------*/
-void xio_vlog(const char *file, unsigned line, const char *function,
-		unsigned level, const char *fmt, ...)
+#define XIO_LOG_DEF_RING_SIZE		256
+#define XIO_LOG_DEF_RATE_INTERVAL	1000		/* msec */
+#define XIO_LOG_REC_SIZE		512
+#define XIO_LOG_FLUSH_INTERVAL		10000		/* usec */
+
+struct xio_log_rec {
+	struct timeval		tv;
+	const char		*file;
+	const char		*function;
+	uint32_t		line;
+	uint32_t		level;
+	char			msg[XIO_LOG_REC_SIZE - 40];
+};
+
+struct xio_log_ring {
+	struct list_head	ring_list_entry;
+	uint32_t		mask;
+	int			orphan;		/* owner thread exited */
+	volatile uint64_t	dropped;
+	char			pad1[32];
+	volatile uint64_t	head;		/* written by the owner */
+	char			pad2[56];
+	volatile uint64_t	tail;		/* written by the flusher */
+	char			pad3[56];
+	struct xio_log_rec	rec[0];
+};
+
+static struct xio_log_attr log_attr = {
+	.async			= 0,
+	.ring_size		= XIO_LOG_DEF_RING_SIZE,
+	.rate_burst		= 0,
+	.rate_interval_ms	= XIO_LOG_DEF_RATE_INTERVAL,
+};
+
+static int			log_async;
+static int			log_flusher_running;
+static pthread_t		log_flusher;
+static pthread_once_t		log_key_once = PTHREAD_ONCE_INIT;
+static pthread_key_t		log_ring_key;
+static pthread_mutex_t		log_rings_lock = PTHREAD_MUTEX_INITIALIZER;
+static LIST_HEAD(log_rings);
+
+static const char * const level_str[] = {
+	"FATAL", "ERROR", "WARN", "INFO", "DEBUG", "TRACE"
+};
+
+/*---------------------------------------------------------------------------*/
+/* xio_log_write							     */
+/*---------------------------------------------------------------------------*/
+static void xio_log_write(const struct timeval *tv, const char *file,
+			  unsigned line, unsigned level, const char *msg)
 {
-	va_list			args;
 	const char		*short_file;
-	struct timeval		tv;
 	struct tm		t;
-	char			buf[2048];
 	char			buf2[48];
-	int			length = 0;
-	static const char * const level_str[] = {
-		"FATAL", "ERROR", "WARN", "INFO", "DEBUG", "TRACE"
-	};
 
-	va_start(args, fmt);
-	length = vsnprintf(buf, sizeof(buf), fmt, args);
-	va_end(args);
-	buf[length] = 0;
-
-	gettimeofday(&tv, NULL);
-	localtime_r(&tv.tv_sec, &t);
+	localtime_r(&tv->tv_sec, &t);
 
 	short_file = strrchr(file, '/');
 	short_file = (short_file == NULL) ? file : short_file + 1;
@@ -88,9 +128,310 @@ void xio_vlog(const char *file, unsigned line, const char *function,
 	*/
 	fprintf(stderr,
 		"["LOG_TIME_FMT"] %-28s [%-5s] - %s",
-		LOG_TIME_ARG(t, tv.tv_usec), buf2,
-		level_str[level], buf);
+		LOG_TIME_ARG(t, tv->tv_usec), buf2,
+		level_str[level], msg);
+}
+
+/*---------------------------------------------------------------------------*/
+/* xio_log_ring_orphan - owner thread exit				     */
+/*---------------------------------------------------------------------------*/
+static void xio_log_ring_orphan(void *data)
+{
+	struct xio_log_ring *ring = data;
+
+	/* the flusher frees it once drained */
+	smp_wmb();
+	ACCESS_ONCE(ring->orphan) = 1;
+}
+
+/*---------------------------------------------------------------------------*/
+/* xio_log_key_create							     */
+/*---------------------------------------------------------------------------*/
+static void xio_log_key_create(void)
+{
+	pthread_key_create(&log_ring_key, xio_log_ring_orphan);
+}
+
+/*---------------------------------------------------------------------------*/
+/* xio_log_ring_get							     */
+/*---------------------------------------------------------------------------*/
+static struct xio_log_ring *xio_log_ring_get(void)
+{
+	struct xio_log_ring	*ring;
+	uint32_t		size;
+
+	ring = pthread_getspecific(log_ring_key);
+	if (likely(ring))
+		return ring;
+
+	size = ACCESS_ONCE(log_attr.ring_size);
+	ring = calloc(1, sizeof(*ring) + size * sizeof(ring->rec[0]));
+	if (!ring)
+		return NULL;
+	ring->mask = size - 1;
+
+	pthread_mutex_lock(&log_rings_lock);
+	list_add_tail(&ring->ring_list_entry, &log_rings);
+	pthread_mutex_unlock(&log_rings_lock);
+
+	pthread_setspecific(log_ring_key, ring);
+
+	return ring;
+}
+
+/*---------------------------------------------------------------------------*/
+/* xio_log_ring_drain - called with log_rings_lock held		     */
+/*---------------------------------------------------------------------------*/
+static int xio_log_ring_drain(struct xio_log_ring *ring)
+{
+	struct xio_log_rec	*rec;
+	struct timeval		tv;
+	uint64_t		head = ACCESS_ONCE(ring->head);
+	uint64_t		tail = ring->tail;
+	uint64_t		dropped;
+	int			n = 0;
+
+	/* records below head are complete */
+	smp_rmb();
+	while (tail != head) {
+		rec = &ring->rec[tail & ring->mask];
+		xio_log_write(&rec->tv, rec->file, rec->line, rec->level,
+			      rec->msg);
+		tail++;
+		n++;
+	}
+	smp_mb();
+	ring->tail = tail;
+
+	dropped = ACCESS_ONCE(ring->dropped);
+	if (dropped) {
+		__sync_fetch_and_sub(&ring->dropped, dropped);
+		gettimeofday(&tv, NULL);
+		fprintf(stderr, "[%lu.%06lu] %" PRIu64
+			" log messages dropped, ring full\n",
+			tv.tv_sec, tv.tv_usec, dropped);
+	}
+
+	return n;
+}
+
+/*---------------------------------------------------------------------------*/
+/* xio_log_drain							     */
+/*---------------------------------------------------------------------------*/
+static int xio_log_drain(void)
+{
+	struct xio_log_ring	*ring, *tmp;
+	int			n = 0;
+
+	pthread_mutex_lock(&log_rings_lock);
+	list_for_each_entry_safe(ring, tmp, &log_rings, ring_list_entry) {
+		/* the owner is gone, nothing can follow what is there */
+		if (ACCESS_ONCE(ring->orphan)) {
+			smp_rmb();
+			n += xio_log_ring_drain(ring);
+			list_del(&ring->ring_list_entry);
+			free(ring);
+			continue;
+		}
+		n += xio_log_ring_drain(ring);
+	}
+	pthread_mutex_unlock(&log_rings_lock);
+
+	if (n)
+		fflush(stderr);
+
+	return n;
+}
+
+/*---------------------------------------------------------------------------*/
+/* xio_log_flusher_cb							     */
+/*---------------------------------------------------------------------------*/
+static void *xio_log_flusher_cb(void *data)
+{
+	while (ACCESS_ONCE(log_flusher_running)) {
+		if (!xio_log_drain())
+			usleep(XIO_LOG_FLUSH_INTERVAL);
+	}
+
+	return NULL;
+}
 
+/*---------------------------------------------------------------------------*/
+/* xio_log_async_start							     */
+/*---------------------------------------------------------------------------*/
+static int xio_log_async_start(void)
+{
+	pthread_once(&log_key_once, xio_log_key_create);
+
+	log_flusher_running = 1;
+	if (pthread_create(&log_flusher, NULL, xio_log_flusher_cb, NULL)) {
+		log_flusher_running = 0;
+		xio_set_error(errno);
+		ERROR_LOG("log flusher thread creation failed. %m\n");
+		return -1;
+	}
+	ACCESS_ONCE(log_async) = 1;
+
+	return 0;
+}
+
+/*---------------------------------------------------------------------------*/
+/* xio_log_async_stop							     */
+/*---------------------------------------------------------------------------*/
+static void xio_log_async_stop(void)
+{
+	ACCESS_ONCE(log_async) = 0;
+	ACCESS_ONCE(log_flusher_running) = 0;
+	pthread_join(log_flusher, NULL);
+
+	/* whatever the flusher left behind */
+	xio_log_drain();
+}
+
+/*---------------------------------------------------------------------------*/
+/* xio_log_set_attr							     */
+/*---------------------------------------------------------------------------*/
+int xio_log_set_attr(const struct xio_log_attr *attr)
+{
+	if (!attr->ring_size || (attr->ring_size & (attr->ring_size - 1))) {
+		xio_set_error(EINVAL);
+		ERROR_LOG("log ring size %u is not a power of 2\n",
+			  attr->ring_size);
+		return -1;
+	}
+	if (attr->rate_burst && !attr->rate_interval_ms) {
+		xio_set_error(EINVAL);
+		ERROR_LOG("log rate limit needs an interval\n");
+		return -1;
+	}
+
+	/* threads that already log keep the ring they have */
+	log_attr.ring_size		= attr->ring_size;
+	log_attr.rate_interval_ms	= attr->rate_interval_ms;
+	log_attr.rate_burst		= attr->rate_burst;
+	ACCESS_ONCE(xio_log_rate_burst)	= attr->rate_burst;
+
+	if (attr->async && !log_attr.async) {
+		if (xio_log_async_start())
+			return -1;
+	} else if (!attr->async && log_attr.async) {
+		xio_log_async_stop();
+	}
+	log_attr.async = !!attr->async;
+
+	return 0;
+}
+
+/*---------------------------------------------------------------------------*/
+/* xio_log_get_attr							     */
+/*---------------------------------------------------------------------------*/
+int xio_log_get_attr(struct xio_log_attr *attr)
+{
+	*attr = log_attr;
+
+	return 0;
+}
+
+/*---------------------------------------------------------------------------*/
+/* xio_log_destructor							     */
+/*---------------------------------------------------------------------------*/
+void xio_log_destructor(void)
+{
+	if (log_attr.async) {
+		xio_log_async_stop();
+		log_attr.async = 0;
+	}
+}
+
+/*---------------------------------------------------------------------------*/
+/* xio_log_ratelimit_check						     */
+/*---------------------------------------------------------------------------*/
+int xio_log_ratelimit_check(struct xio_log_ratelimit *rl,
+			    const char *file, unsigned line,
+			    const char *function)
+{
+	struct timespec		ts;
+	uint64_t		now;
+	uint64_t		begin;
+	uint32_t		missed;
+
+	clock_gettime(CLOCK_MONOTONIC_COARSE, &ts);
+	now = ts.tv_sec * 1000ULL + ts.tv_nsec / 1000000;
+
+	/* threads share the call site. the one that moves begin opens the
+	 * new window and reports what the old one suppressed
+	 */
+	begin = ACCESS_ONCE(rl->begin);
+	if (now - begin >= log_attr.rate_interval_ms &&
+	    __atomic_compare_exchange_n(&rl->begin, &begin, now, 0,
+					__ATOMIC_RELAXED, __ATOMIC_RELAXED)) {
+		missed = __atomic_exchange_n(&rl->missed, 0, __ATOMIC_RELAXED);
+		__atomic_store_n(&rl->printed, 0, __ATOMIC_RELAXED);
+		if (missed)
+			xio_vlog_fn(file, line, function, XIO_LOG_LEVEL_WARN,
+				    "%u messages suppressed\n", missed);
+	}
+	/* a message racing the window change may land in either window */
+	if (ACCESS_ONCE(rl->printed) < ACCESS_ONCE(xio_log_rate_burst) &&
+	    __atomic_fetch_add(&rl->printed, 1, __ATOMIC_RELAXED) <
+	    ACCESS_ONCE(xio_log_rate_burst))
+		return 1;
+	__atomic_fetch_add(&rl->missed, 1, __ATOMIC_RELAXED);
+
+	return 0;
+}
+
+/*---------------------------------------------------------------------------*/
+/* xio_vlog								     */
+/*---------------------------------------------------------------------------*/
+void xio_vlog(const char *file, unsigned line, const char *function,
+		unsigned level, const char *fmt, ...)
+{
+	va_list			args;
+	struct timeval		tv;
+	struct xio_log_ring	*ring;
+	struct xio_log_rec	*rec;
+	uint64_t		head;
+	char			buf[2048];
+	int			length = 0;
+
+	/* fatal messages may be the last ones, never defer them */
+	if (ACCESS_ONCE(log_async) && level != XIO_LOG_LEVEL_FATAL) {
+		ring = xio_log_ring_get();
+		if (unlikely(!ring))
+			goto sync;
+
+		head = ring->head;
+		if (unlikely(head - ACCESS_ONCE(ring->tail) > ring->mask)) {
+			__sync_fetch_and_add(&ring->dropped, 1);
+			return;
+		}
+		rec = &ring->rec[head & ring->mask];
+		gettimeofday(&rec->tv, NULL);
+		rec->file	= file;
+		rec->function	= function;
+		rec->line	= line;
+		rec->level	= level;
+		va_start(args, fmt);
+		vsnprintf(rec->msg, sizeof(rec->msg), fmt, args);
+		va_end(args);
+
+		/* publish the record after its contents */
+		smp_wmb();
+		ACCESS_ONCE(ring->head) = head + 1;
+		return;
+	}
+
+sync:
+	va_start(args, fmt);
+	length = vsnprintf(buf, sizeof(buf), fmt, args);
+	va_end(args);
+	if (length >= (int)sizeof(buf))
+		length = sizeof(buf) - 1;
+	buf[length] = 0;
+
+	gettimeofday(&tv, NULL);
+	xio_log_write(&tv, file, line, level, buf);
 
 	fflush(stderr);
 }
@@ -100,9 +441,16 @@ void xio_vlog(const char *file, unsigned line, const char *function,
 /*---------------------------------------------------------------------------*/
 void xio_read_logging_level(void)
 {
-	char *val = getenv("XIO_TRACE");
+	char *val;
 	int level  = 0;
 
+	val = getenv("XIO_LOG_ASYNC");
+	if (val && atoi(val) && !log_attr.async) {
+		if (!xio_log_async_start())
+			log_attr.async = 1;
+	}
+
+	val = getenv("XIO_TRACE");
 	if (val == NULL)
 		return;
 
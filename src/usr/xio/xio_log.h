@@ -50,19 +50,50 @@
 #define XIO_F_PRINTF(fmtarg, varg) \
 	__attribute__((__format__(printf, fmtarg, varg)))
 
+/*
+ * Levels above XIO_LOG_MAX_LEVEL are compiled out, arguments included.
+ * production builds may set it by ./configure --with-log-max-level=N
+ */
+#ifndef XIO_LOG_MAX_LEVEL
+#define XIO_LOG_MAX_LEVEL	XIO_LOG_LEVEL_TRACE
+#endif
+
 /*---------------------------------------------------------------------------*/
 /* enum									     */
 /*---------------------------------------------------------------------------*/
 extern int		xio_logging_level;
 extern xio_log_fn	xio_vlog_fn;
+extern uint32_t		xio_log_rate_burst;
 
 extern void xio_vlog(const char *file, unsigned line, const char *function,
 		     unsigned level, const char *fmt, ...);
 
+/* per call site state of the rate limit, updated atomically */
+struct xio_log_ratelimit {
+	uint64_t		begin;		/* msec */
+	uint32_t		printed;
+	uint32_t		missed;
+};
+
+int xio_log_ratelimit_check(struct xio_log_ratelimit *rl,
+			    const char *file, unsigned line,
+			    const char *function);
+
+int xio_log_set_attr(const struct xio_log_attr *attr);
+
+int xio_log_get_attr(struct xio_log_attr *attr);
+
+void xio_log_destructor(void);
+
 #define xio_log(level, fmt, ...) \
 	do { \
-		if (unlikely(((level) < XIO_LOG_LEVEL_LAST) &&  \
-					(level) <= xio_logging_level)) { \
+		static struct xio_log_ratelimit _xio_rl; \
+		if ((level) <= XIO_LOG_MAX_LEVEL && \
+		    unlikely(((level) < XIO_LOG_LEVEL_LAST) &&  \
+					(level) <= xio_logging_level) && \
+		    (likely(!xio_log_rate_burst) || \
+		     xio_log_ratelimit_check(&_xio_rl, __FILE__, __LINE__, \
+					     __func__))) { \
 			xio_vlog_fn(__FILE__, __LINE__, __func__, (level), \
 				    fmt, ## __VA_ARGS__); \
 		} \
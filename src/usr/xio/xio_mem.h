@@ -47,6 +47,40 @@ extern struct xio_mem_allocator *mem_allocator;
 extern void *malloc_huge_pages(size_t size);
 extern void free_huge_pages(void *ptr);
 
+/* copy kernels, selected at startup according to the cpu */
+enum xio_memcpy_impl {
+	XIO_MEMCPY_SCALAR,
+	XIO_MEMCPY_AVX2,
+	XIO_MEMCPY_AVX512,
+	XIO_MEMCPY_AUTO
+};
+
+void xio_memcpy_init(void);
+int xio_memcpy_set_impl(enum xio_memcpy_impl impl);
+const char *xio_memcpy_impl_name(void);
+void xio_memcpy_set_nt_threshold(size_t threshold);
+
+/* copies shorter than this never stream and are inlined at the caller */
+#define XIO_MEMCPY_INLINE_MAX	256
+
+void *xio_memcpy_large(void *dst, const void *src, size_t len);
+
+static inline void *xio_memcpy(void *dst, const void *src, size_t len)
+{
+	if (len < XIO_MEMCPY_INLINE_MAX)
+		return memcpy(dst, src, len);
+
+	return xio_memcpy_large(dst, src, len);
+}
+
+/* gather the segments into one contiguous buffer. returns the length */
+size_t xio_memcpy_gather(void *dst, const struct xio_iovec_ex *iov,
+			 int iovlen);
+
+/* scatter up to len bytes over the segments. returns the length */
+size_t xio_memcpy_scatter(struct xio_iovec_ex *iov, int iovlen,
+			  const void *src, size_t len);
+
 static inline void xio_disable_huge_pages(int disable)
 {
 	if (disable_huge_pages)
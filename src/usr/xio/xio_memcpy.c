@@ -0,0 +1,339 @@
+/*
+ * Copyright (c) 2013 Mellanox Technologies®. All rights reserved.
+ *
+ * This software is available to you under a choice of one of two licenses.
+ * You may choose to be licensed under the terms of the GNU General Public
+ * License (GPL) Version 2, available from the file COPYING in the main
+ * directory of this source tree, or the Mellanox Technologies® BSD license
+ * below:
+ *
+ *      - Redistribution and use in source and binary forms, with or without
+ *        modification, are permitted provided that the following conditions
+ *        are met:
+ *
+ *      - Redistributions of source code must retain the above copyright
+ *        notice, this list of conditions and the following disclaimer.
+ *
+ *      - Redistributions in binary form must reproduce the above
+ *        copyright notice, this list of conditions and the following
+ *        disclaimer in the documentation and/or other materials
+ *        provided with the distribution.
+ *
+ *      - Neither the name of the Mellanox Technologies® nor the names of its
+ *        contributors may be used to endorse or promote products derived from
+ *        this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+#include "xio_os.h"
+#include "libxio.h"
+#include "xio_common.h"
+#include "xio_mem.h"
+
+#if defined(__x86_64__) && defined(__GNUC__)
+#define XIO_MEMCPY_X86
+#include <immintrin.h>
+#endif
+
+/* copies at least this long bypass the caches. the large copies of the
+ * library fill registered buffers that only the hca reads, so keeping
+ * them cached evicts the caller's working set for nothing. below a few
+ * kilobytes the unaligned head and tail and the fence outweigh the gain.
+ * the inline send buffer (SEND_BUF_SZ) stays below this, so streaming
+ * fires on the copy into mempool buffers for rdma write
+ */
+#define XIO_MEMCPY_DEF_NT_THRESHOLD	(16*1024)
+
+typedef void (*xio_copy_fn_t)(void *dst, const void *src, size_t len);
+
+/* cached copies call the libc memcpy directly, which already picks a
+ * vector or "rep movsb" variant for the cpu and beats a plain vector loop
+ * on the shapes of xio_memcpy_bench. the kernels below differ only in the
+ * streaming stores used for copies that would otherwise flush the cache
+ */
+struct xio_memcpy_ops {
+	const char	*name;
+	xio_copy_fn_t	copy_nt;	/* streaming stores, no fence */
+	void		(*fence)(void);
+};
+
+/*---------------------------------------------------------------------------*/
+/* scalar kernel							     */
+/*---------------------------------------------------------------------------*/
+static void xio_copy_scalar(void *dst, const void *src, size_t len)
+{
+	memcpy(dst, src, len);
+}
+
+static void xio_fence_none(void)
+{
+}
+
+#ifdef XIO_MEMCPY_X86
+/*---------------------------------------------------------------------------*/
+/* xio_fence_sfence							     */
+/*---------------------------------------------------------------------------*/
+static void xio_fence_sfence(void)
+{
+	/* order the weakly ordered streaming stores */
+	_mm_sfence();
+}
+
+/*---------------------------------------------------------------------------*/
+/* xio_copy_nt_avx2							     */
+/*---------------------------------------------------------------------------*/
+__attribute__((target("avx2")))
+static void xio_copy_nt_avx2(void *dst, const void *src, size_t len)
+{
+	uint8_t		*d = dst;
+	const uint8_t	*s = src;
+	size_t		head;
+	__m256i		v0, v1, v2, v3;
+
+	/* streaming stores require an aligned destination */
+	head = min((32 - ((uintptr_t)d & 31)) & 31, len);
+	if (head) {
+		memcpy(d, s, head);
+		s += head;
+		d += head;
+		len -= head;
+	}
+	while (len >= 128) {
+		v0 = _mm256_loadu_si256((const __m256i *)s);
+		v1 = _mm256_loadu_si256((const __m256i *)(s + 32));
+		v2 = _mm256_loadu_si256((const __m256i *)(s + 64));
+		v3 = _mm256_loadu_si256((const __m256i *)(s + 96));
+		_mm256_stream_si256((__m256i *)d, v0);
+		_mm256_stream_si256((__m256i *)(d + 32), v1);
+		_mm256_stream_si256((__m256i *)(d + 64), v2);
+		_mm256_stream_si256((__m256i *)(d + 96), v3);
+		s += 128;
+		d += 128;
+		len -= 128;
+	}
+	while (len >= 32) {
+		v0 = _mm256_loadu_si256((const __m256i *)s);
+		_mm256_stream_si256((__m256i *)d, v0);
+		s += 32;
+		d += 32;
+		len -= 32;
+	}
+	if (len)
+		memcpy(d, s, len);
+}
+
+/*---------------------------------------------------------------------------*/
+/* xio_copy_nt_avx512							     */
+/*---------------------------------------------------------------------------*/
+__attribute__((target("avx512f")))
+static void xio_copy_nt_avx512(void *dst, const void *src, size_t len)
+{
+	uint8_t		*d = dst;
+	const uint8_t	*s = src;
+	size_t		head;
+	__m512i		v0, v1, v2, v3;
+
+	/* streaming stores require an aligned destination */
+	head = min((64 - ((uintptr_t)d & 63)) & 63, len);
+	if (head) {
+		memcpy(d, s, head);
+		s += head;
+		d += head;
+		len -= head;
+	}
+	while (len >= 256) {
+		v0 = _mm512_loadu_si512((const void *)s);
+		v1 = _mm512_loadu_si512((const void *)(s + 64));
+		v2 = _mm512_loadu_si512((const void *)(s + 128));
+		v3 = _mm512_loadu_si512((const void *)(s + 192));
+		_mm512_stream_si512((__m512i *)d, v0);
+		_mm512_stream_si512((__m512i *)(d + 64), v1);
+		_mm512_stream_si512((__m512i *)(d + 128), v2);
+		_mm512_stream_si512((__m512i *)(d + 192), v3);
+		s += 256;
+		d += 256;
+		len -= 256;
+	}
+	while (len >= 64) {
+		v0 = _mm512_loadu_si512((const void *)s);
+		_mm512_stream_si512((__m512i *)d, v0);
+		s += 64;
+		d += 64;
+		len -= 64;
+	}
+	if (len)
+		memcpy(d, s, len);
+}
+#endif
+
+static const struct xio_memcpy_ops memcpy_impls[] = {
+	[XIO_MEMCPY_SCALAR] = {
+		.name		= "scalar",
+		.copy_nt	= xio_copy_scalar,
+		.fence		= xio_fence_none,
+	},
+#ifdef XIO_MEMCPY_X86
+	[XIO_MEMCPY_AVX2] = {
+		.name		= "avx2",
+		.copy_nt	= xio_copy_nt_avx2,
+		.fence		= xio_fence_sfence,
+	},
+	[XIO_MEMCPY_AVX512] = {
+		.name		= "avx512",
+		.copy_nt	= xio_copy_nt_avx512,
+		.fence		= xio_fence_sfence,
+	},
+#endif
+};
+
+static const struct xio_memcpy_ops *memcpy_ops =
+				&memcpy_impls[XIO_MEMCPY_SCALAR];
+static size_t memcpy_nt_threshold = XIO_MEMCPY_DEF_NT_THRESHOLD;
+
+/*---------------------------------------------------------------------------*/
+/* xio_memcpy_supported							     */
+/*---------------------------------------------------------------------------*/
+static int xio_memcpy_supported(enum xio_memcpy_impl impl)
+{
+	switch (impl) {
+	case XIO_MEMCPY_SCALAR:
+		return 1;
+#ifdef XIO_MEMCPY_X86
+	case XIO_MEMCPY_AVX2:
+		return __builtin_cpu_supports("avx2");
+	case XIO_MEMCPY_AVX512:
+		return __builtin_cpu_supports("avx512f");
+#endif
+	default:
+		return 0;
+	}
+}
+
+/*---------------------------------------------------------------------------*/
+/* xio_memcpy_set_impl							     */
+/*---------------------------------------------------------------------------*/
+int xio_memcpy_set_impl(enum xio_memcpy_impl impl)
+{
+	if (impl == XIO_MEMCPY_AUTO) {
+		if (xio_memcpy_supported(XIO_MEMCPY_AVX512))
+			impl = XIO_MEMCPY_AVX512;
+		else if (xio_memcpy_supported(XIO_MEMCPY_AVX2))
+			impl = XIO_MEMCPY_AVX2;
+		else
+			impl = XIO_MEMCPY_SCALAR;
+	}
+	if (!xio_memcpy_supported(impl))
+		return -1;
+
+	memcpy_ops = &memcpy_impls[impl];
+
+	return 0;
+}
+
+/*---------------------------------------------------------------------------*/
+/* xio_memcpy_impl_name							     */
+/*---------------------------------------------------------------------------*/
+const char *xio_memcpy_impl_name(void)
+{
+	return memcpy_ops->name;
+}
+
+/*---------------------------------------------------------------------------*/
+/* xio_memcpy_set_nt_threshold						     */
+/*---------------------------------------------------------------------------*/
+void xio_memcpy_set_nt_threshold(size_t threshold)
+{
+	memcpy_nt_threshold = threshold;
+}
+
+/*---------------------------------------------------------------------------*/
+/* xio_memcpy_init							     */
+/*---------------------------------------------------------------------------*/
+void xio_memcpy_init(void)
+{
+#ifdef XIO_MEMCPY_X86
+	__builtin_cpu_init();
+#endif
+	xio_memcpy_set_impl(XIO_MEMCPY_AUTO);
+	memcpy_nt_threshold = XIO_MEMCPY_DEF_NT_THRESHOLD;
+}
+
+/*---------------------------------------------------------------------------*/
+/* xio_memcpy_large							     */
+/*---------------------------------------------------------------------------*/
+void *xio_memcpy_large(void *dst, const void *src, size_t len)
+{
+	if (len < memcpy_nt_threshold) {
+		memcpy(dst, src, len);
+	} else {
+		memcpy_ops->copy_nt(dst, src, len);
+		memcpy_ops->fence();
+	}
+
+	return dst;
+}
+
+/*---------------------------------------------------------------------------*/
+/* xio_memcpy_gather							     */
+/*---------------------------------------------------------------------------*/
+size_t xio_memcpy_gather(void *dst, const struct xio_iovec_ex *iov,
+			 int iovlen)
+{
+	uint8_t		*d = dst;
+	int		i;
+	int		nt = 0;
+
+	for (i = 0; i < iovlen; i++) {
+		if (iov[i].iov_len < memcpy_nt_threshold) {
+			memcpy(d, iov[i].iov_base, iov[i].iov_len);
+		} else {
+			memcpy_ops->copy_nt(d, iov[i].iov_base,
+					    iov[i].iov_len);
+			nt = 1;
+		}
+		d += iov[i].iov_len;
+	}
+	/* a single fence for all the streamed segments */
+	if (nt)
+		memcpy_ops->fence();
+
+	return d - (uint8_t *)dst;
+}
+
+/*---------------------------------------------------------------------------*/
+/* xio_memcpy_scatter							     */
+/*---------------------------------------------------------------------------*/
+size_t xio_memcpy_scatter(struct xio_iovec_ex *iov, int iovlen,
+			  const void *src, size_t len)
+{
+	const uint8_t	*s = src;
+	size_t		seg_len;
+	int		i;
+	int		nt = 0;
+
+	for (i = 0; i < iovlen && len; i++) {
+		seg_len = min(iov[i].iov_len, len);
+		if (seg_len < memcpy_nt_threshold) {
+			memcpy(iov[i].iov_base, s, seg_len);
+		} else {
+			memcpy_ops->copy_nt(iov[i].iov_base, s, seg_len);
+			nt = 1;
+		}
+		s += seg_len;
+		len -= seg_len;
+	}
+	if (nt)
+		memcpy_ops->fence();
+
+	return s - (const uint8_t *)src;
+}
@@ -0,0 +1,1037 @@
+/*
+ * Copyright (c) 2013 Mellanox Technologies®. All rights reserved.
+ *
+ * This software is available to you under a choice of one of two licenses.
+ * You may choose to be licensed under the terms of the GNU General Public
+ * License (GPL) Version 2, available from the file COPYING in the main
+ * directory of this source tree, or the Mellanox Technologies® BSD license
+ * below:
+ *
+ *      - Redistribution and use in source and binary forms, with or without
+ *        modification, are permitted provided that the following conditions
+ *        are met:
+ *
+ *      - Redistributions of source code must retain the above copyright
+ *        notice, this list of conditions and the following disclaimer.
+ *
+ *      - Redistributions in binary form must reproduce the above
+ *        copyright notice, this list of conditions and the following
+ *        disclaimer in the documentation and/or other materials
+ *        provided with the distribution.
+ *
+ *      - Neither the name of the Mellanox Technologies® nor the names of its
+ *        contributors may be used to endorse or promote products derived from
+ *        this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#include "xio_os.h"
+#include "libxio.h"
+#include "xio_log.h"
+#include "xio_common.h"
+#include "xio_observer.h"
+#include "xio_context.h"
+#include "xio_task.h"
+#include "xio_msg_list.h"
+#include "xio_conn.h"
+#include "xio_connection.h"
+#include "xio_session.h"
+#include "xio_histogram.h"
+#include "xio_rdma_mempool.h"
+#include "xio_metrics.h"
+
+/*---------------------------------------------------------------------------*/
+/* each exported context keeps a copy of its counters, latency histograms  */
+/* and connection queue depths, refreshed by its own thread under a	     */
+/* sequence counter. a scrape copies the copies and formats them on the     */
+/* exporter thread, nothing on the data path is read or locked by it.	     */
+/* metrics_lock guards only the list, taken when a context comes or goes    */
+/*---------------------------------------------------------------------------*/
+#define XIO_METRICS_DEF_INTERVAL	1000		/* msec */
+#define XIO_METRICS_MAX_CONNS		64		/* per context */
+#define XIO_METRICS_URI_LEN		64
+#define XIO_METRICS_NAME_LEN		32
+#define XIO_METRICS_READ_TRIES		16
+#define XIO_METRICS_POLL_MSEC		200
+#define XIO_METRICS_REQ_MSEC		250		/* raw client grace */
+#define XIO_METRICS_SEND_SEC		1
+#define XIO_METRICS_BUF_SIZE		16384
+
+#define ARRAY_SIZE(arr) (sizeof(arr) / sizeof((arr)[0]))
+
+struct xio_metrics_conn {
+	uint64_t			id;
+	uint64_t			txq_bytes;
+	uint32_t			txq_msgs;
+	uint32_t			in_flight;	/* requests */
+	char				uri[XIO_METRICS_URI_LEN];
+	uint32_t			has_transport;
+	uint32_t			pad;
+	struct xio_transport_stats	transport;
+};
+
+struct xio_metrics_snap {
+	volatile uint32_t		seq;
+	uint32_t			id;
+	int32_t				tid;
+	int32_t				cpu;
+	uint64_t			hertz;
+	uint32_t			nr_conns;	/* on the context */
+	uint32_t			nr_published;	/* in conn[] */
+	uint64_t			counter[XIO_STAT_LAST];
+	char				name[XIO_STAT_LAST]
+					    [XIO_METRICS_NAME_LEN];
+	struct xio_histogram		latency[XIO_LATENCY_LAST];
+	struct xio_metrics_conn		conn[XIO_METRICS_MAX_CONNS];
+};
+
+struct xio_metrics_ctx {
+	struct list_head		metrics_list_entry;
+	struct xio_context		*ctx;
+	xio_ctx_timer_handle_t		timer;
+	struct xio_metrics_snap		snap;
+};
+
+struct xio_metrics_buf {
+	char				*data;
+	size_t				len;
+	size_t				size;
+};
+
+struct xio_metrics_family {
+	const char			*name;
+	const char			*help;
+	const char			*unit;
+	int				counter;
+	int				cycles;		/* in seconds */
+};
+
+static const struct xio_metrics_family metrics_counters[] = {
+	{"xio_tx_messages", "messages sent", NULL, XIO_STAT_TX_MSG, 0},
+	{"xio_rx_messages", "messages received", NULL, XIO_STAT_RX_MSG, 0},
+	{"xio_tx_bytes", "bytes sent", "bytes", XIO_STAT_TX_BYTES, 0},
+	{"xio_rx_bytes", "bytes received", "bytes", XIO_STAT_RX_BYTES, 0},
+	{"xio_delay_seconds", "request round trips summed", "seconds",
+	 XIO_STAT_DELAY, 1},
+	{"xio_app_delay_seconds", "request time in the application summed",
+	 "seconds", XIO_STAT_APPDELAY, 1},
+	{"xio_credit_stalls", "transmissions held for lack of peer credits",
+	 NULL, XIO_STAT_CREDIT_STALLS, 0},
+	{"xio_nop_tx", "credit updates sent without a message", NULL,
+	 XIO_STAT_NOP_TX, 0},
+};
+
+static const char * const metrics_latency_type[] = {
+	"rtt", "app", "queue", "post", "send", "recv"
+};
+
+static const uint64_t metrics_le_nsec[] = {
+	500, 1000, 2500, 5000, 10000, 25000, 50000, 100000, 250000, 500000,
+	1000000, 2500000, 5000000, 10000000, 25000000, 50000000, 100000000,
+	250000000, 500000000, 1000000000, 2500000000ULL, 5000000000ULL,
+	10000000000ULL
+};
+
+#define XIO_METRICS_LE_NR	ARRAY_SIZE(metrics_le_nsec)
+
+static struct xio_metrics_attr	metrics_attr;
+static int			metrics_fd = -1;
+static int			metrics_running;
+static uint32_t			metrics_next_id;
+static pthread_t		metrics_thread;
+static pthread_mutex_t		metrics_attr_lock = PTHREAD_MUTEX_INITIALIZER;
+static pthread_mutex_t		metrics_lock = PTHREAD_MUTEX_INITIALIZER;
+static pthread_once_t		metrics_env_once = PTHREAD_ONCE_INIT;
+static LIST_HEAD(metrics_list);
+
+/*---------------------------------------------------------------------------*/
+/* xio_metrics_interval							     */
+/*---------------------------------------------------------------------------*/
+static inline int xio_metrics_interval(void)
+{
+	uint32_t msec = ACCESS_ONCE(metrics_attr.interval_ms);
+
+	return msec ? msec : XIO_METRICS_DEF_INTERVAL;
+}
+
+/*---------------------------------------------------------------------------*/
+/* xio_metrics_publish - on the context thread				     */
+/*---------------------------------------------------------------------------*/
+static void xio_metrics_publish(struct xio_metrics_ctx *mctx)
+{
+	struct xio_context		*ctx = mctx->ctx;
+	struct xio_metrics_snap		*snap = &mctx->snap;
+	struct xio_metrics_conn		*mconn;
+	struct xio_connection		*connection;
+	uint32_t			n = 0;
+	int				i;
+
+	ACCESS_ONCE(snap->seq) = snap->seq + 1;
+	smp_wmb();
+
+	memcpy(snap->counter, ctx->stats.counter, sizeof(snap->counter));
+	for (i = 0; i < XIO_STAT_LAST; i++) {
+		if (ctx->stats.name[i])
+			strncpy(snap->name[i], ctx->stats.name[i],
+				XIO_METRICS_NAME_LEN - 1);
+		else
+			snap->name[i][0] = 0;
+	}
+	memcpy(snap->latency, ctx->stats.latency, sizeof(snap->latency));
+
+	list_for_each_entry(connection, &ctx->ctx_list, ctx_list_entry) {
+		if (n < XIO_METRICS_MAX_CONNS) {
+			mconn = &snap->conn[n];
+			mconn->id		= (uintptr_t)connection;
+			mconn->txq_msgs		= connection->txq_msgs;
+			mconn->txq_bytes	= connection->txq_bytes;
+			mconn->in_flight	= 0;
+			for (i = 0; i < XIO_MSG_TCLASS_MAX; i++)
+				mconn->in_flight +=
+					connection->tcq[i].reqs_in_flight;
+			if (connection->session && connection->session->uri)
+				strncpy(mconn->uri, connection->session->uri,
+					XIO_METRICS_URI_LEN - 1);
+			else
+				mconn->uri[0] = 0;
+			/* not yet connected or not kept by the transport */
+			mconn->has_transport =
+				!xio_connection_get_transport_stats(
+					connection, &mconn->transport);
+		}
+		n++;
+	}
+	snap->nr_conns		= n;
+	snap->nr_published	= min(n, (uint32_t)XIO_METRICS_MAX_CONNS);
+
+	smp_wmb();
+	ACCESS_ONCE(snap->seq) = snap->seq + 1;
+}
+
+/*---------------------------------------------------------------------------*/
+/* xio_metrics_tick							     */
+/*---------------------------------------------------------------------------*/
+static void xio_metrics_tick(void *data)
+{
+	struct xio_metrics_ctx *mctx = data;
+
+	xio_metrics_publish(mctx);
+	xio_ctx_timer_add(mctx->ctx, xio_metrics_interval(), mctx,
+			  xio_metrics_tick, &mctx->timer);
+}
+
+/*---------------------------------------------------------------------------*/
+/* xio_metrics_read_env							     */
+/*---------------------------------------------------------------------------*/
+static void xio_metrics_read_env(void)
+{
+	struct xio_metrics_attr	attr;
+	char			*val = getenv("XIO_METRICS_ADDR");
+
+	/* an exporter started by the application wins */
+	if (val == NULL || !*val || ACCESS_ONCE(metrics_running))
+		return;
+
+	memset(&attr, 0, sizeof(attr));
+	strncpy(attr.addr, val, sizeof(attr.addr) - 1);
+	xio_metrics_set_attr(&attr);
+}
+
+/*---------------------------------------------------------------------------*/
+/* xio_metrics_attach							     */
+/*---------------------------------------------------------------------------*/
+void xio_metrics_attach(struct xio_context *ctx)
+{
+	struct xio_metrics_ctx	*mctx;
+
+	pthread_once(&metrics_env_once, xio_metrics_read_env);
+	if (!ACCESS_ONCE(metrics_running))
+		return;
+
+	mctx = ucalloc(1, sizeof(*mctx));
+	if (!mctx) {
+		WARN_LOG("no memory for metrics. context %p not " \
+			 "exported\n", ctx);
+		return;
+	}
+	mctx->ctx	= ctx;
+	mctx->snap.tid	= syscall(SYS_gettid);
+	mctx->snap.cpu	= ctx->cpuid;
+	mctx->snap.hertz = ctx->stats.hertz;
+	xio_metrics_publish(mctx);
+
+	pthread_mutex_lock(&metrics_lock);
+	mctx->snap.id = metrics_next_id++;
+	list_add_tail(&mctx->metrics_list_entry, &metrics_list);
+	pthread_mutex_unlock(&metrics_lock);
+
+	ctx->stats.metrics = mctx;
+
+	xio_ctx_timer_add(ctx, xio_metrics_interval(), mctx,
+			  xio_metrics_tick, &mctx->timer);
+}
+
+/*---------------------------------------------------------------------------*/
+/* xio_metrics_detach							     */
+/*---------------------------------------------------------------------------*/
+void xio_metrics_detach(struct xio_context *ctx)
+{
+	struct xio_metrics_ctx	*mctx = ctx->stats.metrics;
+
+	if (!mctx)
+		return;
+
+	if (mctx->timer)
+		xio_ctx_timer_del(ctx, mctx->timer);
+
+	/* may wait for a scrape copying the snapshots */
+	pthread_mutex_lock(&metrics_lock);
+	list_del(&mctx->metrics_list_entry);
+	pthread_mutex_unlock(&metrics_lock);
+
+	ctx->stats.metrics = NULL;
+	ufree(mctx);
+}
+
+/*---------------------------------------------------------------------------*/
+/* xio_metrics_read_snap - 0 on a consistent copy			     */
+/*---------------------------------------------------------------------------*/
+static int xio_metrics_read_snap(const struct xio_metrics_snap *snap,
+				 struct xio_metrics_snap *copy)
+{
+	uint32_t	seq;
+	int		i;
+
+	for (i = 0; i < XIO_METRICS_READ_TRIES; i++) {
+		seq = ACCESS_ONCE(snap->seq);
+		smp_rmb();
+		if (seq & 1) {
+			sched_yield();
+			continue;
+		}
+		memcpy(copy, snap, sizeof(*copy));
+		smp_rmb();
+		if (seq == ACCESS_ONCE(snap->seq))
+			return 0;
+	}
+
+	return -1;
+}
+
+/*---------------------------------------------------------------------------*/
+/* xio_metrics_collect - copy every context's snapshot			     */
+/*---------------------------------------------------------------------------*/
+static int xio_metrics_collect(struct xio_metrics_snap **snaps, int *max)
+{
+	struct xio_metrics_ctx	*mctx;
+	struct xio_metrics_snap	*tmp;
+	int			nr = 0;
+
+	pthread_mutex_lock(&metrics_lock);
+	list_for_each_entry(mctx, &metrics_list, metrics_list_entry) {
+		if (nr == *max) {
+			tmp = realloc(*snaps, (*max + 8) * sizeof(*tmp));
+			if (!tmp)
+				break;
+			*snaps = tmp;
+			*max += 8;
+		}
+		/* a context busy publishing throughout is left out */
+		if (!xio_metrics_read_snap(&mctx->snap, &(*snaps)[nr]))
+			nr++;
+	}
+	pthread_mutex_unlock(&metrics_lock);
+
+	return nr;
+}
+
+/*---------------------------------------------------------------------------*/
+/* xio_metrics_printf							     */
+/*---------------------------------------------------------------------------*/
+static void xio_metrics_printf(struct xio_metrics_buf *buf,
+			       const char *fmt, ...)
+			       __attribute__((format(printf, 2, 3)));
+
+static void xio_metrics_printf(struct xio_metrics_buf *buf,
+			       const char *fmt, ...)
+{
+	va_list		args;
+	char		*data;
+	size_t		size;
+	int		n;
+
+	while (1) {
+		va_start(args, fmt);
+		n = vsnprintf(buf->data + buf->len, buf->size - buf->len,
+			      fmt, args);
+		va_end(args);
+		if (n < 0)
+			return;
+		if ((size_t)n < buf->size - buf->len)
+			break;
+		size = max(buf->size * 2, buf->len + n + 1);
+		data = realloc(buf->data, size);
+		if (!data) {
+			/* keep what fits, the scrape comes out short */
+			buf->data[buf->len] = 0;
+			return;
+		}
+		buf->data = data;
+		buf->size = size;
+	}
+	buf->len += n;
+}
+
+/*---------------------------------------------------------------------------*/
+/* xio_metrics_escape - label value, quote backslash and newline	     */
+/*---------------------------------------------------------------------------*/
+static void xio_metrics_escape(char *dst, const char *src, size_t len)
+{
+	for (; *src && len > 2; src++) {
+		if (*src == '"' || *src == '\\' || *src == '\n') {
+			*dst++ = '\\';
+			len--;
+		}
+		*dst++ = (*src == '\n') ? 'n' : *src;
+		len--;
+	}
+	*dst = 0;
+}
+
+/*---------------------------------------------------------------------------*/
+/* xio_metrics_family_hdr						     */
+/*---------------------------------------------------------------------------*/
+static void xio_metrics_family_hdr(struct xio_metrics_buf *buf,
+				   const char *name, const char *type,
+				   const char *unit, const char *help)
+{
+	xio_metrics_printf(buf, "# TYPE %s %s\n", name, type);
+	if (unit)
+		xio_metrics_printf(buf, "# UNIT %s %s\n", name, unit);
+	xio_metrics_printf(buf, "# HELP %s %s\n", name, help);
+}
+
+/*---------------------------------------------------------------------------*/
+/* xio_metrics_seconds							     */
+/*---------------------------------------------------------------------------*/
+static inline double xio_metrics_seconds(uint64_t cycles, uint64_t hertz)
+{
+	return hertz ? (double)cycles / hertz : 0.0;
+}
+
+/*---------------------------------------------------------------------------*/
+/* xio_metrics_format_contexts						     */
+/*---------------------------------------------------------------------------*/
+static void xio_metrics_format_contexts(struct xio_metrics_buf *buf,
+					const struct xio_metrics_snap *snaps,
+					int nr)
+{
+	const struct xio_metrics_family	*family;
+	const struct xio_metrics_snap	*snap;
+	char				name[2 * XIO_METRICS_NAME_LEN];
+	unsigned int			f;
+	int				i, c;
+
+	xio_metrics_family_hdr(buf, "xio_context", "info", NULL,
+			       "context and the thread running it");
+	for (i = 0, snap = snaps; i < nr; i++, snap++)
+		xio_metrics_printf(buf, "xio_context_info{ctx=\"%u\"," \
+				   "tid=\"%d\",cpu=\"%d\"} 1\n",
+				   snap->id, snap->tid, snap->cpu);
+
+	for (f = 0; f < ARRAY_SIZE(metrics_counters); f++) {
+		family = &metrics_counters[f];
+		xio_metrics_family_hdr(buf, family->name, "counter",
+				       family->unit, family->help);
+		for (i = 0, snap = snaps; i < nr; i++, snap++) {
+			if (family->cycles)
+				xio_metrics_printf(buf,
+					"%s_total{ctx=\"%u\"} %.9f\n",
+					family->name, snap->id,
+					xio_metrics_seconds(
+					    snap->counter[family->counter],
+					    snap->hertz));
+			else
+				xio_metrics_printf(buf,
+					"%s_total{ctx=\"%u\"} %" PRIu64 "\n",
+					family->name, snap->id,
+					snap->counter[family->counter]);
+		}
+	}
+
+	xio_metrics_family_hdr(buf, "xio_user_counter", "counter", NULL,
+			       "counters added by xio_add_counter");
+	for (i = 0, snap = snaps; i < nr; i++, snap++) {
+		for (c = XIO_STAT_USER_FIRST; c < XIO_STAT_LAST; c++) {
+			if (!snap->name[c][0])
+				continue;
+			xio_metrics_escape(name, snap->name[c], sizeof(name));
+			xio_metrics_printf(buf, "xio_user_counter_total" \
+					   "{ctx=\"%u\",name=\"%s\"} %" PRIu64
+					   "\n", snap->id, name,
+					   snap->counter[c]);
+		}
+	}
+}
+
+/*---------------------------------------------------------------------------*/
+/* xio_metrics_format_latency						     */
+/*---------------------------------------------------------------------------*/
+static void xio_metrics_format_latency(struct xio_metrics_buf *buf,
+				       const struct xio_metrics_snap *snaps,
+				       int nr)
+{
+	const struct xio_metrics_snap	*snap;
+	const struct xio_histogram	*hist;
+	uint64_t			cum[XIO_METRICS_LE_NR];
+	unsigned int			j;
+	int				i, t;
+
+	xio_metrics_family_hdr(buf, "xio_latency_seconds", "histogram",
+			       "seconds", "message latencies, rtt from " \
+			       "send to response, app from delivery to " \
+			       "response, queue from send to the wire");
+	for (i = 0, snap = snaps; i < nr; i++, snap++) {
+		for (t = 0; t < XIO_LATENCY_LAST; t++) {
+			hist = &snap->latency[t];
+			xio_hist_fold(hist, snap->hertz, metrics_le_nsec,
+				      XIO_METRICS_LE_NR, cum);
+			for (j = 0; j < XIO_METRICS_LE_NR; j++)
+				xio_metrics_printf(buf,
+					"xio_latency_seconds_bucket{" \
+					"ctx=\"%u\",type=\"%s\",le=\"%g\"} %"
+					PRIu64 "\n", snap->id,
+					metrics_latency_type[t],
+					metrics_le_nsec[j] / 1e9, cum[j]);
+			xio_metrics_printf(buf,
+				"xio_latency_seconds_bucket{ctx=\"%u\"," \
+				"type=\"%s\",le=\"+Inf\"} %" PRIu64 "\n",
+				snap->id, metrics_latency_type[t],
+				hist->count);
+			xio_metrics_printf(buf,
+				"xio_latency_seconds_count{ctx=\"%u\"," \
+				"type=\"%s\"} %" PRIu64 "\n",
+				snap->id, metrics_latency_type[t],
+				hist->count);
+			xio_metrics_printf(buf,
+				"xio_latency_seconds_sum{ctx=\"%u\"," \
+				"type=\"%s\"} %.9f\n",
+				snap->id, metrics_latency_type[t],
+				xio_metrics_seconds(hist->sum, snap->hertz));
+		}
+	}
+}
+
+/*---------------------------------------------------------------------------*/
+/* xio_metrics_conn_labels						     */
+/*---------------------------------------------------------------------------*/
+static void xio_metrics_conn_labels(char *labels, size_t len,
+				    const struct xio_metrics_snap *snap,
+				    const struct xio_metrics_conn *mconn)
+{
+	char uri[2 * XIO_METRICS_URI_LEN];
+
+	xio_metrics_escape(uri, mconn->uri, sizeof(uri));
+	snprintf(labels, len, "ctx=\"%u\",session=\"%s\",conn=\"%" PRIx64
+		 "\"", snap->id, uri, mconn->id);
+}
+
+/*---------------------------------------------------------------------------*/
+/* xio_metrics_format_conns						     */
+/*---------------------------------------------------------------------------*/
+static void xio_metrics_format_conns(struct xio_metrics_buf *buf,
+				     const struct xio_metrics_snap *snaps,
+				     int nr)
+{
+	static const char * const	gauge[][3] = {
+		{"xio_connection_txq_messages", NULL,
+		 "messages queued for transmission"},
+		{"xio_connection_txq_bytes", "bytes",
+		 "bytes queued for transmission"},
+		{"xio_connection_in_flight_requests", NULL,
+		 "requests sent and not yet answered"},
+	};
+	const struct xio_metrics_snap	*snap;
+	const struct xio_metrics_conn	*mconn;
+	char				labels[3 * XIO_METRICS_URI_LEN];
+	uint64_t			val;
+	unsigned int			g, k;
+	int				i;
+
+	xio_metrics_family_hdr(buf, "xio_context_connections", "gauge",
+			       NULL, "connections on the context, the " \
+			       "first 64 are described");
+	for (i = 0, snap = snaps; i < nr; i++, snap++)
+		xio_metrics_printf(buf,
+				   "xio_context_connections{ctx=\"%u\"} %u\n",
+				   snap->id, snap->nr_conns);
+
+	for (g = 0; g < ARRAY_SIZE(gauge); g++) {
+		xio_metrics_family_hdr(buf, gauge[g][0], "gauge",
+				       gauge[g][1], gauge[g][2]);
+		for (i = 0, snap = snaps; i < nr; i++, snap++) {
+			for (k = 0; k < snap->nr_published; k++) {
+				mconn = &snap->conn[k];
+				val = (g == 0) ? mconn->txq_msgs :
+				      (g == 1) ? mconn->txq_bytes :
+						 mconn->in_flight;
+				xio_metrics_conn_labels(labels, sizeof(labels),
+							snap, mconn);
+				xio_metrics_printf(buf, "%s{%s} %" PRIu64 "\n",
+						   gauge[g][0], labels, val);
+			}
+		}
+	}
+}
+
+/*---------------------------------------------------------------------------*/
+/* xio_metrics_format_transport						     */
+/*---------------------------------------------------------------------------*/
+static void xio_metrics_format_transport(struct xio_metrics_buf *buf,
+					 const struct xio_metrics_snap *snaps,
+					 int nr)
+{
+	static const char * const	gauge[][2] = {
+		{"xio_transport_tx_ready", "tasks ready and not yet posted"},
+		{"xio_transport_reqs_in_flight",
+		 "requests posted and not yet completed"},
+		{"xio_transport_rsps_in_flight",
+		 "responses posted and not yet completed"},
+		{"xio_transport_sqe_avail", "free send queue elements"},
+		{"xio_transport_rqe_avail", "free receive queue elements"},
+		{"xio_transport_cqe_avail",
+		 "free elements of the completion queue shared by the " \
+		 "context's connections"},
+		{"xio_transport_peer_credits", "sends the peer can receive"},
+	};
+	const struct xio_metrics_snap	*snap;
+	const struct xio_metrics_conn	*mconn;
+	const struct xio_transport_stats *st;
+	char				labels[3 * XIO_METRICS_URI_LEN];
+	char				name[64];
+	unsigned int			k;
+	int				i, g, avg;
+
+	for (g = 0; g < XIO_TRANSPORT_GAUGE_LAST; g++) {
+		for (avg = 0; avg < 2; avg++) {
+			snprintf(name, sizeof(name), "%s%s", gauge[g][0],
+				 avg ? "_avg" : "");
+			xio_metrics_printf(buf, "# TYPE %s gauge\n" \
+					   "# HELP %s %s%s\n", name, name,
+					   avg ? "time weighted mean, " : "",
+					   gauge[g][1]);
+			for (i = 0, snap = snaps; i < nr; i++, snap++) {
+				for (k = 0; k < snap->nr_published; k++) {
+					mconn = &snap->conn[k];
+					if (!mconn->has_transport)
+						continue;
+					st = &mconn->transport;
+					xio_metrics_conn_labels(
+						labels, sizeof(labels),
+						snap, mconn);
+					if (avg)
+						xio_metrics_printf(buf,
+							"%s{%s} %.3f\n", name,
+							labels,
+							st->avg_milli[g] /
+							1000.0);
+					else
+						xio_metrics_printf(buf,
+							"%s{%s} %u\n", name,
+							labels, st->gauge[g]);
+				}
+			}
+		}
+	}
+
+	for (g = 0; g < 2; g++) {
+		snprintf(name, sizeof(name), "xio_transport_%s_stalls",
+			 g ? "credit" : "window");
+		xio_metrics_family_hdr(buf, name, "counter", NULL,
+				       g ? "window stalls with no peer " \
+				       "credits left" :
+				       "transmissions that found no send " \
+				       "window");
+		for (i = 0, snap = snaps; i < nr; i++, snap++) {
+			for (k = 0; k < snap->nr_published; k++) {
+				mconn = &snap->conn[k];
+				if (!mconn->has_transport)
+					continue;
+				st = &mconn->transport;
+				xio_metrics_conn_labels(labels, sizeof(labels),
+							snap, mconn);
+				xio_metrics_printf(buf,
+					"%s_total{%s} %" PRIu64 "\n", name,
+					labels, g ? st->credit_stalls :
+						    st->window_stalls);
+			}
+		}
+	}
+}
+
+/*---------------------------------------------------------------------------*/
+/* xio_metrics_format_mempools						     */
+/*---------------------------------------------------------------------------*/
+static void xio_metrics_format_mempools(struct xio_metrics_buf *buf)
+{
+	static const char * const	gauge[][2] = {
+		{"xio_mempool_used_blocks", "registered blocks handed out"},
+		{"xio_mempool_allocated_blocks",
+		 "registered blocks in the pool"},
+		{"xio_mempool_max_blocks", "blocks the pool may grow to"},
+	};
+	struct xio_rdma_mempool_usage	usage[XIO_MEM_SLOTS_NR];
+	unsigned int			g;
+	int				node, i, ret, val;
+
+	for (g = 0; g < ARRAY_SIZE(gauge); g++) {
+		xio_metrics_family_hdr(buf, gauge[g][0], "gauge", NULL,
+				       gauge[g][1]);
+		for (node = 0; ; node++) {
+			ret = xio_rdma_mempool_node_usage(node, usage);
+			if (ret < 0)
+				break;
+			if (ret > 0)
+				continue;
+			for (i = 0; i < XIO_MEM_SLOTS_NR; i++) {
+				val = (g == 0) ? usage[i].used_mb_nr :
+				      (g == 1) ? usage[i].curr_mb_nr :
+						 usage[i].max_mb_nr;
+				xio_metrics_printf(buf,
+					"%s{node=\"%d\",block_size=\"%zu\"}" \
+					" %d\n", gauge[g][0], node,
+					usage[i].mb_size, val);
+			}
+		}
+	}
+}
+
+/*---------------------------------------------------------------------------*/
+/* xio_metrics_send							     */
+/*---------------------------------------------------------------------------*/
+static int xio_metrics_send(int fd, const char *data, size_t len)
+{
+	ssize_t n;
+
+	while (len) {
+		n = send(fd, data, len, MSG_NOSIGNAL);
+		if (n < 0) {
+			if (errno == EINTR)
+				continue;
+			return -1;
+		}
+		data += n;
+		len -= n;
+	}
+
+	return 0;
+}
+
+/*---------------------------------------------------------------------------*/
+/* xio_metrics_serve - answer one scrape				     */
+/*---------------------------------------------------------------------------*/
+static void xio_metrics_serve(int fd, struct xio_metrics_buf *buf,
+			      struct xio_metrics_snap **snaps, int *max)
+{
+	struct timeval	tv = { .tv_sec = XIO_METRICS_SEND_SEC };
+	struct pollfd	pfd = { .fd = fd, .events = POLLIN };
+	char		req[1024];
+	char		hdr[192];
+	size_t		got = 0;
+	ssize_t		n;
+	int		nr, len;
+
+	setsockopt(fd, SOL_SOCKET, SO_SNDTIMEO, &tv, sizeof(tv));
+
+	/* an HTTP request up to its blank line, or nothing at all */
+	while (got < sizeof(req) - 1) {
+		if (poll(&pfd, 1, XIO_METRICS_REQ_MSEC) <= 0)
+			break;
+		n = recv(fd, req + got, sizeof(req) - 1 - got, 0);
+		if (n <= 0)
+			break;
+		got += n;
+		req[got] = 0;
+		if (strstr(req, "\r\n\r\n"))
+			break;
+	}
+	if (got && strncmp(req, "GET ", 4)) {
+		len = snprintf(hdr, sizeof(hdr),
+			       "HTTP/1.0 405 Method Not Allowed\r\n" \
+			       "Allow: GET\r\nContent-Length: 0\r\n" \
+			       "Connection: close\r\n\r\n");
+		xio_metrics_send(fd, hdr, len);
+		return;
+	}
+
+	nr = xio_metrics_collect(snaps, max);
+
+	buf->len = 0;
+	buf->data[0] = 0;
+	xio_metrics_format_contexts(buf, *snaps, nr);
+	xio_metrics_format_latency(buf, *snaps, nr);
+	xio_metrics_format_conns(buf, *snaps, nr);
+	xio_metrics_format_transport(buf, *snaps, nr);
+	xio_metrics_format_mempools(buf);
+	xio_metrics_printf(buf, "# EOF\n");
+
+	if (got) {
+		len = snprintf(hdr, sizeof(hdr),
+			       "HTTP/1.0 200 OK\r\nContent-Type: " \
+			       "application/openmetrics-text; " \
+			       "version=1.0.0; charset=utf-8\r\n" \
+			       "Content-Length: %zu\r\n" \
+			       "Connection: close\r\n\r\n", buf->len);
+		if (xio_metrics_send(fd, hdr, len))
+			return;
+	}
+	xio_metrics_send(fd, buf->data, buf->len);
+}
+
+/*---------------------------------------------------------------------------*/
+/* xio_metrics_thread_cb						     */
+/*---------------------------------------------------------------------------*/
+static void *xio_metrics_thread_cb(void *data)
+{
+	struct xio_metrics_buf	buf;
+	struct xio_metrics_snap	*snaps = NULL;
+	struct pollfd		pfd = { .fd = metrics_fd, .events = POLLIN };
+	int			max = 0;
+	int			fd;
+
+	buf.len		= 0;
+	buf.size	= XIO_METRICS_BUF_SIZE;
+	buf.data	= malloc(buf.size);
+	if (!buf.data) {
+		ERROR_LOG("metrics exporter out of memory\n");
+		return NULL;
+	}
+
+	while (ACCESS_ONCE(metrics_running)) {
+		if (poll(&pfd, 1, XIO_METRICS_POLL_MSEC) <= 0)
+			continue;
+		fd = accept4(metrics_fd, NULL, NULL, SOCK_CLOEXEC);
+		if (fd < 0)
+			continue;
+		xio_metrics_serve(fd, &buf, &snaps, &max);
+		close(fd);
+	}
+	free(snaps);
+	free(buf.data);
+
+	return NULL;
+}
+
+/*---------------------------------------------------------------------------*/
+/* xio_metrics_listen_unix						     */
+/*---------------------------------------------------------------------------*/
+static int xio_metrics_listen_unix(const char *path)
+{
+	struct sockaddr_un	sa;
+	struct stat		st;
+	int			fd;
+
+	if (!*path || strlen(path) >= sizeof(sa.sun_path)) {
+		xio_set_error(EINVAL);
+		ERROR_LOG("bad metrics socket path \"%s\"\n", path);
+		return -1;
+	}
+	memset(&sa, 0, sizeof(sa));
+	sa.sun_family = AF_UNIX;
+	strcpy(sa.sun_path, path);
+
+	fd = socket(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0);
+	if (fd < 0) {
+		xio_set_error(errno);
+		ERROR_LOG("socket failed. %m\n");
+		return -1;
+	}
+	/* left behind by a process that did not exit cleanly */
+	if (!stat(path, &st) && S_ISSOCK(st.st_mode))
+		unlink(path);
+	if (bind(fd, (struct sockaddr *)&sa, sizeof(sa))) {
+		xio_set_error(errno);
+		ERROR_LOG("bind %s failed. %m\n", path);
+		close(fd);
+		return -1;
+	}
+
+	return fd;
+}
+
+/*---------------------------------------------------------------------------*/
+/* xio_metrics_listen_tcp						     */
+/*---------------------------------------------------------------------------*/
+static int xio_metrics_listen_tcp(const char *addr)
+{
+	struct addrinfo		hints, *res;
+	char			host[sizeof(metrics_attr.addr)];
+	char			*port, *end;
+	int			fd, ret, on = 1;
+
+	strcpy(host, addr);
+	port = strrchr(host, ':');
+	if (port) {
+		*port++ = 0;
+	} else {
+		port = (char *)addr;
+		strcpy(host, "127.0.0.1");
+	}
+	if (host[0] == '[') {
+		end = strchr(host, ']');
+		if (end)
+			*end = 0;
+		memmove(host, host + 1, strlen(host));
+	}
+
+	memset(&hints, 0, sizeof(hints));
+	hints.ai_flags		= AI_PASSIVE | AI_NUMERICSERV;
+	hints.ai_socktype	= SOCK_STREAM;
+	ret = getaddrinfo(host, port, &hints, &res);
+	if (ret) {
+		xio_set_error(EINVAL);
+		ERROR_LOG("metrics address tcp:%s. %s\n", addr,
+			  gai_strerror(ret));
+		return -1;
+	}
+
+	fd = socket(res->ai_family, SOCK_STREAM | SOCK_CLOEXEC, 0);
+	if (fd < 0) {
+		xio_set_error(errno);
+		ERROR_LOG("socket failed. %m\n");
+		goto cleanup;
+	}
+	setsockopt(fd, SOL_SOCKET, SO_REUSEADDR, &on, sizeof(on));
+	if (bind(fd, res->ai_addr, res->ai_addrlen)) {
+		xio_set_error(errno);
+		ERROR_LOG("bind tcp:%s failed. %m\n", addr);
+		close(fd);
+		fd = -1;
+	}
+
+cleanup:
+	freeaddrinfo(res);
+	return fd;
+}
+
+/*---------------------------------------------------------------------------*/
+/* xio_metrics_start							     */
+/*---------------------------------------------------------------------------*/
+static int xio_metrics_start(const char *addr)
+{
+	int fd;
+
+	if (!strncmp(addr, "unix:", 5)) {
+		fd = xio_metrics_listen_unix(addr + 5);
+	} else if (!strncmp(addr, "tcp:", 4)) {
+		fd = xio_metrics_listen_tcp(addr + 4);
+	} else {
+		xio_set_error(EINVAL);
+		ERROR_LOG("metrics address \"%s\" is neither unix: " \
+			  "nor tcp:\n", addr);
+		return -1;
+	}
+	if (fd < 0)
+		return -1;
+
+	if (listen(fd, 16)) {
+		xio_set_error(errno);
+		ERROR_LOG("listen failed. %m\n");
+		goto cleanup;
+	}
+
+	metrics_fd = fd;
+	metrics_running = 1;
+	if (pthread_create(&metrics_thread, NULL, xio_metrics_thread_cb,
+			   NULL)) {
+		xio_set_error(errno);
+		ERROR_LOG("metrics exporter thread creation failed. %m\n");
+		metrics_running = 0;
+		metrics_fd = -1;
+		goto cleanup;
+	}
+
+	return 0;
+
+cleanup:
+	close(fd);
+	if (!strncmp(addr, "unix:", 5))
+		unlink(addr + 5);
+	return -1;
+}
+
+/*---------------------------------------------------------------------------*/
+/* xio_metrics_stop							     */
+/*---------------------------------------------------------------------------*/
+static void xio_metrics_stop(void)
+{
+	if (!metrics_running)
+		return;
+
+	ACCESS_ONCE(metrics_running) = 0;
+	pthread_join(metrics_thread, NULL);
+	close(metrics_fd);
+	metrics_fd = -1;
+	if (!strncmp(metrics_attr.addr, "unix:", 5))
+		unlink(metrics_attr.addr + 5);
+}
+
+/*---------------------------------------------------------------------------*/
+/* xio_metrics_set_attr							     */
+/*---------------------------------------------------------------------------*/
+int xio_metrics_set_attr(const struct xio_metrics_attr *attr)
+{
+	int retval = 0;
+
+	if (!memchr(attr->addr, 0, sizeof(attr->addr))) {
+		xio_set_error(EINVAL);
+		ERROR_LOG("metrics address is not terminated\n");
+		return -1;
+	}
+
+	pthread_mutex_lock(&metrics_attr_lock);
+	xio_metrics_stop();
+
+	metrics_attr = *attr;
+	if (attr->addr[0]) {
+		retval = xio_metrics_start(attr->addr);
+		if (retval)
+			metrics_attr.addr[0] = 0;
+	}
+	pthread_mutex_unlock(&metrics_attr_lock);
+
+	return retval;
+}
+
+/*---------------------------------------------------------------------------*/
+/* xio_metrics_get_attr							     */
+/*---------------------------------------------------------------------------*/
+int xio_metrics_get_attr(struct xio_metrics_attr *attr)
+{
+	pthread_mutex_lock(&metrics_attr_lock);
+	*attr = metrics_attr;
+	pthread_mutex_unlock(&metrics_attr_lock);
+
+	return 0;
+}
+
+/*---------------------------------------------------------------------------*/
+/* xio_metrics_destructor						     */
+/*---------------------------------------------------------------------------*/
+void xio_metrics_destructor(void)
+{
+	pthread_mutex_lock(&metrics_attr_lock);
+	xio_metrics_stop();
+	metrics_attr.addr[0] = 0;
+	pthread_mutex_unlock(&metrics_attr_lock);
+}
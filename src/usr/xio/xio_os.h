@@ -59,6 +59,7 @@
 #include <assert.h>
 #include <limits.h>
 #include <sched.h>
+#include <poll.h>
 #include <sys/time.h>
 #include <sys/types.h>
 #include <sys/stat.h>
@@ -67,6 +68,7 @@
 #include <sys/shm.h>
 #include <sys/mman.h>
 #include <sys/socket.h>
+#include <sys/un.h>
 #include <sys/timerfd.h>
 #include <sys/syscall.h>
 #include <arpa/inet.h>
@@ -77,6 +79,7 @@
 #include <linux/printk.h>
 #include <linux/atomic.h>
 #include <linux/kref.h>
+#include <linux/srcu.h>
 #include <linux/usr.h>
 #include <linux/netlink.h>
 
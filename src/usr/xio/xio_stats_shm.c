@@ -0,0 +1,329 @@
+/*
+ * Copyright (c) 2013 Mellanox Technologies®. All rights reserved.
+ *
+ * This software is available to you under a choice of one of two licenses.
+ * You may choose to be licensed under the terms of the GNU General Public
+ * License (GPL) Version 2, available from the file COPYING in the main
+ * directory of this source tree, or the Mellanox Technologies® BSD license
+ * below:
+ *
+ *      - Redistribution and use in source and binary forms, with or without
+ *        modification, are permitted provided that the following conditions
+ *        are met:
+ *
+ *      - Redistributions of source code must retain the above copyright
+ *        notice, this list of conditions and the following disclaimer.
+ *
+ *      - Redistributions in binary form must reproduce the above
+ *        copyright notice, this list of conditions and the following
+ *        disclaimer in the documentation and/or other materials
+ *        provided with the distribution.
+ *
+ *      - Neither the name of the Mellanox Technologies® nor the names of its
+ *        contributors may be used to endorse or promote products derived from
+ *        this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#include "xio_os.h"
+#include "libxio.h"
+#include "xio_log.h"
+#include "xio_common.h"
+#include "xio_observer.h"
+#include "xio_context.h"
+#include "get_clock.h"
+#include "xio_stats_shm.h"
+
+/*---------------------------------------------------------------------------*/
+/* one region per process, blocks handed to contexts as they are created.   */
+/* the context thread copies its counters into its block under the block's */
+/* sequence every XIO_STATS_SHM_PERIOD_MSEC, so a reader gets counters that */
+/* belong together, e.g. TX_MSG with TX_BYTES, and the hot path stays on    */
+/* private memory							     */
+/*---------------------------------------------------------------------------*/
+#define XIO_STATS_SHM_PERIOD_MSEC	100
+#define XIO_STATS_SHM_BLOCKS		64
+#define XIO_STATS_SHM_NAME_LEN		32
+#define XIO_STATS_SHM_ALIGN(x)		(((x) + 63) & ~63UL)
+
+#define XIO_STATS_SHM_BLOCKS_OFF	\
+		XIO_STATS_SHM_ALIGN(sizeof(struct xio_stats_shm_hdr))
+#define XIO_STATS_SHM_COUNTERS_OFF	sizeof(struct xio_stats_shm_block)
+#define XIO_STATS_SHM_NAMES_OFF		\
+		(XIO_STATS_SHM_COUNTERS_OFF + XIO_STAT_LAST * sizeof(uint64_t))
+#define XIO_STATS_SHM_BLOCK_SIZE	\
+		XIO_STATS_SHM_ALIGN(XIO_STATS_SHM_NAMES_OFF +	\
+				    XIO_STAT_LAST * XIO_STATS_SHM_NAME_LEN)
+#define XIO_STATS_SHM_SIZE		\
+		(XIO_STATS_SHM_BLOCKS_OFF +			\
+		 XIO_STATS_SHM_BLOCKS * XIO_STATS_SHM_BLOCK_SIZE)
+
+static int			shm_enable;
+static struct xio_stats_shm_hdr	*shm_hdr;
+static char			shm_name[32];
+static pthread_mutex_t		shm_lock = PTHREAD_MUTEX_INITIALIZER;
+
+/*---------------------------------------------------------------------------*/
+/* xio_stats_shm_block							     */
+/*---------------------------------------------------------------------------*/
+static inline struct xio_stats_shm_block *xio_stats_shm_block(int i)
+{
+	char *base = (char *)shm_hdr + XIO_STATS_SHM_BLOCKS_OFF;
+
+	return (struct xio_stats_shm_block *)(base +
+					      i * XIO_STATS_SHM_BLOCK_SIZE);
+}
+
+static inline uint64_t *xio_stats_shm_counters(
+		struct xio_stats_shm_block *block)
+{
+	return (uint64_t *)((char *)block + XIO_STATS_SHM_COUNTERS_OFF);
+}
+
+static inline char *xio_stats_shm_names(struct xio_stats_shm_block *block)
+{
+	return (char *)block + XIO_STATS_SHM_NAMES_OFF;
+}
+
+/*---------------------------------------------------------------------------*/
+/* xio_stats_shm_write_begin - block writers hold shm_lock		     */
+/*---------------------------------------------------------------------------*/
+static inline void xio_stats_shm_write_begin(
+		struct xio_stats_shm_block *block)
+{
+	ACCESS_ONCE(block->seq) = block->seq + 1;
+	smp_wmb();
+}
+
+static inline void xio_stats_shm_write_end(struct xio_stats_shm_block *block)
+{
+	smp_wmb();
+	ACCESS_ONCE(block->seq) = block->seq + 1;
+}
+
+/*---------------------------------------------------------------------------*/
+/* xio_stats_shm_set_enable						     */
+/*---------------------------------------------------------------------------*/
+int xio_stats_shm_set_enable(int enable)
+{
+	shm_enable = !!enable;
+
+	return 0;
+}
+
+/*---------------------------------------------------------------------------*/
+/* xio_stats_shm_get_enable						     */
+/*---------------------------------------------------------------------------*/
+int xio_stats_shm_get_enable(int *enable)
+{
+	*enable = shm_enable;
+
+	return 0;
+}
+
+/*---------------------------------------------------------------------------*/
+/* xio_stats_shm_map							     */
+/*---------------------------------------------------------------------------*/
+static int xio_stats_shm_map(uint64_t hertz)
+{
+	struct xio_stats_shm_hdr	*hdr;
+	int				fd;
+
+	snprintf(shm_name, sizeof(shm_name), XIO_STATS_SHM_NAME, getpid());
+	fd = shm_open(shm_name, O_CREAT | O_TRUNC | O_RDWR | O_CLOEXEC,
+		      S_IRUSR | S_IWUSR);
+	if (fd < 0) {
+		xio_set_error(errno);
+		ERROR_LOG("shm_open %s failed. %m\n", shm_name);
+		return -1;
+	}
+	if (ftruncate(fd, XIO_STATS_SHM_SIZE)) {
+		xio_set_error(errno);
+		ERROR_LOG("ftruncate failed. %m\n");
+		goto cleanup;
+	}
+	hdr = mmap(NULL, XIO_STATS_SHM_SIZE, PROT_READ | PROT_WRITE,
+		   MAP_SHARED, fd, 0);
+	if (hdr == MAP_FAILED) {
+		xio_set_error(errno);
+		ERROR_LOG("mmap failed. %m\n");
+		goto cleanup;
+	}
+	close(fd);
+
+	/* the blocks come zeroed from ftruncate. a reader that sees the
+	 * magic sees the whole header
+	 */
+	hdr->version		= XIO_STATS_SHM_VERSION;
+	hdr->blocks_off		= XIO_STATS_SHM_BLOCKS_OFF;
+	hdr->block_size		= XIO_STATS_SHM_BLOCK_SIZE;
+	hdr->nblocks		= XIO_STATS_SHM_BLOCKS;
+	hdr->ncounters		= XIO_STAT_LAST;
+	hdr->counters_off	= XIO_STATS_SHM_COUNTERS_OFF;
+	hdr->name_len		= XIO_STATS_SHM_NAME_LEN;
+	hdr->names_off		= XIO_STATS_SHM_NAMES_OFF;
+	hdr->pid		= getpid();
+	hdr->hertz		= hertz;
+	smp_wmb();
+	ACCESS_ONCE(hdr->magic)	= XIO_STATS_SHM_MAGIC;
+
+	shm_hdr = hdr;
+
+	return 0;
+
+cleanup:
+	close(fd);
+	shm_unlink(shm_name);
+	return -1;
+}
+
+/*---------------------------------------------------------------------------*/
+/* xio_stats_shm_copy_names						     */
+/*---------------------------------------------------------------------------*/
+static void xio_stats_shm_copy_names(struct xio_context *ctx,
+				     struct xio_stats_shm_block *block)
+{
+	char	*name = xio_stats_shm_names(block);
+	int	i;
+
+	memset(name, 0, XIO_STAT_LAST * XIO_STATS_SHM_NAME_LEN);
+	for (i = 0; i < XIO_STAT_LAST; i++, name += XIO_STATS_SHM_NAME_LEN) {
+		if (ctx->stats.name[i])
+			strncpy(name, ctx->stats.name[i],
+				XIO_STATS_SHM_NAME_LEN - 1);
+	}
+}
+
+/*---------------------------------------------------------------------------*/
+/* xio_stats_shm_tick - on the context thread				     */
+/*---------------------------------------------------------------------------*/
+static void xio_stats_shm_tick(void *data)
+{
+	struct xio_context		*ctx = data;
+	struct xio_stats_shm_block	*block = ctx->stats.shm_block;
+
+	pthread_mutex_lock(&shm_lock);
+	xio_stats_shm_write_begin(block);
+	memcpy(xio_stats_shm_counters(block), ctx->stats.counter,
+	       XIO_STAT_LAST * sizeof(uint64_t));
+	xio_stats_shm_write_end(block);
+	pthread_mutex_unlock(&shm_lock);
+
+	xio_ctx_timer_add(ctx, XIO_STATS_SHM_PERIOD_MSEC, ctx,
+			  xio_stats_shm_tick, &ctx->stats.shm_timer);
+}
+
+/*---------------------------------------------------------------------------*/
+/* xio_stats_shm_attach							     */
+/*---------------------------------------------------------------------------*/
+void xio_stats_shm_attach(struct xio_context *ctx)
+{
+	struct xio_stats_shm_block	*block = NULL;
+	int				i;
+
+	if (!shm_enable)
+		return;
+
+	pthread_mutex_lock(&shm_lock);
+	if (!shm_hdr && xio_stats_shm_map(ctx->stats.hertz))
+		goto unlock;
+
+	for (i = 0; i < XIO_STATS_SHM_BLOCKS; i++) {
+		block = xio_stats_shm_block(i);
+		if (!block->in_use)
+			break;
+	}
+	if (i == XIO_STATS_SHM_BLOCKS) {
+		WARN_LOG("no statistics block left. context %p not " \
+			 "exported\n", ctx);
+		goto unlock;
+	}
+
+	xio_stats_shm_write_begin(block);
+	block->in_use	= 1;
+	block->tid	= syscall(SYS_gettid);
+	block->cpu	= ctx->cpuid;
+	block->start	= get_cycles();
+	memcpy(xio_stats_shm_counters(block), ctx->stats.counter,
+	       XIO_STAT_LAST * sizeof(uint64_t));
+	xio_stats_shm_copy_names(ctx, block);
+	xio_stats_shm_write_end(block);
+
+	ctx->stats.shm_block	= block;
+	pthread_mutex_unlock(&shm_lock);
+
+	xio_ctx_timer_add(ctx, XIO_STATS_SHM_PERIOD_MSEC, ctx,
+			  xio_stats_shm_tick, &ctx->stats.shm_timer);
+	return;
+
+unlock:
+	pthread_mutex_unlock(&shm_lock);
+}
+
+/*---------------------------------------------------------------------------*/
+/* xio_stats_shm_detach							     */
+/*---------------------------------------------------------------------------*/
+void xio_stats_shm_detach(struct xio_context *ctx)
+{
+	struct xio_stats_shm_block	*block = ctx->stats.shm_block;
+
+	if (!block)
+		return;
+
+	if (ctx->stats.shm_timer) {
+		xio_ctx_timer_del(ctx, ctx->stats.shm_timer);
+		ctx->stats.shm_timer = NULL;
+	}
+	ctx->stats.shm_block	= NULL;
+
+	pthread_mutex_lock(&shm_lock);
+	xio_stats_shm_write_begin(block);
+	block->in_use = 0;
+	memset(xio_stats_shm_counters(block), 0,
+	       XIO_STAT_LAST * sizeof(uint64_t));
+	memset(xio_stats_shm_names(block), 0,
+	       XIO_STAT_LAST * XIO_STATS_SHM_NAME_LEN);
+	xio_stats_shm_write_end(block);
+	pthread_mutex_unlock(&shm_lock);
+}
+
+/*---------------------------------------------------------------------------*/
+/* xio_stats_shm_update_names						     */
+/*---------------------------------------------------------------------------*/
+void xio_stats_shm_update_names(struct xio_context *ctx)
+{
+	struct xio_stats_shm_block	*block = ctx->stats.shm_block;
+
+	if (!block)
+		return;
+
+	pthread_mutex_lock(&shm_lock);
+	xio_stats_shm_write_begin(block);
+	xio_stats_shm_copy_names(ctx, block);
+	xio_stats_shm_write_end(block);
+	pthread_mutex_unlock(&shm_lock);
+}
+
+/*---------------------------------------------------------------------------*/
+/* xio_stats_shm_destructor						     */
+/*---------------------------------------------------------------------------*/
+void xio_stats_shm_destructor(void)
+{
+	/* contexts still alive keep counting into the mapping, only the
+	 * name goes away
+	 */
+	pthread_mutex_lock(&shm_lock);
+	if (shm_hdr)
+		shm_unlink(shm_name);
+	pthread_mutex_unlock(&shm_lock);
+}
@@ -88,6 +88,7 @@ struct xio_tasks_pool *xio_tasks_pool_init(int max, int pool_dd_data_sz,
 		q->array[i]->pool	= (void *)q;
 		q->array[i]->dd_data	= ((char *)data) +
 						sizeof(struct xio_task);
+		INIT_LIST_HEAD(&q->array[i]->io_tasks_htbl_entry);
 		list_add_tail(&q->array[i]->tasks_list_entry, &q->stack);
 		data = ((char *)data) + sizeof(struct xio_task) +
 					task_dd_data_sz;